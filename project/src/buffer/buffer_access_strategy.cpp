@@ -0,0 +1,30 @@
+/**
+ * buffer_access_strategy.cpp
+ */
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+// bpm takes its own latch_ then ours, never hold ours while calling in
+BufferAccessStrategy::~BufferAccessStrategy() {
+  std::vector<BufferPoolManager *> bpms;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (auto &ring : rings_) {
+      bpms.push_back(ring.first);
+    }
+  }
+  for (auto bpm : bpms) {
+    bpm->ReleaseStrategy(this);
+  }
+}
+
+// references into unordered_map survive rehash
+BufferAccessStrategy::Ring &
+BufferAccessStrategy::GetRing(BufferPoolManager *bpm) {
+  std::lock_guard<std::mutex> guard(latch_);
+  return rings_[bpm];
+}
+
+} // namespace cmudb
@@ -2,10 +2,43 @@
  * buffer_pool_manager.cpp
  *
  */
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sys/mman.h>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "common/metrics.h"
 
 namespace cmudb {
 
+// process wide, all pools add up (see common/metrics.h)
+static MetricCounter *fetch_hits =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.fetch_hits");
+static MetricCounter *fetch_misses =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.fetch_misses");
+static MetricCounter *no_free_frame =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.no_free_frame");
+static MetricCounter *pin_waits =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.pin_waits");
+static MetricCounter *clean_evictions =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.evictions_clean");
+static MetricCounter *dirty_evictions =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.evictions_dirty");
+static MetricCounter *dirty_writes =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.dirty_writes");
+static MetricCounter *flush_runs =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.flush_runs");
+static MetricCounter *prefetch_reads =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.prefetch_reads");
+static MetricCounter *failed_reads =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.failed_reads");
+static MetricHistogram *miss_latency =
+    MetricsRegistry::Instance().GetHistogram("buffer_pool.miss_us");
+static MetricHistogram *pin_wait_latency =
+    MetricsRegistry::Instance().GetHistogram("buffer_pool.pin_wait_us");
+
 /*
  * Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
@@ -14,20 +47,52 @@ namespace cmudb {
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                      DiskManager *disk_manager,
-                                     LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+                                     LogManager *log_manager,
+                                     ReplacerType replacer_type)
+    : pool_size_(pool_size), page_size_(disk_manager->GetPageSize()),
+      disk_manager_(disk_manager), log_manager_(log_manager) {
   
 
   // new/malloc/ptr == 1 global var, shared by many
   // a consecutive memory space for buffer pool
   pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-  replacer_ = new LRUReplacer<Page *>;
+  // page size only known at runtime == frames' content in 1 arena. mmap'ed
+  // == page aligned, so every frame is O_DIRECT aligned; big pools on
+  // huge pages (fewer TLB misses), best effort
+  page_data_size_ = pool_size_ * page_size_;
+  page_data_ = nullptr; // 0 frames (parallel bpm's own base) == no arena
+  if(page_data_size_ > 0){
+    void *arena = mmap(nullptr, page_data_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(arena == MAP_FAILED){
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if(page_data_size_ >= HUGE_PAGE_SIZE){
+      madvise(arena, page_data_size_, MADV_HUGEPAGE);
+    }
+#endif
+    page_data_ = static_cast<char *>(arena);
+  }
+  // never more entries than frames
+  page_table_ = new LockFreeHashTable<page_id_t, Page *>(pool_size_);
+  if (replacer_type == ReplacerType::CLOCK) {
+    // frame index == offset into pages_
+    replacer_ = new ClockReplacer<Page *>(
+        pool_size_, [this](Page *const &page) { return page - pages_; });
+  } else if (replacer_type == ReplacerType::LRU_K) {
+    replacer_ = new LRUKReplacer<Page *>(
+        LRUK_REPLACER_K, LRUK_CORRELATED_PERIOD, LRUK_RETAINED_PERIOD);
+  } else {
+    replacer_ = new LRUReplacer<Page *>;
+  }
   free_list_ = new std::list<Page *>;
 
-  // put all the pages into free list
+  // put all the pages into free list. arena comes zeroed n stays untouched
+  // (no memory committed) until a frame is used
   for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].data_ = page_data_ + i * page_size_;
+    pages_[i].page_size_ = page_size_;
     free_list_->push_back(&pages_[i]);
   }
 }
@@ -37,7 +102,24 @@ BufferPoolManager::BufferPoolManager(size_t pool_size,
  * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
+  StopPageCleaner();
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_all();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
+  {
+    // in-flight reads finish into their frames
+    std::unique_lock<std::mutex> lock(latch_);
+    prefetch_cv_.wait(lock, [this] { return prefetch_in_flight_ == 0; });
+  }
   delete[] pages_;
+  if(page_data_ != nullptr){
+    munmap(page_data_, page_data_size_);
+  }
   delete page_table_;
   delete replacer_;
   delete free_list_;
@@ -61,71 +143,84 @@ BufferPoolManager::~BufferPoolManager() {
  * NOTE: once fetched, and before unpin(), page being used so not on LRU queue
  * HINT: see venn diagram of pages in RAM in free list vs page table vs lru
  * meta == 5 structs == page, lru, pagetable, free list, disk manager 
+ * 
+ * strategy: miss takes a frame from the scan's private ring instead of
+ * evicting from the shared lru (see buffer_access_strategy.h)
+ * 
+ * hit on a page still being read (read-ahead / another miss) == wait for it
+ * 
+ * hit on a page pinned by someone else == no latch_ at all (TryPinPage)
+ * 
+ * read fails (checksum mismatch / no tablespace) == nullptr, for whoever
+ * waited on it too. never cached, the next fetch reads it again
  */
-Page *BufferPoolManager::FetchPage(page_id_t page_id) { 
-
+Page *BufferPoolManager::FetchPage(page_id_t page_id,
+                                   BufferAccessStrategy *strategy) { 
   // 0. see if requested page in RAM
-  Page *page = page_table_.Find(page_id);
-
-  // 1. if exist, pin page, u() meta, return immediately
-  if(page != nullptr){    
-    ++page->pin_count_;
-    lru_replacer_->Erase(page);
+  Page *page = nullptr;
+  if(page_table_->Find(page_id, page) && TryPinPage(page, page_id)){
+    fetch_hits->Add();
     return page;
+  }
 
+  std::unique_lock<std::mutex> lock(latch_);
 
-  // 2. if not, then find a vacant spot in RAM, then read target page from disk into vacant page
-  } else {
-    
-    // 2.1 free list page 
-    if(!free_list_->empty()){ // vacant spot from free list
-      page = free_list_->front();
-      free_list_->pop_front();
-
-
-
-    // 2.2 lru to FIFO swap existing page to disk
-    }else{ // vacant spot from kicking victim page back to disk
-      if(!lru_replacer_->Victim(page)){ // empty page -> victim page 
-        return nullptr; // NO ANY vacant spot in RAM !!!!!
-      }
-
-      // 2.1.1 if lru page is dirty (diff from disk), then flush to u() disk
-      if(page->is_dirty_){
-        page_id_t dirty_page_id = page->page_id_;
-        char *dirty_page_data = page->GetData();
-
-                
-        if(ENABLE_LOGGING){
-          // dirty page is recored in WAL already 
-          // WAL must flush before dirty page !!!!
-          
-          // 1. block unti WAL flushed 
-          log_manager_->ForceFlushWAL();
-
-          // 2. init DPT oldestLSN for fetched page 
-
+  // 1. if exist, pin page, u() meta, return immediately
+  if(page_table_->Find(page_id, page)){
+    fetch_hits->Add();
+    if(page->pin_count_++ == 0){
+      SetPinLSN(page);
+    }
+    replacer_->Erase(page);
+    if(page->loading_){
+      pin_waits->Add();
+      MetricTimer timer(pin_wait_latency);
+      loaded_cv_.wait(lock, [page] { return !page->loading_; }); // pinned, stays
+      if(page->page_id_ != page_id){
+        // its read failed, see DropFailedRead
+        if(--page->pin_count_ == 0){
+          MakeEvictable(page, nullptr);
         }
-
-        disk_manager_->WritePage(dirty_page_id, dirty_page_data);
+        return nullptr;
       }
-
-      // 2.2 u() meta of the deleted page 
-      lru_replacer_->Erase(page);
-      page_table_->Remove(page);
-
     }
-    
-    // 2.3 r() target page from disk + u() meta of the new page 
-    disk_manager_->ReadPage(page_id, page); // fills page->data
-    page->pin_count_ = 1;
-    page->is_dirty_ = false;
-    page->page_id_ = page_id;
-    page_table_->Insert(page_id, page);
-
     return page;
   }
 
+  // 2. if not, then find a vacant spot in RAM, then read target page from disk into vacant page
+  fetch_misses->Add();
+  MetricTimer timer(miss_latency);
+  page = strategy != nullptr ? GetRingPage(strategy) : GetVictimPage();
+  if(page == nullptr){
+    no_free_frame->Add();
+    return nullptr; // NO ANY vacant spot in RAM !!!!!
+  }
+
+  // 2.3 r() target page from disk + u() meta of the new page 
+  // frame switches pages under its latch == optimistic readers notice.
+  // read w/o latch_, like read-ahead: loading_ + pinned + in page table ==
+  // fetchers of this page wait for it, everyone else carries on
+  page->WLatch();
+  page->rec_lsn_ = INVALID_LSN;
+  page->is_dirty_ = false;
+  SetPinLSN(page);
+  // id n loading_ before the pin, see TryPinPage
+  page->page_id_.store(page_id, std::memory_order_release);
+  page->loading_.store(true, std::memory_order_release);
+  page->pin_count_.store(1, std::memory_order_release);
+  page_table_->Insert(page_id, page);
+  lock.unlock();
+  bool read = disk_manager_->ReadPage(page_id, page->GetData()); // fills page->data
+  page->WUnlatch();
+  lock.lock();
+  if(!read){
+    DropFailedRead(page, page_id);
+    return nullptr;
+  }
+  page->loading_.store(false, std::memory_order_release); // data read 1st
+  loaded_cv_.notify_all();
+
+  return page;
 }
 
 
@@ -139,41 +234,27 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
  * into page table. return nullptr if all the pages in pool are pinned
  * 
  */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) { 
-  
-  
-  // 1. find a vacant spot in RAM
-  Page *empty_page = nullptr;
-  // 1.1 alway try free list first, if not then lru to FIFO swap existing page to disk
-  if(!free_list_->empty()){ // vacant spot from free list
-    empty_page = free_list_->front();
-    free_list_.pop_front();
-  
-  // 1.2
-  }else{ // vacant spot from kicking victim page back to disk
-    if(!lru_replacer_->Victim(empty_page)){ // empty page -> victim page 
-      return nullptr; // NO ANY vacant spot in RAM !!!!!
-    }
-
-    // 1.2.1 if lru page is dirty (diff from disk), then flush to u() disk
-    if(empty_page->is_dirty){
-      page_id_t dirty_page_id = empty_page->page_id_;
-      char *dirty_page_data = empty_page->GetData();
-      disk_manager_->WritePage(dirty_page_id, dirty_page_data);
-    }
+Page *BufferPoolManager::NewPage(page_id_t &page_id, page_id_t hint,
+                                 PageExtent *extent) { 
+  std::lock_guard<std::mutex> guard(latch_);
 
-    // 1.2.2 u() meta of the deleted page 
-    lru_replacer_->Erase(empty_page);
-    page_table_->Remove(empty_page);    
+  // 1. find a vacant spot in RAM before burning a page id on disk
+  if(free_list_->empty() && replacer_->Size() == 0){
+    no_free_frame->Add();
+    return nullptr; // NO ANY vacant spot in RAM !!!!!
   }
 
   // 2. u() meta there's a new page 
-  page_id = disk_manager_->AllocatePage(); // RAM to keep track of the used disk addr
-  empty_page->pin_count_ = 1;
-  empty_page->is_dirty = false;
-  empty_page->page_id = page_id;
-  page_table_->Insert(page_id, empty_page);
-    
+  page_id = disk_manager_->AllocatePage(hint, extent); // RAM to keep track of the used disk addr
+  if(page_id == INVALID_PAGE_ID){
+    return nullptr; // tablespace not open / full
+  }
+  Page *page = NewPageWithId(page_id);
+  if(page == nullptr){
+    // every victim was being cleaned, id back to the free space map
+    disk_manager_->DeallocatePage(page_id);
+    page_id = INVALID_PAGE_ID;
+  }
   return page;
 }
 
@@ -199,23 +280,33 @@ Page *BufferPoolManager::NewPage(page_id_t &page_id) {
  * 3. if pin_count > 0, decrement it, put page to LRU when pin_count is 0 
  * 4. to set page dirty if user changed the page after fetch()  
  * 
- *
+ * ring frame unpinned by its own scan stays private (not in LRU),
+ * unpinned by anyone else == promoted to shared pool
+ * 
+ * not the last pin == no LRU change, no latch_ (TryUnpinPage)
  */
-bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-  
-  
-  Page *page = page_table_->Find(page_id, page);
-  if (page == nullptr){
+bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty,
+                                  BufferAccessStrategy *strategy) {
+  Page *page = nullptr;
+  if(page_table_->Find(page_id, page) &&
+     TryUnpinPage(page, page_id, is_dirty)){
+    return true;
+  }
+
+  std::lock_guard<std::mutex> guard(latch_);
+
+  if (!page_table_->Find(page_id, page)){
     return false; // page MUST be in RAM for it to have pin_count
   }
   if (page->pin_count_ <= 0){
     return false;
   }
   if(--page->pin_count_ == 0){
-    lru_replacer->Insert(page);
+    MakeEvictable(page, strategy);
   }
   if(is_dirty){
-    page->is_dirty = true;
+    SetRecLSN(page);
+    page->is_dirty_ = true;
   }
   
   return true;
@@ -227,12 +318,21 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
  * page_id -> page -> flush() to disk 
  */
 bool BufferPoolManager::FlushPage(page_id_t page_id) { 
-  
-  Page *page = page_table_->Find(page_id, page);
-  if(page == nullptr){
+  std::lock_guard<std::mutex> guard(latch_);
+
+  Page *page = nullptr;
+  if(!page_table_->Find(page_id, page)){
     return false;
   }
+  if(page->loading_){
+    return true; // being read == disk copy is the content
+  }
 
+  // cleared 1st, a lock free unpin may mark it dirty again meanwhile
+  page->rec_lsn_ = INVALID_LSN;
+  if(page->is_dirty_.exchange(false)){
+    dirty_writes->Add();
+  }
   disk_manager_->WritePage(page_id, page->GetData());
   return true; 
 }
@@ -244,12 +344,13 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
  * u() 5 meta
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) { 
-  
-  Page *page = page_table_->Find(page_id, page);
-  if(page == nullptr){
+  std::lock_guard<std::mutex> guard(latch_);
+
+  Page *page = nullptr;
+  if(!page_table_->Find(page_id, page)){
     return false;
   }
-  if (page->pin_count_ > 0){
+  if (page->pin_count_ > 0 || page->cleaning_){
     return false;
   }
   
@@ -258,17 +359,809 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
 
   // delete from meta 
   page_table_->Remove(page_id);
-  lru_replacer_->Erase(page);
+  replacer_->Erase(page);
 
   // free up page slot in RAM 
-  page->is_dirty = false;
-  page->page_id = EMPTY_PAGE_ID;
+  page->strategy_ = nullptr; // a scan ring may still point at it, ring checks
+  page->rec_lsn_ = INVALID_LSN;
+  page->is_dirty_ = false;
   page->pin_count_ = 0;
-  free_list->push_back(page);
+  page->WLatch();
+  page->page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+  page->ResetMemory();
+  page->WUnlatch();
+  free_list_->push_back(page);
 
   return true; // succesefully deleted
 }
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * pin w/o latch_, only while someone else holds a pin: an unpinned frame is
+ * in lru / a scan ring, taking it out of there needs latch_.
+ * pinned frame can't be evicted, so after pinning re-check that it still
+ * holds page_id (lookup may be stale) and is read already
+ * 
+ * frame reuse: evicted == page_id_ INVALID, new page_id_ n loading_ stored
+ * (release) before pin_count_ leaves 0. a pin taken here (acquire) on the
+ * new life sees both, never the old id w loading_ already false
+ */
+bool BufferPoolManager::TryPinPage(Page *page, page_id_t page_id) {
+  int pin_count = page->pin_count_.load(std::memory_order_acquire);
+  do {
+    if(pin_count <= 0){
+      return false;
+    }
+  } while(!page->pin_count_.compare_exchange_weak(
+      pin_count, pin_count + 1, std::memory_order_acq_rel,
+      std::memory_order_acquire));
+
+  if(page->page_id_.load(std::memory_order_acquire) == page_id &&
+     !page->loading_.load(std::memory_order_acquire)){
+    return true;
+  }
+
+  // frame recycled / still being read, give the pin back
+  std::lock_guard<std::mutex> guard(latch_);
+  if(--page->pin_count_ == 0){
+    MakeEvictable(page, page->strategy_);
+  }
+  return false;
+}
+
+
+/*
+ * unpin w/o latch_ unless it's the last pin (1 -> 0 puts it in lru / ring).
+ * caller holds a pin, so the frame can't change under us
+ */
+bool BufferPoolManager::TryUnpinPage(Page *page, page_id_t page_id,
+                                     bool is_dirty) {
+  int pin_count = page->pin_count_.load(std::memory_order_acquire);
+  if(pin_count <= 1 ||
+     page->page_id_.load(std::memory_order_acquire) != page_id){
+    return false;
+  }
+  if(is_dirty){
+    SetRecLSN(page);
+    page->is_dirty_ = true; // before our pin goes
+  }
+  while(!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)){
+    if(pin_count <= 1){
+      return false; // others unpinned meanwhile, ours is the last
+    }
+  }
+  return true;
+}
+
+
+/* helpers, caller MUST hold latch_ */
+
+/*
+ * find a vacant spot in RAM for fetch() / new()
+ * 
+ * 1. free list first
+ * 2. lru to FIFO swap existing page to disk
+ * 
+ * @return: nullptr if all pages are pinned
+ */
+Page *BufferPoolManager::GetVictimPage() {
+  Page *page = nullptr;
+
+  // 1. free list page 
+  if(!free_list_->empty()){ // vacant spot from free list
+    page = free_list_->front();
+    free_list_->pop_front();
+    return page;
+  }
+
+  // 2. vacant spot from kicking victim page back to disk
+  // frame the cleaner is writing right now == cleaner frees it when done
+  do {
+    if(!replacer_->Victim(page)){ // empty page -> victim page 
+      return nullptr;
+    }
+    page->evict_after_clean_ = page->cleaning_;
+  } while(page->cleaning_);
+  EvictPage(page);
+  return page;
+}
+
+
+/*
+ * vacant spot for a seq scan miss, recycled inside the scan's own ring
+ * 
+ * 1. ring not full yet, grow it w a normal victim
+ * 2. ring full, reuse the next slot round robin if still ours + unpinned
+ * 3. slot pinned / promoted / deleted meanwhile, replace it w a normal victim
+ */
+Page *BufferPoolManager::GetRingPage(BufferAccessStrategy *strategy) {
+  BufferAccessStrategy::Ring &ring = strategy->GetRing(this);
+  Page *page = nullptr;
+
+  // 1. grow
+  if(ring.frames_.size() < strategy->ring_size_){
+    page = GetVictimPage();
+    if(page == nullptr){
+      return nullptr;
+    }
+    page->strategy_ = strategy;
+    ring.frames_.push_back(page);
+    return page;
+  }
+
+  // 2. recycle, never in lru so nobody else could have taken it
+  Page *&slot = ring.frames_[ring.next_];
+  ring.next_ = (ring.next_ + 1) % ring.frames_.size();
+  if(slot->strategy_ == strategy && slot->pin_count_ == 0){
+    if(!slot->cleaning_){
+      EvictPage(slot);
+      return slot;
+    }
+    // batched flush writing it, freed once written
+    slot->strategy_ = nullptr;
+    slot->evict_after_clean_ = true;
+  }
+
+  // 3. replace
+  page = GetVictimPage();
+  if(page == nullptr){
+    return nullptr;
+  }
+  page->strategy_ = strategy;
+  slot = page;
+  return page;
+}
+
+
+/*
+ * unpinned page back to the replacer, except a ring frame released by its
+ * own scan: stays private. anyone else == promoted to shared pool
+ * 
+ * frame whose read failed (no page, out of the page table) == free list
+ */
+void BufferPoolManager::MakeEvictable(Page *page,
+                                      BufferAccessStrategy *strategy) {
+  if(page->page_id_ == INVALID_PAGE_ID){
+    page->strategy_ = nullptr; // a scan ring may still point at it
+    free_list_->push_back(page);
+    return;
+  }
+  if(page->strategy_ == nullptr || page->strategy_ != strategy){
+    page->strategy_ = nullptr;
+    replacer_->Insert(page);
+  }
+}
+
+
+/*
+ * read of page_id into its loading_ frame failed: out of the page table,
+ * frame emptied, waiters woken. they see page_id_ changed n give their
+ * pins back, the last one frees the frame (MakeEvictable)
+ */
+void BufferPoolManager::DropFailedRead(Page *page, page_id_t page_id) {
+  failed_reads->Add();
+  page_table_->Remove(page_id);
+  page->WLatch();
+  page->page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+  page->ResetMemory();
+  page->WUnlatch();
+  page->loading_.store(false, std::memory_order_release);
+  loaded_cv_.notify_all();
+  if(--page->pin_count_ == 0){
+    MakeEvictable(page, nullptr);
+  }
+}
+
+
+/*
+ * DPT bookkeeping. a change is logged while the page is pinned, its lsn >=
+ * the next lsn when the pin began. 1st dirty unpin since the page was clean
+ * makes that its recLSN, later ones keep the older 1
+ */
+void BufferPoolManager::SetPinLSN(Page *page) {
+  page->pin_lsn_ =
+      log_manager_ != nullptr ? log_manager_->GetNextLSN() : INVALID_LSN;
+}
+
+void BufferPoolManager::SetRecLSN(Page *page) {
+  lsn_t clean = INVALID_LSN;
+  page->rec_lsn_.compare_exchange_strong(clean, page->pin_lsn_.load());
+}
+
+
+/*
+ * kick page content out of its frame, frame stays where it is
+ * 
+ * 1. if page is dirty (diff from disk), then flush to u() disk
+ * 2. u() meta of the kicked page, frame holds no page until reused ==
+ *    stale page table lookups can't mistake it for the old one
+ */
+void BufferPoolManager::EvictPage(Page *page) {
+  if(!page->is_dirty_){
+    ++clean_evictions_;
+    clean_evictions->Add();
+  } else {
+    ++dirty_evictions_;
+    dirty_evictions->Add();
+    dirty_writes->Add();
+    if(ENABLE_LOGGING && log_manager_ != nullptr){
+      // dirty page is recored in WAL already 
+      // WAL must flush before dirty page !!!!
+      log_manager_->ForceFlushWAL();
+    }
+    disk_manager_->WritePage(page->page_id_, page->GetData());
+    page->rec_lsn_ = INVALID_LSN;
+    page->is_dirty_ = false;
+  }
+  page_table_->Remove(page->page_id_);
+  page->WLatch();
+  page->page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+  page->WUnlatch();
+}
+
+
+/*
+ * scan finished: its unpinned ring frames go straight to the free list
+ * (scanned pages are not worth keeping), pinned ones are left to their
+ * current users and join the lru on their last unpin
+ */
+void BufferPoolManager::ReleaseStrategy(BufferAccessStrategy *strategy) {
+  std::lock_guard<std::mutex> guard(latch_);
+
+  // queued read-ahead would use the strategy after it is gone
+  for(auto it = prefetch_queue_.begin(); it != prefetch_queue_.end();){
+    it = it->second == strategy ? prefetch_queue_.erase(it) : std::next(it);
+  }
+
+  BufferAccessStrategy::Ring &ring = strategy->GetRing(this);
+  for(Page *page : ring.frames_){
+    if(page->strategy_ != strategy){
+      continue; // promoted / deleted / listed twice
+    }
+    page->strategy_ = nullptr;
+    if(page->pin_count_ > 0){
+      continue;
+    }
+    if(page->cleaning_){
+      page->evict_after_clean_ = true; // freed once written
+      continue;
+    }
+    EvictPage(page);
+    page->WLatch();
+    page->ResetMemory();
+    page->WUnlatch();
+    free_list_->push_back(page);
+  }
+  ring.frames_.clear();
+}
+
+
+/*
+ * frame for a page id that is already allocated on disk
+ * NewPage() allocates itself, ParallelBufferPoolManager allocates then routes
+ */
+Page *BufferPoolManager::NewPageWithId(page_id_t page_id) {
+  Page *page = GetVictimPage();
+  if(page == nullptr){
+    return nullptr;
+  }
+
+  page->WLatch();
+  page->ResetMemory(); // new page == zeroed out
+  page->rec_lsn_ = INVALID_LSN;
+  page->is_dirty_ = false;
+  SetPinLSN(page);
+  // id before the pin, see TryPinPage
+  page->page_id_.store(page_id, std::memory_order_release);
+  page->pin_count_.store(1, std::memory_order_release);
+  page->WUnlatch();
+  page_table_->Insert(page_id, page);
+  return page;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* page cleaner */
+
+/*
+ * write back dirty pages before they reach the victim spot, so a miss
+ * finds a clean victim w/o WAL flush + page write
+ * 
+ * 1. under latch_: pick dirty pages from replacer's cold end, mark cleaning_
+ *    + clear dirty (a user that changes it during the write re-dirties it)
+ * 2. w/o latch_: write them, page read latch keeps writers out meanwhile
+ * 3. under latch_: done, free frames that were picked as victim meanwhile
+ * 
+ * cleaning_ frames stay in replacer: a miss skipping over them, DeletePage
+ * refusing them == frame + page id stable during the write w/o a pin
+ * 
+ * WAL: pages w log records not on disk yet are left to eviction (it forces
+ * the log), cleaner never flushes the log itself. checked again under the
+ * read latch, a user may have changed the page between 1 n 2
+ */
+size_t BufferPoolManager::CleanPages(size_t max_pages) {
+  std::vector<Page *> batch;
+  bool logging = ENABLE_LOGGING && log_manager_ != nullptr;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+
+    // 1. at most half the evictable frames, misses can always use the rest
+    std::vector<Page *> cold;
+    replacer_->PeekVictims(cold,
+                           std::min(replacer_->Size() / 2, 4 * max_pages));
+    lsn_t persistent_lsn = logging ? log_manager_->GetPersistentLSN()
+                                   : INVALID_LSN;
+    for(Page *page : cold){
+      if(batch.size() >= max_pages){
+        break;
+      }
+      if(!page->is_dirty_ || page->cleaning_ || page->pin_count_ > 0){
+        continue;
+      }
+      if(logging && page->GetLSN() > persistent_lsn){
+        continue;
+      }
+      page->cleaning_ = true;
+      page->cleaning_rec_lsn_ = page->rec_lsn_.exchange(INVALID_LSN);
+      page->is_dirty_ = false;
+      batch.push_back(page);
+    }
+  }
+
+  // 2. unpinned == no user holds its latch, a new user waits for the write.
+  // changed since 1 n its log not durable == not written, dirty again
+  std::vector<Page *> skipped;
+  for(Page *page : batch){
+    page->RLatch();
+    if(logging && page->GetLSN() > log_manager_->GetPersistentLSN()){
+      page->RUnlatch();
+      skipped.push_back(page);
+      continue;
+    }
+    disk_manager_->WritePage(page->page_id_, page->GetData());
+    page->RUnlatch();
+    dirty_writes->Add();
+  }
+  if(!skipped.empty()){
+    std::lock_guard<std::mutex> guard(latch_);
+    for(Page *page : skipped){
+      // older recLSN wins over one set by the change's unpin
+      lsn_t rec_lsn = page->rec_lsn_;
+      while((rec_lsn == INVALID_LSN || rec_lsn > page->cleaning_rec_lsn_) &&
+            !page->rec_lsn_.compare_exchange_weak(rec_lsn,
+                                                  page->cleaning_rec_lsn_)){
+      }
+      page->is_dirty_ = true;
+    }
+  }
+
+  // 3. a miss skipped it (evict_after_clean_) == it is the coldest, free it
+  FinishCleaning(batch);
+  size_t written = batch.size() - skipped.size();
+  cleaner_writes_ += written;
+  return written;
+}
+
+
+void BufferPoolManager::FinishCleaning(const std::vector<Page *> &batch) {
+  std::lock_guard<std::mutex> guard(latch_);
+  cleaned_cv_.notify_all();
+  for(Page *page : batch){
+    page->cleaning_ = false;
+    page->cleaning_rec_lsn_ = INVALID_LSN; // written, off the DPT
+    if(!page->evict_after_clean_){
+      continue;
+    }
+    page->evict_after_clean_ = false;
+    if(page->pin_count_ > 0 || page->is_dirty_){
+      continue; // fetched again meanwhile, back in lru on last unpin
+    }
+    replacer_->Erase(page); // fetched + unpinned meanwhile
+    EvictPage(page);
+    page->WLatch();
+    page->ResetMemory();
+    page->WUnlatch();
+    free_list_->push_back(page);
+  }
+}
+
+
+/*
+ * under latch_: frames keep their page, FlushPage / evictions write under
+ * it too. fuzzy otherwise, lock free unpins go on: recLSN set before dirty
+ * == a page is never dirty w/o 1
+ * 
+ * cleaning_ == write in flight, not on disk yet, still in the DPT
+ */
+void BufferPoolManager::GetDirtyPageTable(
+    std::unordered_map<page_id_t, lsn_t> &dirty_page_table) {
+  std::lock_guard<std::mutex> guard(latch_);
+  for(size_t i = 0; i < pool_size_; ++i){
+    Page *page = &pages_[i];
+    page_id_t page_id = page->page_id_;
+    if(page_id == INVALID_PAGE_ID || page->loading_){
+      continue;
+    }
+    lsn_t rec_lsn = page->rec_lsn_;
+    if(rec_lsn == INVALID_LSN && page->pin_count_ > 0){
+      rec_lsn = page->pin_lsn_;
+    }
+    if(page->cleaning_ && page->cleaning_rec_lsn_ != INVALID_LSN &&
+       (rec_lsn == INVALID_LSN || page->cleaning_rec_lsn_ < rec_lsn)){
+      rec_lsn = page->cleaning_rec_lsn_;
+    }
+    if(rec_lsn != INVALID_LSN){
+      dirty_page_table[page_id] = rec_lsn;
+    }
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* batched flush */
+
+size_t BufferPoolManager::FlushAllPages() {
+  // deleted pages' unlinks are in the pool or on disk by now, written by
+  // the flush (cleaner writes waited for), durable once released == their
+  // ids can be handed out again
+  uint64_t free_mark = GetFreeMark();
+  size_t num_written = FlushRange(0, std::numeric_limits<page_id_t>::max());
+  ReleaseFreedPages(free_mark);
+  return num_written;
+}
+
+/*
+ * checkpoint / shutdown: every dirty page in range, in page id order ==
+ * sequential disk writes, adjacent pages 1 write
+ * 
+ * 1. under latch_: collect dirty frames, mark cleaning_ + clear dirty, same
+ *    as the cleaner (frame n page id stay put w/o a pin, re-dirtied if
+ *    changed during the write). frames the cleaner / another flush is
+ *    writing are waited for n taken if still dirty == every page dirty
+ *    before the call is written by the time it returns
+ * 2. w/o latch_: sort, write runs in parallel. WAL of every page must be on
+ *    disk 1st, forced per run if its copies are ahead of the log
+ * 3. under latch_: done, like the cleaner's
+ */
+size_t BufferPoolManager::FlushRange(page_id_t first_page_id,
+                                     page_id_t last_page_id) {
+  std::vector<Page *> batch;
+  CollectDirtyPages(first_page_id, last_page_id, batch);
+  size_t written = WriteBatch(batch);
+  FinishCleaning(batch);
+  return written;
+}
+
+void BufferPoolManager::CollectDirtyPages(page_id_t first_page_id,
+                                          page_id_t last_page_id,
+                                          std::vector<Page *> &batch) {
+  std::unique_lock<std::mutex> lock(latch_);
+  for(size_t i = 0; i < pool_size_; ++i){
+    Page *page = &pages_[i];
+    page_id_t page_id = page->page_id_;
+    if(page_id == INVALID_PAGE_ID || page_id < first_page_id ||
+       page_id > last_page_id){
+      continue;
+    }
+    // cleaner may leave it dirty (log not durable) / not synced yet (its
+    // caller syncs, see ReleaseFreedPages)
+    if(page->cleaning_){
+      cleaned_cv_.wait(lock, [page] { return !page->cleaning_; });
+      if(page->page_id_ != page_id){
+        continue; // evicted once written
+      }
+    }
+    // loading_ == disk copy is the content
+    if(!page->is_dirty_ || page->loading_){
+      continue;
+    }
+    page->cleaning_ = true;
+    page->cleaning_rec_lsn_ = page->rec_lsn_.exchange(INVALID_LSN);
+    page->is_dirty_ = false;
+    batch.push_back(page);
+  }
+}
+
+/*
+ * runs == adjacent page ids, <= FLUSH_MAX_RUN_PAGES each, written async in
+ * page id order, FLUSH_IO_DEPTH runs in flight
+ * 
+ * each page is copied into a run buffer under its own read latch, then the
+ * run goes out in 1 write. latching a whole run at once would hold several
+ * page latches in page id order, deadlocking w b+tree crabbing that latches
+ * in tree order
+ * 
+ * pages may be pinned n changed right up to their copy == the log is forced
+ * after a run is copied, only if a copied page lsn isn't durable yet
+ */
+size_t BufferPoolManager::WriteBatch(std::vector<Page *> batch) {
+  if(batch.empty()){
+    return 0;
+  }
+  bool logging = ENABLE_LOGGING && log_manager_ != nullptr;
+  std::sort(batch.begin(), batch.end(), [](Page *a, Page *b) {
+    return a->page_id_ < b->page_id_;
+  });
+
+  // [begin, end) of batch
+  std::vector<std::pair<size_t, size_t>> runs;
+  for(size_t begin = 0, end = 1; begin < batch.size(); begin = end, ++end){
+    while(end < batch.size() && end - begin < FLUSH_MAX_RUN_PAGES &&
+          batch[end]->page_id_ == batch[end - 1]->page_id_ + 1){
+      ++end;
+    }
+    runs.emplace_back(begin, end);
+  }
+
+  // buffer slot reused once its previous run is written. aligned == no
+  // bounce copy w direct I/O
+  size_t depth = std::min<size_t>(FLUSH_IO_DEPTH, runs.size());
+  std::vector<char *> buffers(depth);
+  for(auto &buffer : buffers){
+    buffer = DiskManager::AllocateAligned(FLUSH_MAX_RUN_PAGES * page_size_);
+  }
+  std::vector<std::shared_ptr<IOHandle>> handles(depth);
+  for(size_t r = 0; r < runs.size(); ++r){
+    size_t slot = r % depth;
+    if(handles[slot] != nullptr){
+      handles[slot]->Wait();
+    }
+    size_t begin = runs[r].first, end = runs[r].second;
+    char *buffer = buffers[slot];
+    lsn_t run_lsn = INVALID_LSN;
+    for(size_t i = begin; i < end; ++i){
+      Page *page = batch[i];
+      page->RLatch();
+      memcpy(buffer + (i - begin) * page_size_, page->GetData(), page_size_);
+      run_lsn = std::max(run_lsn, page->GetLSN());
+      page->RUnlatch();
+    }
+    if(logging && run_lsn > log_manager_->GetPersistentLSN()){
+      log_manager_->ForceFlushWAL();
+    }
+    handles[slot] = disk_manager_->WritePagesAsync(batch[begin]->page_id_,
+                                                   buffer, end - begin);
+  }
+  IOHandle::WaitAll(handles);
+  for(auto buffer : buffers){
+    DiskManager::FreeAligned(buffer);
+  }
+  disk_manager_->SyncPages(); // checkpoint / shutdown == must be durable
+  dirty_writes->Add(batch.size());
+  flush_runs->Add(runs.size());
+  return batch.size();
+}
+
+
+void BufferPoolManager::RunPageCleaner() {
+  std::lock_guard<std::mutex> guard(cleaner_latch_);
+  if(cleaner_running_){
+    return;
+  }
+  cleaner_running_ = true;
+  cleaner_thread_ = new std::thread(&BufferPoolManager::PageCleanerLoop, this);
+}
+
+
+void BufferPoolManager::StopPageCleaner() {
+  {
+    std::lock_guard<std::mutex> guard(cleaner_latch_);
+    if(!cleaner_running_){
+      return;
+    }
+    cleaner_running_ = false;
+  }
+  cleaner_cv_.notify_all();
+  cleaner_thread_->join();
+  delete cleaner_thread_;
+  cleaner_thread_ = nullptr;
+}
+
+
+void BufferPoolManager::SetPageCleanerRate(std::chrono::milliseconds interval,
+                                           size_t max_pages) {
+  std::lock_guard<std::mutex> guard(cleaner_latch_);
+  cleaner_interval_ = interval;
+  cleaner_max_pages_ = max_pages;
+}
+
+
+// 1 round per interval, stop wakes it up early
+void BufferPoolManager::PageCleanerLoop() {
+  std::unique_lock<std::mutex> lock(cleaner_latch_);
+  while(cleaner_running_){
+    size_t max_pages = cleaner_max_pages_;
+    lock.unlock();
+    CleanPages(max_pages);
+    lock.lock();
+    cleaner_cv_.wait_for(lock, cleaner_interval_,
+                         [this] { return !cleaner_running_; });
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* read-ahead */
+
+/*
+ * queue an async read, I/O workers spawned on 1st call
+ * 
+ * NOTE: best effort, dropped if the pool has no frame when a worker gets it
+ */
+bool BufferPoolManager::PrefetchPage(page_id_t page_id,
+                                     BufferAccessStrategy *strategy) {
+  std::lock_guard<std::mutex> guard(latch_);
+
+  Page *page = nullptr;
+  if(page_id == INVALID_PAGE_ID || page_table_->Find(page_id, page)){
+    return false;
+  }
+  for(auto &request : prefetch_queue_){
+    if(request.first == page_id){
+      return false;
+    }
+  }
+
+  if(!prefetch_thread_.joinable()){
+    prefetch_thread_ = std::thread(&BufferPoolManager::PrefetchLoop, this);
+  }
+  if(strategy != nullptr){
+    strategy->GetRing(this); // destructor knows to drop queued requests
+  }
+  prefetch_queue_.emplace_back(page_id, strategy);
+  prefetch_cv_.notify_one();
+  return true;
+}
+
+
+Page *BufferPoolManager::FetchPageIfLoaded(page_id_t page_id,
+                                           BufferAccessStrategy *strategy,
+                                           bool *in_flight) {
+  std::lock_guard<std::mutex> guard(latch_);
+
+  Page *page = nullptr;
+  bool resident = page_table_->Find(page_id, page);
+  if(in_flight != nullptr){
+    *in_flight = resident && page->loading_;
+    for(auto &request : prefetch_queue_){
+      *in_flight = *in_flight || request.first == page_id;
+    }
+  }
+  if(!resident || page->loading_){
+    return nullptr;
+  }
+  if(page->pin_count_++ == 0){
+    SetPinLSN(page);
+  }
+  replacer_->Erase(page);
+  return page;
+}
+
+
+/*
+ * lookup only, for optimistic readers (b+tree search). a frame being read
+ * in is latched exclusively, OptimisticLatch() waits for it
+ */
+Page *BufferPoolManager::PeekPage(page_id_t page_id) {
+  Page *page = nullptr;
+  if(!page_table_->Find(page_id, page)){
+    return nullptr;
+  }
+  return page;
+}
+
+
+/*
+ * dispatcher, never waits for a read itself
+ * 
+ * 1. under latch_: pop a request, take a frame, put page in page table as
+ *    loading_ + pinned by us == FetchPage waits, nobody evicts it
+ * 2. w/o latch_: submit async read, up to READAHEAD_MAX_IN_FLIGHT at once
+ * 3. FinishPrefetch() on completion
+ */
+void BufferPoolManager::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while(true){
+    prefetch_cv_.wait(lock, [this] {
+      return prefetch_stop_ || (!prefetch_queue_.empty() &&
+                                prefetch_in_flight_ < READAHEAD_MAX_IN_FLIGHT);
+    });
+    if(prefetch_stop_){
+      return;
+    }
+
+    // 1. frame
+    page_id_t page_id = prefetch_queue_.front().first;
+    BufferAccessStrategy *strategy = prefetch_queue_.front().second;
+    prefetch_queue_.pop_front();
+    Page *page = nullptr;
+    if(page_table_->Find(page_id, page)){
+      continue; // fetched meanwhile
+    }
+    page = strategy != nullptr ? GetRingPage(strategy) : GetVictimPage();
+    if(page == nullptr){
+      continue; // pool all pinned, the scan reads it itself
+    }
+    // latched until read, optimistic readers wait / notice the switch
+    page->WLatch();
+    page->rec_lsn_ = INVALID_LSN;
+    page->is_dirty_ = false;
+    SetPinLSN(page);
+    // id n loading_ before the pin, see TryPinPage
+    page->page_id_.store(page_id, std::memory_order_release);
+    page->loading_.store(true, std::memory_order_release);
+    page->pin_count_.store(1, std::memory_order_release);
+    page_table_->Insert(page_id, page);
+
+    ++prefetch_in_flight_;
+
+    // 2. read
+    lock.unlock();
+    disk_manager_->ReadPageAsync(page_id, page->GetData(),
+                                 [this, page, page_id, strategy](int64_t res) {
+                                   FinishPrefetch(page, page_id, strategy,
+                                                  res >= 0);
+                                 });
+    lock.lock();
+  }
+}
+
+
+/*
+ * in the I/O completion thread: loaded, wake waiters, unpin like its scan
+ * would. strategy only compared (may be gone, its frames released)
+ * 
+ * !read (checksum mismatch / no tablespace) == dropped, never published
+ */
+void BufferPoolManager::FinishPrefetch(Page *page, page_id_t page_id,
+                                       BufferAccessStrategy *strategy,
+                                       bool read) {
+  page->WUnlatch();
+  std::lock_guard<std::mutex> guard(latch_);
+  if(!read){
+    DropFailedRead(page, page_id);
+  } else {
+    page->loading_.store(false, std::memory_order_release); // data read 1st
+    loaded_cv_.notify_all();
+    if(--page->pin_count_ == 0){
+      MakeEvictable(page, strategy);
+    }
+  }
+  ++prefetch_reads_;
+  prefetch_reads->Add();
+  --prefetch_in_flight_;
+  prefetch_cv_.notify_all();
+}
 
 } // namespace cmudb
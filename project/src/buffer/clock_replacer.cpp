@@ -0,0 +1,100 @@
+/**
+ * clock_replacer.cpp
+ * 
+ * hand sweeps the frames like a clock
+ * - evictable + ref bit on == 2nd chance, clear bit, move on
+ * - evictable + ref bit off == victim
+ * 
+ * unpin == Insert() == set 2 bits
+ * pin (hit in FetchPage) == Erase() == clear 1 bit, no allocation
+ */
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames,
+                                std::function<size_t(const T &)> frame_id)
+    : frames_(num_frames), frame_id_(frame_id) {}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() {}
+
+
+// unpinned == can be victim, ref bit on since just used
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  Frame &frame = frames_[frame_id_(value)];
+  frame.value_ = value;
+  frame.ref_ = true;
+  if (!frame.evictable_) {
+    frame.evictable_ = true;
+    ++size_;
+  }
+}
+
+
+
+// sweep at most 2 rounds: 1st round may only clear ref bits
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  if (size_ == 0) {
+    return false;
+  }
+
+  for (size_t i = 0; i < 2 * frames_.size(); ++i) {
+    Frame &frame = frames_[hand_];
+    hand_ = (hand_ + 1) % frames_.size();
+
+    if (!frame.evictable_) {
+      continue;
+    }
+    if (frame.ref_) {
+      frame.ref_ = false; // 2nd chance
+      continue;
+    }
+
+    frame.evictable_ = false;
+    --size_;
+    value = frame.value_;
+    return true;
+  }
+  return false;
+}
+
+
+
+// pinned == not evictable anymore
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  Frame &frame = frames_[frame_id_(value)];
+  if (!frame.evictable_) {
+    return false;
+  }
+  frame.evictable_ = false;
+  --size_;
+  return true;
+}
+
+
+
+template <typename T> size_t ClockReplacer<T>::Size() { return size_; }
+
+
+// order the hand would pick them: ref bit off from hand on, then ref bit on
+template <typename T>
+void ClockReplacer<T>::PeekVictims(std::vector<T> &values, size_t n) {
+  values.clear();
+  for (int ref = 0; ref < 2; ++ref) {
+    for (size_t i = 0; i < frames_.size() && values.size() < n; ++i) {
+      Frame &frame = frames_[(hand_ + i) % frames_.size()];
+      if (frame.evictable_ && frame.ref_ == (ref == 1)) {
+        values.push_back(frame.value_);
+      }
+    }
+  }
+}
+
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
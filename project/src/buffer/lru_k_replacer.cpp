@@ -0,0 +1,215 @@
+/**
+ * lru_k_replacer.cpp
+ * 
+ * Insert() == unpin == 1 reference, page becomes evictable
+ * Erase() == pin, page is not evictable but keeps its history
+ * Victim() == largest backward K-distance among evictable pages
+ * 
+ * Victim() is a linear pass over the resident values, it only runs on a miss
+ * and the resident set is bounded by the num of frames.
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k, uint64_t correlated_reference_period,
+                              uint64_t retained_information_period)
+    : k_(k), correlated_reference_period_(correlated_reference_period),
+      retained_information_period_(retained_information_period) {
+  assert(k_ > 0);
+}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() {}
+
+// frame -> page it currently holds
+template <> int64_t LRUKReplacer<Page *>::GetKey(Page *const &value) {
+  return value->GetPageId();
+}
+
+// test only
+template <> int64_t LRUKReplacer<int>::GetKey(const int &value) {
+  return value;
+}
+
+
+/*
+ * 1 reference at current time
+ * 
+ * 1. 1st time seen (or history expired) == hist_[0] = now
+ * 2. uncorrelated (now - last > CRP) == shift history, close the correlated
+ *    period so it counts as 1 point in time
+ * 3. correlated == only u() last
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  uint64_t now = ++current_time_;
+  int64_t key = GetKey(value);
+
+  // 0. u() resident set
+  auto resident = resident_.find(value);
+  if (resident == resident_.end()) {
+    resident_[value] = std::make_pair(key, true);
+    ++size_;
+  } else {
+    if (!resident->second.second) {
+      ++size_;
+    }
+    resident->second = std::make_pair(key, true);
+  }
+
+  auto it = history_.find(key);
+  if (it == history_.end()) {
+    History &history = history_[key];
+    history.hist_.assign(k_, 0);
+    history.hist_[0] = now;
+    history.last_ = now;
+    return;
+  }
+
+  History &history = it->second;
+  if (now - history.last_ > correlated_reference_period_) {
+    uint64_t correlated_period = history.last_ - history.hist_[0];
+    for (size_t i = k_ - 1; i > 0; --i) {
+      history.hist_[i] = history.hist_[i - 1] == 0
+                             ? 0
+                             : history.hist_[i - 1] + correlated_period;
+    }
+    history.hist_[0] = now;
+  }
+  history.last_ = now;
+}
+
+
+
+/*
+ * 1. only pages outside their correlated period are eligible
+ *    (if every evictable page is inside it, fall back to all of them)
+ * 2. infinite K-distance (< K refs) first, LRU among them by hist_[0]
+ * 3. otherwise oldest K-th reference
+ * 4. victim's history stays for RIP, expired histories are purged
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  if (size_ == 0) {
+    return false;
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    bool found = false;
+    bool found_infinite = false;
+    uint64_t best_time = 0;
+    typename std::unordered_map<T, std::pair<int64_t, bool>>::iterator victim;
+
+    for (auto it = resident_.begin(); it != resident_.end(); ++it) {
+      if (!it->second.second) {
+        continue; // pinned
+      }
+      History &history = history_[it->second.first];
+      if (pass == 0 &&
+          current_time_ - history.last_ <= correlated_reference_period_) {
+        continue;
+      }
+
+      bool infinite = history.hist_[k_ - 1] == 0;
+      uint64_t time = infinite ? history.hist_[0] : history.hist_[k_ - 1];
+      if (!found || (infinite && !found_infinite) ||
+          (infinite == found_infinite && time < best_time)) {
+        found = true;
+        found_infinite = infinite;
+        best_time = time;
+        victim = it;
+      }
+    }
+
+    if (found) {
+      value = victim->first;
+      if (retained_information_period_ == 0) {
+        history_.erase(victim->second.first);
+      }
+      resident_.erase(victim);
+      --size_;
+      PurgeHistory();
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+// pinned == not evictable, history kept for the next unpin
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  auto it = resident_.find(value);
+  if (it == resident_.end() || !it->second.second) {
+    return false;
+  }
+  it->second.second = false;
+  --size_;
+  return true;
+}
+
+
+
+template <typename T> size_t LRUKReplacer<T>::Size() { return size_; }
+
+
+
+// Victim() order w/o CRP: infinite distance (LRU among them) then by K-th
+template <typename T>
+void LRUKReplacer<T>::PeekVictims(std::vector<T> &values, size_t n) {
+  std::vector<std::pair<std::pair<bool, uint64_t>, T>> order;
+  for (auto &resident : resident_) {
+    if (!resident.second.second) {
+      continue; // pinned
+    }
+    History &history = history_[resident.second.first];
+    bool infinite = history.hist_[k_ - 1] == 0;
+    uint64_t time = infinite ? history.hist_[0] : history.hist_[k_ - 1];
+    order.push_back(std::make_pair(std::make_pair(!infinite, time),
+                                   resident.first));
+  }
+  n = std::min(n, order.size());
+  std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                    [](const std::pair<std::pair<bool, uint64_t>, T> &a,
+                       const std::pair<std::pair<bool, uint64_t>, T> &b) {
+                      return a.first < b.first;
+                    });
+  values.clear();
+  for (size_t i = 0; i < n; ++i) {
+    values.push_back(order[i].second);
+  }
+}
+
+
+
+// drop non-resident histories older than RIP, at most once per RIP ticks
+template <typename T> void LRUKReplacer<T>::PurgeHistory() {
+  if (retained_information_period_ == 0 ||
+      current_time_ - last_purge_time_ < retained_information_period_) {
+    return;
+  }
+  last_purge_time_ = current_time_;
+
+  std::unordered_map<int64_t, bool> resident_keys;
+  for (auto &resident : resident_) {
+    resident_keys[resident.second.first] = true;
+  }
+  for (auto it = history_.begin(); it != history_.end();) {
+    if (current_time_ - it->second.last_ > retained_information_period_ &&
+        resident_keys.count(it->first) == 0) {
+      it = history_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
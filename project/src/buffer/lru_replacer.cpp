@@ -32,7 +32,7 @@ template <typename T> void LRUReplacer<T>::Insert(const T &value) {
   // 3. if page already exists, move yourself to front + u() unordered map
   } else {
     
-    linked_list_of_pageptr.erase(linked_list_iterator);
+    linked_list_of_pageptr.erase(linked_list_iterator->second);
 
     linked_list_of_pageptr.insert(linked_list_of_pageptr.begin(), value);
     map_of_pageptr_iter[value] = linked_list_of_pageptr.begin();
@@ -52,8 +52,8 @@ template <typename T> bool LRUReplacer<T>::Victim(T &value) {
   }
   
   // 2. If LRU is non-empty, pop the front + return true 
-  value = linked_list_of_pageptr.rbegin();
-  linked_list_of_pageptr.popback();
+  value = linked_list_of_pageptr.back();
+  linked_list_of_pageptr.pop_back();
   map_of_pageptr_iter.erase(value);
   return true;
 }
@@ -74,8 +74,8 @@ template <typename T> bool LRUReplacer<T>::Erase(const T &value) {
   }
   
   // 3. if exist, delete from linked list + unordered map + return true 
-  linked_list_of_pageptr.erase(linked_list_iterator);
-  map_of_pageptr_iter.erase(value);
+  linked_list_of_pageptr.erase(linked_list_iterator->second);
+  map_of_pageptr_iter.erase(linked_list_iterator);
   
   return true;
 }
@@ -102,6 +102,21 @@ template <typename T> size_t LRUReplacer<T>::Size() {
 
 
 
+// back of the list == next to go
+template <typename T>
+void LRUReplacer<T>::PeekVictims(std::vector<T> &values, size_t n) {
+  values.clear();
+  for (auto it = linked_list_of_pageptr.rbegin();
+       it != linked_list_of_pageptr.rend() && values.size() < n; ++it) {
+    values.push_back(*it);
+  }
+}
+
+
+
+
+
+
 template class LRUReplacer<Page *>;
 // test only
 template class LRUReplacer<int>;
@@ -0,0 +1,117 @@
+/**
+ * mmap_buffer_pool_manager.cpp
+ */
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "buffer/mmap_buffer_pool_manager.h"
+#include "common/metrics.h"
+
+namespace cmudb {
+
+// process wide (see common/metrics.h)
+static MetricCounter *mapped_fetches =
+    MetricsRegistry::Instance().GetCounter("buffer_pool.mapped_fetches");
+
+/*
+ * base pool w 0 frames == no arena, no cleaner, no prefetch thread
+ */
+MmapBufferPoolManager::MmapBufferPoolManager(DiskManager *disk_manager)
+    : BufferPoolManager(0, disk_manager), disk_manager_(disk_manager) {
+  size_t page_size = GetPageSize();
+  for (int t = 0; t < MAX_TABLESPACES; ++t) {
+    mappings_[t] = disk_manager->MapPages(num_pages_[t], t);
+    if (mappings_[t] == nullptr) {
+      continue;
+    }
+    frames_[t] = new Page[num_pages_[t]];
+    for (size_t i = 0; i < num_pages_[t]; ++i) {
+      frames_[t][i].page_id_ = DiskManager::MakePageId(t, i);
+      frames_[t][i].page_size_ = page_size;
+      // PROT_READ mapping, the const is enforced by the mmu
+      frames_[t][i].data_ = const_cast<char *>(mappings_[t]) + i * page_size;
+    }
+  }
+}
+
+MmapBufferPoolManager::~MmapBufferPoolManager() {
+  for (int t = 0; t < MAX_TABLESPACES; ++t) {
+    delete[] frames_[t];
+    disk_manager_->UnmapPages(mappings_[t], num_pages_[t]);
+  }
+}
+
+size_t MmapBufferPoolManager::GetNumPages() const {
+  size_t num_pages = 0;
+  for (int t = 0; t < MAX_TABLESPACES; ++t) {
+    num_pages += num_pages_[t];
+  }
+  return num_pages;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+Page *MmapBufferPoolManager::GetPage(page_id_t page_id) {
+  if (page_id < 0) {
+    return nullptr;
+  }
+  int t = DiskManager::GetTablespaceId(page_id);
+  size_t i = DiskManager::GetFilePageId(page_id);
+  if (i >= num_pages_[t]) {
+    return nullptr;
+  }
+  return &frames_[t][i];
+}
+
+Page *MmapBufferPoolManager::FetchPage(page_id_t page_id,
+                                       BufferAccessStrategy *) {
+  Page *page = GetPage(page_id);
+  if (page != nullptr) {
+    mapped_fetches->Add();
+  }
+  return page;
+}
+
+bool MmapBufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty,
+                                      BufferAccessStrategy *) {
+  return GetPage(page_id) != nullptr && !is_dirty;
+}
+
+bool MmapBufferPoolManager::PrefetchPage(page_id_t page_id,
+                                         BufferAccessStrategy *) {
+  Page *page = GetPage(page_id);
+  if (page == nullptr) {
+    return false;
+  }
+  // madvise wants an os page aligned start
+  static const uintptr_t os_page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t start = reinterpret_cast<uintptr_t>(page->data_);
+  uintptr_t aligned = start - start % os_page_size;
+  madvise(reinterpret_cast<void *>(aligned), start + GetPageSize() - aligned,
+          MADV_WILLNEED);
+  return false;
+}
+
+Page *MmapBufferPoolManager::FetchPageIfLoaded(page_id_t page_id,
+                                               BufferAccessStrategy *strategy,
+                                               bool *in_flight) {
+  if (in_flight != nullptr) {
+    *in_flight = false;
+  }
+  return FetchPage(page_id, strategy);
+}
+
+Page *MmapBufferPoolManager::PeekPage(page_id_t page_id) {
+  return GetPage(page_id);
+}
+
+} // namespace cmudb
@@ -0,0 +1,244 @@
+/**
+ * parallel_buffer_pool_manager.cpp
+ * 
+ * 1 latch per shard instead of 1 latch for the whole pool
+ * 
+ * page_id -> hash -> shard, every API call is forwarded to exactly 1 shard
+ * so no global lock at all
+ */
+#include <cassert>
+#include <functional>
+
+#include "buffer/parallel_buffer_pool_manager.h"
+
+namespace cmudb {
+
+/*
+ * base class gets 0 frames, all frames live in the shards
+ */
+ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances,
+                                                     size_t pool_size,
+                                                     DiskManager *disk_manager,
+                                                     LogManager *log_manager,
+                                                     ReplacerType replacer_type)
+    : BufferPoolManager(0, disk_manager, log_manager) {
+  assert(num_instances > 0);
+
+  // round up so total frames >= pool_size
+  size_t instance_pool_size = (pool_size + num_instances - 1) / num_instances;
+  for (size_t i = 0; i < num_instances; ++i) {
+    instances_.push_back(
+        new BufferPoolManager(instance_pool_size, disk_manager, log_manager,
+                              replacer_type));
+  }
+  pool_size_ = instance_pool_size * num_instances;
+}
+
+ParallelBufferPoolManager::~ParallelBufferPoolManager() {
+  for (auto instance : instances_) {
+    delete instance;
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// page_id -> shard, same page_id always same shard
+BufferPoolManager *
+ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
+  size_t hashed_page_id = std::hash<page_id_t>()(page_id);
+  return instances_[hashed_page_id % instances_.size()];
+}
+
+// strategy keeps one ring per shard, keyed by the shard it reaches
+Page *ParallelBufferPoolManager::FetchPage(page_id_t page_id,
+                                           BufferAccessStrategy *strategy) {
+  return GetBufferPoolManager(page_id)->FetchPage(page_id, strategy);
+}
+
+bool ParallelBufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty,
+                                          BufferAccessStrategy *strategy) {
+  return GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty, strategy);
+}
+
+bool ParallelBufferPoolManager::FlushPage(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->FlushPage(page_id);
+}
+
+/*
+ * adjacent page ids live in different shards, per shard flushes could never
+ * coalesce them == collect from every shard, sort + write as 1 batch
+ */
+size_t ParallelBufferPoolManager::FlushRange(page_id_t first_page_id,
+                                             page_id_t last_page_id) {
+  std::vector<std::vector<Page *>> batches(instances_.size());
+  std::vector<Page *> batch;
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->CollectDirtyPages(first_page_id, last_page_id, batches[i]);
+    batch.insert(batch.end(), batches[i].begin(), batches[i].end());
+  }
+  size_t written = WriteBatch(batch);
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->FinishCleaning(batches[i]);
+  }
+  return written;
+}
+
+bool ParallelBufferPoolManager::DeletePage(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->DeletePage(page_id);
+}
+
+// read-ahead lands in the owning shard, served by that shard's I/O workers
+bool ParallelBufferPoolManager::PrefetchPage(page_id_t page_id,
+                                             BufferAccessStrategy *strategy) {
+  return GetBufferPoolManager(page_id)->PrefetchPage(page_id, strategy);
+}
+
+Page *ParallelBufferPoolManager::FetchPageIfLoaded(
+    page_id_t page_id, BufferAccessStrategy *strategy, bool *in_flight) {
+  return GetBufferPoolManager(page_id)->FetchPageIfLoaded(page_id, strategy,
+                                                          in_flight);
+}
+
+Page *ParallelBufferPoolManager::PeekPage(page_id_t page_id) {
+  return GetBufferPoolManager(page_id)->PeekPage(page_id);
+}
+
+
+/*
+ * page id first, then shard
+ * 
+ * 1. allocate page id on disk (disk manager is atomic, no latch here)
+ * 2. route to owning shard, let it find a frame
+ * 3. owning shard all pinned == next page id (next shard), until 1 has room
+ *    or every shard was full. ids skipped are given back, nullptr only if
+ *    the whole pool is pinned
+ */
+Page *ParallelBufferPoolManager::NewPage(page_id_t &page_id, page_id_t hint,
+                                         PageExtent *extent) {
+  std::vector<bool> full(instances_.size(), false);
+  size_t num_full = 0;
+  std::vector<page_id_t> skipped;
+  Page *page = nullptr;
+  // ids needn't come in shard order, 2 rounds is enough to meet every shard
+  for (size_t i = 0; i < 2 * instances_.size(); ++i) {
+    page_id = disk_manager_->AllocatePage(hint, extent);
+    if (page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    size_t index = std::hash<page_id_t>()(page_id) % instances_.size();
+    if (!full[index]) {
+      BufferPoolManager *instance = instances_[index];
+      std::lock_guard<std::mutex> guard(instance->latch_);
+      page = instance->NewPageWithId(page_id);
+    }
+    if (page != nullptr) {
+      break;
+    }
+    skipped.push_back(page_id);
+    if (!full[index]) {
+      full[index] = true;
+      if (++num_full == instances_.size()) {
+        break;
+      }
+    }
+    hint = page_id;
+  }
+
+  for (page_id_t skipped_page_id : skipped) {
+    disk_manager_->DeallocatePage(skipped_page_id);
+  }
+  if (page == nullptr) {
+    page_id = INVALID_PAGE_ID;
+  }
+  return page;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* page cleaner, every shard cleans its own cold end */
+
+size_t ParallelBufferPoolManager::CleanPages(size_t max_pages) {
+  size_t written = 0;
+  for (auto instance : instances_) {
+    written += instance->CleanPages(max_pages);
+  }
+  return written;
+}
+
+void ParallelBufferPoolManager::RunPageCleaner() {
+  for (auto instance : instances_) {
+    instance->RunPageCleaner();
+  }
+}
+
+void ParallelBufferPoolManager::StopPageCleaner() {
+  for (auto instance : instances_) {
+    instance->StopPageCleaner();
+  }
+}
+
+void ParallelBufferPoolManager::SetPageCleanerRate(
+    std::chrono::milliseconds interval, size_t max_pages) {
+  for (auto instance : instances_) {
+    instance->SetPageCleanerRate(interval, max_pages);
+  }
+}
+
+uint64_t ParallelBufferPoolManager::GetCleanEvictions() const {
+  uint64_t evictions = 0;
+  for (auto instance : instances_) {
+    evictions += instance->GetCleanEvictions();
+  }
+  return evictions;
+}
+
+uint64_t ParallelBufferPoolManager::GetDirtyEvictions() const {
+  uint64_t evictions = 0;
+  for (auto instance : instances_) {
+    evictions += instance->GetDirtyEvictions();
+  }
+  return evictions;
+}
+
+uint64_t ParallelBufferPoolManager::GetCleanerWrites() const {
+  uint64_t writes = 0;
+  for (auto instance : instances_) {
+    writes += instance->GetCleanerWrites();
+  }
+  return writes;
+}
+
+uint64_t ParallelBufferPoolManager::GetPrefetchReads() const {
+  uint64_t reads = 0;
+  for (auto instance : instances_) {
+    reads += instance->GetPrefetchReads();
+  }
+  return reads;
+}
+
+void ParallelBufferPoolManager::GetDirtyPageTable(
+    std::unordered_map<page_id_t, lsn_t> &dirty_page_table) {
+  for (auto instance : instances_) {
+    instance->GetDirtyPageTable(dirty_page_table);
+  }
+}
+
+} // namespace cmudb
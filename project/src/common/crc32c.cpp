@@ -0,0 +1,77 @@
+/**
+ * crc32c.cpp
+ */
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "common/crc32c.h"
+
+namespace cmudb {
+
+// reflected Castagnoli polynomial
+static constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+struct Crc32cTable {
+  uint32_t entries_[256];
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+      }
+      entries_[i] = crc;
+    }
+  }
+};
+
+uint32_t Crc32c::ComputeSoftware(const char *data, size_t size, uint32_t crc) {
+  static const Crc32cTable table;
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table.entries_[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^
+          (crc >> 8);
+  }
+  return ~crc;
+}
+
+#if defined(__x86_64__)
+// compiled for sse4.2 whatever -march says, only called if the cpu has it
+__attribute__((target("sse4.2"))) static uint32_t
+ComputeHardware(const char *data, size_t size, uint32_t crc) {
+  uint64_t crc64 = ~crc;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8); // unaligned load
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc64);
+  for (; i < size; i++) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(data[i]));
+  }
+  return ~crc32;
+}
+#endif
+
+bool Crc32c::IsHardwareAccelerated() {
+#if defined(__x86_64__)
+  static const bool sse42 = __builtin_cpu_supports("sse4.2");
+  return sse42;
+#else
+  return false;
+#endif
+}
+
+uint32_t Crc32c::Compute(const char *data, size_t size, uint32_t crc) {
+#if defined(__x86_64__)
+  if (IsHardwareAccelerated()) {
+    return ComputeHardware(data, size, crc);
+  }
+#endif
+  return ComputeSoftware(data, size, crc);
+}
+
+} // namespace cmudb
@@ -0,0 +1,190 @@
+/**
+ * lz4.cpp
+ *
+ * sequence == token (literal length << 4 | match length - 4), literal
+ * length bytes if >= 15, literals, 2 byte little endian offset, match
+ * length bytes if >= 15. the last sequence is literals only; the last 5
+ * bytes are always literals n no match starts in the last 12 (decoders may
+ * copy in 8 byte steps)
+ */
+#include <cstring>
+
+#include "common/lz4.h"
+
+namespace cmudb {
+
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MATCH_FIND_LIMIT = 12;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int MAX_HASH_LOG = 12;
+
+static inline uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+// 15 in the token, the rest in 255s n a final byte < 255
+static inline uint8_t *WriteLength(uint8_t *op, size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+// false == ran past the input
+static inline bool ReadLength(const uint8_t *&ip, const uint8_t *end,
+                              size_t &length) {
+  uint8_t byte;
+  do {
+    if (ip >= end) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * hash table sized to the input (a 512 byte page clears 512 bytes of
+ * table, not 8K), positions fit 16 bits
+ */
+size_t Lz4::Compress(const char *src, size_t size, char *dst,
+                     size_t capacity) {
+  const uint8_t *base = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *ip = base, *anchor = base, *end = base + size;
+  uint8_t *op = reinterpret_cast<uint8_t *>(dst), *op_end = op + capacity;
+  uint8_t *out = op;
+
+  int hash_log = 8;
+  while (hash_log < MAX_HASH_LOG && (size_t(1) << hash_log) < size / 2) {
+    hash_log++;
+  }
+  uint16_t table[1 << MAX_HASH_LOG];
+  memset(table, 0, sizeof(uint16_t) << hash_log);
+  auto hash = [hash_log](uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hash_log);
+  };
+
+  if (size > MATCH_FIND_LIMIT) {
+    const uint8_t *match_find_end = end - MATCH_FIND_LIMIT;
+    const uint8_t *match_end = end - LAST_LITERALS;
+    while (ip < match_find_end) {
+      uint32_t sequence = Read32(ip);
+      uint32_t h = hash(sequence);
+      const uint8_t *ref = base + table[h];
+      table[h] = static_cast<uint16_t>(ip - base);
+      if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET ||
+          Read32(ref) != sequence) {
+        ip++;
+        continue;
+      }
+      // extend backwards over literals, then forwards
+      while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+      const uint8_t *ip_match = ip + MIN_MATCH, *ref_match = ref + MIN_MATCH;
+      while (ip_match < match_end && *ip_match == *ref_match) {
+        ip_match++;
+        ref_match++;
+      }
+      size_t literals = ip - anchor;
+      size_t match = ip_match - ip - MIN_MATCH;
+      if (static_cast<size_t>(op_end - op) <
+          1 + literals / 255 + 1 + literals + 2 + match / 255 + 1) {
+        return 0;
+      }
+      uint8_t *token = op++;
+      *token = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+      if (literals >= 15) {
+        op = WriteLength(op, literals);
+      }
+      memcpy(op, anchor, literals);
+      op += literals;
+      size_t offset = ip - ref;
+      *op++ = static_cast<uint8_t>(offset);
+      *op++ = static_cast<uint8_t>(offset >> 8);
+      *token |= match >= 15 ? 15 : match;
+      if (match >= 15) {
+        op = WriteLength(op, match);
+      }
+      ip = anchor = ip_match;
+      // position just before the end of the match, for runs
+      if (ip - 2 > base && ip < match_find_end) {
+        table[hash(Read32(ip - 2))] = static_cast<uint16_t>(ip - 2 - base);
+      }
+    }
+  }
+
+  size_t literals = end - anchor;
+  if (static_cast<size_t>(op_end - op) < 1 + literals / 255 + 1 + literals) {
+    return 0;
+  }
+  *op++ = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+  if (literals >= 15) {
+    op = WriteLength(op, literals);
+  }
+  memcpy(op, anchor, literals);
+  op += literals;
+  return op - out;
+}
+
+int64_t Lz4::Decompress(const char *src, size_t size, char *dst,
+                        size_t capacity) {
+  const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *end = ip + size;
+  uint8_t *out = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *op = out, *op_end = out + capacity;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !ReadLength(ip, end, literals)) {
+      return -1;
+    }
+    if (literals > static_cast<size_t>(end - ip) ||
+        literals > static_cast<size_t>(op_end - op)) {
+      return -1;
+    }
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+    if (ip == end) {
+      break; // last sequence, literals only
+    }
+
+    if (end - ip < 2) {
+      return -1;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - out)) {
+      return -1;
+    }
+    size_t match = token & 15;
+    if (match == 15 && !ReadLength(ip, end, match)) {
+      return -1;
+    }
+    match += MIN_MATCH;
+    if (match > static_cast<size_t>(op_end - op)) {
+      return -1;
+    }
+    const uint8_t *ref = op - offset;
+    if (offset >= match) {
+      memcpy(op, ref, match);
+      op += match;
+    } else {
+      // overlapping == repeats the last offset bytes
+      for (size_t i = 0; i < match; i++) {
+        *op++ = ref[i];
+      }
+    }
+  }
+  return op - out;
+}
+
+} // namespace cmudb
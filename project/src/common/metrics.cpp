@@ -0,0 +1,155 @@
+/**
+ * metrics.cpp
+ */
+#include "common/metrics.h"
+
+namespace cmudb {
+
+// threads take shards round robin, in the order they 1st record
+size_t MetricShardIndex() {
+  static std::atomic<size_t> next_shard{0};
+  static thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+  return shard;
+}
+
+uint64_t MetricCounter::Get() const {
+  uint64_t sum = 0;
+  for (const Shard &shard : shards_) {
+    sum += shard.value_.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+void MetricHistogram::Record(uint64_t micros) {
+  // bucket == num of significant bits
+  int bucket = 0;
+  while (bucket < num_buckets_ - 1 && micros >= (1ULL << bucket)) {
+    bucket++;
+  }
+  Shard &shard = shards_[MetricShardIndex()];
+  shard.buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.sum_.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void MetricHistogram::GetBuckets(uint64_t (&buckets)[num_buckets_]) const {
+  for (int i = 0; i < num_buckets_; i++) {
+    buckets[i] = 0;
+    for (const Shard &shard : shards_) {
+      buckets[i] += shard.buckets_[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+uint64_t MetricHistogram::GetCount() const {
+  uint64_t buckets[num_buckets_];
+  GetBuckets(buckets);
+  uint64_t count = 0;
+  for (uint64_t num : buckets) {
+    count += num;
+  }
+  return count;
+}
+
+uint64_t MetricHistogram::GetSum() const {
+  uint64_t sum = 0;
+  for (const Shard &shard : shards_) {
+    sum += shard.sum_.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+/*
+ * walk buckets until q of all records are covered, 1 snapshot of the buckets
+ * == count n walk agree
+ */
+uint64_t MetricHistogram::GetPercentile(double q) const {
+  uint64_t buckets[num_buckets_];
+  GetBuckets(buckets);
+  uint64_t count = 0;
+  for (uint64_t num : buckets) {
+    count += num;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+  rank = rank == 0 ? 1 : rank;
+  uint64_t seen = 0;
+  for (int i = 0; i < num_buckets_; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return 1ULL << i;
+    }
+  }
+  return 1ULL << (num_buckets_ - 1);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// never destroyed, metrics may be recorded from static destructors
+MetricsRegistry &MetricsRegistry::Instance() {
+  static MetricsRegistry *registry = new MetricsRegistry();
+  return *registry;
+}
+
+MetricCounter *MetricsRegistry::GetCounter(const std::string &name) {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_ptr<MetricCounter> &counter = counters_[name];
+  if (counter == nullptr) {
+    counter.reset(new MetricCounter());
+  }
+  return counter.get();
+}
+
+MetricHistogram *MetricsRegistry::GetHistogram(const std::string &name) {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::unique_ptr<MetricHistogram> &histogram = histograms_[name];
+  if (histogram == nullptr) {
+    histogram.reset(new MetricHistogram());
+  }
+  return histogram.get();
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+MetricsRegistry::SnapshotCounters() {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<std::pair<std::string, uint64_t>> counters;
+  for (auto &counter : counters_) {
+    counters.emplace_back(counter.first, counter.second->Get());
+  }
+  return counters;
+}
+
+std::vector<std::pair<std::string, const MetricHistogram *>>
+MetricsRegistry::GetHistograms() {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<std::pair<std::string, const MetricHistogram *>> histograms;
+  for (auto &histogram : histograms_) {
+    histograms.emplace_back(histogram.first, histogram.second.get());
+  }
+  return histograms;
+}
+
+} // namespace cmudb
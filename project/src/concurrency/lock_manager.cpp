@@ -39,141 +39,87 @@ lock_shared == pages in txn == r w lock +  txn_manger’s state of txn + lock_ta
  * - wait die only kill xlock ?? 
  * 
  * cv
- * - no need to notify other txns u granted lock
- * - only need to notify when unlock()
+ * - notify when unlock(), n when granted: shared requests queued behind
+ *   a granted 1 may go too
  * 
  * 1 wait queue == 1 txn can only have 1 entry at most
  * - 2PL == for each record id, 1 txn calls lock() 1 time
  * - for lock_upgrade(), txn must hv slock in grant set already
  * 
- * 
- * TODO: txn manager s/xlock set 
  */
 
+#include "common/metrics.h"
 #include "concurrency/lock_manager.h"
 
 namespace cmudb {
 
-/**
- * @brief 
- * 
- * 
- * txn == e.g. txn1, txn2, txn3 
- * rid == e.g. rid1, rid2, rid3
- * 
- * 
- * @return 
- * whether granted lock
- * 
+// process wide (see common/metrics.h)
+static MetricCounter *lock_waits =
+    MetricsRegistry::Instance().GetCounter("lock.waits");
+static MetricCounter *lock_dies =
+    MetricsRegistry::Instance().GetCounter("lock.wait_die_aborts");
+static MetricHistogram *lock_wait_latency =
+    MetricsRegistry::Instance().GetHistogram("lock.wait_us");
+
+/*
+ * shared n exclusive requests: wait die against conflicting granted /
+ * queued requests, then queue n block till grantable (Row::CouldGrant)
+ *
+ * 2PL: no lock once shrinking == abort
  */
-bool LockManager::LockShared(Transaction *txn, const RID &rid) {
-
-
-  // 0. 2PL checking condition
-  // 2PL gurantees txn will call all lock() before unlock()
-  assert(txn->GetState() == TransactionState::GROWING); 
-  assert(!txn->GetState() == TransactionState::ABORTED);
-
-
-  // 1. wait die + lock table to decide if: 
-  // 1. txn gets lock, 2. wait for lock or 3. kill itself
-  // 1.1 if strict 2PL == waits til txn is committed
-  auto row = lock_table_[rid];
-  txn_id_t tid = txn->GetTransactionId();
-  
-  Request lock_req(tid, Mode::SHARED);
-
-  // 1.2.1 
-  // if empty or grant set only has shared lock, grant 
-  // newly arrived, even if younger under wait die, 
-  // as long as shared mode + shared req == grant shared lock
-  if(row->GrantedSetEmpty() || row->CouldGrantSharedLock()){    
-    row.AddGrantedSet(lock_req);
-    return true;
-
-  // 1.2.2
-  } else { // grant set has exclusive lock == wait or die
-
+bool LockManager::Lock(Transaction *txn, const RID &rid, Request lock_req) {
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    txn->SetState(TransactionState::ABORTED);
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
 
-    // 1.2.2.1: wait
-    /**
-    if txn is older than oldest in existing txns == wait
-    wait == append “lock request table” 
-    wait die == only older than oldest wait == younger than older all die
-    multithreads == older might arrive late == possible   
-    if txn is younger than oldest in wait queue == die
-    shouldnt it be any txn in queue == die since not oldest ??    
-     */
-    
-    // txn older/same as oldest in wait queue
-    if(tid <= row->GetOldestWaitQueue() 
-        || row->TxnInGrantedSet(tid)
-        || row->WaitQueueEmpty()) { 
-      row->AddFrontWaitQueue(lock_req);
-      
-      // block + check condition every time when other txn unlock()
-      // cv unblocks to get lock (lock table) until lock (lock manager) granted
-      cv_wait_queue_.wait(lock_table_lock_, [&]()){
-        // condition: no txn in grant set + 1st of wait queue
-        if (row->GrantedSetEmpty() && wait_queue->Begin()->tid_ == tid){
-          return true;
-        } 
-        return false;
-      }
+  std::unique_lock<std::mutex> lock(lock_table_lock_);
+  std::unique_ptr<Row> &entry = lock_table_[rid];
+  if (entry == nullptr) {
+    entry.reset(new Row());
+  }
+  // stays put while its wait queue isn't empty
+  Row *row = entry.get();
 
-      row->AddGrantedSet(lock_req);
-      row->DeleteWaitqueue(lock_req);
-      return true;
-    
-    // 1.2.2.2: die 
-    } else { // txn not older than oldest in wait queue
-      txn->SetState(TransactionState::ABORTED);
-      return false;
+  // 1. die: conflicts w an older txn
+  if (row->MustDie(lock_req)) {
+    lock_dies->Add();
+    txn->SetState(TransactionState::ABORTED);
+    if (row->IsEmpty()) {
+      lock_table_.erase(rid);
     }
+    return false;
   }
 
-  return false;
-}
-
+  // 2. wait: only on younger txns, they die / finish
+  row->AddWaitQueue(lock_req);
+  if (!row->CouldGrant(lock_req)) {
+    lock_waits->Add();
+    MetricTimer timer(lock_wait_latency);
+    cv_wait_queue_.wait(lock, [&] { return row->CouldGrant(lock_req); });
+  }
 
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////
+  // 3. granted
+  row->DeleteWaitQueue(lock_req.tid_);
+  row->AddGrantedSet(lock_req);
+  if (lock_req.mode_ == Mode::SHARED) {
+    txn->GetSharedLockSet()->emplace(rid);
+  } else {
+    txn->GetExclusiveLockSet()->emplace(rid);
+  }
+  // shared requests queued behind this 1 may be grantable now too
+  cv_wait_queue_.notify_all();
+  return true;
+}
 
+bool LockManager::LockShared(Transaction *txn, const RID &rid) {
+  return Lock(txn, rid, Request(txn->GetTransactionId(), Mode::SHARED));
+}
 
-/**
- * 
- * 
- * 
- * 
- * how is it different from lock_shared() ??
- * - lock_s() == granted slock of any txn == grant lock
- * - lock_x() == granted slock of same txn == 1st in wait queue
- * 
- */
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
-
-
-  // 1. wait die to decide if txn gets lock, wait for lock or kill itself
-
-  // 1.1 no txn, must be able to get xlock
-
-  // 1.2 wait die == dealing w deadlock == only oldest txn than waiting queue cna get xlock
-
-
-
-  // 2. cv wait til all previous lock requests are granted
-
-
-
-  // 3. u() txn granted xlock + notify other threads
-
-  return false;
+  return Lock(txn, rid, Request(txn->GetTransactionId(), Mode::EXCLUSIVE));
 }
 
 
@@ -187,21 +133,11 @@ bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief 
- * upgrade() == xlock() 
+ * @brief
+ * upgrade() == xlock()
  * - but txn needs to have a slock in grant set first
  * - n wait til only u 1 slock left in grant set
- * 
- * 
- * Q&A
- * can be called by both slock in grant set n wait queue ??
- * - see test
- * - called only by slock in grant set 
- * - since LockUpgrade() must after LockShared()
- * - n LockShared() wont return unless gets lock 
- * 
- * why once slock -> xlock in wait queue == wait die ??
- * 
+ *
  * why wait die ?
  * - 1+ slock txns in grant set can call upgrade()
  * - deadlock == since there can only be 1 xlock,
@@ -209,99 +145,89 @@ bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
  * - wait die == T1, T2 slock grant set, if both upgrade()
  * - then T2 dies, T1 directly upgrades() in grant set
  * - T2 forced to unlock() w/o upgrade() == no deadlock
- * 
- * slock() waitdie vs upgrade() waitdie
- * - upgrade(): T1 cv waits on "only T1 in grant set", in upgrade_wait_queue_
- * - slock(): other txns cv wait on "grant set empty", in wait_queue_
- * 
+ *
+ * a pending upgrade goes before queued requests, new ones can't overtake it
  */
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-
-  // 0.
-  auto row = lock_table_[rid];
+  if (txn->GetState() != TransactionState::GROWING) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
   txn_id_t tid = txn->GetTransactionId();
-  if(!row->TxnInGrantedSet(tid)){return false;}
 
-  
-  // 1. if only 1 txn in grant set, auto upgrade to xlock
-  if(IsOnlyTxnInGrantedSet(tid)){
-    // T1 slock -> xlock (in grant set)
-    row->UpgradeGrantedSet(tid);
-    return true; 
+  std::unique_lock<std::mutex> lock(lock_table_lock_);
+  auto entry = lock_table_.find(rid);
+  if (entry == lock_table_.end() ||
+      entry->second->GetGrantedMode(tid) != Mode::SHARED) {
+    return false;
   }
+  Row *row = entry->second.get();
 
-  // 2. if 1+ txns == wait die
-  
-  // 2.1. wait 
-  if(row->UpgradeWaitQueueEmpty() || tid <= upgrade_wait_queue_[0] ){
-    // cv block til only T1 in grant set
-    cv_grant_set_.wait(lock_table_lock_, [&]()){
-      return row->IsOnlyTxnInGrantedSet(tid);
-    }
-
-    // T1 slock -> xlock (in grant set)
-    row->UpgradeGrantedSet(tid);
-    return true;
-
-  // 2.2. die 
-  } else {
+  // 1. die: an older txn holds / waits for it, or upgrades it already
+  if (row->MustDie(Request(tid, Mode::EXCLUSIVE))) {
+    lock_dies->Add();
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  
-}
 
+  // 2. wait til the other shared locks are released
+  if (!row->IsOnlyTxnInGrantedSet(tid)) {
+    row->upgrading_ = tid;
+    lock_waits->Add();
+    MetricTimer timer(lock_wait_latency);
+    cv_grant_set_.wait(lock, [&] { return row->IsOnlyTxnInGrantedSet(tid); });
+    row->upgrading_ = INVALID_TXN_ID;
+  }
+
+  // 3. T1 slock -> xlock (in grant set)
+  row->UpgradeGrantedSet(tid);
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetExclusiveLockSet()->emplace(rid);
+  return true;
+}
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief 
- * 
- * txn state: grow -> shrink
- * 
- * Q&A:
- * how to ensure txn got all locks (2PL) ?? 
- * - txn manager once got signal from last lock() call
- * - txn manager then u() to shrinking state
- * 
- * once granted set changes from x to s
- * all slock in wait queue auto granted slock ??
- * - i dont think so ??
- * 
+ * @brief
+ *
+ * txn state: grow -> shrink, 1st unlock (vanilla 2PL)
+ *
+ * strict 2PL: locks held till commit / abort, unlock before that refused
  */
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
-
-  // 0. 
-  auto row = lock_table_[rid];
-  txn_id_t tid = txn->GetTransactionId();  
-  if(!IsTxnInGrantedSet(tid)){return false;}
-
-
-  // 1. if strict 2pl
-  // txn must "commit" or "abort" before it calls unlock()
-
-
-  // 2. if vanilla 2pl 
-
-  // 2.1 u() txn manager 
-  txn->SetState(TransactionState::SHRINKING);
-  if(row->GetGrantedSet(tid).mode_ == LockMode::SHARED){
-    txn->GetSharedLockSet()->erase(rid);
-  }else{
-    txn->GetExclusiveLockSet()->erase(rid);
+  if (strict_2PL_ && txn->GetState() != TransactionState::COMMITTED &&
+      txn->GetState() != TransactionState::ABORTED) {
+    return false;
   }
+  txn_id_t tid = txn->GetTransactionId();
 
-  // 2.2 u() lock table  
-  row->DeleteGrantedSet(tid);
+  std::lock_guard<std::mutex> lock(lock_table_lock_);
+  auto entry = lock_table_.find(rid);
+  if (entry == lock_table_.end() || !entry->second->DeleteGrantedSet(tid)) {
+    return false;
+  }
+  if (entry->second->IsEmpty()) {
+    lock_table_.erase(entry);
+  }
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetExclusiveLockSet()->erase(rid);
+  if (txn->GetState() == TransactionState::GROWING) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
 
-  
-  // 3. notify txns in wait queue + grant set 
+  // waiters of any row check again
   cv_wait_queue_.notify_all();
   cv_grant_set_.notify_all();
-
-
-
-  return false;
+  return true;
 }
 
 } // namespace cmudb
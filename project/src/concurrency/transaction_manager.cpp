@@ -19,6 +19,14 @@ namespace cmudb {
 Transaction *TransactionManager::Begin() {
   Transaction *txn = new Transaction(next_txn_id_++);
 
+  // in the ATT before its BEGIN is, a checkpoint in between can't miss it
+  {
+    std::lock_guard<std::mutex> guard(active_latch_);
+    lsn_t begin_lsn =
+        log_manager_ != nullptr ? log_manager_->GetNextLSN() : INVALID_LSN;
+    active_txns_[txn->GetTransactionId()] = {txn, begin_lsn};
+  }
+
   if (ENABLE_LOGGING) {
     // TODO: write log and update transaction's prev_lsn here
     
@@ -121,13 +129,15 @@ void TransactionManager::Commit(Transaction *txn) {
     // txn->SetPrevLSN(lsn); // no u() TT latestLSN
 
 
-    // 3.2 block till flush WAL(RAM) up to commit to disk
-    log_manager_->ForceFlushWAL();
+    // 3.2 block till WAL(RAM) up to commit is on disk, 1 flush per group of
+    // committers (see LogManager::WaitForFlush)
+    log_manager_->WaitForFlush(lsn);
 
     
     // 3.3 w() <END, txnID> to log     
 
   }
+  EndTransaction(txn);
 
 
   // 4. for 2PL 
@@ -181,11 +191,12 @@ void TransactionManager::Abort(Transaction *txn) {
 
     LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(), 
               LogRecordType::ABORT);    
-    auto lsn = log_manager->AppendLogRecord(log_entry);                
-    log_manager_->ForceFlushWAL();
+    auto lsn = log_manager_->AppendLogRecord(log_entry);
+    log_manager_->WaitForFlush(lsn);
 
 
   }
+  EndTransaction(txn);
 
   // release all the lock
   std::unordered_set<RID> lock_set;
@@ -198,4 +209,41 @@ void TransactionManager::Abort(Transaction *txn) {
     lock_manager_->Unlock(txn, locked_rid);
   }
 }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * ATT for a fuzzy checkpoint (see CheckpointManager). last lsns move on
+ * meanwhile, analysis picks up whatever is logged after BEGIN_CHECKPOINT
+ */
+void TransactionManager::GetActiveTransactions(
+    std::unordered_map<txn_id_t, lsn_t> &active_txns, lsn_t &oldest_lsn) {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  oldest_lsn = INVALID_LSN;
+  for (auto &entry : active_txns_) {
+    lsn_t last_lsn = entry.second.first->GetPrevLSN();
+    if (last_lsn != INVALID_LSN) {
+      active_txns[entry.first] = last_lsn;
+    }
+    lsn_t begin_lsn = entry.second.second;
+    if (oldest_lsn == INVALID_LSN || begin_lsn < oldest_lsn) {
+      oldest_lsn = begin_lsn;
+    }
+  }
+}
+
+// committed / aborted, its records are never undone
+void TransactionManager::EndTransaction(Transaction *txn) {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  active_txns_.erase(txn->GetTransactionId());
+}
 } // namespace cmudb
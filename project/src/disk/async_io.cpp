@@ -0,0 +1,422 @@
+/**
+ * async_io.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/async_io.h"
+
+namespace cmudb {
+
+int64_t IOHandle::Wait() {
+  if (!IsDone()) {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return done_.load(); });
+  }
+  return result_;
+}
+
+bool IOHandle::WaitAll(const std::vector<std::shared_ptr<IOHandle>> &handles) {
+  bool ok = true;
+  for (auto &handle : handles) {
+    ok = handle->Wait() >= 0 && ok;
+  }
+  return ok;
+}
+
+std::shared_ptr<IOHandle> IOHandle::Done(int64_t result) {
+  auto handle = std::make_shared<IOHandle>();
+  handle->Complete(result);
+  return handle;
+}
+
+void IOHandle::Complete(int64_t result) {
+  std::lock_guard<std::mutex> guard(latch_);
+  result_ = result;
+  done_.store(true, std::memory_order_release);
+  cv_.notify_all();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* common */
+
+AsyncIO *AsyncIO::Create(size_t queue_depth) {
+  try {
+    return new IoUringIO(queue_depth);
+  } catch (Exception &e) {
+    LOG_DEBUG("%s, falling back to thread pool", e.what());
+    return new ThreadPoolIO();
+  }
+}
+
+std::shared_ptr<IOHandle> AsyncIO::Submit(IOType type, int fd, char *data,
+                                          size_t size, int64_t offset,
+                                          IOCallback callback) {
+  std::vector<IORequest> requests(1);
+  requests[0] = {type, fd, data, size, offset, std::move(callback), nullptr};
+  return SubmitBatch(requests)[0];
+}
+
+std::vector<std::shared_ptr<IOHandle>>
+AsyncIO::SubmitBatch(std::vector<IORequest> &requests) {
+  std::vector<std::shared_ptr<IOHandle>> handles;
+  std::vector<IORequest *> owned;
+  for (auto &request : requests) {
+    handles.push_back(std::make_shared<IOHandle>());
+    owned.push_back(new IORequest(request));
+    owned.back()->handle_ = handles.back();
+  }
+  SubmitRequests(owned);
+  return handles;
+}
+
+void AsyncIO::Complete(IORequest *request, int64_t result) {
+  if (request->callback_) {
+    request->callback_(result);
+  }
+  request->handle_->Complete(result);
+  delete request;
+}
+
+/*
+ * blocking syscalls from done bytes on, until size / eof / error
+ * @return total bytes, or -errno
+ */
+int64_t AsyncIO::FinishShort(IORequest *request, int64_t done) {
+  size_t size = request->size_;
+  while (static_cast<size_t>(done) < size) {
+    ssize_t n;
+    char *data = request->data_ + done;
+    if (request->type_ == IOType::READ) {
+      n = pread(request->fd_, data, size - done, request->offset_ + done);
+    } else {
+      n = pwrite(request->fd_, data, size - done, request->offset_ + done);
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return -errno;
+    }
+    if (n == 0) {
+      break; // eof
+    }
+    done += n;
+  }
+  return done;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* thread pool */
+
+ThreadPoolIO::ThreadPoolIO(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.emplace_back(&ThreadPoolIO::WorkerLoop, this);
+  }
+}
+
+// queued requests still run
+ThreadPoolIO::~ThreadPoolIO() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIO::SubmitRequests(std::vector<IORequest *> &requests) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    queue_.insert(queue_.end(), requests.begin(), requests.end());
+  }
+  cv_.notify_all();
+}
+
+void ThreadPoolIO::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return; // stop_
+    }
+    IORequest *request = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+    Complete(request, FinishShort(request, 0));
+    lock.lock();
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* io_uring */
+
+struct IoUringIO::UringRequest {
+  IORequest *request_;
+  struct iovec iov_;
+};
+
+IoUringIO::IoUringIO(size_t queue_depth) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, queue_depth, &params);
+  if (ring_fd_ < 0) {
+    throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED,
+                    std::string("io_uring_setup: ") + strerror(errno));
+  }
+  sq_entries_ = params.sq_entries;
+  cq_entries_ = params.cq_entries;
+
+  // 1 mmap for both rings on newer kernels
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap
+                 ? sq_ring_
+                 : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    int error = errno;
+    if (sq_ring_ != MAP_FAILED)
+      munmap(sq_ring_, sq_ring_size_);
+    if (!single_mmap && cq_ring_ != MAP_FAILED)
+      munmap(cq_ring_, cq_ring_size_);
+    if (sqes_ != MAP_FAILED)
+      munmap(sqes_, sqes_size_);
+    close(ring_fd_);
+    throw Exception(EXCEPTION_TYPE_NOT_IMPLEMENTED,
+                    std::string("io_uring mmap: ") + strerror(error));
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  reaper_ = std::thread(&IoUringIO::ReaperLoop, this);
+}
+
+/*
+ * nop w user_data 0 wakes the reaper, it leaves once everything in flight
+ * completed
+ */
+IoUringIO::~IoUringIO() {
+  {
+    std::unique_lock<std::mutex> lock(submit_latch_);
+    space_cv_.wait(lock, [this] { return in_flight_ < sq_entries_; });
+    stop_ = true;
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe *sqe =
+        static_cast<struct io_uring_sqe *>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = 0;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    in_flight_++;
+    Enter(1, 0, 0);
+  }
+  reaper_.join();
+
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+int IoUringIO::Enter(unsigned to_submit, unsigned min_complete,
+                     unsigned flags) {
+  while (true) {
+    int rc = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                     flags, nullptr, 0);
+    if (rc >= 0 || errno != EINTR) {
+      return rc;
+    }
+  }
+}
+
+/*
+ * batch in chunks that fit: wait for room, fill sqes, 1 enter per chunk
+ *
+ * enter failing for good == sqes the kernel didn't take are taken back off
+ * the ring, they n the requests not queued yet complete w -errno (after
+ * the latch is dropped, callbacks may take other latches)
+ */
+void IoUringIO::SubmitRequests(std::vector<IORequest *> &requests) {
+  std::vector<IORequest *> failed;
+  int error = 0;
+  {
+    std::unique_lock<std::mutex> lock(submit_latch_);
+    std::vector<UringRequest *> chunk;
+    size_t next = 0;
+    while (next < requests.size() && error == 0) {
+      chunk.clear();
+      while (next < requests.size() &&
+             in_flight_ + chunk.size() < sq_entries_) {
+        UringRequest *request = new UringRequest();
+        request->request_ = requests[next++];
+        QueueRequest(request);
+        chunk.push_back(request);
+      }
+      if (chunk.empty()) {
+        space_cv_.wait(lock); // ring full, reaper makes room
+        continue;
+      }
+      unsigned to_submit = chunk.size();
+      in_flight_ += to_submit;
+
+      // kernel may take fewer than asked (EAGAIN / EBUSY), rest stays queued
+      while (to_submit > 0) {
+        int rc = Enter(to_submit, 0, 0);
+        if (rc > 0) {
+          to_submit -= rc;
+        } else if (rc < 0 && errno != EAGAIN && errno != EBUSY) {
+          error = errno;
+          break;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      if (error != 0) {
+        LOG_DEBUG("io_uring_enter: %s", strerror(error));
+        // untaken sqes are the last ones queued, nobody else moves the tail
+        __atomic_store_n(sq_tail_, *sq_tail_ - to_submit, __ATOMIC_RELEASE);
+        in_flight_ -= to_submit;
+        space_cv_.notify_all();
+        for (size_t i = chunk.size() - to_submit; i < chunk.size(); i++) {
+          failed.push_back(chunk[i]->request_);
+          delete chunk[i];
+        }
+        failed.insert(failed.end(), requests.begin() + next, requests.end());
+      }
+    }
+  }
+  for (IORequest *request : failed) {
+    Complete(request, -error);
+  }
+}
+
+void IoUringIO::QueueRequest(UringRequest *request) {
+  IORequest *io = request->request_;
+  request->iov_.iov_base = io->data_;
+  request->iov_.iov_len = io->size_;
+
+  unsigned tail = *sq_tail_; // only submitters write it, under submit_latch_
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = io->fd_;
+  sqe->user_data = reinterpret_cast<uint64_t>(request);
+  sqe->opcode = io->type_ == IOType::READ ? IORING_OP_READV : IORING_OP_WRITEV;
+  sqe->addr = reinterpret_cast<uint64_t>(&request->iov_);
+  sqe->len = 1;
+  sqe->off = io->offset_;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * 1 wakeup == every cqe posted so far, head advanced once for the batch
+ */
+void IoUringIO::ReaperLoop() {
+  std::vector<std::pair<uint64_t, int64_t>> batch;
+  while (true) {
+    if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EBUSY) {
+      LOG_DEBUG("io_uring_enter: %s", strerror(errno));
+    }
+
+    batch.clear();
+    unsigned head = *cq_head_; // only the reaper writes it
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe =
+          static_cast<struct io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+      batch.emplace_back(cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    // sqes consumed == room for submitters. the latch also orders the
+    // submitter's request writes before our reads below (the kernel
+    // already does, sanitizers can't see that)
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> guard(submit_latch_);
+      in_flight_ -= batch.size();
+      space_cv_.notify_all();
+      stopping = stop_ && in_flight_ == 0;
+    }
+
+    for (auto &cqe : batch) {
+      if (cqe.first == 0) {
+        continue; // stop nop
+      }
+      UringRequest *request = reinterpret_cast<UringRequest *>(cqe.first);
+      IORequest *io = request->request_;
+      int64_t result = cqe.second;
+      if (result >= 0 && static_cast<size_t>(result) < io->size_) {
+        result = FinishShort(io, result); // signal / eof, rare
+      }
+      delete request;
+      Complete(io, result);
+    }
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+} // namespace cmudb
@@ -1,63 +1,339 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/types.h>
 #include <thread>
+#include <unistd.h>
 
+#include "common/crc32c.h"
 #include "common/logger.h"
+#include "common/lz4.h"
+#include "common/metrics.h"
 #include "disk/disk_manager.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
+// process wide, all db files add up (see common/metrics.h)
+static MetricCounter *page_reads =
+    MetricsRegistry::Instance().GetCounter("disk.page_reads");
+static MetricCounter *page_writes =
+    MetricsRegistry::Instance().GetCounter("disk.page_writes");
+static MetricCounter *log_writes =
+    MetricsRegistry::Instance().GetCounter("disk.log_writes");
+static MetricCounter *log_write_bytes =
+    MetricsRegistry::Instance().GetCounter("disk.log_write_bytes");
+static MetricHistogram *read_latency =
+    MetricsRegistry::Instance().GetHistogram("disk.page_read_us");
+static MetricHistogram *write_latency =
+    MetricsRegistry::Instance().GetHistogram("disk.page_write_us");
+static MetricHistogram *log_write_latency =
+    MetricsRegistry::Instance().GetHistogram("disk.log_write_us");
+static MetricCounter *reused_pages =
+    MetricsRegistry::Instance().GetCounter("disk.pages_reused");
+static MetricCounter *fsm_syncs =
+    MetricsRegistry::Instance().GetCounter("disk.fsm_syncs");
+static MetricCounter *fallocates =
+    MetricsRegistry::Instance().GetCounter("disk.fallocates");
+// direct_io I/O on a caller's unaligned buffer, copied through an aligned one
+static MetricCounter *bounced_ios =
+    MetricsRegistry::Instance().GetCounter("disk.direct_io_bounces");
+static MetricCounter *checksum_failures =
+    MetricsRegistry::Instance().GetCounter("disk.checksum_failures");
+static MetricCounter *pages_scrubbed =
+    MetricsRegistry::Instance().GetCounter("disk.pages_scrubbed");
+static MetricCounter *scrub_passes =
+    MetricsRegistry::Instance().GetCounter("disk.scrub_passes");
+// compressed files: slot bytes written, vs page_writes * page size
+static MetricCounter *packed_bytes =
+    MetricsRegistry::Instance().GetCounter("disk.packed_bytes_written");
+static MetricCounter *relocated_pages =
+    MetricsRegistry::Instance().GetCounter("disk.pages_relocated");
+
+// pread/pwrite until size bytes or eof/error, retry on EINTR
+// @return bytes done
+static size_t PreadFull(int fd, char *data, size_t size, int64_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+static size_t PwriteFull(int fd, const char *data, size_t size,
+                         int64_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+// <dir>/<name>.fsm next to <dir>/<name>.db, extension appended if none
+static std::string SiblingFile(const std::string &file,
+                               const std::string &extension) {
+  std::string::size_type dot = file.rfind('.');
+  std::string::size_type slash = file.rfind('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return file + extension;
+  }
+  return file.substr(0, dot) + extension;
+}
+
+// "" == db file's name up to its 1st '.', w .log
+static std::string LogFileName(const std::string &db_file,
+                               const std::string &log_file) {
+  if (!log_file.empty()) {
+    return log_file;
+  }
+  return db_file.substr(0, db_file.find('.')) + ".log";
+}
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input page_size: page size of a new database file
+ * @input direct_io: O_DIRECT, no OS page cache
+ * @input log_file: log file name, "" == db file name w .log
+ * @input compress: new db file compressed
+ * @input read_only: existing files only, O_RDONLY
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
+DiskManager::DiskManager(const std::string &db_file, size_t page_size,
+                         bool direct_io, const std::string &log_file,
+                         bool compress, bool read_only)
+    : file_name_(db_file), compress_(compress), read_only_(read_only),
+      page_size_(page_size), num_flushes_(0), flush_log_(false),
       flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
-  log_name_ = file_name_.substr(0, n) + ".log";
+  log_name_ = LogFileName(db_file, log_file);
 
-  log_io_.open(log_name_,
-               std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app |
-                                std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app |
-                                std::ios::out);
+  OpenFiles(direct_io);
+  DataFile *file = files_[0];
+  if (file == nullptr) {
+    return;
   }
 
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  // existing db == page size from header page, at a fixed offset so it can be
+  // read before knowing how big the header page is. 1st block, O_DIRECT
+  // reads nothing smaller. compressed == the whole page, whatever its size
+  size_t header_size =
+      file->compressed_ != nullptr ? MAX_PAGE_SIZE : MIN_PAGE_SIZE;
+  char *header = AllocateAligned(header_size);
+  int64_t read_count =
+      file->compressed_ != nullptr
+          ? file->compressed_->ReadPage(0, header, header_size)
+          : static_cast<int64_t>(PreadFull(file->fd_, header, header_size, 0));
+  if (read_count >= HEADER_PAGE_SIZE_OFFSET + 4) {
+    int32_t stored;
+    memcpy(&stored, header + HEADER_PAGE_SIZE_OFFSET, 4);
+    if (stored >= MIN_PAGE_SIZE && stored <= MAX_PAGE_SIZE &&
+        (stored & (stored - 1)) == 0) {
+      page_size_ = stored;
+    } else {
+      LOG_DEBUG("no page size in header page, using %zu", page_size_);
+    }
   }
+  FreeAligned(header);
+
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  LoadFreeSpaceMap(file);
+}
+
+void DiskManager::RemoveFiles(const std::string &db_file,
+                              const std::string &log_file) {
+  remove(db_file.c_str());
+  remove(SiblingFile(db_file, ".fsm").c_str());
+  remove(SiblingFile(db_file, ".map").c_str());
+  remove(LogFileName(db_file, log_file).c_str());
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  StopScrubber();
+  async_io_.reset(); // in-flight I/O done before fds go
+  for (auto &slot : files_) {
+    DataFile *file = slot;
+    if (file == nullptr)
+      continue;
+    if (file->fd_ >= 0)
+      close(file->fd_);
+    if (file->fsm_fd_ >= 0)
+      close(file->fsm_fd_);
+    delete file;
+  }
+  if (log_fd_ >= 0)
+    close(log_fd_);
+  FreeAligned(log_tail_);
+}
+
+/**
+ * both created if they do not exist. O_DIRECT refused == buffered, for both
+ * files. read-only == the db file only, buffered
+ */
+void DiskManager::OpenFiles(bool direct_io) {
+  if (read_only_) {
+    files_[0] = OpenDataFile(file_name_, SiblingFile(file_name_, ".fsm"));
+    return;
+  }
+  if (direct_io) {
+    // positional writes of whole blocks, O_APPEND can't do that
+    log_fd_ = open(log_name_.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (log_fd_ >= 0) {
+      direct_io_ = true;
+      files_[0] = OpenDataFile(file_name_, SiblingFile(file_name_, ".fsm"));
+      DataFile *file = files_[0];
+      if (file != nullptr && (file->compressed_ != nullptr ||
+                              (fcntl(file->fd_, F_GETFL) & O_DIRECT) != 0)) {
+        log_size_ = GetFileSize(log_name_);
+        log_reserved_ = log_size_;
+        log_tail_ = AllocateAligned(DIRECT_IO_ALIGNMENT);
+        int64_t tail_offset = log_size_ - log_size_ % DIRECT_IO_ALIGNMENT;
+        PreadFull(log_fd_, log_tail_, DIRECT_IO_ALIGNMENT, tail_offset);
+        return;
+      }
+      direct_io_ = false;
+      close(log_fd_);
+      if (file != nullptr) {
+        close(file->fd_);
+        close(file->fsm_fd_);
+        delete file;
+        files_[0] = nullptr;
+      }
+    }
+    LOG_DEBUG("O_DIRECT: %s, using buffered I/O", strerror(errno));
+  }
+
+  log_fd_ = open(log_name_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (log_fd_ < 0) {
+    LOG_DEBUG("can't open log file");
+  }
+  log_size_ = log_reserved_ = std::max<int64_t>(GetFileSize(log_name_), 0);
+  files_[0] = OpenDataFile(file_name_, SiblingFile(file_name_, ".fsm"));
+}
+
+/**
+ * direct_io_ n a file system w/o O_DIRECT (another volume) == that file
+ * buffered, the others stay direct. compressed: slots are not block
+ * aligned, always buffered
+ */
+DiskManager::DataFile *DiskManager::OpenDataFile(const std::string &db_file,
+                                                 const std::string &fsm_file) {
+  std::string map_file = SiblingFile(db_file, ".map");
+  bool compressed = GetFileSize(db_file) > 0 ? GetFileSize(map_file) > 0
+                                             : compress_ && !read_only_;
+  if (!compressed && !read_only_ && GetFileSize(map_file) >= 0) {
+    remove(map_file.c_str()); // stale, next to an empty / plain file
+  }
+  int flags = read_only_ ? O_RDONLY : O_RDWR | O_CREAT;
+  int fd = -1;
+  if (direct_io_ && !compressed) {
+    fd = open(db_file.c_str(), flags | O_DIRECT, 0644);
+  }
+  if (fd < 0) {
+    fd = open(db_file.c_str(), flags, 0644);
+  }
+  if (fd < 0) {
+    LOG_DEBUG("can't open db file %s", db_file.c_str());
+    return nullptr;
+  }
+  DataFile *file = new DataFile;
+  file->fd_ = fd;
+  file->name_ = db_file;
+  file->fsm_name_ = fsm_file;
+  // tiny, written in bursts == always through the page cache. read-only
+  // w/o one == every page allocated (LoadFreeSpaceMap)
+  file->fsm_fd_ = open(fsm_file.c_str(), flags, 0644);
+  if (file->fsm_fd_ < 0 && !read_only_) {
+    LOG_DEBUG("can't open free space map");
+  }
+  if (compressed) {
+    file->compressed_.reset(new CompressedPageFile(fd, map_file, read_only_));
+  }
+  return file;
+}
+
+/**
+ * files are never closed before the destructor == a page id's file stays
+ * valid for any I/O once published
+ */
+bool DiskManager::OpenTablespace(int tablespace_id,
+                                 const std::string &db_file) {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (tablespace_id <= 0 || tablespace_id >= MAX_TABLESPACES ||
+      files_[tablespace_id] != nullptr) {
+    return false;
+  }
+  DataFile *file = OpenDataFile(db_file, SiblingFile(db_file, ".fsm"));
+  if (file == nullptr) {
+    return false;
+  }
+  LoadFreeSpaceMap(file);
+  files_[tablespace_id].store(file, std::memory_order_release);
+  return true;
+}
+
+int DiskManager::CreateTablespace(const std::string &db_file) {
+  for (int tablespace_id = 1; tablespace_id < MAX_TABLESPACES;
+       tablespace_id++) {
+    if (!HasTablespace(tablespace_id)) {
+      return OpenTablespace(tablespace_id, db_file) ? tablespace_id : -1;
+    }
+  }
+  return -1;
+}
+
+bool DiskManager::HasTablespace(int tablespace_id) const {
+  return tablespace_id >= 0 && tablespace_id < MAX_TABLESPACES &&
+         files_[tablespace_id].load(std::memory_order_acquire) != nullptr;
+}
+
+bool DiskManager::IsCompressed(int tablespace_id) const {
+  return HasTablespace(tablespace_id) &&
+         files_[tablespace_id].load()->compressed_ != nullptr;
+}
+
+DiskManager::DataFile *DiskManager::GetFile(page_id_t page_id,
+                                            int64_t &offset) const {
+  if (page_id < 0) {
+    return nullptr;
+  }
+  offset = static_cast<int64_t>(GetFilePageId(page_id)) * page_size_;
+  return files_[GetTablespaceId(page_id)].load(std::memory_order_acquire);
+}
+
+char *DiskManager::AllocateAligned(size_t size) {
+  size = (size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT *
+         DIRECT_IO_ALIGNMENT;
+  void *data = nullptr;
+  if (posix_memalign(&data, DIRECT_IO_ALIGNMENT, size) != 0) {
+    throw std::bad_alloc();
+  }
+  return static_cast<char *>(data);
 }
 
 
@@ -74,41 +350,671 @@ DiskManager::~DiskManager() {
 /**
  * Write the contents of the specified page into disk file
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+void DiskManager::WritePage(page_id_t page_id, char *page_data) {
+  WritePages(page_id, page_data, 1);
+}
+
+/**
+ * Write num_pages consecutive pages (pages_data holds them back to back)
+ * starting at first_page_id, e.g. a run of a sorted flush
+ */
+void DiskManager::WritePages(page_id_t first_page_id, char *pages_data,
+                             size_t num_pages) {
+  if (fsm_dirty_) {
+    SyncFreeSpaceMap(); // pages allocated before anything can point at them
+  }
+  int64_t offset;
+  DataFile *file = GetFile(first_page_id, offset);
+  if (file == nullptr) {
+    LOG_DEBUG("no tablespace for page %d", first_page_id);
+    return;
+  }
+  page_writes->Add(num_pages);
+  MetricTimer timer(write_latency);
+  StampChecksums(pages_data, num_pages);
+  if (file->compressed_ != nullptr) {
+    if (!file->compressed_->WritePages(GetFilePageId(first_page_id),
+                                       pages_data, num_pages, page_size_)) {
+      LOG_DEBUG("I/O error while writing");
+    }
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  size_t size = num_pages * page_size_;
+  const char *data = pages_data;
+  char *bounce = nullptr;
+  if (NeedsBounce(pages_data)) {
+    bounced_ios->Add();
+    bounce = AllocateAligned(size);
+    memcpy(bounce, pages_data, size);
+    data = bounce;
+  }
+  // in the OS page cache once it returns (on disk w direct_io),
+  // SyncPages() for durability
+  if (PwriteFull(file->fd_, data, size, offset) < size) {
+    LOG_DEBUG("I/O error while writing");
+  }
+  FreeAligned(bounce);
+}
+
+void DiskManager::SyncPages() {
+  for (auto &slot : files_) {
+    DataFile *file = slot.load(std::memory_order_acquire);
+    if (file != nullptr && file->compressed_ != nullptr) {
+      if (!file->compressed_->Sync()) {
+        LOG_DEBUG("I/O error while syncing %s", file->name_.c_str());
+      }
+    } else if (file != nullptr && fdatasync(file->fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing %s", file->name_.c_str());
+    }
+  }
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  int64_t offset;
+  DataFile *file = GetFile(page_id, offset);
+  if (file == nullptr) {
+    LOG_DEBUG("no tablespace for page %d", page_id);
+    memset(page_data, 0, page_size_);
+    return false;
+  }
+  page_reads->Add();
+  MetricTimer timer(read_latency);
+  if (file->compressed_ != nullptr) {
+    // can't be decompressed == corrupt, w or w/o checksum checks
+    if (!ReadCompressedPage(file, page_id, page_data) ||
+        (verify_checksums_ && !ChecksumMatches(page_data))) {
+      ReportCorruptPage(page_id);
+      return false;
     }
+    return true;
+  }
+  char *bounce = nullptr;
+  if (NeedsBounce(page_data)) {
+    bounced_ios->Add();
+    bounce = AllocateAligned(page_size_);
   }
+  char *buffer = bounce != nullptr ? bounce : page_data;
+  size_t read_count = PreadFull(file->fd_, buffer, page_size_, offset);
+  // if file ends before reading page_size_ (never written / beyond eof)
+  if (read_count < page_size_) {
+    LOG_DEBUG("Read less than a page");
+    memset(buffer + read_count, 0, page_size_ - read_count);
+  }
+  if (bounce != nullptr) {
+    memcpy(page_data, bounce, page_size_);
+    FreeAligned(bounce);
+  }
+  if (verify_checksums_ && !ChecksumMatches(page_data)) {
+    ReportCorruptPage(page_id);
+    return false;
+  }
+  return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* read-only mapping */
+
+/**
+ * pages written later (by another process) past the mapped length are not
+ * part of the mapping
+ */
+const char *DiskManager::MapPages(size_t &num_pages, int tablespace_id) {
+  num_pages = 0;
+  if (!HasTablespace(tablespace_id)) {
+    return nullptr;
+  }
+  DataFile *file = files_[tablespace_id];
+  if (file->compressed_ != nullptr) {
+    LOG_DEBUG("tablespace %d is compressed, can't be mapped", tablespace_id);
+    return nullptr;
+  }
+  int64_t file_size = GetFileSize(file->name_);
+  num_pages = file_size > 0 ? file_size / page_size_ : 0;
+  if (num_pages == 0) {
+    return nullptr;
+  }
+  void *data = mmap(nullptr, num_pages * page_size_, PROT_READ, MAP_SHARED,
+                    file->fd_, 0);
+  if (data == MAP_FAILED) {
+    LOG_DEBUG("mmap: %s", strerror(errno));
+    num_pages = 0;
+    return nullptr;
+  }
+  return static_cast<const char *>(data);
+}
+
+void DiskManager::UnmapPages(const char *data, size_t num_pages) {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), num_pages * page_size_);
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* async I/O */
+
+AsyncIO *DiskManager::GetAsyncIO() {
+  std::call_once(async_io_once_,
+                 [this] { async_io_.reset(AsyncIO::Create()); });
+  return async_io_.get();
+}
+
+/**
+ * latency == submit to completion, i.e. incl. queueing in the backend
+ */
+std::shared_ptr<IOHandle> DiskManager::ReadPageAsync(page_id_t page_id,
+                                                     char *page_data,
+                                                     IOCallback on_done) {
+  int64_t offset;
+  DataFile *file = GetFile(page_id, offset);
+  if (file == nullptr) {
+    LOG_DEBUG("no tablespace for page %d", page_id);
+    memset(page_data, 0, page_size_);
+    if (on_done) {
+      on_done(-EBADF);
+    }
+    return IOHandle::Done(-EBADF);
+  }
+  if (file->compressed_ != nullptr) {
+    // slot lookup + decompression, nothing to overlap
+    int64_t result = ReadPage(page_id, page_data) ? page_size_ : -EIO;
+    if (on_done) {
+      on_done(result);
+    }
+    return IOHandle::Done(result);
+  }
+  size_t page_size = page_size_;
+  page_reads->Add();
+  char *bounce = nullptr;
+  if (NeedsBounce(page_data)) {
+    bounced_ios->Add();
+    bounce = AllocateAligned(page_size_);
+  }
+  auto start = std::chrono::steady_clock::now();
+  return GetAsyncIO()->Submit(
+      IOType::READ, file->fd_, bounce != nullptr ? bounce : page_data,
+      page_size_, offset, [=](int64_t result) {
+        read_latency->RecordSince(start);
+        size_t read_count = result < 0 ? 0 : result;
+        if (bounce != nullptr) {
+          memcpy(page_data, bounce, read_count);
+          FreeAligned(bounce);
+        }
+        if (read_count < page_size) {
+          memset(page_data + read_count, 0, page_size - read_count);
+        }
+        if (result >= 0 && verify_checksums_ && !ChecksumMatches(page_data)) {
+          ReportCorruptPage(page_id);
+          result = -EIO;
+        }
+        if (on_done) {
+          on_done(result);
+        }
+      });
+}
+
+std::shared_ptr<IOHandle> DiskManager::WritePagesAsync(page_id_t first_page_id,
+                                                       char *pages_data,
+                                                       size_t num_pages,
+                                                       IOCallback on_done) {
+  if (fsm_dirty_) {
+    SyncFreeSpaceMap();
+  }
+  int64_t offset;
+  DataFile *file = GetFile(first_page_id, offset);
+  if (file == nullptr) {
+    LOG_DEBUG("no tablespace for page %d", first_page_id);
+    if (on_done) {
+      on_done(-EBADF);
+    }
+    return IOHandle::Done(-EBADF);
+  }
+  size_t size = num_pages * page_size_;
+  if (file->compressed_ != nullptr) {
+    // compressed n written before returning, like WritePages()
+    WritePages(first_page_id, pages_data, num_pages);
+    if (on_done) {
+      on_done(size);
+    }
+    return IOHandle::Done(size);
+  }
+  page_writes->Add(num_pages);
+  StampChecksums(pages_data, num_pages);
+  char *bounce = nullptr;
+  if (NeedsBounce(pages_data)) {
+    bounced_ios->Add();
+    bounce = AllocateAligned(size);
+    memcpy(bounce, pages_data, size);
+  }
+  auto start = std::chrono::steady_clock::now();
+  return GetAsyncIO()->Submit(
+      IOType::WRITE, file->fd_,
+      bounce != nullptr ? bounce : pages_data, size,
+      offset, [=](int64_t result) {
+        write_latency->RecordSince(start);
+        FreeAligned(bounce);
+        if (result < 0) {
+          LOG_DEBUG("I/O error while writing");
+        }
+        if (on_done) {
+          on_done(result);
+        }
+      });
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* checksums */
+
+void DiskManager::StampChecksums(char *pages_data, size_t num_pages) {
+  size_t covered = page_size_ - PAGE_CHECKSUM_SIZE;
+  for (size_t i = 0; i < num_pages; i++) {
+    char *page = pages_data + i * page_size_;
+    uint32_t crc = Crc32c::Compute(page, covered);
+    crc = crc == 0 ? 1 : crc; // 0 == not stamped
+    memcpy(page + covered, &crc, PAGE_CHECKSUM_SIZE);
+  }
+}
+
+bool DiskManager::ChecksumMatches(const char *page_data) const {
+  size_t covered = page_size_ - PAGE_CHECKSUM_SIZE;
+  uint32_t stored;
+  memcpy(&stored, page_data + covered, PAGE_CHECKSUM_SIZE);
+  if (stored == 0) {
+    return true;
+  }
+  uint32_t crc = Crc32c::Compute(page_data, covered);
+  return stored == (crc == 0 ? 1 : crc);
+}
+
+void DiskManager::ReportCorruptPage(page_id_t page_id) {
+  LOG_DEBUG("checksum mismatch on page %d", page_id);
+  checksum_failures->Add();
+  std::lock_guard<std::mutex> guard(corrupt_latch_);
+  corrupt_pages_.insert(page_id);
+}
+
+std::vector<page_id_t> DiskManager::GetCorruptPages() {
+  std::lock_guard<std::mutex> guard(corrupt_latch_);
+  return std::vector<page_id_t>(corrupt_pages_.begin(), corrupt_pages_.end());
+}
+
+void DiskManager::StartScrubber(size_t pages_per_second,
+                                std::function<bool(page_id_t)> skip) {
+  std::lock_guard<std::mutex> guard(scrub_latch_);
+  if (scrubber_.joinable()) {
+    return;
+  }
+  stop_scrub_ = false;
+  scrubber_ = std::thread(&DiskManager::ScrubLoop, this,
+                          std::max<size_t>(pages_per_second, 1),
+                          std::move(skip));
+}
+
+void DiskManager::StopScrubber() {
+  {
+    std::lock_guard<std::mutex> guard(scrub_latch_);
+    stop_scrub_ = true;
+  }
+  scrub_cv_.notify_all();
+  if (scrubber_.joinable()) {
+    scrubber_.join();
+  }
+}
+
+/**
+ * 1 page per interval, waiting on scrub_cv_ == stopping does not wait out
+ * the throttle. reads w pread into its own buffer: no buffer pool frame, no
+ * page cache pollution beyond what the read itself does. a mismatch is read
+ * again once, a write racing the 1st read can't fail the page
+ */
+void DiskManager::ScrubLoop(size_t pages_per_second,
+                            std::function<bool(page_id_t)> skip) {
+  auto interval = std::chrono::microseconds(1000000 / pages_per_second);
+  auto next = std::chrono::steady_clock::now();
+  char *buffer = AllocateAligned(page_size_);
+  std::unique_lock<std::mutex> lock(scrub_latch_);
+  auto wait = [&] {
+    next = std::max(next + interval, std::chrono::steady_clock::now());
+    return scrub_cv_.wait_until(lock, next, [this] { return stop_scrub_; });
+  };
+  while (!wait()) {
+    for (int tablespace_id = 0; tablespace_id < MAX_TABLESPACES;
+         tablespace_id++) {
+      DataFile *file = files_[tablespace_id].load(std::memory_order_acquire);
+      for (page_id_t page = 0; file != nullptr; page++) {
+        page_id_t end_page_id;
+        {
+          std::lock_guard<std::mutex> guard(fsm_latch_);
+          end_page_id = file->end_page_id_;
+        }
+        if (page >= end_page_id) {
+          break;
+        }
+        page_id_t page_id = MakePageId(tablespace_id, page);
+        if (!IsAllocated(page_id) || (skip && skip(page_id))) {
+          continue;
+        }
+        if (wait()) {
+          FreeAligned(buffer);
+          return;
+        }
+        int64_t offset = static_cast<int64_t>(page) * page_size_;
+        bool ok = false;
+        for (int attempt = 0; attempt < 2 && !ok; attempt++) {
+          if (file->compressed_ != nullptr) {
+            ok = ReadCompressedPage(file, page_id, buffer) &&
+                 ChecksumMatches(buffer);
+            continue;
+          }
+          size_t read_count = PreadFull(file->fd_, buffer, page_size_, offset);
+          ok = read_count < page_size_ || ChecksumMatches(buffer);
+        }
+        pages_scrubbed->Add();
+        if (!ok) {
+          ReportCorruptPage(page_id);
+        }
+      }
+    }
+    scrub_passes->Add();
+  }
+  FreeAligned(buffer);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* compressed page files */
+
+bool DiskManager::ReadCompressedPage(DataFile *file, page_id_t page_id,
+                                     char *page_data) {
+  int64_t size = file->compressed_->ReadPage(GetFilePageId(page_id),
+                                             page_data, page_size_);
+  if (size == static_cast<int64_t>(page_size_)) {
+    return true;
+  }
+  memset(page_data, 0, page_size_);
+  return size == 0;
+}
+
+/**
+ * slots rebuilt from the map: the gaps between mapped slots are free (slots
+ * freed before a crash included)
+ */
+CompressedPageFile::CompressedPageFile(int fd, const std::string &map_file,
+                                       bool read_only)
+    : fd_(fd) {
+  map_fd_ = open(map_file.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT,
+                 0644);
+  if (map_fd_ < 0) {
+    LOG_DEBUG("can't open slot map %s", map_file.c_str());
+    return;
+  }
+  struct stat stat_buf;
+  if (fstat(fd_, &stat_buf) != 0 || stat_buf.st_size == 0) {
+    if (!read_only && ftruncate(map_fd_, 0) != 0) {
+      LOG_DEBUG("can't reset slot map");
+    }
+    return;
+  }
+  if (fstat(map_fd_, &stat_buf) != 0) {
+    return;
+  }
+  std::vector<uint32_t> entries(stat_buf.st_size / 8 * 2);
+  PreadFull(map_fd_, reinterpret_cast<char *>(entries.data()),
+            entries.size() * 4, 0);
+  slots_.resize(entries.size() / 2);
+  std::vector<std::pair<uint32_t, uint32_t>> used;
+  for (size_t page = 0; page < slots_.size(); page++) {
+    Slot &slot = slots_[page];
+    slot.offset_ = entries[2 * page];
+    slot.length_ = entries[2 * page + 1];
+    if (slot.length_ == 0) {
+      continue;
+    }
+    slot.units_ = ((slot.length_ & ~RAW_SLOT) + COMPRESSED_SLOT_SIZE - 1) /
+                  COMPRESSED_SLOT_SIZE;
+    used.emplace_back(slot.offset_, slot.units_);
+  }
+  std::sort(used.begin(), used.end());
+  for (auto &slot : used) {
+    if (slot.first > end_) {
+      free_slots_[slot.first - end_].push_back(end_);
+    }
+    end_ = std::max(end_, slot.first + slot.second);
+  }
+}
+
+CompressedPageFile::~CompressedPageFile() {
+  if (map_fd_ >= 0) {
+    close(map_fd_);
+  }
+}
+
+/**
+ * 1. compressed into a staging buffer, slot after slot, w/o latch_
+ * 2. a fresh slot for every page, never the one it is in (copy on write)
+ * 3. data written, runs of adjacent slots at once
+ * 4. map entries switched n written, old slots pending till Sync()
+ * a reader sees the old slot until 4 == never a slot being written
+ */
+bool CompressedPageFile::WritePages(page_id_t page, const char *pages_data,
+                                    size_t num_pages, size_t page_size) {
+  const size_t unit = COMPRESSED_SLOT_SIZE;
+  size_t page_units = (page_size + unit - 1) / unit;
+  std::vector<char> staging(num_pages * page_units * unit, 0);
+  std::vector<uint32_t> lengths(num_pages), units(num_pages),
+      offsets(num_pages);
+  std::vector<size_t> positions(num_pages);
+  size_t position = 0;
+  for (size_t i = 0; i < num_pages; i++) {
+    const char *data = pages_data + i * page_size;
+    // must save at least 1 unit, else raw
+    size_t length = Lz4::Compress(data, page_size, &staging[position],
+                                  (page_units - 1) * unit);
+    if (length == 0) {
+      memcpy(&staging[position], data, page_size);
+      lengths[i] = page_size | RAW_SLOT;
+      units[i] = page_units;
+    } else {
+      lengths[i] = length;
+      units[i] = (length + unit - 1) / unit;
+    }
+    positions[i] = position;
+    position += units[i] * unit;
+  }
+  packed_bytes->Add(position);
+
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (slots_.size() < page + num_pages) {
+      slots_.resize(page + num_pages);
+    }
+    for (size_t i = 0; i < num_pages; i++) {
+      offsets[i] = AllocateSlot(units[i]);
+    }
+  }
+
+  bool ok = true;
+  for (size_t begin = 0, end = 1; begin < num_pages; begin = end, end++) {
+    while (end < num_pages &&
+           offsets[end] == offsets[end - 1] + units[end - 1]) {
+      end++;
+    }
+    size_t size = positions[end - 1] + units[end - 1] * unit - positions[begin];
+    if (PwriteFull(fd_, &staging[positions[begin]], size,
+                   static_cast<int64_t>(offsets[begin]) * unit) < size) {
+      ok = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(latch_);
+  for (size_t i = 0; i < num_pages; i++) {
+    Slot &slot = slots_[page + i];
+    if (!ok) {
+      pending_free_.emplace_back(offsets[i], units[i]); // old slot stays
+      continue;
+    }
+    if (slot.length_ != 0) {
+      relocated_pages->Add();
+      pending_free_.emplace_back(slot.offset_, slot.units_);
+    }
+    slot.offset_ = offsets[i];
+    slot.length_ = lengths[i];
+    slot.units_ = units[i];
+  }
+  // under latch_ == a Sync() releasing these old slots syncs the entries
+  return WriteMapEntries(page, num_pages) && ok;
+}
+
+/**
+ * read latch from slot lookup to the end of the read, see Sync()
+ */
+int64_t CompressedPageFile::ReadPage(page_id_t page, char *page_data,
+                                     size_t capacity) {
+  std::shared_lock<std::shared_timed_mutex> read_guard(reads_);
+  Slot slot;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (page < 0 || static_cast<size_t>(page) >= slots_.size()) {
+      return 0;
+    }
+    slot = slots_[page];
+  }
+  if (slot.length_ == 0) {
+    return 0;
+  }
+  size_t length = slot.length_ & ~RAW_SLOT;
+  int64_t offset = static_cast<int64_t>(slot.offset_) * COMPRESSED_SLOT_SIZE;
+  if (slot.length_ & RAW_SLOT) {
+    if (length > capacity || PreadFull(fd_, page_data, length, offset) < length) {
+      return -1;
+    }
+    return length;
+  }
+  std::vector<char> packed(length);
+  if (PreadFull(fd_, packed.data(), length, offset) < length) {
+    return -1;
+  }
+  return Lz4::Decompress(packed.data(), length, page_data, capacity);
+}
+
+void CompressedPageFile::FreePage(page_id_t page) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (page < 0 || static_cast<size_t>(page) >= slots_.size() ||
+      slots_[page].length_ == 0) {
+    return;
+  }
+  pending_free_.emplace_back(slots_[page].offset_, slots_[page].units_);
+  slots_[page] = Slot();
+  WriteMapEntries(page, 1);
+}
+
+/**
+ * slots freed after the count was taken may have map entries written after
+ * the map sync, they wait for the next one. reads in flight may still use
+ * an old slot they looked up before its entry switched == waited out 1st
+ */
+bool CompressedPageFile::Sync() {
+  size_t num_pending;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    num_pending = pending_free_.size();
+  }
+  if (fdatasync(fd_) != 0 || fdatasync(map_fd_) != 0) {
+    return false;
+  }
+  { std::lock_guard<std::shared_timed_mutex> drain(reads_); }
+  std::lock_guard<std::mutex> guard(latch_);
+  for (size_t i = 0; i < num_pending; i++) {
+    free_slots_[pending_free_[i].second].push_back(pending_free_[i].first);
+  }
+  pending_free_.erase(pending_free_.begin(),
+                      pending_free_.begin() + num_pending);
+  return true;
+}
+
+page_id_t CompressedPageFile::GetNumPages() {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t num_pages = slots_.size();
+  while (num_pages > 0 && slots_[num_pages - 1].length_ == 0) {
+    num_pages--;
+  }
+  return num_pages;
+}
+
+int64_t CompressedPageFile::GetPackedSize() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return static_cast<int64_t>(end_) * COMPRESSED_SLOT_SIZE;
+}
+
+/**
+ * best fit, the rest of a bigger slot stays free. else the end of the file
+ */
+uint32_t CompressedPageFile::AllocateSlot(uint32_t units) {
+  auto it = free_slots_.lower_bound(units);
+  if (it == free_slots_.end()) {
+    uint32_t offset = end_;
+    end_ += units;
+    return offset;
+  }
+  uint32_t offset = it->second.back();
+  uint32_t free_units = it->first;
+  it->second.pop_back();
+  if (it->second.empty()) {
+    free_slots_.erase(it);
+  }
+  if (free_units > units) {
+    free_slots_[free_units - units].push_back(offset + units);
+  }
+  return offset;
+}
+
+bool CompressedPageFile::WriteMapEntries(page_id_t page, size_t num_pages) {
+  std::vector<uint32_t> entries(2 * num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    entries[2 * i] = slots_[page + i].offset_;
+    entries[2 * i + 1] = slots_[page + i].length_;
+  }
+  size_t size = entries.size() * 4;
+  return PwriteFull(map_fd_, reinterpret_cast<const char *>(entries.data()),
+                    size, static_cast<int64_t>(page) * 8) == size;
 }
 
 
@@ -127,8 +1033,8 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != log_buffer_used_);
+  log_buffer_used_ = log_data;
 
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
     return;
@@ -141,19 +1047,69 @@ void DiskManager::WriteLog(char *log_data, int size) {
            std::future_status::ready);
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
+  log_writes->Add();
+  log_write_bytes->Add(size);
+  MetricTimer timer(log_write_latency);
+  ReserveLogSpace(size);
+  if (direct_io_) {
+    if (WriteLogDirect(log_data, size)) {
+      flush_log_ = false;
+    }
+    return;
+  }
+  // sequence write, O_APPEND == always at the end
+  size_t done = 0;
+  while (done < static_cast<size_t>(size)) {
+    ssize_t n = write(log_fd_, log_data + done, size - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_DEBUG("I/O error while writing log");
+      log_size_ = GetFileSize(log_name_);
+      return;
+    }
+    done += n;
+  }
+  log_size_ += size;
+  // durable before returning
+  if (fdatasync(log_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing log");
     return;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
+/**
+ * O_DIRECT writes whole blocks at block offsets: rewrite the partial last
+ * block w the new data appended, zero padded. then the file is cut back to
+ * the real log size, so readers never see the padding, n synced (1
+ * fdatasync covers data n size)
+ */
+bool DiskManager::WriteLogDirect(const char *log_data, size_t size) {
+  size_t head = log_size_ % DIRECT_IO_ALIGNMENT;
+  int64_t offset = log_size_ - head;
+  size_t padded = (head + size + DIRECT_IO_ALIGNMENT - 1) /
+                  DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+  char *blocks = AllocateAligned(padded);
+  memcpy(blocks, log_tail_, head);
+  memcpy(blocks + head, log_data, size);
+  memset(blocks + head + size, 0, padded - head - size);
+
+  bool ok = PwriteFull(log_fd_, blocks, padded, offset) == padded &&
+            ftruncate(log_fd_, log_size_ + size) == 0 &&
+            fdatasync(log_fd_) == 0;
+  if (ok) {
+    log_size_ += size;
+    size_t tail = log_size_ % DIRECT_IO_ALIGNMENT;
+    memcpy(log_tail_, blocks + (log_size_ - tail - offset), tail);
+  } else {
+    LOG_DEBUG("I/O error while writing log");
+  }
+  FreeAligned(blocks);
+  return ok;
+}
+
 
 
 
@@ -169,12 +1125,23 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
     // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
+  int read_count;
+  if (direct_io_) {
+    // whole blocks around [offset, offset + size) into an aligned copy
+    int64_t start = offset - offset % DIRECT_IO_ALIGNMENT;
+    size_t length = (offset + size - start + DIRECT_IO_ALIGNMENT - 1) /
+                    DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    char *blocks = AllocateAligned(length);
+    int64_t done = PreadFull(log_fd_, blocks, length, start);
+    read_count = std::max<int64_t>(
+        0, std::min<int64_t>(size, done - (offset - start)));
+    memcpy(log_data, blocks + (offset - start), read_count);
+    FreeAligned(blocks);
+  } else {
+    read_count = PreadFull(log_fd_, log_data, size, offset);
+  }
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
@@ -192,18 +1159,396 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 
 }
 
+/**
+ * preallocated extents past size go too, reserved again by the next write.
+ * O_DIRECT == partial last block reread, appends rewrite it
+ */
+void DiskManager::TruncateLog(int64_t size) {
+  if (log_fd_ < 0 || size >= log_size_) {
+    return;
+  }
+  if (ftruncate(log_fd_, size) != 0 || fdatasync(log_fd_) != 0) {
+    LOG_DEBUG("I/O error while truncating log");
+    return;
+  }
+  log_size_ = log_reserved_ = size;
+  if (direct_io_) {
+    PreadFull(log_fd_, log_tail_, DIRECT_IO_ALIGNMENT,
+              size - size % DIRECT_IO_ALIGNMENT);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* free space map */
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * reuses freed pages, file only grows once there are none. the last page id
+ * of a tablespace is never handed out == consecutive page ids (flush runs)
+ * never span 2 files
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(page_id_t hint, PageExtent *extent) {
+  const page_id_t max_pages = (1 << TABLESPACE_PAGE_BITS) - 1;
+  int tablespace_id = extent != nullptr ? extent->tablespace_id_
+                      : hint >= 0       ? GetTablespaceId(hint)
+                                        : 0;
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (!HasTablespace(tablespace_id)) {
+    LOG_DEBUG("tablespace %d not open", tablespace_id);
+    return INVALID_PAGE_ID;
+  }
+  DataFile *file = files_[tablespace_id];
+  if (extent != nullptr) {
+    if (extent->next_page_id_ == extent->end_page_id_) {
+      // free run nearest the hint (else where the last run ended), the end
+      // of the file if none is long enough
+      page_id_t near = hint >= 0 && GetTablespaceId(hint) == tablespace_id
+                           ? GetFilePageId(hint)
+                       : extent->end_page_id_ != INVALID_PAGE_ID
+                           ? GetFilePageId(extent->end_page_id_)
+                           : 0;
+      size_t num_pages = extent->num_pages_;
+      page_id_t first = FindFreeRun(file, near, file->end_page_id_, num_pages);
+      if (first == INVALID_PAGE_ID) {
+        first = FindFreeRun(file, 0, near, num_pages);
+      }
+      if (first == INVALID_PAGE_ID) {
+        first = file->end_page_id_;
+      } else {
+        reused_pages->Add(num_pages);
+      }
+      page_id_t end = first + num_pages;
+      if (end > max_pages) {
+        LOG_DEBUG("tablespace %d full", tablespace_id);
+        return INVALID_PAGE_ID;
+      }
+      // taken in memory == nobody else gets its pages, on disk 1 by 1 as
+      // they are handed out
+      for (page_id_t page_id = first; page_id < end; page_id++) {
+        SetReserved(file, page_id, true);
+      }
+      ReserveDbSpace(file, end - 1);
+      extent->disk_manager_ = this;
+      extent->next_page_id_ = MakePageId(tablespace_id, first);
+      extent->end_page_id_ = MakePageId(tablespace_id, end);
+    }
+    page_id_t page_id = GetFilePageId(extent->next_page_id_);
+    SetReserved(file, page_id, false);
+    SetAllocated(file, page_id, true);
+    return extent->next_page_id_++;
+  }
+  page_id_t page_id =
+      FindFreePage(file, hint >= 0 ? GetFilePageId(hint) : INVALID_PAGE_ID);
+  if (page_id == INVALID_PAGE_ID) {
+    page_id = file->end_page_id_;
+    if (page_id >= max_pages) {
+      LOG_DEBUG("tablespace %d full", tablespace_id);
+      return INVALID_PAGE_ID;
+    }
+    ReserveDbSpace(file, page_id);
+  } else {
+    reused_pages->Add();
+  }
+  SetAllocated(file, page_id, true);
+  return MakePageId(tablespace_id, page_id);
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * caller unlinked it already, but that may not be on disk yet
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  pending_free_.push_back(page_id);
+}
+
+uint64_t DiskManager::GetFreeMark() {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  return num_released_ + pending_free_.size();
+}
+
+/**
+ * every page write so far durable 1st: pages written w/o sync (eviction,
+ * page cleaner) may hold the unlinks too
+ */
+void DiskManager::ReleaseFreedPages(uint64_t mark) {
+  SyncPages();
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  while (num_released_ < mark && !pending_free_.empty()) {
+    page_id_t page_id = pending_free_.front();
+    DataFile *file = files_[GetTablespaceId(page_id)];
+    SetAllocated(file, GetFilePageId(page_id), false);
+    if (file->compressed_ != nullptr) {
+      file->compressed_->FreePage(GetFilePageId(page_id));
+    }
+    pending_free_.pop_front();
+    num_released_++;
+  }
+}
+
+/**
+ * never handed out == never linked from anywhere n never allocated on disk,
+ * free at once
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::ReleaseExtent(PageExtent *extent) {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  while (extent->next_page_id_ < extent->end_page_id_) {
+    page_id_t page_id = extent->next_page_id_++;
+    SetReserved(files_[GetTablespaceId(page_id)], GetFilePageId(page_id),
+                false);
+  }
+}
+
+PageExtent::~PageExtent() {
+  if (disk_manager_ != nullptr) {
+    disk_manager_->ReleaseExtent(this);
+  }
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (page_id < 0 || !HasTablespace(GetTablespaceId(page_id))) {
+    return false;
+  }
+  DataFile *file = files_[GetTablespaceId(page_id)];
+  page_id_t file_page_id = GetFilePageId(page_id);
+  size_t word = file_page_id / 64;
+  return word < file->fsm_.size() &&
+         ((file->fsm_[word] >> (file_page_id % 64)) & 1) != 0;
+}
+
+/**
+ * map file missing / empty while the db has pages (db older than the map)
+ * == every page in the file counts as allocated. empty db == any map left
+ * behind is stale, nothing on disk can reference its pages
+ */
+void DiskManager::LoadFreeSpaceMap(DataFile *file) {
+  int64_t db_size = GetFileSize(file->name_);
+  page_id_t db_pages = file->compressed_ != nullptr
+                           ? file->compressed_->GetNumPages()
+                           : db_size > 0 ? db_size / page_size_ : 0;
+  int64_t fsm_size = db_pages > 0 ? GetFileSize(file->fsm_name_) : 0;
+  size_t words_per_page = page_size_ / 8;
+  size_t fsm_pages = fsm_size > 0 ? fsm_size / page_size_ : 0;
+
+  file->fsm_.assign(fsm_pages * words_per_page, 0);
+  file->fsm_page_dirty_.assign(fsm_pages, false);
+  if (fsm_pages > 0) {
+    PreadFull(file->fsm_fd_, reinterpret_cast<char *>(file->fsm_.data()),
+              fsm_pages * page_size_, 0);
+  } else {
+    if (file->fsm_fd_ >= 0 && !read_only_ && ftruncate(file->fsm_fd_, 0) != 0) {
+      LOG_DEBUG("can't reset free space map");
+    }
+    for (page_id_t page_id = 0; page_id < db_pages; page_id++) {
+      SetAllocated(file, page_id, true);
+    }
+  }
+
+  file->reserved_page_id_ = db_pages;
+  file->end_page_id_ = 0;
+  for (size_t word = file->fsm_.size(); word > 0; word--) {
+    uint64_t bits = file->fsm_[word - 1];
+    if (bits != 0) {
+      file->end_page_id_ = (word - 1) * 64 + 63 - __builtin_clzll(bits) + 1;
+      break;
+    }
+  }
+}
+
+/**
+ * map grows 1 fsm page at a time, changed fsm page marked for the next sync
+ */
+void DiskManager::SetAllocated(DataFile *file, page_id_t page_id,
+                               bool allocated) {
+  size_t words_per_page = page_size_ / 8;
+  size_t word = page_id / 64;
+  if (word >= file->fsm_.size()) {
+    size_t fsm_pages = word / words_per_page + 1;
+    file->fsm_.resize(fsm_pages * words_per_page, 0);
+    file->fsm_page_dirty_.resize(fsm_pages, false);
+  }
+  uint64_t bit = 1ULL << (page_id % 64);
+  uint64_t &bits = file->fsm_[word];
+  bits = allocated ? bits | bit : bits & ~bit;
+  file->fsm_page_dirty_[word / words_per_page] = true;
+  fsm_dirty_ = true;
+  if (allocated && page_id >= file->end_page_id_) {
+    file->end_page_id_ = page_id + 1;
+  }
+}
+
+/**
+ * reserved == allocated in memory, left out of the map on disk (see
+ * SyncFreeSpaceMap). unreserved w/o being handed out == free again
+ */
+void DiskManager::SetReserved(DataFile *file, page_id_t page_id,
+                              bool reserved) {
+  size_t word = page_id / 64;
+  if (word >= file->reserved_.size()) {
+    file->reserved_.resize(word + 1, 0);
+  }
+  uint64_t bit = 1ULL << (page_id % 64);
+  if (reserved) {
+    file->reserved_[word] |= bit;
+    SetAllocated(file, page_id, true);
+  } else if ((file->reserved_[word] & bit) != 0) {
+    file->reserved_[word] &= ~bit;
+    file->fsm_[word] &= ~bit; // 0 on disk all along, nothing to write
+  }
+}
+
+/**
+ * KEEP_SIZE: blocks allocated, file size untouched == size still means
+ * pages written (mmap, free space map load). no fallocate (tmpfs, old
+ * fs) == blocks allocated on write as before
+ */
+void DiskManager::ReserveDbSpace(DataFile *file, page_id_t page_id) {
+  // compressed: slots are appended, a page id says nothing about where
+  if (page_id < file->reserved_page_id_ || file->compressed_ != nullptr) {
+    return;
+  }
+  page_id_t end = (page_id / DB_EXTENT_PAGES + 1) * DB_EXTENT_PAGES;
+  fallocates->Add();
+  if (fallocate(file->fd_, FALLOC_FL_KEEP_SIZE,
+                static_cast<off_t>(file->reserved_page_id_) * page_size_,
+                static_cast<off_t>(end - file->reserved_page_id_) *
+                    page_size_) != 0) {
+    LOG_DEBUG("fallocate: %s", strerror(errno));
+  }
+  file->reserved_page_id_ = end;
+}
+
+/**
+ * caller is the only log writer. async appends reserve at submission, before
+ * the kernel extends the file
+ */
+void DiskManager::ReserveLogSpace(size_t size) {
+  if (log_size_ + static_cast<int64_t>(size) <= log_reserved_ || log_fd_ < 0) {
+    return;
+  }
+  int64_t end = (log_size_ + size) / LOG_EXTENT_SIZE * LOG_EXTENT_SIZE +
+                LOG_EXTENT_SIZE;
+  fallocates->Add();
+  if (fallocate(log_fd_, FALLOC_FL_KEEP_SIZE, log_reserved_,
+                end - log_reserved_) != 0) {
+    LOG_DEBUG("fallocate: %s", strerror(errno));
+  }
+  log_reserved_ = end;
+}
+
+/**
+ * 1st clear bit in [hint, end), then [0, hint). 64 pages per word looked at
+ */
+page_id_t DiskManager::FindFreePage(DataFile *file, page_id_t hint) {
+  const std::vector<uint64_t> &fsm = file->fsm_;
+  page_id_t end_page_id = file->end_page_id_;
+  if (hint < 0 || hint >= end_page_id) {
+    hint = 0;
+  }
+  size_t end_word = (end_page_id + 63) / 64;
+  size_t hint_word = hint / 64;
+  for (size_t i = 0; i < end_word; i++) {
+    size_t word = (hint_word + i) % end_word;
+    uint64_t free_bits = ~fsm[word];
+    if (i == 0) {
+      free_bits &= ~0ULL << (hint % 64); // not before hint, this time
+    }
+    if (free_bits != 0) {
+      page_id_t page_id = word * 64 + __builtin_ctzll(free_bits);
+      if (page_id < end_page_id) {
+        return page_id;
+      }
+    }
+  }
+  // hint's word before hint, skipped above
+  if (hint_word < end_word) {
+    uint64_t free_bits = ~fsm[hint_word] & ((1ULL << (hint % 64)) - 1);
+    if (free_bits != 0) {
+      return hint_word * 64 + __builtin_ctzll(free_bits);
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+/**
+ * 1st num_pages free pages in a row starting in [from, to), all before
+ * end_page_id_. full words skipped
+ */
+page_id_t DiskManager::FindFreeRun(DataFile *file, page_id_t from,
+                                   page_id_t to, size_t num_pages) {
+  size_t run = 0; // free pages in a row right before page_id
+  for (page_id_t page_id = from; page_id < file->end_page_id_;) {
+    if (run == 0 && page_id >= to) {
+      break;
+    }
+    uint64_t bits = file->fsm_[page_id / 64];
+    if (run == 0 && page_id % 64 == 0 && bits == ~0ULL) {
+      page_id += 64;
+      continue;
+    }
+    if (((bits >> (page_id % 64)) & 1) != 0) {
+      run = 0;
+    } else if (++run == num_pages) {
+      return page_id + 1 - num_pages;
+    }
+    page_id++;
+  }
+  return INVALID_PAGE_ID;
+}
+
+/**
+ * allocations between checking fsm_dirty_ n the latch are covered too,
+ * they happened before their pages were handed out. 1 fdatasync per file
+ * w dirty fsm pages. extents' pages not handed out yet written as free
+ */
+void DiskManager::SyncFreeSpaceMap() {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (!fsm_dirty_) {
+    return;
+  }
+  size_t words_per_page = page_size_ / 8;
+  std::vector<uint64_t> words(words_per_page);
+  for (auto &slot : files_) {
+    DataFile *file = slot;
+    if (file == nullptr) {
+      continue;
+    }
+    bool written = false;
+    for (size_t fsm_page = 0; fsm_page < file->fsm_page_dirty_.size();
+         fsm_page++) {
+      if (!file->fsm_page_dirty_[fsm_page]) {
+        continue;
+      }
+      for (size_t i = 0; i < words_per_page; i++) {
+        size_t word = fsm_page * words_per_page + i;
+        words[i] = file->fsm_[word] &
+                   ~(word < file->reserved_.size() ? file->reserved_[word] : 0);
+      }
+      const char *data = reinterpret_cast<const char *>(words.data());
+      if (PwriteFull(file->fsm_fd_, data, page_size_,
+                     fsm_page * page_size_) < page_size_) {
+        LOG_DEBUG("I/O error while writing free space map");
+        return; // stays dirty, retried before the next write
+      }
+      file->fsm_page_dirty_[fsm_page] = false;
+      written = true;
+    }
+    if (written && fdatasync(file->fsm_fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing free space map");
+      return;
+    }
+  }
+  fsm_syncs->Add();
+  fsm_dirty_ = false;
 }
 
 /**
@@ -219,7 +1564,7 @@ bool DiskManager::GetFlushState() const { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+int64_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
   return rc == 0 ? stat_buf.st_size : -1;
@@ -0,0 +1,225 @@
+/*
+ * lock_free_hash_table.cpp
+ *
+ * seqlock per slot: writer makes seq odd, writes, makes it even again.
+ * reader copies the slot between 2 reads of seq, same even value == copy is
+ * consistent
+ */
+#include <functional>
+
+#include "common/exception.h"
+#include "hash/lock_free_hash_table.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * constructor
+ *
+ * num slots == power of 2 >= 2 * capacity, i.e. load factor <= 1/2, so
+ * linear probes stay short and there is always an empty slot to stop at
+ */
+template <typename K, typename V>
+LockFreeHashTable<K, V>::LockFreeHashTable(size_t capacity)
+    : capacity_(capacity) {
+  size_t num_slots = 2;
+  while (num_slots < 2 * capacity) {
+    num_slots <<= 1;
+  }
+  slots_ = new Slot[num_slots];
+  mask_ = num_slots - 1;
+  for (size_t i = 0; i < num_slots; i++) {
+    slots_[i].key_.store(K(), std::memory_order_relaxed);
+    slots_[i].value_.store(V(), std::memory_order_relaxed);
+  }
+}
+
+template <typename K, typename V>
+LockFreeHashTable<K, V>::~LockFreeHashTable() {
+  delete[] slots_;
+}
+
+// hash func, fibonacci hashing on top == sequential page ids spread out
+template <typename K, typename V>
+size_t LockFreeHashTable<K, V>::HashKey(const K &key) const {
+  uint64_t h = std::hash<K>()(key) * 0x9E3779B97F4A7C15ULL;
+  return (h ^ (h >> 32)) & mask_;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* lookup, no lock */
+
+/*
+ * probe from key's home slot until key or an empty slot
+ *
+ * miss while a remove was shifting keys == key may have moved from a slot we
+ * had not reached yet into 1 we had passed, probe again
+ */
+template <typename K, typename V>
+bool LockFreeHashTable<K, V>::Find(const K &key, V &value) {
+  while (true) {
+    uint64_t shift_before = shift_seq_.load(std::memory_order_acquire);
+
+    size_t i = HashKey(key);
+    for (size_t n = 0; n <= mask_; n++) {
+      K slot_key;
+      V slot_value;
+      if (!ReadSlot(slots_[i], slot_key, slot_value)) {
+        break; // end of probe
+      }
+      if (slot_key == key) {
+        value = slot_value;
+        return true;
+      }
+      i = (i + 1) & mask_;
+    }
+
+    // slot reads above happen before shift_seq_ re-read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((shift_before & 1) == 0 &&
+        shift_seq_.load(std::memory_order_relaxed) == shift_before) {
+      return false;
+    }
+  }
+}
+
+template <typename K, typename V>
+bool LockFreeHashTable<K, V>::ReadSlot(Slot &slot, K &key, V &value) const {
+  while (true) {
+    uint32_t before = slot.seq_.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue; // writer in the slot, only a few stores
+    }
+    bool used = slot.used_.load(std::memory_order_relaxed);
+    key = slot.key_.load(std::memory_order_relaxed);
+    value = slot.value_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq_.load(std::memory_order_relaxed) == before) {
+      return used;
+    }
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/* modifiers, 1 writer at a time */
+
+/*
+ * existing key == value overwritten in place
+ * new key == 1st empty slot on its probe
+ */
+template <typename K, typename V>
+void LockFreeHashTable<K, V>::Insert(const K &key, const V &value) {
+  std::lock_guard<std::mutex> guard(write_latch_);
+
+  size_t i = HashKey(key);
+  K slot_key;
+  V slot_value;
+  while (ReadSlot(slots_[i], slot_key, slot_value)) {
+    if (slot_key == key) {
+      WriteSlot(slots_[i], true, key, value);
+      return;
+    }
+    i = (i + 1) & mask_;
+  }
+
+  if (size_.load(std::memory_order_relaxed) == capacity_) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "lock free hash table full");
+  }
+  WriteSlot(slots_[i], true, key, value);
+  size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * backward shift: walk the cluster after the hole, move back every key whose
+ * home is at or before the hole, the last slot moved from becomes empty.
+ *
+ * a key is copied into the hole before its old slot is reused, so a reader
+ * looking for it always finds it in 1 of the 2
+ */
+template <typename K, typename V>
+bool LockFreeHashTable<K, V>::Remove(const K &key) {
+  std::lock_guard<std::mutex> guard(write_latch_);
+
+  size_t hole = HashKey(key);
+  K slot_key;
+  V slot_value;
+  while (true) {
+    if (!ReadSlot(slots_[hole], slot_key, slot_value)) {
+      return false;
+    }
+    if (slot_key == key) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  uint64_t shift = shift_seq_.load(std::memory_order_relaxed);
+  shift_seq_.store(shift + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  size_t j = hole;
+  while (true) {
+    j = (j + 1) & mask_;
+    if (!ReadSlot(slots_[j], slot_key, slot_value)) {
+      break; // end of cluster
+    }
+    // hole within [home, j) == key can move back into it
+    size_t home = HashKey(slot_key);
+    if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+      WriteSlot(slots_[hole], true, slot_key, slot_value);
+      hole = j;
+    }
+  }
+  WriteSlot(slots_[hole], false, K(), V());
+  size_.fetch_sub(1, std::memory_order_relaxed);
+
+  shift_seq_.store(shift + 2, std::memory_order_release);
+  return true;
+}
+
+template <typename K, typename V>
+void LockFreeHashTable<K, V>::WriteSlot(Slot &slot, bool used, const K &key,
+                                        const V &value) {
+  uint32_t seq = slot.seq_.load(std::memory_order_relaxed);
+  slot.seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.used_.store(used, std::memory_order_relaxed);
+  slot.key_.store(key, std::memory_order_relaxed);
+  slot.value_.store(value, std::memory_order_relaxed);
+  slot.seq_.store(seq + 2, std::memory_order_release);
+}
+
+template class LockFreeHashTable<page_id_t, Page *>;
+// test purpose
+template class LockFreeHashTable<int, int>;
+
+} // namespace cmudb
@@ -0,0 +1,61 @@
+/**
+ * buffer_access_strategy.h
+ *
+ * Ring of a few private frames for one bulk access (seq scan), so a single
+ * large scan cannot wipe out the whole pool.
+ *
+ * Pages fetched through the strategy recycle the ring's frames round robin
+ * and are never handed to the shared replacer when unpinned. Pages that
+ * were already in the pool are used in place as usual.
+ *
+ * A ring frame is promoted back to the shared pool (replacer) when someone
+ * without the strategy unpins it last == other users want the page too.
+ *
+ * MUST NOT outlive the buffer pool manager it was used with. Destroying it
+ * drops its read-ahead requests that are still queued
+ */
+
+#pragma once
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class BufferPoolManager;
+class Page;
+
+class BufferAccessStrategy {
+  friend class BufferPoolManager;
+
+public:
+  explicit BufferAccessStrategy(size_t ring_size = SCAN_RING_SIZE)
+      : ring_size_(ring_size == 0 ? 1 : ring_size) {}
+
+  // hands every ring frame back to the pool it was taken from
+  ~BufferAccessStrategy();
+
+  BufferAccessStrategy(const BufferAccessStrategy &) = delete;
+  BufferAccessStrategy &operator=(const BufferAccessStrategy &) = delete;
+
+  inline size_t GetRingSize() const { return ring_size_; }
+
+private:
+  struct Ring {
+    std::vector<Page *> frames_;
+    size_t next_ = 0; // slot recycled next
+  };
+
+  // ring of 1 bpm, created on 1st use. Ring itself is protected by that
+  // bpm's latch_, map by latch_ below (shards' I/O workers look up at once)
+  Ring &GetRing(BufferPoolManager *bpm);
+
+  size_t ring_size_;
+  // one ring per bpm instance == parallel bpm shards never swap frames
+  std::unordered_map<BufferPoolManager *, Ring> rings_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
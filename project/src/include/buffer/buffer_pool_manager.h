@@ -9,43 +9,191 @@
  * 
  */
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "buffer/buffer_access_strategy.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
 #include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
+#include "hash/lock_free_hash_table.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace cmudb {
 class BufferPoolManager {
+  // parallel bpm == N of us, hands us page ids it allocated itself
+  friend class ParallelBufferPoolManager;
+  friend class BufferAccessStrategy;
+
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                          LogManager *log_manager = nullptr,
+                          ReplacerType replacer_type = ReplacerType::LRU);
+
+  virtual ~BufferPoolManager();
+
+  // virtual == ParallelBufferPoolManager is a drop-in for callers that hold
+  // a BufferPoolManager* (b+tree, table heap, storage engine)
+  // strategy == bulk access (seq scan) recycling its own ring of frames
+  virtual Page *FetchPage(page_id_t page_id,
+                          BufferAccessStrategy *strategy = nullptr);
+
+  virtual bool UnpinPage(page_id_t page_id, bool is_dirty,
+                         BufferAccessStrategy *strategy = nullptr);
+
+  virtual bool FlushPage(page_id_t page_id);
+
+  /* batched flush == checkpoint / shutdown */
+  // write back dirty pages (pinned ones too) sorted by page id, adjacent
+  // pages coalesced into 1 write, FLUSH_IO_DEPTH async writes in flight,
+  // synced at the end. @return num pages written
+  // all pages == deleted pages' ids reusable afterwards
+  virtual size_t FlushAllPages();
+  // same, only page ids in [first_page_id, last_page_id]
+  virtual size_t FlushRange(page_id_t first_page_id, page_id_t last_page_id);
+
+  // hint == page the new one gets linked from, page id allocated near it.
+  // extent == caller's own run of page ids, hint only places its next run
+  // (see PageExtent)
+  virtual Page *NewPage(page_id_t &page_id,
+                        page_id_t hint = INVALID_PAGE_ID,
+                        PageExtent *extent = nullptr);
+
+  virtual bool DeletePage(page_id_t page_id);
+
+  /* read-ahead == async reads, submitted by 1 dispatcher thread started on
+     1st prefetch, finished in the disk manager's I/O completion thread */
+  // queue page_id to be read into a frame (the strategy's ring if given),
+  // returns at once. false == resident / queued already
+  virtual bool PrefetchPage(page_id_t page_id,
+                            BufferAccessStrategy *strategy = nullptr);
 
-  ~BufferPoolManager();
+  // no I/O, no waiting: pinned page if resident + read, else nullptr.
+  // in_flight == set if a prefetch is still reading it
+  virtual Page *FetchPageIfLoaded(page_id_t page_id,
+                                  BufferAccessStrategy *strategy = nullptr,
+                                  bool *in_flight = nullptr);
 
-  Page *FetchPage(page_id_t page_id);
+  virtual uint64_t GetPrefetchReads() const { return prefetch_reads_; }
 
-  bool UnpinPage(page_id_t page_id, bool is_dirty);
+  // no pin, no I/O, no latch_: frame holding page_id right now or nullptr.
+  // frame can be reused any time, read it through Page::OptimisticLatch()
+  virtual Page *PeekPage(page_id_t page_id);
 
-  bool FlushPage(page_id_t page_id);
+  inline size_t GetPoolSize() const { return pool_size_; }
+  // per database, from disk manager == header page
+  inline size_t GetPageSize() const { return page_size_; }
 
-  Page *NewPage(page_id_t &page_id);
+  /* page cleaner == bg thread writing dirty pages at replacer's cold end */
+  // 1 round, write back <= max_pages dirty unpinned pages, @return num written
+  virtual size_t CleanPages(size_t max_pages);
+  virtual void RunPageCleaner();
+  virtual void StopPageCleaner();
+  // rate limit == <= max_pages per round, 1 round per interval
+  virtual void SetPageCleanerRate(std::chrono::milliseconds interval,
+                                  size_t max_pages);
 
-  bool DeletePage(page_id_t page_id);
+  // victims that were clean (no I/O) vs dirty (written on the miss)
+  virtual uint64_t GetCleanEvictions() const { return clean_evictions_; }
+  virtual uint64_t GetDirtyEvictions() const { return dirty_evictions_; }
+  virtual uint64_t GetCleanerWrites() const { return cleaner_writes_; }
+
+  // checkpoint: <page_id, recLSN> of dirty pages. pinned ones too, w their
+  // pin's lsn if not dirty yet (may be changed right now, unpin marks it)
+  virtual void GetDirtyPageTable(
+      std::unordered_map<page_id_t, lsn_t> &dirty_page_table);
+  // deleted pages' ids reusable once every unlink from them is on disk:
+  // take the mark, get the pages dirty before it written, then release
+  // (syncs every page write 1st)
+  inline uint64_t GetFreeMark() { return disk_manager_->GetFreeMark(); }
+  inline void ReleaseFreedPages(uint64_t mark) {
+    disk_manager_->ReleaseFreedPages(mark);
+  }
 
 
 private:
+  // page table hit w/o latch_, false == take the slow path
+  bool TryPinPage(Page *page, page_id_t page_id);
+  bool TryUnpinPage(Page *page, page_id_t page_id, bool is_dirty);
+
+  // caller MUST hold latch_
+  Page *GetVictimPage();
+  Page *GetRingPage(BufferAccessStrategy *strategy);
+  void EvictPage(Page *page);
+  Page *NewPageWithId(page_id_t page_id);
+
+  // scan done, ring frames back to free list
+  void ReleaseStrategy(BufferAccessStrategy *strategy);
+
+  void PageCleanerLoop();
+  /* batched flush, FlushRange in steps (parallel bpm spans its shards) */
+  // dirty pages in range -> batch, marked cleaning_ + clean
+  void CollectDirtyPages(page_id_t first_page_id, page_id_t last_page_id,
+                         std::vector<Page *> &batch);
+  // WAL, sort, write in runs. @return num pages written
+  size_t WriteBatch(std::vector<Page *> batch);
+  // writes of cleaning_ pages done, free the ones a miss picked meanwhile
+  void FinishCleaning(const std::vector<Page *> &batch);
+
+  void PrefetchLoop();
+  // async read of a prefetched page done, read == passed its checks
+  void FinishPrefetch(Page *page, page_id_t page_id,
+                      BufferAccessStrategy *strategy, bool read);
+  // pin_count_ hit 0: lru, or stays private in the strategy's ring. read
+  // failed == free list
+  void MakeEvictable(Page *page, BufferAccessStrategy *strategy);
+  // miss / read-ahead couldn't read the page: never handed out
+  void DropFailedRead(Page *page, page_id_t page_id);
+  // pin_count_ 0 -> 1 / frame gets a page: DPT bookkeeping
+  void SetPinLSN(Page *page);
+  // before is_dirty_ is set
+  static void SetRecLSN(Page *page);
+
   size_t pool_size_; // number of pages in buffer pool
+  size_t page_size_; // bytes per page
   Page *pages_;      // array of pages
+  char *page_data_;  // pool_size_ * page_size_ bytes, pages_' content
+  size_t page_data_size_; // mmap'ed length of page_data_
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // all pages w content in RAM
-  Replacer<Page *> *lru_replacer_;   // lru == only unpinned of all pages 
+  // all pages w content in RAM. lookups lock free, i.e. may run w/o latch_,
+  // modified under latch_ only
+  HashTable<page_id_t, Page *> *page_table_;
+  Replacer<Page *> *replacer_;   // lru/clock == only unpinned of all pages 
   std::list<Page *> *free_list_; // all free pages in RAM w/o content == not in lru or page_table 
   
   std::mutex latch_;             // to protect shared data structure
+
+  /* page cleaner */
+  std::thread *cleaner_thread_ = nullptr;
+  bool cleaner_running_ = false;
+  std::chrono::milliseconds cleaner_interval_{PAGE_CLEANER_INTERVAL_MS};
+  size_t cleaner_max_pages_ = PAGE_CLEANER_MAX_PAGES;
+  std::mutex cleaner_latch_;             // protect 4 vars above
+  std::condition_variable cleaner_cv_;   // wake up early to stop
+
+  std::atomic<uint64_t> clean_evictions_{0};
+  std::atomic<uint64_t> dirty_evictions_{0};
+  std::atomic<uint64_t> cleaner_writes_{0};
+
+  /* read-ahead, all protected by latch_ */
+  std::deque<std::pair<page_id_t, BufferAccessStrategy *>> prefetch_queue_;
+  std::thread prefetch_thread_;
+  size_t prefetch_in_flight_ = 0; // <= READAHEAD_MAX_IN_FLIGHT
+  bool prefetch_stop_ = false;
+  // queue not empty n room in flight / stop / in flight read done
+  std::condition_variable prefetch_cv_;
+  std::condition_variable loaded_cv_;   // a loading_ page is read
+  std::condition_variable cleaned_cv_;  // cleaning_ frames written
+  std::atomic<uint64_t> prefetch_reads_{0};
 };
 } // namespace cmudb
@@ -0,0 +1,47 @@
+/**
+ * clock_replacer.h
+ *
+ * CLOCK / clock-sweep: 1 flat array slot per frame, no list, no map
+ * - ref bit == touched since hand last passed
+ * - evictable == unpinned, hand may pick it
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+public:
+  // frame_id == value -> slot in [0, num_frames), e.g. page ptr - pages_
+  ClockReplacer(size_t num_frames, std::function<size_t(const T &)> frame_id);
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void PeekVictims(std::vector<T> &values, size_t n);
+
+private:
+  struct Frame {
+    T value_;
+    bool ref_ = false;
+    bool evictable_ = false;
+  };
+
+  std::vector<Frame> frames_;
+  std::function<size_t(const T &)> frame_id_;
+  size_t hand_ = 0;
+  size_t size_ = 0; // num of evictable frames
+};
+
+} // namespace cmudb
@@ -0,0 +1,71 @@
+/**
+ * lru_k_replacer.h
+ *
+ * LRU-K (O'Neil et al.): victim == page w the largest backward K-distance,
+ * i.e. the page whose K-th most recent reference is the oldest.
+ * Pages seen < K times have infinite distance == a 1-pass scan is kicked out
+ * before pages that are used over and over (b+tree root/internal pages).
+ *
+ * correlated reference period (CRP): re-references within CRP ticks of the
+ * last one (e.g. TableIterator fetching the same page once per tuple) count as
+ * 1 reference, and a page is not evicted within CRP ticks of its last use.
+ *
+ * retained information period (RIP): history is kept by page id (not frame)
+ * for RIP ticks after eviction, so a page that comes back is not treated as
+ * brand new. 0 == forget history at eviction.
+ */
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+public:
+  // time == logical clock, 1 tick per Insert()
+  explicit LRUKReplacer(size_t k = 2, uint64_t correlated_reference_period = 0,
+                        uint64_t retained_information_period = 0);
+
+  ~LRUKReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void PeekVictims(std::vector<T> &values, size_t n);
+
+private:
+  // value -> identity of its content, page ptr -> page id
+  static int64_t GetKey(const T &value);
+  void PurgeHistory();
+
+  struct History {
+    // hist_[0] == most recent uncorrelated reference, hist_[k-1] == K-th
+    // 0 == undefined (seen < K times)
+    std::vector<uint64_t> hist_;
+    uint64_t last_ = 0; // most recent reference, correlated or not
+  };
+
+  size_t k_;
+  uint64_t correlated_reference_period_;
+  uint64_t retained_information_period_;
+  uint64_t current_time_ = 0;
+  uint64_t last_purge_time_ = 0;
+
+  // resident values (in a frame) -> key, bool == evictable
+  std::unordered_map<T, std::pair<int64_t, bool>> resident_;
+  size_t size_ = 0; // num of evictable values
+
+  // key -> history, survives pin/unpin and eviction (for RIP)
+  std::unordered_map<int64_t, History> history_;
+};
+
+} // namespace cmudb
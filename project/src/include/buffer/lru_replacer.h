@@ -1,5 +1,8 @@
 #pragma once
 
+#include <list>
+#include <unordered_map>
+
 #include "buffer/replacer.h"
 #include "hash/extendible_hash.h"
 
@@ -20,6 +23,8 @@ public:
 
   size_t Size();
 
+  void PeekVictims(std::vector<T> &values, size_t n);
+
 
 
 
@@ -34,7 +39,7 @@ private:
   iterator == ptr to page's ptr == addr of linked list node that stores page's ptr
   */
   std::list<T> linked_list_of_pageptr;
-  std::unordered_map<T, std::list<T>::iterator> map_of_pageptr_iter; 
+  std::unordered_map<T, typename std::list<T>::iterator> map_of_pageptr_iter; 
 
   
 };
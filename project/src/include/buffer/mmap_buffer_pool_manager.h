@@ -0,0 +1,77 @@
+/**
+ * mmap_buffer_pool_manager.h
+ *
+ * Read-only buffer pool over 1 mapping of the whole db file, e.g. for
+ * analytics replicas. A fetched page's data points straight into the
+ * mapping: no frame copy, no eviction, no page table, no latch_. The OS page
+ * cache is the only cache.
+ *
+ * Drop-in for BufferPoolManager == table heap / index iterators fetch
+ * through the same virtual interface. Pages are mapped PROT_READ, writing
+ * one faults; NewPage / DeletePage / FlushPage fail. Each tablespace file
+ * open in the disk manager is mapped once at construction, pages appended /
+ * tablespaces opened afterwards are not seen. Page checksums are not
+ * verified, nothing is read through the disk manager.
+ */
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class MmapBufferPoolManager : public BufferPoolManager {
+public:
+  explicit MmapBufferPoolManager(DiskManager *disk_manager);
+
+  ~MmapBufferPoolManager();
+
+  // nullptr == page_id past the mapped end of file. nothing is ever
+  // evicted == pins are not counted
+  Page *FetchPage(page_id_t page_id,
+                  BufferAccessStrategy *strategy = nullptr) override;
+
+  // false == is_dirty, a read-only pool can't have written the page
+  bool UnpinPage(page_id_t page_id, bool is_dirty,
+                 BufferAccessStrategy *strategy = nullptr) override;
+
+  bool FlushPage(page_id_t) override { return false; }
+  size_t FlushRange(page_id_t, page_id_t) override { return 0; }
+
+  Page *NewPage(page_id_t &, page_id_t = INVALID_PAGE_ID,
+                PageExtent * = nullptr) override {
+    return nullptr;
+  }
+  bool DeletePage(page_id_t) override { return false; }
+
+  // madvise(WILLNEED), kernel reads it in the background. always false, the
+  // page is resident as far as the pool goes
+  bool PrefetchPage(page_id_t page_id,
+                    BufferAccessStrategy *strategy = nullptr) override;
+
+  Page *FetchPageIfLoaded(page_id_t page_id,
+                          BufferAccessStrategy *strategy = nullptr,
+                          bool *in_flight = nullptr) override;
+
+  Page *PeekPage(page_id_t page_id) override;
+
+  // nothing dirty, nothing to clean
+  void GetDirtyPageTable(std::unordered_map<page_id_t, lsn_t> &) override {}
+  size_t CleanPages(size_t) override { return 0; }
+  void RunPageCleaner() override {}
+  void StopPageCleaner() override {}
+
+  // all tablespaces
+  size_t GetNumPages() const;
+
+private:
+  Page *GetPage(page_id_t page_id);
+
+  DiskManager *disk_manager_;
+  // per tablespace, nullptr / 0 if not open or empty
+  const char *mappings_[MAX_TABLESPACES] = {};
+  size_t num_pages_[MAX_TABLESPACES] = {};
+  Page *frames_[MAX_TABLESPACES] = {}; // frame i == page i, data in the mapping
+};
+
+} // namespace cmudb
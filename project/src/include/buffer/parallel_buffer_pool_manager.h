@@ -0,0 +1,82 @@
+/**
+ * parallel_buffer_pool_manager.h
+ *
+ * N independent buffer pool manager instances (shards), each w its own
+ * latch, free list, page table and replacer. Page ids are routed to a shard
+ * by hash, so threads touching different pages never share a latch.
+ *
+ * Drop-in for BufferPoolManager == b+tree, table heap, storage engine keep
+ * holding a BufferPoolManager*
+ */
+
+#pragma once
+#include <atomic>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class ParallelBufferPoolManager : public BufferPoolManager {
+public:
+  // pool_size == total frames, split evenly across num_instances shards
+  ParallelBufferPoolManager(size_t num_instances, size_t pool_size,
+                            DiskManager *disk_manager,
+                            LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
+
+  ~ParallelBufferPoolManager();
+
+  Page *FetchPage(page_id_t page_id,
+                  BufferAccessStrategy *strategy = nullptr) override;
+
+  bool UnpinPage(page_id_t page_id, bool is_dirty,
+                 BufferAccessStrategy *strategy = nullptr) override;
+
+  bool FlushPage(page_id_t page_id) override;
+
+  // 1 batch over all shards, FlushAllPages() comes along
+  size_t FlushRange(page_id_t first_page_id, page_id_t last_page_id) override;
+
+  // owning shard all pinned == another id, owned by a shard w room
+  Page *NewPage(page_id_t &page_id, page_id_t hint = INVALID_PAGE_ID,
+                PageExtent *extent = nullptr) override;
+
+  bool DeletePage(page_id_t page_id) override;
+
+  bool PrefetchPage(page_id_t page_id,
+                    BufferAccessStrategy *strategy = nullptr) override;
+
+  Page *FetchPageIfLoaded(page_id_t page_id,
+                          BufferAccessStrategy *strategy = nullptr,
+                          bool *in_flight = nullptr) override;
+
+  Page *PeekPage(page_id_t page_id) override;
+
+  // 1 cleaner per shard, max_pages per shard per round
+  size_t CleanPages(size_t max_pages) override;
+  void RunPageCleaner() override;
+  void StopPageCleaner() override;
+  void SetPageCleanerRate(std::chrono::milliseconds interval,
+                          size_t max_pages) override;
+
+  // sum over shards
+  uint64_t GetCleanEvictions() const override;
+  uint64_t GetDirtyEvictions() const override;
+  uint64_t GetCleanerWrites() const override;
+  uint64_t GetPrefetchReads() const override;
+
+  // all shards'
+  void GetDirtyPageTable(
+      std::unordered_map<page_id_t, lsn_t> &dirty_page_table) override;
+
+  // shard that owns page_id
+  BufferPoolManager *GetBufferPoolManager(page_id_t page_id);
+
+  inline size_t GetNumInstances() const { return instances_.size(); }
+
+private:
+  std::vector<BufferPoolManager *> instances_;
+};
+
+} // namespace cmudb
@@ -6,9 +6,13 @@
 #pragma once
 
 #include <cstdlib>
+#include <vector>
 
 namespace cmudb {
 
+// which replacer BufferPoolManager builds for its frames
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +21,9 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // up to n next victims, coldest first, w/o evicting or touching them
+  // (page cleaner writes these back ahead of eviction)
+  virtual void PeekVictims(std::vector<T> &values, size_t n) = 0;
 };
 
 } // namespace cmudb
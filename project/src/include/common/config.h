@@ -24,11 +24,50 @@ extern std::atomic<bool> ENABLE_LOGGING;
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
+#define PAGE_SIZE 512     // default size of a data page in byte, per database
+#define MIN_PAGE_SIZE 512              // page_size module arg lower bound
+#define MAX_PAGE_SIZE 65536            // page_size module arg upper bound
+#define HEADER_PAGE_SIZE_OFFSET 4      // header page: page size, read before the pool exists
+#define HEADER_POOL_SIZE_OFFSET 8      // header page: buffer pool size
+#define HEADER_MASTER_RECORD_OFFSET 12 // header page: last checkpoint n its redo point (24)
+#define HEADER_FORMAT_OFFSET 36        // header page: magic n format version, checked on open
+#define HEADER_MAGIC 0x42444d43        // "CMDB"
+#define HEADER_FORMAT_VERSION 1        // bump on any file layout change
 #define LOG_BUFFER_SIZE                                                            \
-  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
+  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // default size of a log buffer in byte
+#define LOG_BUFFER_COUNT 4             // log buffers in the WAL ring, filled while others flush
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
-#define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define BUFFER_POOL_SIZE 10            // default size of buffer pool, per database
+#define BUFFER_POOL_INSTANCES 8        // num of buffer pool shards, at most
+#define BUFFER_POOL_MIN_INSTANCE_SIZE 32 // frames per shard, smaller pools get fewer shards
+#define LRUK_REPLACER_K 2              // K of LRU-K replacer
+#define LRUK_CORRELATED_PERIOD 4       // LRU-K correlated reference period, in unpins
+#define LRUK_RETAINED_PERIOD 1024      // LRU-K history kept after eviction, in unpins
+#define SCAN_RING_SIZE 4               // private frames per seq scan ring
+#define PAGE_CLEANER_INTERVAL_MS 10    // page cleaner sleep between rounds
+#define PAGE_CLEANER_MAX_PAGES 8       // page cleaner writes per round, per pool
+#define READAHEAD_MAX_IN_FLIGHT 16     // read-ahead reads submitted at once, per pool
+#define READAHEAD_MAX_WINDOW 8         // max pages a seq scan keeps in flight
+#define OLC_MAX_RESTARTS 8             // optimistic b+tree search tries before latching
+#define FLUSH_IO_DEPTH 8               // runs in flight per FlushAllPages / FlushRange call
+#define FLUSH_MAX_RUN_PAGES 32         // max adjacent pages coalesced into 1 write
+#define ASYNC_IO_QUEUE_DEPTH 64        // io_uring entries == max I/Os in flight per disk manager
+#define ASYNC_IO_THREADS 4             // workers of the thread pool fallback
+#define METRICS_SHARDS 16              // per metric, each thread adds into 1 of them
+#define DIRECT_IO_ALIGNMENT 512        // O_DIRECT: buffer address, file offset n length multiple of it
+#define HUGE_PAGE_SIZE (2 << 20)       // buffer pool arenas this big or bigger ask for huge pages
+#define DB_EXTENT_PAGES 256            // db file space reserved (fallocate) per step, in pages
+#define LOG_EXTENT_SIZE (1 << 20)      // log file space reserved per step, in bytes
+#define GROUP_COMMIT_DELAY_US 0        // group commit leader waits up to this for more committers
+#define GROUP_COMMIT_BATCH 8           // ... n stops waiting once this many are pending
+#define CHECKPOINT_INTERVAL_MS 30000   // checkpoint thread sleep between checkpoints
+#define OBJECT_EXTENT_PAGES 16         // pages a table heap / b+tree reserves for itself at once
+#define TABLESPACE_PAGE_BITS 24        // page id == tablespace id << this | page within its file
+#define MAX_TABLESPACES 128            // files per database, tablespace 0 == the db file itself
+#define TABLESPACE_RECORD_SIZE 128     // header page: tablespace id (4) + path, from the page end down
+#define PAGE_CHECKSUM_SIZE 4           // crc32c of the rest of the page, in its last bytes
+#define SCRUB_PAGES_PER_SECOND 1000    // background scrubber's default read rate
+#define COMPRESSED_SLOT_SIZE 64        // compressed files: page slots are whole multiples of it
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
@@ -0,0 +1,26 @@
+/**
+ * crc32c.h
+ *
+ * CRC32C (Castagnoli), the page checksum. SSE4.2 crc32 instruction, 8 bytes
+ * per instruction, when the cpu has it (checked once at runtime), else a
+ * table driven software version. both give the same result
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+class Crc32c {
+public:
+  // crc == result of a previous call == continue over more data, 0 to start
+  static uint32_t Compute(const char *data, size_t size, uint32_t crc = 0);
+  // always the table driven one, for tests / comparison
+  static uint32_t ComputeSoftware(const char *data, size_t size,
+                                  uint32_t crc = 0);
+  static bool IsHardwareAccelerated();
+};
+
+} // namespace cmudb
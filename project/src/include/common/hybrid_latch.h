@@ -0,0 +1,96 @@
+/**
+ * hybrid_latch.h
+ *
+ * 8 byte page latch, 3 modes:
+ * - exclusive / shared: like RWMutex, writer waits for readers to drain and
+ *   blocks new ones meanwhile
+ * - optimistic: reader writes nothing, remembers the version, reads, then
+ *   validates the version is unchanged. any exclusive unlock bumps version
+ *
+ * state_ layout (bits):
+ *  ------------------------------------------------
+ * | version (47) | shared count (16) | exclusive (1) |
+ *  ------------------------------------------------
+ *
+ * waiting == spin + yield, page latches are held for short critical sections
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace cmudb {
+class HybridLatch {
+
+  static const uint64_t exclusive_ = 1;
+  static const uint64_t reader_ = 1ULL << 1;
+  static const uint64_t reader_mask_ = 0xFFFFULL << 1;
+  static const uint64_t version_ = 1ULL << 17;
+  static const uint64_t version_mask_ = ~(version_ - 1);
+
+public:
+  HybridLatch() : state_(0) {}
+
+  HybridLatch(const HybridLatch &) = delete;
+  HybridLatch &operator=(const HybridLatch &) = delete;
+
+  void WLock() {
+    // 1. claim exclusive bit, new readers wait from now on
+    uint64_t state = state_.load(std::memory_order_relaxed);
+    while ((state & exclusive_) != 0 ||
+           !state_.compare_exchange_weak(state, state | exclusive_,
+                                         std::memory_order_acquire)) {
+      if ((state & exclusive_) != 0) {
+        std::this_thread::yield();
+        state = state_.load(std::memory_order_relaxed);
+      }
+    }
+    // 2. readers already in finish
+    while ((state_.load(std::memory_order_acquire) & reader_mask_) != 0)
+      std::this_thread::yield();
+  }
+
+  // version + 1, exclusive bit cleared, in 1 add
+  void WUnlock() {
+    state_.fetch_add(version_ - exclusive_, std::memory_order_release);
+  }
+
+  void RLock() {
+    uint64_t state = state_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((state & exclusive_) != 0 || (state & reader_mask_) == reader_mask_) {
+        std::this_thread::yield();
+        state = state_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (state_.compare_exchange_weak(state, state + reader_,
+                                       std::memory_order_acquire))
+        return;
+    }
+  }
+
+  void RUnlock() { state_.fetch_sub(reader_, std::memory_order_release); }
+
+  // wait out a writer, @return version to Validate() against
+  uint64_t OptimisticLock() {
+    uint64_t state = state_.load(std::memory_order_acquire);
+    while ((state & exclusive_) != 0) {
+      std::this_thread::yield();
+      state = state_.load(std::memory_order_acquire);
+    }
+    return state & version_mask_;
+  }
+
+  // true == nothing was written since OptimisticLock() returned version,
+  // reads done in between saw a consistent page
+  bool Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (state_.load(std::memory_order_relaxed) & ~reader_mask_) == version;
+  }
+
+private:
+  std::atomic<uint64_t> state_;
+};
+} // namespace cmudb
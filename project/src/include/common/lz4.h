@@ -0,0 +1,32 @@
+/**
+ * lz4.h
+ *
+ * LZ4 block format codec, no dependency, for page compression (see
+ * DiskManager). greedy single probe hash of 4 byte sequences, matches up to
+ * 64K back. input up to 64K (any page size); output of Compress() is a
+ * standard LZ4 block, any LZ4 decoder reads it. Decompress() checks every
+ * length n offset, malformed input never reads / writes out of bounds
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+class Lz4 {
+public:
+  // worst case (incompressible) output for size bytes in
+  static inline size_t MaxCompressedSize(size_t size) {
+    return size + size / 255 + 16;
+  }
+  // @return compressed size, 0 == does not fit in capacity
+  static size_t Compress(const char *src, size_t size, char *dst,
+                         size_t capacity);
+  // @return decompressed size, -1 == malformed / more than capacity
+  static int64_t Decompress(const char *src, size_t size, char *dst,
+                            size_t capacity);
+};
+
+} // namespace cmudb
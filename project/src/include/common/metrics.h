@@ -0,0 +1,125 @@
+/**
+ * metrics.h
+ *
+ * process wide metrics: named counters + latency histograms, recorded by
+ * buffer pool, disk manager, log manager, lock manager. read live through
+ * the metrics_* virtual tables (see vtable/virtual_table.cpp)
+ *
+ * recording never locks and barely shares cache lines between threads:
+ * every metric is METRICS_SHARDS cache line padded shards, a thread always
+ * adds into its own shard (relaxed atomic add), a reader sums the shards.
+ * readers may see a histogram's count n buckets a few records apart, fine
+ * for monitoring
+ *
+ * registry lookup takes a mutex == done once, call sites keep the pointer:
+ *   static MetricCounter *hits = MetricsRegistry::Instance().GetCounter("x");
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+// shard the calling thread records into, fixed per thread
+size_t MetricShardIndex();
+
+class MetricCounter {
+public:
+  MetricCounter() = default;
+  MetricCounter(const MetricCounter &) = delete;
+  MetricCounter &operator=(const MetricCounter &) = delete;
+
+  void Add(uint64_t num = 1) {
+    shards_[MetricShardIndex()].value_.fetch_add(num,
+                                                 std::memory_order_relaxed);
+  }
+  uint64_t Get() const;
+
+private:
+  // padded, not alignas: no aligned new before c++17
+  struct Shard {
+    std::atomic<uint64_t> value_{0};
+    char padding_[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  Shard shards_[METRICS_SHARDS];
+};
+
+/*
+ * log2 buckets, in microseconds: bucket 0 == < 1us, bucket i == [2^(i-1),
+ * 2^i) us, last bucket open ended (>= 2^30 us, ~18 min)
+ */
+class MetricHistogram {
+public:
+  static const int num_buckets_ = 32;
+
+  MetricHistogram() = default;
+  MetricHistogram(const MetricHistogram &) = delete;
+  MetricHistogram &operator=(const MetricHistogram &) = delete;
+
+  void Record(uint64_t micros);
+  // time from start till now, e.g. start captured at an async submit
+  void RecordSince(std::chrono::steady_clock::time_point start) {
+    Record(std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count());
+  }
+
+  uint64_t GetCount() const;
+  uint64_t GetSum() const; // us
+  // upper bound of the bucket the q-th (0 < q <= 1) record falls in, us
+  uint64_t GetPercentile(double q) const;
+  void GetBuckets(uint64_t (&buckets)[num_buckets_]) const;
+
+private:
+  struct Shard {
+    std::atomic<uint64_t> buckets_[num_buckets_];
+    std::atomic<uint64_t> sum_;
+    char padding_[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  Shard shards_[METRICS_SHARDS] = {};
+};
+
+// records time from construction to destruction into histogram
+class MetricTimer {
+public:
+  explicit MetricTimer(MetricHistogram *histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~MetricTimer() { histogram_->RecordSince(start_); }
+
+private:
+  MetricHistogram *histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+class MetricsRegistry {
+public:
+  static MetricsRegistry &Instance();
+
+  // created on 1st use, same name == same metric, pointer valid forever
+  MetricCounter *GetCounter(const std::string &name);
+  MetricHistogram *GetHistogram(const std::string &name);
+
+  // all metrics, ordered by name
+  std::vector<std::pair<std::string, uint64_t>> SnapshotCounters();
+  std::vector<std::pair<std::string, const MetricHistogram *>> GetHistograms();
+
+private:
+  MetricsRegistry() = default;
+
+  std::mutex latch_;
+  std::map<std::string, std::unique_ptr<MetricCounter>> counters_;
+  std::map<std::string, std::unique_ptr<MetricHistogram>> histograms_;
+};
+
+} // namespace cmudb
@@ -1,9 +1,13 @@
 /**
  * lock_manager.h
  *
- * 
+ *
  * Tuple level lock manager, use wait-die to prevent deadlocks
- * modeled after 
+ * modeled after
+ *
+ * wait-die == a txn only ever waits for younger ones (larger txn id): a
+ * request conflicting w an older holder / waiter aborts the requester
+ * instead. waits-for edges all point young, no cycle
  */
 
 #pragma once
@@ -22,7 +26,7 @@ namespace cmudb {
 
 enum class Mode {ERROR = -1, SHARED = 0, EXCLUSIVE = 1};
 struct Request {
-  explicit Request(txn_id_t tid, Mode mode) : 
+  explicit Request(txn_id_t tid, Mode mode) :
   tid_(tid), mode_(mode) {}
 
   txn_id_t tid_;
@@ -30,142 +34,123 @@ struct Request {
 };
 
 /**
- * 1 row of a lock rquest table 
+ * 1 row of a lock rquest table
  * - 3 columns (granted set, lock mode, wait queue)
- * 
- * 
- * Q&A
- * how to incorporate strict 2PL ??
+ *
+ * caller holds the lock manager's lock_table_lock_
  */
 class Row {
 
 public:
 
-  // init
-  Row(Request lock_req){
-    wait_queue_.push_back(lock_req);
+  // 2 requests of different txns can't both be granted
+  static bool Conflicts(const Request &a, const Request &b) {
+    return a.tid_ != b.tid_ &&
+           (a.mode_ == Mode::EXCLUSIVE || b.mode_ == Mode::EXCLUSIVE);
   }
-  
-  // wait die: 
-  txn_id_t GetOldestWaitQueue(){
-    return wait_queue_.begin().tid_;
-  };
 
-  
   /**
-   * 
-   * 2PL == T1 gets all lock first, T2 gets only after T1 release
-   * ordered by txn id NOT arrival time 
-   * wait die == only oldest is added == always add front
+   * wait die: txn conflicts w an older granted / waiting request (or an
+   * older txn upgrading) == die. upgrade == exclusive request
    */
-  void AddFrontWaitQueue(Request lock_req){
-    wait_queue_.push_front(lock_req);
-  };
-
-
-  bool DeleteWaitQueue(txn_id_t tid){
-    for (auto i = wait_queue_.begin(); i !=wait_queue_.end(); ++i){
-      if(i->tid_ == tid){
-        wait_queue_.erase(i); 
-        return true; // successfully deleted 
+  bool MustDie(const Request &lock_req) const {
+    for (auto &granted : granted_set_) {
+      if (Conflicts(granted, lock_req) && granted.tid_ < lock_req.tid_) {
+        return true;
       }
     }
-    return false; // not found
-  };
-
-  // granted set related
-  bool WaitQueueEmpty(){return wait_queue_.empty()};
-  bool GrantedSetEmpty(){return granted_set_.empty()};
-  bool UpgradeWaitQueueEmpty(){return upgrade_wait_queue_.empty()};
-
-  
-  // TRICKY CASE !!!! 2PL conflicts w wait die
-  // if T3 already granted, but T1, T2 arrived late, then T3 lock()
-  // wait die: T3 dies, but then deadlock since 2PL
-  // T3 wont release lock unless T3 gets all the lock 
-  // thic func == for T3 to get 1st in wait queue to get the lock
-  // 
-  // what if upgrade ?? 
-  bool IsTxnInGrantedSet(txn_id_t tid){ 
-    for (Request* i = granted_set_.begin(); i !=granted_set_.end(); ++i){
-      if(i->tid_ == tid){
-        return true; // T3 gets 1st in wait queue since T3 in grant set
+    for (auto &waiting : wait_queue_) {
+      if (Conflicts(waiting, lock_req) && waiting.tid_ < lock_req.tid_) {
+        return true;
       }
     }
-    return false; // kill T3  
-  };
-
+    return upgrading_ != INVALID_TXN_ID && upgrading_ < lock_req.tid_;
+  }
 
-  // for upgrade()
-  bool IsOnlyTxnInGrantedSet(txn_id_t tid){     
-    if(IsTxnInGrantedSet(tid) && granted_set_.size()== 1 ){
-      return true;
+  /**
+   * lock_req compatible w every granted request n every 1 queued before it
+   * (FIFO, a later shared lock doesn't starve a queued exclusive 1). a
+   * pending upgrade goes 1st
+   */
+  bool CouldGrant(const Request &lock_req) const {
+    if (upgrading_ != INVALID_TXN_ID && upgrading_ != lock_req.tid_) {
+      return false;
     }
-    return false;
-
-  };
-
+    for (auto &granted : granted_set_) {
+      if (Conflicts(granted, lock_req)) {
+        return false;
+      }
+    }
+    for (auto &waiting : wait_queue_) {
+      if (waiting.tid_ == lock_req.tid_) {
+        break;
+      }
+      if (Conflicts(waiting, lock_req)) {
+        return false;
+      }
+    }
+    return true;
+  }
 
+  // upgrade: only its own shared lock left in the grant set
+  bool IsOnlyTxnInGrantedSet(txn_id_t tid) const {
+    return granted_set_.size() == 1 && granted_set_.front().tid_ == tid;
+  }
 
-  // for upgrade()
-  bool IsTxnInGrantedSet(txn_id_t tid){ 
-    for (Request* i = granted_set_.begin(); i !=granted_set_.end(); ++i){
-      if(i->tid_ == tid && i->mode_ == Mode::SHARED){
-        return true; 
+  // INVALID_TXN_ID's mode == ERROR
+  Mode GetGrantedMode(txn_id_t tid) const {
+    for (auto &granted : granted_set_) {
+      if (granted.tid_ == tid) {
+        return granted.mode_;
       }
     }
-    return false; 
-  };
+    return Mode::ERROR;
+  }
 
-  bool UpgradeGrantedSet(txn_id_t tid){ 
-    for (Request* i = granted_set_.begin(); i !=granted_set_.end(); ++i){
-      if(i->tid_ == tid && i->mode_ == Mode::SHARED){
-        i->mode_ = Mode::EXCLUSIVE; 
+  void AddGrantedSet(Request lock_req) { granted_set_.push_back(lock_req); }
+
+  void UpgradeGrantedSet(txn_id_t tid) {
+    for (auto &granted : granted_set_) {
+      if (granted.tid_ == tid) {
+        granted.mode_ = Mode::EXCLUSIVE;
       }
     }
-    return false; 
-  };
-  
-  bool CouldGrantSharedLock(){
-    assert(!granted_set_.empty());
-    return granted_set_.begin()->mode == Mode::SHARED;
-  };
-
-
-  // for unlock garbage collecting
-  Request GetGrantedSet(txn_id_t tid){
-    for (Request* i = granted_set_.begin(); i !=granted_set_.end(); ++i){
-      if(i->tid_ == tid){
-        return *i; 
+  }
+
+  bool DeleteGrantedSet(txn_id_t tid) {
+    for (auto i = granted_set_.begin(); i != granted_set_.end(); ++i) {
+      if (i->tid_ == tid) {
+        granted_set_.erase(i);
+        return true;
       }
     }
-    return Request(Mode::ERROR, Mode::ERROR);
-  };
+    return false; // not found
+  }
 
-  void AddGrantedSet(Request lock_req){
-    granted_set_.push_back(lock_req);
-  };
+  void AddWaitQueue(Request lock_req) { wait_queue_.push_back(lock_req); }
 
-  bool DeleteGrantedSet(txn_id_t tid){
-    for (auto i = granted_set_.begin(); i !=granted_set_.end(); ++i){
-      if(i->tid_ == tid){
-        granted_set_.erase(i); 
-        return true;
+  bool DeleteWaitQueue(txn_id_t tid) {
+    for (auto i = wait_queue_.begin(); i != wait_queue_.end(); ++i) {
+      if (i->tid_ == tid) {
+        wait_queue_.erase(i);
+        return true; // successfully deleted
       }
     }
     return false; // not found
-  };
+  }
 
+  bool IsEmpty() const {
+    return granted_set_.empty() && wait_queue_.empty() &&
+           upgrading_ == INVALID_TXN_ID;
+  }
 
+  // at most 1, a 2nd upgrader is younger (both hold shared locks) n dies
+  txn_id_t upgrading_ = INVALID_TXN_ID;
 
 private:
-  // TODO: lock !!!!!!!!
-
   /* 3 columns of lock request table */
-  std::list<Request> granted_set_;  
-  std::list<Request> wait_queue_;
-  std::list<txn_id_t> upgrade_wait_queue_; // mode must be x
-
+  std::list<Request> granted_set_;
+  std::list<Request> wait_queue_; // arrival order
 };
 
 
@@ -173,7 +158,7 @@ private:
 
 
 /**
- * 
+ *
  */
 class LockManager {
 
@@ -195,17 +180,20 @@ public:
   bool Unlock(Transaction *txn, const RID &rid);
   /*** END OF APIs ***/
 
-  
+
 
 
 private:
+  // shared n exclusive alike, lock_req's mode. lock held by the caller
+  bool Lock(Transaction *txn, const RID &rid, Request lock_req);
+
   bool strict_2PL_;
 
   // {rid : {granted_set, s/x, wait_queue[{txn : s/x}]}}
-  std::unordered_map<RID, std::unique_ptr<Row>> lock_table_; 
+  std::unordered_map<RID, std::unique_ptr<Row>> lock_table_;
   std::mutex lock_table_lock_;
-  std::condition_variable cv_wait_queue_;
-  std::condition_variable cv_grant_set_;  
+  std::condition_variable cv_wait_queue_; // lock requests, any row
+  std::condition_variable cv_grant_set_;  // upgrades, any row
 
 
 
@@ -214,4 +202,3 @@ private:
 };
 
 } // namespace cmudb
-
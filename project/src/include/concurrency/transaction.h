@@ -148,7 +148,7 @@ private:
   TransactionState state_;
   std::thread::id thread_id_;  
   txn_id_t txn_id_;
-  lsn_t prev_lsn_; // TT latestLSN
+  std::atomic<lsn_t> prev_lsn_; // TT latestLSN, checkpoint reads it too
 
 
   /* ABORT */
@@ -5,6 +5,8 @@
 
 #pragma once
 #include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "common/config.h"
@@ -22,12 +24,25 @@ public:
   void Commit(Transaction *txn);
   void Abort(Transaction *txn);
 
+  // checkpoint ATT: <txn_id, last lsn> of txns that logged something.
+  // oldest_lsn == lower bound of every active txn's BEGIN lsn, INVALID_LSN
+  // if none is active
+  void GetActiveTransactions(std::unordered_map<txn_id_t, lsn_t> &active_txns,
+                             lsn_t &oldest_lsn);
+
 
 
 private:
+  // out of the ATT
+  void EndTransaction(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
+
+  // ATT: begun, not committed / aborted yet, <txn, its BEGIN lsn or lower>
+  std::mutex active_latch_;
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> active_txns_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,174 @@
+/**
+ * async_io.h
+ *
+ * Asynchronous file I/O for the disk manager: submit reads / writes, get a
+ * completion handle back, completions are reaped in batches by the
+ * backend's own thread(s).
+ *
+ * 2 backends, same interface:
+ * - io_uring: raw syscalls (io_uring_setup / io_uring_enter + mmap'ed
+ *   rings), no liburing. 1 enter per submitted batch, 1 reaper thread
+ *   draining every completion the kernel posted per wakeup
+ * - thread pool: pread / pwrite on ASYNC_IO_THREADS workers, for kernels /
+ *   sandboxes w/o io_uring
+ * AsyncIO::Create() picks io_uring if the kernel lets us set up a ring
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+// result == bytes transferred, or -errno
+typedef std::function<void(int64_t result)> IOCallback;
+
+/*
+ * completion handle of 1 request, shared by submitter n backend
+ */
+class IOHandle {
+  friend class AsyncIO;
+
+public:
+  bool IsDone() const { return done_.load(std::memory_order_acquire); }
+  // block until done, @return bytes transferred or -errno
+  int64_t Wait();
+
+  // wait for all, @return false if any of them failed
+  static bool WaitAll(const std::vector<std::shared_ptr<IOHandle>> &handles);
+  // already done, for work a caller had to do synchronously
+  static std::shared_ptr<IOHandle> Done(int64_t result);
+
+private:
+  void Complete(int64_t result);
+
+  std::atomic<bool> done_{false};
+  int64_t result_ = 0;
+  std::mutex latch_;
+  std::condition_variable cv_;
+};
+
+enum class IOType { READ, WRITE };
+
+struct IORequest {
+  IOType type_;
+  int fd_;
+  char *data_;
+  size_t size_;
+  int64_t offset_;
+  // runs in the completing (reaper / worker) thread, before the handle is
+  // done. short n non-blocking: MUST NOT wait for other I/O or submit
+  IOCallback callback_;
+  std::shared_ptr<IOHandle> handle_;
+};
+
+class AsyncIO {
+public:
+  // io_uring if available, else thread pool
+  static AsyncIO *Create(size_t queue_depth = ASYNC_IO_QUEUE_DEPTH);
+
+  virtual ~AsyncIO() {}
+
+  std::shared_ptr<IOHandle> Submit(IOType type, int fd, char *data,
+                                   size_t size, int64_t offset,
+                                   IOCallback callback = nullptr);
+  // batch == 1 submission, handles in request order
+  std::vector<std::shared_ptr<IOHandle>>
+  SubmitBatch(std::vector<IORequest> &requests);
+
+  virtual const char *GetName() const = 0;
+
+protected:
+  // takes ownership of requests
+  virtual void SubmitRequests(std::vector<IORequest *> &requests) = 0;
+  // callback, then handle, then request deleted
+  static void Complete(IORequest *request, int64_t result);
+  // short read / write (eof, signal) finished synchronously
+  static int64_t FinishShort(IORequest *request, int64_t done);
+};
+
+/*
+ * fallback: workers take requests off 1 queue, blocking syscalls
+ */
+class ThreadPoolIO : public AsyncIO {
+public:
+  explicit ThreadPoolIO(size_t num_threads = ASYNC_IO_THREADS);
+  ~ThreadPoolIO();
+
+  const char *GetName() const override { return "thread_pool"; }
+
+protected:
+  void SubmitRequests(std::vector<IORequest *> &requests) override;
+
+private:
+  void WorkerLoop();
+
+  std::deque<IORequest *> queue_;
+  bool stop_ = false;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::vector<std::thread> workers_;
+};
+
+/*
+ * io_uring w/o liburing
+ *
+ * submission: under submit_latch_, fill sqes at the sq tail, publish tail,
+ * 1 io_uring_enter for the batch. at most sq size sqes in flight (a
+ * submitter waits) == neither ring ever overflows
+ *
+ * completion: reaper blocks in io_uring_enter(GETEVENTS), then consumes
+ * everything between cq head n tail in 1 go
+ */
+class IoUringIO : public AsyncIO {
+public:
+  // throws if the kernel refuses a ring
+  explicit IoUringIO(size_t queue_depth);
+  ~IoUringIO();
+
+  const char *GetName() const override { return "io_uring"; }
+
+protected:
+  void SubmitRequests(std::vector<IORequest *> &requests) override;
+
+private:
+  // iovec must live until the kernel is done w the request
+  struct UringRequest;
+
+  void ReaperLoop();
+  // caller holds submit_latch_, 1 sqe
+  void QueueRequest(UringRequest *request);
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+  int ring_fd_ = -1;
+  // rings shared w the kernel, pointers into the mmap'ed areas
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  void *cqes_;
+  unsigned sq_entries_;
+  unsigned cq_entries_;
+
+  std::mutex submit_latch_;
+  std::condition_variable space_cv_; // a completion freed room
+  size_t in_flight_ = 0;             // sqes, protected by submit_latch_
+  bool stop_ = false;
+  std::thread reaper_;
+};
+
+} // namespace cmudb
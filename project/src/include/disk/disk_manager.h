@@ -5,31 +5,271 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * direct_io == db n log file opened O_DIRECT, bypassing the OS page cache:
+ * a page lives in the buffer pool only, not twice. buffers handed in should
+ * be DIRECT_IO_ALIGNMENT aligned (buffer pool frames, AllocateAligned());
+ * others are bounced through an aligned copy. log writes go out in whole
+ * aligned blocks, the partial last one is kept n rewritten by the next
+ * write
+ *
+ * free space map == <db>.fsm, 1 bit per db page (set == allocated), in
+ * pages of page size. crash safe w/o the WAL, a crash can only leak pages:
+ * - allocated bits are made durable before any db page write, which is
+ *   what could reference the new page
+ * - deallocated pages only become free at a full flush
+ *   (ReleaseFreedPages), once every unlink from them is on disk
+ * - extents' pages are reserved in memory, each one goes into the map on
+ *   disk when handed out. a crash drops the reservations w the extents
+ *
+ * space is reserved ahead in extents (fallocate, file size unchanged): db
+ * file DB_EXTENT_PAGES, log file LOG_EXTENT_SIZE at a time == the file
+ * system allocates blocks once per extent, not on every page / append
+ *
+ * tablespaces: page id == tablespace id << TABLESPACE_PAGE_BITS | page
+ * within that tablespace's file. tablespace 0 == db_file, the others are
+ * opened by path (other directories / volumes), each w its own free space
+ * map, all I/O goes to the file the page id names. which object lives in
+ * which tablespace is recorded by the header page
+ *
+ * checksums: every page written gets a crc32c (common/crc32c.h) of its
+ * first page size - PAGE_CHECKSUM_SIZE bytes stamped into its last
+ * PAGE_CHECKSUM_SIZE, in the caller's buffer. page layouts leave that
+ * trailer alone. stored 0 == never written / from before checksums, not
+ * verified. reads verify unless turned off; a background scrubber reads
+ * pages nobody has cached at a throttled rate n verifies them. mismatches
+ * are logged, counted (disk.checksum_failures) n kept (GetCorruptPages())
+ *
+ * compress == new tablespace files are CompressedPageFiles: pages LZ4
+ * compressed into variable size slots, found through a slot map. existing
+ * files keep what they are (<db>.map next to a non-empty file ==
+ * compressed). compressed files are never O_DIRECT n can't be mapped,
+ * async I/O on them completes synchronously
  */
 
 #pragma once
 #include <atomic>
-#include <fstream>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
 #include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/config.h"
+#include "disk/async_io.h"
 
 namespace cmudb {
 
+class DiskManager;
+
+/*
+ * run of page ids reserved for 1 object (table heap, b+tree), handed out in
+ * order by AllocatePage(hint, extent) == the object's pages stay next to
+ * each other on disk even when objects grow interleaved. unused ids go back
+ * when it is destroyed (before its disk manager), a crash frees them too
+ */
+class PageExtent {
+  friend class DiskManager;
+
+public:
+  explicit PageExtent(size_t num_pages = OBJECT_EXTENT_PAGES,
+                      int tablespace_id = 0)
+      : num_pages_(num_pages), tablespace_id_(tablespace_id) {}
+  ~PageExtent();
+  PageExtent(const PageExtent &) = delete;
+  PageExtent &operator=(const PageExtent &) = delete;
+
+private:
+  // all set by the disk manager under its fsm_latch_
+  DiskManager *disk_manager_ = nullptr;
+  size_t num_pages_;
+  int tablespace_id_; // pages taken from this file
+  page_id_t next_page_id_ = INVALID_PAGE_ID;
+  page_id_t end_page_id_ = INVALID_PAGE_ID;
+};
+
+/*
+ * compressed tablespace file: each page in a slot of whole
+ * COMPRESSED_SLOT_SIZE units anywhere in the file, LZ4 compressed (raw if
+ * that saves less than a unit). slot map == <db>.map, 8 bytes per page:
+ * slot offset in units, length in bytes (0 == never written)
+ *
+ * a rewritten page always moves (copy on write): best fitting free slot
+ * (split) or the end of the file, never written over in place. its old
+ * slot is reused only after the next Sync(), once the map entry pointing
+ * away from it is durable n no read still uses it
+ */
+class CompressedPageFile {
+public:
+  // fd == data file, not owned. a map next to an empty data file is stale.
+  // read_only == map opened as is, never reset / written
+  CompressedPageFile(int fd, const std::string &map_file,
+                     bool read_only = false);
+  ~CompressedPageFile();
+  CompressedPageFile(const CompressedPageFile &) = delete;
+  CompressedPageFile &operator=(const CompressedPageFile &) = delete;
+
+  // num_pages consecutive pages (page_size each) from page on, adjacent
+  // slots in 1 write. false == I/O error
+  bool WritePages(page_id_t page, const char *pages_data, size_t num_pages,
+                  size_t page_size);
+  // @return bytes of page, 0 == never written (page_data untouched), -1 ==
+  // I/O error / malformed / more than capacity
+  int64_t ReadPage(page_id_t page, char *page_data, size_t capacity);
+  // slot freed, page reads as never written
+  void FreePage(page_id_t page);
+  // data n map durable, then slots freed before it are reusable
+  bool Sync();
+  // 1 past the highest page w a slot entry
+  page_id_t GetNumPages();
+  // file bytes up to the end of the last slot
+  int64_t GetPackedSize();
+
+private:
+  struct Slot {
+    uint32_t offset_ = 0; // in units
+    uint32_t length_ = 0; // bytes, | RAW_SLOT == stored uncompressed
+    uint32_t units_ = 0;  // capacity, >= length_ in units
+  };
+  static constexpr uint32_t RAW_SLOT = 1u << 31;
+
+  // caller holds latch_. @return offset in units
+  uint32_t AllocateSlot(uint32_t units);
+  // caller holds latch_. entries of [page, page + num_pages) written
+  bool WriteMapEntries(page_id_t page, size_t num_pages);
+
+  int fd_;
+  int map_fd_ = -1;
+  std::shared_timed_mutex reads_; // shared by each ReadPage, see Sync()
+  std::mutex latch_; // everything below
+  std::vector<Slot> slots_; // per page
+  std::map<uint32_t, std::vector<uint32_t>> free_slots_; // units -> offsets
+  std::vector<std::pair<uint32_t, uint32_t>> pending_free_; // offset, units
+  uint32_t end_ = 0; // 1 past the last slot, in units
+};
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // page_size == for a new database, an existing one keeps what its header
+  // page says
+  // direct_io == falls back to buffered I/O if the file system refuses
+  // O_DIRECT (e.g. tmpfs), see IsDirectIO()
+  // log_file == "" : db_file's name w .log, e.g. on a volume of its own
+  // compress == new files compressed, see CompressedPageFile
+  // read_only == existing files opened O_RDONLY, nothing created (no log,
+  // no free space map), nothing written. writes fail
+  DiskManager(const std::string &db_file, size_t page_size = PAGE_SIZE,
+              bool direct_io = false, const std::string &log_file = "",
+              bool compress = false, bool read_only = false);
   ~DiskManager();
 
-  void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  // db_file, its free space map / slot map n its log (same log_file as
+  // opened with) off the file system. none of them open
+  static void RemoveFiles(const std::string &db_file,
+                          const std::string &log_file = "");
+
+  /* tablespaces, created if the file does not exist */
+  // false == id taken / out of range, or the file can't be opened
+  bool OpenTablespace(int tablespace_id, const std::string &db_file);
+  // lowest unused id, -1 if none / can't open
+  int CreateTablespace(const std::string &db_file);
+  bool HasTablespace(int tablespace_id) const;
+  static inline int GetTablespaceId(page_id_t page_id) {
+    return page_id >> TABLESPACE_PAGE_BITS;
+  }
+  // page within its tablespace's file
+  static inline page_id_t GetFilePageId(page_id_t page_id) {
+    return page_id & ((1 << TABLESPACE_PAGE_BITS) - 1);
+  }
+  static inline page_id_t MakePageId(int tablespace_id, page_id_t page) {
+    return (tablespace_id << TABLESPACE_PAGE_BITS) | page;
+  }
+
+  // DIRECT_IO_ALIGNMENT aligned, size rounded up to it. FreeAligned() it
+  static char *AllocateAligned(size_t size);
+  static void FreeAligned(char *data) { free(data); }
+
+  // page_data's checksum trailer stamped before it goes out
+  void WritePage(page_id_t page_id, char *page_data);
+  // false == checksum mismatch (page_data holds what is on disk) / no
+  // tablespace (zeros)
+  bool ReadPage(page_id_t page_id, char *page_data);
+  // num_pages consecutive pages from first_page_id on, 1 seek + 1 write
+  void WritePages(page_id_t first_page_id, char *pages_data,
+                  size_t num_pages);
+  // page writes so far durable (fdatasync), e.g. end of a checkpoint
+  void SyncPages();
+
+  /* async I/O (disk/async_io.h), backend started on 1st use */
+  // return at once, buffer untouched by caller until the handle is done.
+  // on_done == called in the backend's thread on completion, after the
+  // page is read (zero filled past eof) / written. -EIO to on_done ==
+  // checksum mismatch
+  std::shared_ptr<IOHandle> ReadPageAsync(page_id_t page_id, char *page_data,
+                                          IOCallback on_done = nullptr);
+  std::shared_ptr<IOHandle> WritePagesAsync(page_id_t first_page_id,
+                                            char *pages_data,
+                                            size_t num_pages,
+                                            IOCallback on_done = nullptr);
+  // "io_uring" / "thread_pool"
+  const char *GetAsyncIOBackend() { return GetAsyncIO()->GetName(); }
+
+  /* checksums */
+  // off == reads trust the disk, the scrubber still checks
+  void SetVerifyChecksums(bool verify) { verify_checksums_ = verify; }
+  // every page failing a check so far, ascending
+  std::vector<page_id_t> GetCorruptPages();
+  // background thread: allocated pages of every open tablespace, over n
+  // over, at most pages_per_second. skip(page_id) == true: not read, e.g.
+  // cached in a buffer pool (its copy there is newer, gets written anyway)
+  void StartScrubber(size_t pages_per_second = SCRUB_PAGES_PER_SECOND,
+                     std::function<bool(page_id_t)> skip = nullptr);
+  // waits for the current page, no-op if not running
+  void StopScrubber();
+
+  /* read-only mapping of a whole tablespace file, page n (within the
+     tablespace) at n * page size. not verified */
+  // num_pages == whole pages in the file. nullptr if empty / refused
+  const char *MapPages(size_t &num_pages, int tablespace_id = 0);
+  void UnmapPages(const char *data, size_t num_pages);
 
   void WriteLog(char *log_data, int size);
   bool ReadLog(char *log_data, int size, int offset);
+  // bytes written to the log file, i.e. where the next WriteLog lands
+  inline int64_t GetLogSize() const { return log_size_; }
+  // drop the log from size on (torn record of a crash), before any WriteLog
+  void TruncateLog(int64_t size);
 
-  page_id_t AllocatePage();
+  // free page nearest after hint (e.g. the page the new one gets linked
+  // from), else lowest free one, else 1 past the end. in hint's tablespace,
+  // 0 w/o a hint.
+  // extent == next page of the extent. used up == a new one from the free
+  // run nearest the hint (else where its last one ended), the end of its
+  // tablespace's file if no run is long enough.
+  // INVALID_PAGE_ID == tablespace not open / full
+  page_id_t AllocatePage(page_id_t hint = INVALID_PAGE_ID,
+                         PageExtent *extent = nullptr);
+  // pending until ReleaseFreedPages(), a crash before that leaks it
   void DeallocatePage(page_id_t page_id);
+  // full flush: take the mark 1st, write n sync every dirty page, then
+  // release == pages deallocated before the mark are free for reuse
+  uint64_t GetFreeMark();
+  void ReleaseFreedPages(uint64_t mark);
+  bool IsAllocated(page_id_t page_id);
+  // extent's unused pages deallocated
+  void ReleaseExtent(PageExtent *extent);
+
+  inline size_t GetPageSize() const { return page_size_; }
+  inline bool IsDirectIO() const { return direct_io_; }
+  bool IsCompressed(int tablespace_id = 0) const;
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,17 +277,101 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  // 1 tablespace. fds n names fixed once published in files_, the rest
+  // protected by fsm_latch_
+  struct DataFile {
+    int fd_ = -1; // positional I/O only
+    std::string name_;
+    int fsm_fd_ = -1;
+    std::string fsm_name_;
+    std::vector<uint64_t> fsm_;        // bit n == page n allocated
+    std::vector<bool> fsm_page_dirty_; // per fsm page, not written yet
+    std::vector<uint64_t> reserved_;   // bit n == page n in an extent, unused
+    page_id_t end_page_id_ = 0;        // 1 past the highest allocated page
+    page_id_t reserved_page_id_ = 0;   // 1 past the last fallocate'd page
+    // nullptr == page n at n * page size
+    std::unique_ptr<CompressedPageFile> compressed_;
+  };
+
+  int64_t GetFileSize(const std::string &name);
+  AsyncIO *GetAsyncIO();
+  // O_DIRECT n data not aligned == go through an aligned copy
+  inline bool NeedsBounce(const char *data) const {
+    return direct_io_ &&
+           reinterpret_cast<uintptr_t>(data) % DIRECT_IO_ALIGNMENT != 0;
+  }
+  void OpenFiles(bool direct_io);
+  // data file n its free space map opened (O_DIRECT w direct_io_ if the
+  // file system allows), nullptr if it can't be
+  DataFile *OpenDataFile(const std::string &db_file,
+                         const std::string &fsm_file);
+  // file holding page_id n its offset in there, nullptr if not open
+  DataFile *GetFile(page_id_t page_id, int64_t &offset) const;
+  // caller holds fsm_latch_. page ids within the file
+  void LoadFreeSpaceMap(DataFile *file);
+  void SetAllocated(DataFile *file, page_id_t page_id, bool allocated);
+  void SetReserved(DataFile *file, page_id_t page_id, bool reserved);
+  page_id_t FindFreePage(DataFile *file, page_id_t hint);
+  page_id_t FindFreeRun(DataFile *file, page_id_t from, page_id_t to,
+                        size_t num_pages);
+  // dirty fsm pages written n synced, before any db page write
+  void SyncFreeSpaceMap();
+  // fallocate up to the extent holding page_id / log_size_ + size
+  void ReserveDbSpace(DataFile *file, page_id_t page_id);
+  void ReserveLogSpace(size_t size);
+  // direct_io: tail block + data padded to whole blocks, @return false on
+  // I/O error
+  bool WriteLogDirect(const char *log_data, size_t size);
+  // trailer of each page set from the rest of it
+  void StampChecksums(char *pages_data, size_t num_pages);
+  // true == matches / never stamped
+  bool ChecksumMatches(const char *page_data) const;
+  // compressed file: page decompressed into page_data (zeros if never
+  // written), false == can't be
+  bool ReadCompressedPage(DataFile *file, page_id_t page_id, char *page_data);
+  // logged, counted, kept
+  void ReportCorruptPage(page_id_t page_id);
+  void ScrubLoop(size_t pages_per_second, std::function<bool(page_id_t)> skip);
+
+  // log file, appended only
+  int log_fd_ = -1;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // tablespace files, positional I/O only (pread/pwrite) == no cursor, no
+  // latch, any num of threads read n write pages at once. published once
+  // open, closed by the destructor only
+  std::atomic<DataFile *> files_[MAX_TABLESPACES] = {};
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  bool direct_io_ = false;
+  bool compress_ = false; // for new files
+  bool read_only_ = false;
+  // log bytes written so far. direct_io: copy of the last, partial block
+  // (log_size_ % DIRECT_IO_ALIGNMENT bytes of it valid)
+  int64_t log_size_ = 0;
+  char *log_tail_ = nullptr;
+  int64_t log_reserved_ = 0; // bytes fallocate'd, >= log_size_ mostly
+  size_t page_size_;
+
+  // free space maps (in files_), everything protected by fsm_latch_
+  std::mutex fsm_latch_;
+  std::atomic<bool> fsm_dirty_{false}; // any fsm page, read w/o the latch
+  std::deque<page_id_t> pending_free_;
+  uint64_t num_released_ = 0; // + pending_free_.size() == deallocated so far
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+  const char *log_buffer_used_ = nullptr; // WriteLog's last buffer, per log
+
+  std::unique_ptr<AsyncIO> async_io_;
+  std::once_flag async_io_once_;
+
+  std::atomic<bool> verify_checksums_{true};
+  std::mutex corrupt_latch_;
+  std::set<page_id_t> corrupt_pages_; // protected by corrupt_latch_
+  // scrubber, stop_scrub_ protected by scrub_latch_
+  std::thread scrubber_;
+  std::mutex scrub_latch_;
+  std::condition_variable scrub_cv_;
+  bool stop_scrub_ = false;
 };
 
 } // namespace cmudb
\ No newline at end of file
@@ -0,0 +1,71 @@
+/**
+ * lock_free_hash_table.h
+ *
+ * Concurrent open addressing hash table, fixed capacity, linear probing.
+ * Built for the buffer pool's page table: lookups (the hot path of every
+ * page hit) never take a lock, writers are serialized by a mutex.
+ *
+ * - every slot is a seqlock == readers copy key/value, retry if a writer
+ *   touched the slot meanwhile (odd / changed sequence number)
+ * - remove == backward shift, no tombstones, so probe lengths stay short.
+ *   a shift can move a key behind a reader's back, so a miss is re-checked
+ *   against shift_seq_ and retried; a hit never needs that
+ *
+ * K, V must be trivially copyable (page_id_t, Page *)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+class LockFreeHashTable : public HashTable<K, V> {
+
+  struct Slot {
+    std::atomic<uint32_t> seq_{0}; // odd == being written
+    std::atomic<bool> used_{false};
+    std::atomic<K> key_;
+    std::atomic<V> value_;
+  };
+
+public:
+  // capacity == max num of keys at once, e.g. pool size for a page table
+  explicit LockFreeHashTable(size_t capacity);
+  ~LockFreeHashTable();
+
+  LockFreeHashTable(const LockFreeHashTable &) = delete;
+  LockFreeHashTable &operator=(const LockFreeHashTable &) = delete;
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+  bool Remove(const K &key) override;
+  // throws once capacity keys are stored
+  void Insert(const K &key, const V &value) override;
+
+  size_t Size() const { return size_.load(); }
+  size_t GetNumSlots() const { return mask_ + 1; }
+
+private:
+  size_t HashKey(const K &key) const;
+
+  // consistent snapshot of slot, false == slot empty
+  bool ReadSlot(Slot &slot, K &key, V &value) const;
+  // caller MUST hold write_latch_
+  void WriteSlot(Slot &slot, bool used, const K &key, const V &value);
+
+  Slot *slots_;
+  size_t mask_;     // num slots - 1, num slots is a power of 2
+  size_t capacity_;
+  std::atomic<size_t> size_{0};
+
+  std::atomic<uint64_t> shift_seq_{0}; // odd == remove shifting keys
+  std::mutex write_latch_;             // 1 writer at a time
+};
+
+} // namespace cmudb
@@ -30,7 +30,8 @@ public:
   explicit BPlusTree(const std::string &name,
                            BufferPoolManager *buffer_pool_manager,
                            const KeyComparator &comparator,
-                           page_id_t root_page_id = INVALID_PAGE_ID);
+                           page_id_t root_page_id = INVALID_PAGE_ID,
+                           int tablespace_id = 0);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsBTreeEmpty() const{ return root_page_id_ == INVALID_PAGE_ID; };
@@ -69,6 +70,15 @@ public:
 
 
 private:
+  // search w optimistic lock coupling: no latch taken, no pin, versions
+  // validated on the way down, restart on conflict.
+  // false == gave up (page not in RAM / kept conflicting), latch instead
+  bool GetValueOptimistic(const KeyType &key, ValueType &value, bool &found);
+  // search w read latch crabbing
+  bool GetValuePessimistic(const KeyType &key, ValueType &value);
+  // size read w/o latch may be torn, keeps lookups inside the frame
+  bool IsSizeInBounds(BPlusTreePage *node) const;
+
   void StartNewBPlusTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value,
@@ -102,6 +112,9 @@ private:
   BufferPoolManager *buffer_pool_manager_;
   // not fixed == 1 btree manager handles 1+ btrees == users many primary keys
   page_id_t root_page_id_; 
+  // new nodes come from here == 1 index's nodes clustered on disk, in its
+  // tablespace (root's, once there is a root)
+  PageExtent extent_;
 
 
   std::string index_name_;
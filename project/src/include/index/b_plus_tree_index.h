@@ -21,7 +21,8 @@ class BPlusTreeIndex : public Index {
 public:
   BPlusTreeIndex(IndexMetadata *metadata,
                  BufferPoolManager *buffer_pool_manager,
-                 page_id_t root_page_id = INVALID_PAGE_ID);
+                 page_id_t root_page_id = INVALID_PAGE_ID,
+                 int tablespace_id = 0);
 
   ~BPlusTreeIndex() {}
 
@@ -0,0 +1,84 @@
+/**
+ * checkpoint_manager.h
+ *
+ * fuzzy checkpoints (ARIES): txns n page writes go on while 1 is taken,
+ * nothing is flushed but the log n pages dirty since before the previous
+ * checkpoint. pages deleted before the previous checkpoint become reusable
+ * (see BufferPoolManager::ReleaseFreedPages)
+ *
+ * 1. BEGIN_CHECKPOINT
+ * 2. ATT (txn manager) n DPT (buffer pool) snapshots, in END_CHECKPOINT
+ * 3. log forced, then the master record in the header page points at
+ *    BEGIN_CHECKPOINT n the redo point
+ *
+ * crash before 3 == recovery uses the previous master record. recovery
+ * analysis starts at BEGIN_CHECKPOINT, redo at the redo point: the latest
+ * checkpoint (or the log start) before every recLSN n active txn's BEGIN,
+ * so lsn -> offset is known for all of redo n undo. old dirty pages written
+ * in step 0 keep it moving == recovery reads ~2 checkpoint intervals of log,
+ * not the whole log (long running txns hold it back)
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class CheckpointManager {
+public:
+  // log_manager fresh == nothing appended yet, its 1st record is the redo
+  // point until a checkpoint moves it. header page must exist
+  CheckpointManager(TransactionManager *transaction_manager,
+                    LogManager *log_manager,
+                    BufferPoolManager *buffer_pool_manager);
+
+  ~CheckpointManager();
+
+  // 1 checkpoint, @return its BEGIN_CHECKPOINT lsn. INVALID_LSN == logging
+  // off / header page not there, master record unchanged
+  lsn_t Checkpoint();
+  // checkpoint every interval until stopped
+  void RunCheckpointThread(std::chrono::milliseconds interval =
+                               std::chrono::milliseconds(CHECKPOINT_INTERVAL_MS));
+  void StopCheckpointThread();
+
+  // redo point of the last checkpoint, the log start before the 1st
+  inline lsn_t GetRedoLSN() {
+    std::lock_guard<std::mutex> guard(latch_);
+    return checkpoints_.front().lsn_;
+  }
+
+private:
+  // a place recovery can start reading at
+  struct LogPosition {
+    lsn_t lsn_;
+    int64_t offset_;
+  };
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+
+  // checkpoints since the redo point, redo point 1st. 1 checkpoint at a time
+  std::mutex latch_;
+  std::deque<LogPosition> checkpoints_;
+  // last BEGIN_CHECKPOINT n the free mark taken right before it
+  lsn_t previous_lsn_ = INVALID_LSN;
+  uint64_t free_mark_ = 0;
+
+  /* checkpoint thread */
+  std::thread *checkpoint_thread_ = nullptr;
+  bool stop_checkpoint_thread_ = false;
+  std::mutex thread_latch_;
+  std::condition_variable cv_stop_;
+};
+
+} // namespace cmudb
@@ -3,17 +3,36 @@
  * log manager maintain a separate thread that is awaken when the log buffer is
  * full or time out(every X second) to write log buffer's content into disk log
  * file.
- * 
- * 
- * 
- * 
+ *
+ * group commit: a committer waits for its commit lsn, not for a flush of its
+ * own. 1 of the waiters (leader) writes everything appended so far, waiters
+ * whose lsn <= persistent_lsn_ are released together, the rest make the
+ * next group. the leader may wait up to commit_delay_ for commit_batch_
+ * committers to pile up first
+ *
+ * appends don't take lock_WAL_: 1 CAS on reserved_ hands out the lsn n the
+ * buffer slot, threads serialize into their slots in parallel
+ *
+ * log buffers == ring. sealing the buffer being filled moves reservations
+ * to the next 1 in the ring, the sealed 1 waits in sealed_ to be written, by
+ * pointer, in ring order. appenders only stall when every other buffer is
+ * sealed or in flight. a sealed buffer is written once every slot in it is
+ * filled (filled_ == bytes reserved)
+ *
+ * lsns aren't in the log: a record's offset in the log file (e.g. where
+ * recovery starts reading) comes from its append, buffer_offsets_ + slot.
+ * reopening a log counts them on from the last checkpoint (ResumeLog)
  */
 
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <condition_variable>
-#include <future>
+#include <deque>
 #include <mutex>
+#include <thread>
 
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
@@ -22,77 +41,151 @@ namespace cmudb {
 
 class LogManager {
 public:
-  LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN),
+  // log_buffer_capacity == must hold a record of 1 full page tuple, i.e.
+  // scales w the database's page size. per buffer, log_buffer_count of them
+  LogManager(DiskManager *disk_manager,
+             size_t log_buffer_capacity = LOG_BUFFER_SIZE,
+             size_t log_buffer_count = LOG_BUFFER_COUNT)
+      : log_buffer_capacity_(log_buffer_capacity),
+        log_buffer_count_(log_buffer_count), reserved_(0),
+        persistent_lsn_(INVALID_LSN), flush_thread_(nullptr),
         disk_manager_(disk_manager) {
-    // TODO: you may intialize your own defined memeber variables here
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    assert(log_buffer_capacity_ <= RESERVED_OFFSET_MASK);
+    assert(log_buffer_count_ >= 2 && log_buffer_count_ <= MAX_LOG_BUFFERS);
+    log_buffers_ = new char *[log_buffer_count_];
+    filled_ = new std::atomic<int>[log_buffer_count_];
+    buffer_offsets_ = new int64_t[log_buffer_count_];
+    for (size_t i = 0; i < log_buffer_count_; ++i) {
+      log_buffers_[i] = new char[log_buffer_capacity_];
+      filled_[i] = 0;
+    }
+    ResumeLog();
   }
 
   ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    if (flush_thread_ != nullptr) {
+      StopFlushThread();
+    }
+    for (size_t i = 0; i < log_buffer_count_; ++i) {
+      delete[] log_buffers_[i];
+    }
+    delete[] log_buffers_;
+    delete[] filled_;
+    delete[] buffer_offsets_;
+    log_buffers_ = nullptr;
   }
 
 
   /* major funcs */
-  // spawn a separate thread to wake up periodically to flush
-  lsn_t AppendLogRecord(LogRecord &log_record);
+  // serialize into the log buffer, sets n @return the record's lsn. no lock
+  // unless the buffer is full: then seals it n goes on in the next 1, or
+  // flushes (or waits for the flush in progress) if the ring is full.
+  // offset != nullptr == set to the record's offset in the log file
+  lsn_t AppendLogRecord(LogRecord &log_record, int64_t *offset = nullptr);
+  // spawn a separate thread to wake up periodically to flush, ENABLE_LOGGING
+  // on
   void RunFlushThread();
+  // flush what's left, join the flush thread, ENABLE_LOGGING off
+  void StopFlushThread();
+  // group commit: block until lsn is durable, leading a flush if none is in
+  // progress
+  void WaitForFlush(lsn_t lsn);
+  // everything appended so far durable, e.g. before a dirty page goes out
   void ForceFlushWAL();
-  void log_buffer_to_flush_buffer();
 
-  void StopFlushThread();
-  
-  
+  // leader waits up to commit_delay for commit_batch committers (itself
+  // included) before it flushes. 0 delay == flush at once
+  void SetGroupCommit(std::chrono::microseconds commit_delay,
+                      size_t commit_batch);
+
+
   /* getter, setter, helper */
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
-  inline void SetPromise(std::promise<void> *promise) { promise_finished_flush_WAL_ = promise; }
-  
+  inline lsn_t GetNextLSN() { return ReservedLSN(reserved_); }
+  // where the next record goes in the log file, exact w no append running
+  inline int64_t GetNextOffset() {
+    uint64_t reserved = reserved_.load(std::memory_order_acquire);
+    return buffer_offsets_[ReservedBuffer(reserved)] +
+           ReservedOffset(reserved);
+  }
+  inline size_t GetLogBufferCapacity() const { return log_buffer_capacity_; }
+  inline char *GetLogBuffer() {
+    return log_buffers_[ReservedBuffer(reserved_)];
+  }
+
 
-/**
- * @brief 
- * 
- * 5 LSNs are all here ??
- * - LSN, flushLSN == here
- * - 
- * 
- * 4 tables
- * TT == txn mananger 
- * ATT == log recovery 
- */
 private:
+  // existing log: lsns n appends go on after its last complete record, a
+  // torn 1 behind it (crash mid write) cut off. counted from the master
+  // record's checkpoint on, the same records recovery reads
+  void ResumeLog();
+  // caller holds lock_WAL_ n has set flushing_. writes sealed buffers (n
+  // the 1 being filled) w the lock released till everything appended
+  // before the call is on disk, persistent_lsn_ n waiters woken per buffer
+  void Flush(std::unique_lock<std::mutex> &lock);
+  // caller holds lock_WAL_. move appends on to the next buffer, queue the
+  // current 1 for writing, no IO. false == current 1 empty, or the next 1
+  // still sealed / in flight (ring full)
+  bool SealBuffer();
+
+  // reserved_ == lsn << 32 | buffer being filled << 24 | bytes reserved
+  static const uint64_t RESERVED_OFFSET_MASK = (1ULL << 24) - 1;
+  static const size_t MAX_LOG_BUFFERS = 256;
+  static lsn_t ReservedLSN(uint64_t reserved) {
+    return static_cast<lsn_t>(reserved >> 32);
+  }
+  static int ReservedBuffer(uint64_t reserved) {
+    return (reserved >> 24) & (MAX_LOG_BUFFERS - 1);
+  }
+  static int ReservedOffset(uint64_t reserved) {
+    return static_cast<int>(reserved & RESERVED_OFFSET_MASK);
+  }
+
+  // a buffer waiting to be written, oldest first
+  struct SealedBuffer {
+    int buffer_;
+    int size_; // bytes reserved in it
+    lsn_t lsn_; // its last record
+  };
 
   /* WAL */
-  // LSN, prevLSN, pageID, payload 
-  char *log_buffer_; // WAL in RAM  
-  int log_buffer_size_;
-  std::atomic<lsn_t> next_lsn_; // LSN
-  
+  // LSN, prevLSN, pageID, payload
+  size_t log_buffer_capacity_; // bytes of each log buffer
+  size_t log_buffer_count_;
+  char **log_buffers_; // WAL in RAM, ring filled n flushed in turn
+  // next lsn n the slot of the next record, 1 CAS per append
+  std::atomic<uint64_t> reserved_;
+  std::atomic<int> *filled_; // bytes serialized into each buffer so far
+  // log file offset of each buffer's 1st byte, set when the buffer before
+  // it in the ring is sealed
+  int64_t *buffer_offsets_;
+
 
 
   /* flush */
   // log records before & include persistent_lsn_ have been written to disk
   std::atomic<lsn_t> persistent_lsn_; // flushLSN == WAL LSN in disk
-  char *flush_buffer_; // buffer since IO is slow, while holds lock
-  int flush_buffer_size_;
+  // sealed n in flight buffers, in ring order before the 1 being filled
+  std::deque<SealedBuffer> sealed_;
   std::thread *flush_thread_;
-  bool new_log_entries_;
+  bool stop_flush_thread_ = false;
   DiskManager *disk_manager_; // w() log
 
 
+  /* group commit */
+  bool flushing_ = false;      // 1 leader / flush thread at a time
+  size_t pending_commits_ = 0; // waiters whose lsn isn't durable yet
+  std::chrono::microseconds commit_delay_{GROUP_COMMIT_DELAY_US};
+  size_t commit_batch_ = GROUP_COMMIT_BATCH;
+
+
   /* syncronization */
   // 1+ txns will call 6 funcs, pages can flush/fetch anytime
-  std::mutex lock_WAL_; // protect all vars  
-  std::condition_variable cv_flush_WAL_; // only 1 bg flush thread 
-  std::promise<void> *promise_finished_flush_WAL_; // like cv
-  
-  
+  std::mutex lock_WAL_; // protect all vars
+  std::condition_variable cv_flush_WAL_; // wakes the bg flush thread
+  std::condition_variable cv_flushed_;   // a flush finished
+  std::condition_variable cv_commit_;    // a leader's batch filled up
 
 };
 
@@ -3,39 +3,60 @@
  * 
  * log record struct does not follow bytes layout below !!!
  * 
+ * v == varint (7 bits per byte, low first, high bit == more), so small
+ * numbers take 1 byte. lsn is not stored: a record's lsn == previous
+ * record's + 1, the reader counts
  * 
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in totoal)
+ * For EACH log record, HEADER is like (4 fields in common, 4 bytes typical)
  *-------------------------------------------------------------
- * | size | LSN | transID | prevLSN | LogType |
+ * | size(v) | LogType(1 byte) | transID + 1(v) | LSN - prevLSN(v) |
  *-------------------------------------------------------------
+ * size == bytes after the size field, LSN - prevLSN == 0 if no prevLSN
+ * 
+ * 
+ * rid == | page_id + 1(v) | slot_num + 1(v) |
+ * tuple == | tuple_size(v) | tuple_data(char[] array) |
  * 
  * 
  * For insert type log record
  *-------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
+ * | HEADER | rid | tuple |
  *-------------------------------------------------------------
  * 
  * 
  * For delete type(including markdelete, rollbackdelete, applydelete)
  *-------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
+ * | HEADER | rid | tuple |
  *-------------------------------------------------------------
  * 
  * 
- * For update type log record
+ * For update type log record, new tuple == diff against the old 1 (old
+ * bytes up to new_tuple_size, then each range overwritten). gap == bytes
+ * since the end of the previous range
  *------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size |
- * | new_tuple_data |
+ * | HEADER | rid | old tuple | new_tuple_size(v) | num_ranges(v) |
+ * | gap(v) | length(v) | new bytes | gap(v) | ...
  *------------------------------------------------------------------------------
  * 
  * 
- * For new page type log record
+ * For new page type log record, page inited n linked after prev page
  *-------------------------------------------------------------
- * | HEADER | prev_page_id |
+ * | HEADER | page_id + 1(v) | prev_page_id + 1(v) |
  *-------------------------------------------------------------
+ * 
+ * 
+ * For checkpoint type log record, BEGIN_CHECKPOINT == HEADER only. END's
+ * tables are a snapshot taken after BEGIN (ATT == txn's last lsn, DPT ==
+ * page's recLSN), tables too big for 1 log buffer go on in more END records
+ *------------------------------------------------------------------------------
+ * | HEADER | num_txns(v) | txn_id + 1(v) | last_lsn + 1(v) | ...
+ * | num_pages(v) | page_id + 1(v) | rec_lsn + 1(v) | ...
+ *------------------------------------------------------------------------------
  */
 #pragma once
 #include <cassert>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "table/tuple.h"
@@ -54,6 +75,9 @@ enum class LogRecordType {
   ABORT,
   // when create a new page in heap table
   NEWPAGE,
+  // fuzzy checkpoint, see CheckpointManager
+  BEGIN_CHECKPOINT,
+  END_CHECKPOINT,
 };
 
 class LogRecord {
@@ -71,7 +95,7 @@ class LogRecord {
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
-/* 5 types of constructors 
+/* 6 types of constructors 
 
 
 all others == fill in when init log 
@@ -88,10 +112,13 @@ public:
 
   
 
-  // constructor for Transaction type(BEGIN/COMMIT/ABORT)
+  // constructor for Transaction type(BEGIN/COMMIT/ABORT), n for
+  // BEGIN_CHECKPOINT w/o txn
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
-        prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type) {
+    ComputeBodySize();
+  }
 
   
 
@@ -113,7 +140,7 @@ public:
       delete_tuple_ = tuple;
     }
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    ComputeBodySize();
   }
 
 
@@ -125,21 +152,33 @@ public:
       : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
         log_record_type_(log_record_type), update_rid_(update_rid),
         old_tuple_(old_tuple), new_tuple_(new_tuple) {
-    // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() +
-            new_tuple.GetLength() + 2 * sizeof(int32_t);
+    // calculate log record size, n the diff
+    ComputeBodySize();
   }
 
 
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
-            page_id_t prev_page_id)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
-        prev_lsn_(prev_lsn), log_record_type_(log_record_type),
+            page_id_t page_id, page_id_t prev_page_id)
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), page_id_(page_id),
         prev_page_id_(prev_page_id) {
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(page_id_t);
+    ComputeBodySize();
+  }
+
+  // constructor for END_CHECKPOINT type, <txn_id, last lsn> n <page_id,
+  // recLSN>
+  LogRecord(LogRecordType log_record_type,
+            const std::vector<std::pair<txn_id_t, lsn_t>> &active_txns,
+            const std::vector<std::pair<page_id_t, lsn_t>> &dirty_pages)
+      : lsn_(INVALID_LSN), txn_id_(INVALID_TXN_ID), prev_lsn_(INVALID_LSN),
+        log_record_type_(log_record_type), active_txns_(active_txns),
+        dirty_pages_(dirty_pages) {
+    assert(log_record_type == LogRecordType::END_CHECKPOINT);
+    // calculate log record size
+    ComputeBodySize();
   }
 
   ~LogRecord() {}
@@ -155,14 +194,44 @@ public:
 
   inline RID &GetDeleteRID() { return delete_rid_; }
 
+  inline Tuple &GetDeleteTuple() { return delete_tuple_; }
+
   inline Tuple &GetInserteTuple() { return insert_tuple_; }
 
   inline RID &GetInsertRID() { return insert_rid_; }
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  // bytes in the log, set once appended / deserialized
   inline int32_t GetSize() { return size_; }
 
+  inline RID &GetUpdateRID() { return update_rid_; }
+
+  inline Tuple &GetOldTuple() { return old_tuple_; }
+
+  inline Tuple &GetNewTuple() { return new_tuple_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() {
+    return active_txns_;
+  }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() {
+    return dirty_pages_;
+  }
+
+  // worst case bytes 1 END_CHECKPOINT entry takes
+  static const int32_t MAX_CHECKPOINT_ENTRY_SIZE = 10;
+
+  /* main funcs */
+  // bytes it takes in the log once given lsn (prevLSN stored as a delta)
+  int32_t GetSerializedSize(lsn_t lsn) const;
+  // as the record at lsn, GetSerializedSize(lsn) bytes
+  void SerializeTo(char *storage, lsn_t lsn) const;
+  // lsn == previous record's + 1, not in the log. @return false == size
+  // bytes hold no complete record (end of log / torn tail), size_ n lsn_ set
+  // otherwise
+  bool DeserializeFrom(const char *data, int32_t size, lsn_t lsn);
+
   inline lsn_t GetLSN() { return lsn_; }
 
   inline txn_id_t GetTxnId() { return txn_id_; }
@@ -172,6 +241,8 @@ public:
   inline LogRecordType &GetLogRecordType() { return log_record_type_; }
 
   inline page_id_t GetPrevPageId() { return prev_page_id_; }
+
+  inline page_id_t GetNewPageId() { return page_id_; }
   
 
 
@@ -194,9 +265,13 @@ public:
 
 // 1 row of WAL table 
 private:
+  // body_size_ from the fields, update_diff_ too for UPDATE
+  void ComputeBodySize();
+
   // the length of log record(for serialization, in bytes)
   int32_t size_ = 0;
-  const static int HEADER_SIZE = 20;
+  // bytes after the size field, w/o the LSN - prevLSN varint
+  int32_t body_size_ = 0;
 
   // must have fields
   lsn_t lsn_ = INVALID_LSN;
@@ -216,9 +291,16 @@ private:
   RID update_rid_;
   Tuple old_tuple_;
   Tuple new_tuple_;
+  // byte ranges of new_tuple_ that differ from old_tuple_, <offset, length>
+  std::vector<std::pair<int32_t, int32_t>> update_diff_;
 
   // case4: for new page opeartion
+  page_id_t page_id_ = INVALID_PAGE_ID;
   page_id_t prev_page_id_ = INVALID_PAGE_ID;
+
+  // case5: for end checkpoint, ATT n DPT
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
   
 }; // namespace cmudb
 
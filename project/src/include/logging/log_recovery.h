@@ -1,7 +1,14 @@
 /**
  * log_recovery.h
  * 
- * Read log file from disk, redo and undo
+ * Read log file from disk, analysis, redo and undo
+ * 
+ * analysis starts at the last checkpoint (master record in the header
+ * page), redo at its redo point, not at the top of the log
+ *
+ * runs before the flush thread (ENABLE_LOGGING off): table pages changed w
+ * no txn, lock or log. undo logs its inverse changes n an ABORT per loser
+ * itself, like TransactionManager::Abort, on the reopened log
  */
 
 #pragma once
@@ -10,19 +17,25 @@
 #include <unordered_map>
 
 #include "buffer/buffer_pool_manager.h"
-#include "concurrency/lock_manager.h"
+#include "logging/log_manager.h"
 #include "logging/log_record.h"
+#include "page/table_page.h"
 
 namespace cmudb {
 
 class LogRecovery {
 public:
+  // log_manager == on the same log, nothing appended yet (lsns resumed at
+  // its end). its buffer capacity == a record never spans 2 reads
   LogRecovery(DiskManager *disk_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager,
+                    LogManager *log_manager)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
+        log_manager_(log_manager),
+        log_buffer_capacity_(log_manager->GetLogBufferCapacity()),
+        redo_lsn_(0), redo_offset_(0) {
     // global transaction through recovery phase
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[log_buffer_capacity_];
   }
 
   ~LogRecovery() {
@@ -30,9 +43,18 @@ public:
     log_buffer_ = nullptr;
   }
 
+  // ATT n DPT from the last checkpoint on, Redo() runs it 1st
+  void Analysis();
   void Redo();
+  // losers rolled back n ended, pages flushed
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord &log_record);
+  // lsn == the record's, counted from the start of the log (not stored)
+  bool DeserializeLogRecord(const char *data, int size, lsn_t lsn,
+                            LogRecord &log_record);
+
+  // where redo started reading, from the master record
+  inline lsn_t GetRedoLSN() { return redo_lsn_; }
+  inline int64_t GetRedoOffset() { return redo_offset_; }
 
 private:
   // TODO: you can add whatever member variable here
@@ -43,7 +65,6 @@ private:
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   LogManager *log_manager_;
-  LockManager *lock_manager_;
 
 
  
@@ -51,20 +72,36 @@ private:
   // during log recovery == WAL's txn n LSN -> ATT + latest lsn 
   // i.e. built during analysis, used for undo as the start pt to undo
   std::unordered_map<txn_id_t, lsn_t> active_txn_; // ATT <txn_id, txn's latest_lsn>
+  // DPT <page_id, recLSN>, records before a page's recLSN are on disk
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table_;
 
   
   
   /* for read log from disk */    
   
-  // LOG_BUFFER_SIZE = (BUFFER_POOL_SIZE + 1) * PAGE_SIZE
+  // log_buffer_capacity_ = (BUFFER_POOL_SIZE + 1) * page size
   // BUFFER_POOL_SIZE = 10
-  // PAGE_SIZE = 512 bytes
+  // page size = 512 bytes by default
+  size_t log_buffer_capacity_;
   char *log_buffer_; // 11 * 512 bytes rows of WAL
-  int offset_;
   
   // map of LSN <-> log file offset 
   // == only need to parse log buffer once into WAL
-  std::unordered_map<lsn_t, int> lsn_offset_map_;
+  std::unordered_map<lsn_t, int64_t> lsn_offset_map_;
+
+  // from the master record, where redo starts reading
+  lsn_t redo_lsn_;
+  int64_t redo_offset_;
+
+  // record changes a page in place == DPT applies
+  static page_id_t GetPageId(LogRecord &log_record);
+  // page(s) of log_record brought up to its lsn, unless there already
+  void RedoLogRecord(LogRecord &log_record);
+  // log_record's tuple change done again on page, no lock / log
+  static void ApplyChange(TablePage *page, LogRecord &log_record);
+  // inverse of log_record logged (chained after prev_lsn) n applied,
+  // @return its lsn
+  lsn_t UndoLogRecord(LogRecord &log_record, lsn_t prev_lsn);
 };
 
 } // namespace cmudb
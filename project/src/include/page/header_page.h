@@ -6,9 +6,34 @@
  * 32 bytes) and their corresponding root_id
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ------------------------------------------------------------------------------------
+ * | RecordCount (4) | PageSize (4) | PoolSize (4) | MasterRecord (24) | Magic (4) | Version (4) |
+ *  ------------------------------------------------------------------------------------
+ *  ----------------------------------------------------
+ * | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  ----------------------------------------------------
+ * PageSize / PoolSize == per database parameters, PageSize is read by disk
+ * manager straight from the file (HEADER_PAGE_SIZE_OFFSET) on open
+ *
+ * MasterRecord (HEADER_MASTER_RECORD_OFFSET) == last complete checkpoint:
+ *  ---------------------------------------------------------------------
+ * | CheckpointLSN (4) | CheckpointOffset (8) | RedoLSN (4) | RedoOffset (8) |
+ *  ---------------------------------------------------------------------
+ * offsets in the log file, lsns aren't stored in the log. checkpoint ==
+ * its BEGIN_CHECKPOINT record, analysis starts there. redo == where redo
+ * starts, <= every dirty page's recLSN n active txn's BEGIN. all 0 == no
+ * checkpoint, both from the start of the log
+ *
+ * Magic n Version (HEADER_FORMAT_OFFSET) == HEADER_MAGIC n
+ * HEADER_FORMAT_VERSION, anything else (older layout, not a db file) is
+ * refused on open. all of the above 0 == header page not written yet
+ *
+ * Tablespaces (where objects are placed, see DiskManager) grow from the end
+ * of the page down:
+ *  ---------------------------------------------------------------------
+ * | ... | Tablespace_1 id (4) | path (124) | TablespaceCount (4) | Checksum (4) |
+ *  ---------------------------------------------------------------------
+ * an object's tablespace is the one its root_id is in
  */
 
 #pragma once
@@ -21,7 +46,15 @@ namespace cmudb {
 
 class HeaderPage : public Page {
 public:
-  void Init() { SetRecordCount(0); }
+  // page size == this frame's, i.e. the one disk manager was opened with
+  void Init(size_t pool_size = BUFFER_POOL_SIZE) {
+    SetRecordCount(0);
+    SetTablespaceCount(0);
+    SetPageSize(Page::GetPageSize());
+    SetPoolSize(pool_size);
+    SetMasterRecord(0, 0, 0, 0);
+    SetFormat();
+  }
   /**
    * Record related
    */
@@ -33,9 +66,42 @@ public:
   bool GetRootId(const std::string &name, page_id_t &root_id);
   int GetRecordCount();
 
+  /**
+   * Tablespace related, path < 124 bytes
+   */
+  bool InsertTablespace(int tablespace_id, const std::string &path);
+  // return tablespace_id if success
+  bool GetTablespaceId(const std::string &path, int &tablespace_id);
+  // index in [0, GetTablespaceCount())
+  void GetTablespace(int index, int &tablespace_id, std::string &path);
+  int GetTablespaceCount();
+
+  /**
+   * Database parameters
+   */
+  size_t GetPageSize();
+  size_t GetPoolSize();
+  void SetPoolSize(size_t pool_size);
+
+  // this build's magic n version
+  bool IsSupportedFormat();
+
+  /**
+   * Master record, written by CheckpointManager, read by LogRecovery
+   */
+  void GetMasterRecord(lsn_t &checkpoint_lsn, int64_t &checkpoint_offset,
+                       lsn_t &redo_lsn, int64_t &redo_offset);
+  void SetMasterRecord(lsn_t checkpoint_lsn, int64_t checkpoint_offset,
+                       lsn_t redo_lsn, int64_t redo_offset);
+
 private:
   int FindRecord(const std::string &name);
   void SetRecordCount(int record_count);
+  // offset of tablespace index, count's offset for index -1
+  int TablespaceOffset(int index);
+  void SetTablespaceCount(int tablespace_count);
+  void SetPageSize(size_t page_size);
+  void SetFormat();
   
 };
 } // namespace cmudb
@@ -19,24 +19,32 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
 #include "common/config.h"
-#include "common/rwmutex.h"
+#include "common/hybrid_latch.h"
 
 namespace cmudb {
 
+class BufferAccessStrategy;
+
 class Page {
   friend class BufferPoolManager;
+  friend class MmapBufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
   // get page id
-  inline page_id_t GetPageId() { return page_id_; }
+  inline page_id_t GetPageId() {
+    return page_id_.load(std::memory_order_acquire);
+  }
+  // runtime page size of the database this frame belongs to
+  inline size_t GetPageSize() { return page_size_; }
   // get page pin count
   inline int GetPinCount() { return pin_count_; }
   // method use to latch/unlatch page content
@@ -44,6 +52,13 @@ public:
   inline void WLatch() { rwlatch_.WLock(); }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
+  // optimistic read: no shared state written. data read in between may be
+  // torn, only act on it after ValidateLatch(). frame may hold another page
+  // by then == check GetPageId() before validating
+  inline uint64_t OptimisticLatch() { return rwlatch_.OptimisticLock(); }
+  inline bool ValidateLatch(uint64_t version) {
+    return rwlatch_.Validate(version);
+  }
 
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
   
@@ -55,16 +70,32 @@ public:
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, 0, page_size_); }
 
 
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
-  RWMutex rwlatch_;
+  // changes only while rwlatch_ is held exclusively == optimistic readers
+  // see the frame switch pages. INVALID_PAGE_ID once evicted, stored before
+  // pin_count_ leaves 0 (release) == lock free pins see the frame's page
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  // 0 -> 1 only under bpm latch, n -> n + 1 also lock free (page table hit)
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false}; // set by lock free unpin too
+  // DPT: lsn before the oldest change not on disk yet, set before is_dirty_
+  // n reset before it is cleared. INVALID_LSN == clean
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
+  // next lsn at the last 0 -> 1 pin, <= anything logged while pinned since
+  std::atomic<lsn_t> pin_lsn_{INVALID_LSN};
+  BufferAccessStrategy *strategy_ = nullptr; // ring owning this frame, if any
+  bool cleaning_ = false;          // page cleaner writing it back right now
+  lsn_t cleaning_rec_lsn_ = INVALID_LSN; // rec_lsn_ of that write, till done
+  bool evict_after_clean_ = false; // picked as victim while cleaning
+  // read-ahead / miss still reading it from disk, stored like page_id_
+  std::atomic<bool> loading_{false};
+  HybridLatch rwlatch_;
   
   
-  char data_[PAGE_SIZE]; // page size of bytes
+  size_t page_size_ = 0;
+  char *data_ = nullptr; // page_size_ bytes, in buffer pool manager's arena
 };
 
 } // namespace cmudb
@@ -65,6 +65,9 @@ public:
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
                 LockManager *lock_manager);
 
+  // recovery: into rid's slot (empty / next new 1), no lock n no log
+  bool InsertTupleAt(const Tuple &tuple, const RID &rid);
+
   /**
    * Tuple iterator
    */
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <cassert>
+#include <deque>
 
 #include "common/rid.h"
 #include "table/tuple.h"
@@ -14,12 +15,16 @@
 namespace cmudb {
 
 class TableHeap;
+class TablePage;
+class BufferAccessStrategy;
 
 class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  // strategy == pages fetched through the scan's ring, owned by the caller
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                BufferAccessStrategy *strategy = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -40,9 +45,18 @@ public:
   TableIterator operator++(int);
 
 private:
+  // read-ahead, see table_iterator.cpp
+  TablePage *FetchNextPage(page_id_t page_id);
+  void ReadAhead(TablePage *page);
+  size_t MaxReadAheadWindow();
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  BufferAccessStrategy *strategy_;
+  // pages of the chain past the current one, prefetch issued, in order
+  std::deque<page_id_t> readahead_;
+  size_t readahead_window_ = 1;
 };
 
 } // namespace cmudb
\ No newline at end of file
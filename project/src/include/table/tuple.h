@@ -36,6 +36,8 @@ public:
 
   // construct w char* / string
   void DeserializeFrom(const char *storage);
+  // construct w size bytes of raw data, no size prefix
+  void DeserializeFrom(const char *data, int32_t size);
 
   // copy constructor, deep copy
   Tuple(const Tuple &other);
@@ -4,11 +4,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "buffer/lru_replacer.h"
+#include "buffer/mmap_buffer_pool_manager.h"
+#include "buffer/parallel_buffer_pool_manager.h"
 #include "catalog/schema.h"
+#include "common/exception.h"
+#include "common/logger.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/log_manager.h"
+#include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
 #include "table/tuple.h"
@@ -26,7 +38,8 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv);
 
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id = INVALID_PAGE_ID);
+                      page_id_t root_id = INVALID_PAGE_ID,
+                      int tablespace_id = 0);
 Transaction *GetTransaction();
 
 /* API declaration */
@@ -71,38 +84,174 @@ int VtabBegin(sqlite3_vtab *pVTab);
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // page_size == new database only, an existing one keeps its own
+  // pool_size == 0: whatever the header page says
+  // read_only == existing database served from a read-only mapping of the
+  // file (replicas), no buffer pool copies, nothing ever written back. files
+  // opened O_RDONLY, no log: no log manager, flush thread, checkpoints
+  // existing log == recovered before the constructor returns. header page
+  // of another format / not a db file == Exception, log untouched
+  // log_file_name == "" : next to the db file, else e.g. on its own volume
+  // compress == new database / tablespace files store pages compressed
+  StorageEngine(std::string db_file_name, size_t page_size = PAGE_SIZE,
+                size_t pool_size = 0, bool read_only = false,
+                std::string log_file_name = "", bool compress = false)
+      : db_file_name_(db_file_name), log_file_name_(log_file_name),
+        read_only_(read_only), compress_(compress) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, page_size, false,
+                                    log_file_name, compress, read_only);
+    page_size_ = disk_manager_->GetPageSize();
+    // refused before anything reads n resumes (truncates) the log
+    if (!IsSupportedFormat()) {
+      delete disk_manager_;
+      throw Exception(db_file_name + ": not a database file of format " +
+                      std::to_string(HEADER_FORMAT_VERSION));
+    }
+    pool_size_ = pool_size != 0 ? pool_size : GetStoredPoolSize();
 
-    // log related
-    log_manager_ = new LogManager(disk_manager_);
+    // log related, 1 record holds up to a page worth of tuple. opening a
+    // log resumes (may truncate) it == never on a read-only database
+    if (!read_only_) {
+      log_manager_ =
+          new LogManager(disk_manager_, (BUFFER_POOL_SIZE + 1) * page_size_);
+    }
 
-    buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    // compressed pages can't be mapped, decompressed into frames instead
+    if (read_only_ && !disk_manager_->IsCompressed()) {
+      {
+        // maps the db file only, enough to read the tablespaces off the
+        // header page. the real pool maps them all
+        MmapBufferPoolManager header_pool(disk_manager_);
+        OpenTablespaces(&header_pool);
+      }
+      buffer_pool_manager_ = new MmapBufferPoolManager(disk_manager_);
+    } else {
+      // a b+tree op pins a few pages of 1 shard: tiny shards would run dry
+      size_t num_instances = std::max<size_t>(
+          1, std::min<size_t>(BUFFER_POOL_INSTANCES,
+                              pool_size_ / BUFFER_POOL_MIN_INSTANCE_SIZE));
+      buffer_pool_manager_ = new ParallelBufferPoolManager(
+          num_instances, pool_size_, disk_manager_, log_manager_);
+      OpenTablespaces(buffer_pool_manager_);
+      // crash leftovers redone / undone before anything else writes a page
+      if (!read_only_) {
+        Recover();
+      }
+      // dirty pages written ahead of eviction, misses find clean victims
+      if (!read_only_) {
+        buffer_pool_manager_->RunPageCleaner();
+      }
+      // cold pages checked in the background, cached ones get rewritten
+      BufferPoolManager *bpm = buffer_pool_manager_;
+      disk_manager_->StartScrubber(SCRUB_PAGES_PER_SECOND,
+                                   [bpm](page_id_t page_id) {
+                                     return bpm->PeekPage(page_id) != nullptr;
+                                   });
+    }
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+
+    // read-only == nothing logged, nothing to checkpoint
+    if (!read_only_) {
+      checkpoint_manager_ = new CheckpointManager(
+          transaction_manager_, log_manager_, buffer_pool_manager_);
+    }
   }
 
   ~StorageEngine() {
-    if (ENABLE_LOGGING)
+    // checkpoint thread stopped before the managers it uses go
+    delete checkpoint_manager_;
+    // scrubber asks the pool, cleaner writes through disk manager, stop
+    // them before anything goes, then dirty pages out in 1 sorted batch
+    disk_manager_->StopScrubber();
+    buffer_pool_manager_->StopPageCleaner();
+    if (!read_only_)
+      buffer_pool_manager_->FlushAllPages();
+    if (log_manager_ != nullptr)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
+    // pool's in-flight I/O / mapping goes before the files do
     delete buffer_pool_manager_;
+    delete disk_manager_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
   }
 
+  std::string db_file_name_;
+  std::string log_file_name_;
+  bool read_only_;
+  bool compress_;
+  size_t page_size_; // per database, fixed once it has tables
+  size_t pool_size_; // frames, split across the buffer pool's shards
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
-  LogManager *log_manager_;
+  LogManager *log_manager_ = nullptr; // nullptr == read-only
+  CheckpointManager *checkpoint_manager_ = nullptr;
+
+private:
+  // header page read straight off disk, pool needs the size before it exists
+  size_t GetStoredPoolSize() {
+    std::vector<char> header(page_size_);
+    disk_manager_->ReadPage(HEADER_PAGE_ID, header.data()); // new db == zeros
+    int32_t pool_size;
+    memcpy(&pool_size, header.data() + HEADER_POOL_SIZE_OFFSET, 4);
+    return pool_size > 0 ? pool_size : BUFFER_POOL_SIZE;
+  }
+
+  // header page read straight off disk: this build's magic n version, or
+  // not written yet (new db). checksum mismatch == not a db file either
+  bool IsSupportedFormat() {
+    std::vector<char> header(page_size_);
+    if (!disk_manager_->ReadPage(HEADER_PAGE_ID, header.data()))
+      return false;
+    int32_t magic, version;
+    memcpy(&magic, header.data() + HEADER_FORMAT_OFFSET, 4);
+    memcpy(&version, header.data() + HEADER_FORMAT_OFFSET + 4, 4);
+    if (magic == HEADER_MAGIC && version == HEADER_FORMAT_VERSION)
+      return true;
+    return std::all_of(header.begin(), header.begin() + HEADER_FORMAT_OFFSET + 8,
+                       [](char c) { return c == 0; });
+  }
+
+  // every tablespace recorded in the header page, before any of their pages
+  // is read. new db == no header page yet
+  void OpenTablespaces(BufferPoolManager *buffer_pool_manager) {
+    if (!disk_manager_->IsAllocated(HEADER_PAGE_ID))
+      return;
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+    if (header_page == nullptr)
+      return;
+    int tablespace_id;
+    std::string path;
+    for (int i = 0; i < header_page->GetTablespaceCount(); i++) {
+      header_page->GetTablespace(i, tablespace_id, path);
+      if (!disk_manager_->OpenTablespace(tablespace_id, path)) {
+        LOG_DEBUG("can't open tablespace %d: %s", tablespace_id, path.c_str());
+      }
+    }
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+  }
+
+  // analysis, redo n undo from the master record's checkpoint on. runs w
+  // logging off, before the page cleaner, flush n checkpoint threads: undo
+  // forces its own records n flushes the pages it changed. empty log == new
+  // db, nothing to do
+  void Recover() {
+    if (log_manager_->GetNextOffset() == 0)
+      return;
+    LogRecovery log_recovery(disk_manager_, buffer_pool_manager_,
+                             log_manager_);
+    log_recovery.Redo();
+    log_recovery.Undo();
+  }
 };
 
 StorageEngine *storage_engine_;
@@ -123,9 +272,12 @@ class VirtualTable {
 
 
 public:
+  // tablespace_id == where a new table heap goes, an existing one stays in
+  // first_page_id's
   VirtualTable(Schema *schema, BufferPoolManager *buffer_pool_manager,
                LockManager *lock_manager, LogManager *log_manager, Index *index,
-               page_id_t first_page_id = INVALID_PAGE_ID)
+               page_id_t first_page_id = INVALID_PAGE_ID,
+               int tablespace_id = 0)
       : schema_(schema), index_(index) {
     if (first_page_id != INVALID_PAGE_ID) {
       // reopen an exist table
@@ -134,8 +286,8 @@ public:
     } else {
       // create table for the first time
       Transaction *txn = storage_engine_->transaction_manager_->Begin();
-      table_heap_ =
-          new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+      table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
+                                  log_manager, txn, tablespace_id);
       storage_engine_->transaction_manager_->Commit(txn);
     }
   }
@@ -191,7 +343,9 @@ public:
     return table_heap_->UpdateTuple(tuple, rid, GetTransaction());
   }
 
-  inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
+  inline TableIterator begin(BufferAccessStrategy *strategy = nullptr) {
+    return table_heap_->begin(GetTransaction(), strategy);
+  }
 
   inline TableIterator end() { return table_heap_->end(); }
 
@@ -224,14 +378,21 @@ private:
 
 class Cursor {
 public:
-  Cursor(VirtualTable *virtual_table)
-      : table_iterator_(virtual_table->begin()), virtual_table_(virtual_table) {
-  }
+  Cursor(VirtualTable *virtual_table) : virtual_table_(virtual_table) {}
+
+  ~Cursor() { delete table_iterator_; }
 
   inline void SetScanFlag(bool is_index_scan) {
     is_index_scan_ = is_index_scan;
   }
 
+  // full table scan from the 1st tuple, through the scan's ring. index
+  // scans n point lookups never start 1, they read through the shared pool
+  inline void BeginScan() {
+    delete table_iterator_;
+    table_iterator_ = new TableIterator(virtual_table_->begin(&scan_strategy_));
+  }
+
   inline bool IsIndexScan() { return is_index_scan_; }
 
   inline VirtualTable *GetVirtualTable() { return virtual_table_; }
@@ -244,7 +405,7 @@ public:
     if (is_index_scan_)
       return results[offset_].Get();
     else
-      return (*table_iterator_).GetRid().Get();
+      return (**table_iterator_).GetRid().Get();
   }
 
   // return tuple at which cursor is currently pointed
@@ -255,7 +416,7 @@ public:
       virtual_table_->table_heap_->GetTuple(rid, tuple, GetTransaction());
       return tuple.GetValue(schema, column);
     } else {
-      return table_iterator_->GetValue(schema, column);
+      return (*table_iterator_)->GetValue(schema, column);
     }
   }
 
@@ -264,7 +425,7 @@ public:
     if (is_index_scan_)
       ++offset_;
     else
-      ++table_iterator_;
+      ++(*table_iterator_);
     return *this;
   }
   // is end of cursor(no more tuple)
@@ -272,7 +433,7 @@ public:
     if (is_index_scan_)
       return offset_ == static_cast<int>(results.size());
     else
-      return table_iterator_ == virtual_table_->end();
+      return *table_iterator_ == virtual_table_->end();
   }
 
   // wrapper around poit scan methods
@@ -285,8 +446,10 @@ private:
   // for index scan
   std::vector<RID> results;
   int offset_ = 0;
-  // for sequential scan
-  TableIterator table_iterator_;
+  // for sequential scan, ring of private frames so a full scan does not
+  // flush the shared pool. declared before iterator == outlives it
+  BufferAccessStrategy scan_strategy_;
+  TableIterator *table_iterator_ = nullptr; // BeginScan()
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
   VirtualTable *virtual_table_;
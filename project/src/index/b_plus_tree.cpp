@@ -62,9 +62,13 @@ INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(const std::string &name,
                                 BufferPoolManager *buffer_pool_manager,
                                 const KeyComparator &comparator,
-                                page_id_t root_page_id)
+                                page_id_t root_page_id, int tablespace_id)
     : index_name_(name), root_page_id_(root_page_id),
-      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      extent_(OBJECT_EXTENT_PAGES,
+              root_page_id != INVALID_PAGE_ID
+                  ? DiskManager::GetTablespaceId(root_page_id)
+                  : tablespace_id) {}
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -89,15 +93,159 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                               std::vector<ValueType> &result,
                               Transaction *transaction) {
+  ValueType value;
+  bool found = false;
 
+  // 1. optimistic: readers write nothing shared, root stays in every core's
+  // cache instead of bouncing between them
+  if(!GetValueOptimistic(key, value, found)){
 
-  // 1. get "data page" of certain range of keys from disk
+    // 2. page not in RAM / too many writers: latch n pin like before
+    found = GetValuePessimistic(key, value);
+  }
+  if(found){
+    result.push_back(value);
+  }
+  return found;
+}
 
 
-  // 2. use key to search for value within that data page 
-      
-  
-  return false;
+/*
+ * optimistic lock coupling
+ * 
+ * - version of a node read before its content, validated after
+ * - child version taken BEFORE parent validated again == child id came from
+ *   a consistent parent n child unchanged since we got there
+ * - validation fails == somebody wrote, restart from root
+ * - frames are only peeked (no pin), page id re-checked before validating
+ *   == frame still holds the page we wanted
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValueOptimistic(const KeyType &key, ValueType &value,
+                                        bool &found) {
+  for(int restart = 0; restart < OLC_MAX_RESTARTS; restart++){
+
+    // 1. root, must still be root (not split / shrunk meanwhile)
+    page_id_t page_id = root_page_id_;
+    if(page_id == INVALID_PAGE_ID){
+      found = false;
+      return true;
+    }
+    Page *page = buffer_pool_manager_->PeekPage(page_id);
+    if(page == nullptr){
+      return false;
+    }
+    uint64_t version = page->OptimisticLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    bool is_root = node->IsRootPage();
+    if(page->GetPageId() != page_id || !page->ValidateLatch(version) ||
+       !is_root){
+      continue;
+    }
+
+    // 2. hop down
+    bool valid = true;
+    while(valid && IsSizeInBounds(node) && !node->IsLeafPage()){
+      auto *internal_node = reinterpret_cast<BPlusTreeInternalPage<
+          KeyType, page_id_t, KeyComparator> *>(node);
+      page_id_t child_id = internal_node->Lookup(key, comparator_);
+      if(!page->ValidateLatch(version)){
+        valid = false;
+        break;
+      }
+      Page *child = buffer_pool_manager_->PeekPage(child_id);
+      if(child == nullptr){
+        return false;
+      }
+      uint64_t child_version = child->OptimisticLatch();
+      page_id_t child_frame_id = child->GetPageId();
+      valid = page->ValidateLatch(version) && child_frame_id == child_id;
+
+      page = child;
+      version = child_version;
+      node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    }
+    if(!valid || !IsSizeInBounds(node)){
+      continue;
+    }
+
+    // 3. leaf, node type n content both validated here
+    auto *leaf_node = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node);
+    found = leaf_node->Lookup(key, value, comparator_);
+    if(page->ValidateLatch(version)){
+      return true;
+    }
+  }
+  return false; // kept conflicting w writers
+}
+
+
+/*
+ * read latch crabbing: child latched before parent released
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValuePessimistic(const KeyType &key,
+                                         ValueType &value) {
+  while(true){
+
+    // 1. root, latched before checking it is still root
+    page_id_t page_id = root_page_id_;
+    if(page_id == INVALID_PAGE_ID){
+      return false;
+    }
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if(page == nullptr){
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "all page are pinned while GetValue");
+    }
+    page->RLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if(!node->IsRootPage()){
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      continue;
+    }
+
+    // 2. hop down
+    while(!node->IsLeafPage()){
+      auto *internal_node = reinterpret_cast<BPlusTreeInternalPage<
+          KeyType, page_id_t, KeyComparator> *>(node);
+      page_id_t child_id = internal_node->Lookup(key, comparator_);
+      Page *child = buffer_pool_manager_->FetchPage(child_id);
+      if(child == nullptr){
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        throw Exception(EXCEPTION_TYPE_INDEX,
+                        "all page are pinned while GetValue");
+      }
+      child->RLatch();
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = child;
+      node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    }
+
+    // 3. leaf
+    auto *leaf_node = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node);
+    bool found = leaf_node->Lookup(key, value, comparator_);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return found;
+  }
+}
+
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSizeInBounds(BPlusTreePage *node) const {
+  size_t page_size = buffer_pool_manager_->GetPageSize() - PAGE_CHECKSUM_SIZE;
+  size_t slots =
+      node->IsLeafPage()
+          ? (page_size - sizeof(B_PLUS_TREE_LEAF_PAGE_TYPE)) /
+                sizeof(MappingType)
+          : (page_size - sizeof(BPlusTreeInternalPage<KeyType, page_id_t,
+                                                      KeyComparator>)) /
+                sizeof(std::pair<KeyType, page_id_t>);
+  return node->GetSize() >= 0 && static_cast<size_t>(node->GetSize()) <= slots;
 }
 
 /*
@@ -223,7 +371,8 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewBPlusTree(const KeyType &key, const ValueType &value) {
   
   // 1. init root page
-  auto *root_page = buffer_pool_manager_->NewPage(root_page_id_);
+  auto *root_page = buffer_pool_manager_->NewPage(root_page_id_,
+                                                  INVALID_PAGE_ID, &extent_);
   if (root_page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while StartNewTree");
@@ -329,14 +478,16 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_child_node,
 
     
     // 1. init new page for root
-    auto *root_page = buffer_pool_manager_->NewPage(ROOT_PAGE_ID);
+    auto *root_page = buffer_pool_manager_->NewPage(ROOT_PAGE_ID,
+                                                    INVALID_PAGE_ID, &extent_);
     LatchPage(root_page, txn, Operation::INSERT);    
     auto root_internal_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t,
                                             KeyComparator> *>(page->root_page());
     
     // 2. new root page register() old, new split leaf page as children
     // 1 to many (1 parent, many kv/children)
-    root_internal_page->Init();
+    root_internal_page->Init(ROOT_PAGE_ID, INVALID_PAGE_ID,
+                             buffer_pool_manager_->GetPageSize());
     root_internal_page->PopulateNewRoot(old_child_node, key, new_child_node);
 
     
@@ -402,10 +553,13 @@ template <typename N> N *BPLUSTREE_TYPE::Split(N *old_page) {
     
     // 3.2.1 init new page
     page_id_t new_page_id;
-    auto new_page = buffer_pool_manager_->NewPage(new_page_id);
+    // sibling from the tree's extent, near the page it splits off
+    auto new_page = buffer_pool_manager_->NewPage(
+        new_page_id, old_page->GetPageId(), &extent_);
     LatchPage(new_page, txn, Operation::INSERT);    
     N* new_btree_page = reinterpret_cast<N *>(new_page->GetData());
-    new_btree_page->Init(new_page_id, INVALID_PAGE_ID);
+    new_btree_page->Init(new_page_id, INVALID_PAGE_ID,
+                         buffer_pool_manager_->GetPageSize());
     
     
     // 3.2.2 tranfer half of old -> new page 
@@ -0,0 +1,193 @@
+/**
+ * checkpoint_manager.cpp
+ * - fuzzy checkpoints, steps at the top of checkpoint_manager.h
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+#include "common/metrics.h"
+#include "logging/checkpoint_manager.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+// process wide (see common/metrics.h)
+static MetricCounter *checkpoints =
+    MetricsRegistry::Instance().GetCounter("checkpoint.checkpoints");
+static MetricCounter *old_page_writes =
+    MetricsRegistry::Instance().GetCounter("checkpoint.old_page_writes");
+static MetricHistogram *checkpoint_latency =
+    MetricsRegistry::Instance().GetHistogram("checkpoint.us");
+
+CheckpointManager::CheckpointManager(TransactionManager *transaction_manager,
+                                     LogManager *log_manager,
+                                     BufferPoolManager *buffer_pool_manager)
+    : transaction_manager_(transaction_manager), log_manager_(log_manager),
+      buffer_pool_manager_(buffer_pool_manager) {
+  checkpoints_.push_back(
+      {log_manager_->GetNextLSN(), log_manager_->GetNextOffset()});
+}
+
+CheckpointManager::~CheckpointManager() { StopCheckpointThread(); }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * 0. pages dirty since before the previous checkpoint written out, usually
+ *    few: the page cleaner writes cold ones anyway, these are hot. pages
+ *    deleted before it released then: every unlink from them is written
+ * 1. BEGIN_CHECKPOINT, its offset == where analysis starts
+ * 2. snapshots after BEGIN: whatever they miss is logged after it
+ * 3. END_CHECKPOINT, as many as it takes to fit the log buffers
+ * 4. log forced, then the master record
+ *
+ * redo point never moves back: recLSNs n BEGINs show up after the snapshot
+ * they'd be older than
+ */
+lsn_t CheckpointManager::Checkpoint() {
+  if (!ENABLE_LOGGING) {
+    return INVALID_LSN;
+  }
+  std::lock_guard<std::mutex> guard(latch_);
+  MetricTimer timer(checkpoint_latency);
+
+  // 0. old pages. recLSN == previous lsn: pinned right before its BEGIN,
+  // may hold an unlink from before its free mark
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  if (previous_lsn_ != INVALID_LSN) {
+    buffer_pool_manager_->GetDirtyPageTable(dirty_page_table);
+    for (auto &entry : dirty_page_table) {
+      if (entry.second <= previous_lsn_ &&
+          buffer_pool_manager_->FlushRange(entry.first, entry.first) > 0) {
+        old_page_writes->Add();
+      }
+    }
+    dirty_page_table.clear();
+    buffer_pool_manager_->ReleaseFreedPages(free_mark_);
+  }
+
+  // 1. begin, pages deleted so far unlinked before it
+  free_mark_ = buffer_pool_manager_->GetFreeMark();
+  LogRecord begin(INVALID_TXN_ID, INVALID_LSN,
+                  LogRecordType::BEGIN_CHECKPOINT);
+  int64_t begin_offset;
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(begin, &begin_offset);
+  previous_lsn_ = begin_lsn;
+
+  // 2. ATT, DPT n the oldest lsn redo / undo may need
+  std::unordered_map<txn_id_t, lsn_t> active_txns;
+  lsn_t redo_lsn;
+  transaction_manager_->GetActiveTransactions(active_txns, redo_lsn);
+  buffer_pool_manager_->GetDirtyPageTable(dirty_page_table);
+  if (redo_lsn == INVALID_LSN || begin_lsn < redo_lsn) {
+    redo_lsn = begin_lsn;
+  }
+  for (auto &entry : dirty_page_table) {
+    redo_lsn = std::min(redo_lsn, entry.second);
+  }
+
+  // 3. end, header + 2 counts take < 32 bytes
+  std::vector<std::pair<txn_id_t, lsn_t>> txns(active_txns.begin(),
+                                               active_txns.end());
+  std::vector<std::pair<page_id_t, lsn_t>> pages(dirty_page_table.begin(),
+                                                 dirty_page_table.end());
+  size_t per_record = (log_manager_->GetLogBufferCapacity() - 32) /
+                      LogRecord::MAX_CHECKPOINT_ENTRY_SIZE;
+  assert(per_record > 0);
+  size_t next_txn = 0, next_page = 0;
+  do {
+    size_t num_txns = std::min(txns.size() - next_txn, per_record);
+    size_t num_pages =
+        std::min(pages.size() - next_page, per_record - num_txns);
+    LogRecord end(
+        LogRecordType::END_CHECKPOINT,
+        std::vector<std::pair<txn_id_t, lsn_t>>(
+            txns.begin() + next_txn, txns.begin() + next_txn + num_txns),
+        std::vector<std::pair<page_id_t, lsn_t>>(
+            pages.begin() + next_page, pages.begin() + next_page + num_pages));
+    log_manager_->AppendLogRecord(end);
+    next_txn += num_txns;
+    next_page += num_pages;
+  } while (next_txn < txns.size() || next_page < pages.size());
+
+  // 4. durable before the master record points at it. redo point == latest
+  // checkpoint at / before redo_lsn, older ones no longer needed
+  log_manager_->ForceFlushWAL();
+  checkpoints_.push_back({begin_lsn, begin_offset});
+  while (checkpoints_.size() > 1 && checkpoints_[1].lsn_ <= redo_lsn) {
+    checkpoints_.pop_front();
+  }
+  LogPosition redo = checkpoints_.front();
+
+  // page writers copy it under its read latch == never half a master record
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return INVALID_LSN;
+  }
+  header_page->WLatch();
+  header_page->SetMasterRecord(begin_lsn, begin_offset, redo.lsn_,
+                               redo.offset_);
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  buffer_pool_manager_->FlushRange(HEADER_PAGE_ID, HEADER_PAGE_ID);
+  checkpoints->Add();
+  return begin_lsn;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+void CheckpointManager::RunCheckpointThread(
+    std::chrono::milliseconds interval) {
+  if (checkpoint_thread_ != nullptr) {
+    return;
+  }
+  stop_checkpoint_thread_ = false;
+  checkpoint_thread_ = new std::thread([this, interval]() {
+    std::unique_lock<std::mutex> lock(thread_latch_);
+    while (!cv_stop_.wait_for(lock, interval,
+                              [this] { return stop_checkpoint_thread_; })) {
+      lock.unlock();
+      Checkpoint();
+      lock.lock();
+    }
+  });
+}
+
+// waits for a checkpoint in progress, no-op if not running
+void CheckpointManager::StopCheckpointThread() {
+  if (checkpoint_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(thread_latch_);
+    stop_checkpoint_thread_ = true;
+  }
+  cv_stop_.notify_one();
+  checkpoint_thread_->join();
+  delete checkpoint_thread_;
+  checkpoint_thread_ = nullptr;
+}
+
+} // namespace cmudb
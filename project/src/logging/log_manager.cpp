@@ -40,121 +40,210 @@
  * 
  */
 
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "common/metrics.h"
 #include "logging/log_manager.h"
 
 namespace cmudb {
 
+// process wide (see common/metrics.h)
+static MetricCounter *log_appends =
+    MetricsRegistry::Instance().GetCounter("wal.appends");
+static MetricCounter *log_flushes =
+    MetricsRegistry::Instance().GetCounter("wal.flushes");
+static MetricCounter *force_flushes =
+    MetricsRegistry::Instance().GetCounter("wal.force_flushes");
+static MetricCounter *commit_waits =
+    MetricsRegistry::Instance().GetCounter("wal.commit_waits");
+static MetricCounter *group_commits =
+    MetricsRegistry::Instance().GetCounter("wal.group_commits");
+static MetricCounter *buffer_full_waits =
+    MetricsRegistry::Instance().GetCounter("wal.buffer_full_waits");
+static MetricHistogram *flush_latency =
+    MetricsRegistry::Instance().GetHistogram("wal.flush_us");
+static MetricHistogram *force_flush_latency =
+    MetricsRegistry::Instance().GetHistogram("wal.force_flush_wait_us");
+static MetricHistogram *commit_wait_latency =
+    MetricsRegistry::Instance().GetHistogram("wal.commit_wait_us");
+
 
 
 /*
- * background thread to flush WAL in RAM to disk 
- * - u() 4 tables 
- * 
- * set ENABLE_LOGGING = true
- * 
- * The flush can be triggered when the log buffer is full or 
- * 
- * buffer pool manager wants to force flush (it only happens when the flushed page has a
- * larger LSN than persistent LSN) ?? FIFO ?? 
- * shouild i flush 
- * 
- * 
- * flush() WAL(log entries) first, before flush() Page
- * - flush() Page from RAM to Disk only when: flushedLSN >= pageLSN 
- * - flushedLSN == log’s latest LSN in disk 
- * 
- * 
- * even if txn commits 
- * - WAL might not be flushed before it crashes
- * - only flushes periodically
- * - 1 txn commit =/= 1 user's SQL statement
- * - 
- * 
- * 
- * log buffer == WAL 
- * 
- * d() WAL 
- * d() buffer pool 
- * d() DPT 
- * no u() TT 
+ * master record (header page, layout in header_page.h) read off disk: no
+ * buffer pool yet. none / unreadable == all 0, from the start of the log
+ *
+ * lsn of each record == previous + 1, the checkpoint's from the master
+ * record. scan stops at the 1st record that doesn't parse, like analysis
  */
-void LogManager::RunFlushThread() { // flush WAL
-
-  flush_thread_ = new std::thread([&](){
-    
-    while(true){
-      LOG_INFO("Flush thread starts");
-
-      std::unique_lock<std::mutex> unique_lock_WAL(lock_WAL_);
-          
-      // once flush thread gets lock, no txn can u() WAL until timeout/full WAL
-      cv_flush_WAL_.wait_for(unique_lock_WAL, LOG_TIMEOUT) 
-                == std::cv_status::timeout { // timeout + full WAL
-        if(new_log_entries_){        
-          
-          log_buffer_to_flush_buffer(); // non-blocking == no IO
-        }
-      }
+void LogManager::ResumeLog() {
+  int64_t log_size = disk_manager_->GetLogSize();
+  lsn_t lsn = 0;
+  int64_t offset = 0;
+  std::vector<char> header(disk_manager_->GetPageSize());
+  if (log_size > 0 &&
+      disk_manager_->ReadPage(HEADER_PAGE_ID, header.data())) {
+    int64_t checkpoint_offset;
+    memcpy(&lsn, header.data() + HEADER_MASTER_RECORD_OFFSET, 4);
+    memcpy(&checkpoint_offset, header.data() + HEADER_MASTER_RECORD_OFFSET + 4,
+           8);
+    // not a master record of this log
+    if (lsn < 0 || checkpoint_offset < 0 || checkpoint_offset > log_size) {
+      lsn = 0;
+      checkpoint_offset = 0;
+    }
+    offset = checkpoint_offset;
+  }
 
-      // can append log_buffer during flush_buffer I/O
-      unique_lock_WAL.unlock(); 
+  std::vector<char> log(log_buffer_capacity_);
+  LogRecord log_record;
+  while (offset < log_size &&
+         disk_manager_->ReadLog(log.data(), log.size(), offset)) {
+    int read = 0;
+    while (log_record.DeserializeFrom(log.data() + read, log.size() - read,
+                                      lsn)) {
+      read += log_record.GetSize();
+      lsn++;
+    }
+    // a record never spans 2 buffers == nothing parsed is the end
+    if (read == 0) {
+      break;
+    }
+    offset += read;
+  }
+  if (offset < log_size) {
+    disk_manager_->TruncateLog(offset);
+  }
+
+  reserved_ = static_cast<uint64_t>(lsn) << 32;
+  buffer_offsets_[0] = offset;
+  persistent_lsn_ = lsn - 1;
+}
 
-      // flush WAL == blocking since IO
-      disk_manager_.WriteLog(flush_buffer_, flush_buffer_size_);      
-      flush_buffer_size_ = 0;
-      SetPersistentLSN(persistent_lsn_);
 
-      if(promise_finished_flush_WAL_){
-        promise_finished_flush_WAL_->set_value(); // notify()
-      }
-    }    
-  }
 
+/*
+ * background thread to flush WAL in RAM to disk every LOG_TIMEOUT, for
+ * records nobody waits on. set ENABLE_LOGGING = true
+ *
+ * a sealed buffer wakes it early. commit / force flush don't: whoever needs
+ * the flush does it (see Flush), the thread skips a round if a flush is in
+ * progress
+ */
+void LogManager::RunFlushThread() {
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  ENABLE_LOGGING = true;
+  stop_flush_thread_ = false;
+  flush_thread_ = new std::thread([this]() {
+    std::unique_lock<std::mutex> lock(lock_WAL_);
+    while (!stop_flush_thread_) {
+      cv_flush_WAL_.wait_for(lock, LOG_TIMEOUT);
+      if (!flushing_ && (!sealed_.empty() || ReservedOffset(reserved_) > 0)) {
+        flushing_ = true;
+        Flush(lock);
+      }
+    }
+  });
 }
 
 
 
-/**
- * @brief 
- * called only by buffer pool manager 
- * 
- * - flush WAL before flushing dirty page (force flush)
- * - WAL full (cv notify)
- * - timer (cv notify)
+/*
+ * Stop and join the flush thread, flush what's left, set ENABLE_LOGGING =
+ * false
  */
-void LogManager::ForceFlushWAL(std::promise<void> *promise){
-  
-  // 1. buffer pool thread + flush WAL thread -> same promise 
-  std::unqiue_lock<std::mutex> lock(lock_WAL_);
-  SetPromise(promise);
-  lock.unlock();
-  
-  // 2. wake up flsuh thread 
+void LogManager::StopFlushThread() {
+  if (flush_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(lock_WAL_);
+    stop_flush_thread_ = true;
+  }
   cv_flush_WAL_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
 
-  
-  // 3. block until flush thread flushed WAL 
-  promise->get_future().wait();
-
-  lock.lock();
-  SetPromise(nullptr);
-  lock.unlock();
+  ForceFlushWAL();
+  ENABLE_LOGGING = false;
 }
 
 
 
 /*
- * Stop and join the flush thread, set ENABLE_LOGGING = false
+ * commit: block until lsn is durable
  *
- * 
- * 
- * ?? 
- * 
+ * no flush in progress == caller is the leader: it may wait up to
+ * commit_delay_ for commit_batch_ committers, then flushes everything
+ * appended so far, its followers' records included. flush in progress ==
+ * wait for it, lsn may have been in it. else lead the next one
  */
-void LogManager::StopFlushThread() {
+void LogManager::WaitForFlush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(lock_WAL_);
+  if (lsn <= persistent_lsn_) {
+    return;
+  }
+  commit_waits->Add();
+  MetricTimer timer(commit_wait_latency);
+
+  // batch full == the leader can stop waiting
+  if (++pending_commits_ >= commit_batch_) {
+    cv_commit_.notify_one();
+  }
+  while (persistent_lsn_ < lsn) {
+    if (flushing_) {
+      cv_flushed_.wait(lock);
+      continue;
+    }
+    flushing_ = true;
+    if (commit_delay_.count() > 0) {
+      cv_commit_.wait_for(lock, commit_delay_, [this] {
+        return pending_commits_ >= commit_batch_;
+      });
+    }
+    group_commits->Add();
+    Flush(lock);
+  }
+  pending_commits_--;
+}
+
+
+
+/**
+ * @brief
+ * called by buffer pool manager before a dirty page w a larger LSN than
+ * persistent LSN goes out, n by StopFlushThread
+ *
+ * no commit delay, nobody else is going to join
+ */
+void LogManager::ForceFlushWAL() {
+  force_flushes->Add();
+  MetricTimer timer(force_flush_latency); // caller blocked this long
+
+  std::unique_lock<std::mutex> lock(lock_WAL_);
+  lsn_t lsn = GetNextLSN() - 1;
+  while (persistent_lsn_ < lsn) {
+    if (flushing_) {
+      cv_flushed_.wait(lock);
+    } else {
+      flushing_ = true;
+      Flush(lock);
+    }
+  }
+}
+
 
-  flush_thread_->join();
 
+void LogManager::SetGroupCommit(std::chrono::microseconds commit_delay,
+                                size_t commit_batch) {
+  std::lock_guard<std::mutex> lock(lock_WAL_);
+  commit_delay_ = commit_delay;
+  commit_batch_ = std::max<size_t>(commit_batch, 1);
 }
 
 
@@ -172,139 +261,141 @@ void LogManager::StopFlushThread() {
 
 /*
  * log record (object) -> log buffer (char* not map)
- * 
+ *
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
+ * bytes layout at the top of log_record.h (LogRecord::SerializeTo)
  *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
- * 
- * 
- * tuple == 1 row in table 
+ * tuple == 1 row in table
  * log_record == tuple + log table cols (lsn, prevlsn, txnid, rid etc.)
- * 
- * Q&A:
- * why WAL == char* not map
- * - you will hv to flush char* at the end anyway
- * 
- * 
- * why pass by reference ??
- * - normal == by value/copy
- * - & == by reference/actual var == affect original var
- * - char* x_ptr = &x_var;
- * 
- * 
  */
-lsn_t LogManager::AppendLogRecord(LogRecord &log_record){ 
-
-  
-  // 1. acquire WAL lock 
-  // lock_guard == no unlock(), lock til func ends, but lightweighter
-  std::unique_lock<std::mutex> unique_lock_WAL(lock_WAL_);
-
-  
-  // 2. if WAL is full, wake up flush thread
-  if(log_buffer_.GetSize() + log_record.GetSize() >= LOG_BUFFER_SIZE){
-    
-    std::unique_lock<std::mutex> unique_lock_WAL(lock_WAL_);
-    log_buffer_to_flush_buffer();
-    
-    cv_flush_WAL_.notify_one();
+lsn_t LogManager::AppendLogRecord(LogRecord &log_record, int64_t *offset) {
+  // 1. reserve lsn + slot: 1 CAS, retried only if another append / a seal
+  // got in between. full buffer == seal it n go on in the next 1, the only
+  // time an append takes lock_WAL_. ring full == flush (or wait for the
+  // flush in progress) to free a buffer
+  uint64_t reserved = reserved_.load(std::memory_order_acquire);
+  int size;
+  while (true) {
+    // prevLSN is stored as a delta == size depends on the lsn
+    size = log_record.GetSerializedSize(ReservedLSN(reserved));
+    assert(size <= static_cast<int>(log_buffer_capacity_));
+    if (ReservedOffset(reserved) + size <=
+        static_cast<int>(log_buffer_capacity_)) {
+      // lsn + 1, offset + size, same buffer
+      if (reserved_.compare_exchange_weak(reserved,
+                                          reserved + (1ULL << 32) + size,
+                                          std::memory_order_acq_rel)) {
+        break;
+      }
+      continue;
+    }
+    buffer_full_waits->Add();
+    std::unique_lock<std::mutex> lock(lock_WAL_);
+    // seals happen under lock_WAL_, still full == nobody sealed it yet
+    reserved = reserved_.load(std::memory_order_acquire);
+    if (ReservedOffset(reserved) + size >
+        static_cast<int>(log_buffer_capacity_)) {
+      if (SealBuffer()) {
+        cv_flush_WAL_.notify_one();
+      } else if (flushing_) {
+        cv_flushed_.wait(lock);
+      } else {
+        flushing_ = true;
+        Flush(lock);
+      }
+    }
+    reserved = reserved_.load(std::memory_order_acquire);
   }
 
-  
-  // 3. depends on log type, appends log record -> log buffer
-  // 20 bytes header for all types of log
-  memcpy(log_buffer_ + log_buffer_size_, &log_record, 20);
-  log_buffer_size_ += 20;
-
-
-  switch (log_record.log_record_type_){
-  case LogRecordType::INSERT:
-    // rid, tuple 
-    memcpy(log_buffer_ + log_buffer_size_, &log_record.insert_rid_, sizeof(RID));
-    log_buffer_size_ += sizeof(RID);
-
-    log_record.insert_tuple_.SerializeTo(log_buffer_ + log_buffer_size_);
-    log_buffer_size_ += log_record.insert_tuple_.GetLength();
-
-    break;
-  
-  case LogRecordType::MARKDELETE:
-       LogRecordType::ROLLBACKDELETE:
-       LogRecordType::APPLYDELETE:
-    // rid, tuple 
-    memcpy(log_buffer_ + log_buffer_size_, &log_record.delete_rid_, sizeof(RID));
-    log_buffer_size_ += sizeof(RID);
-
-    log_record.delete_tuple_.SerializeTo(log_buffer_ + log_buffer_size_);
-    log_buffer_size_ += log_record.delete_tuple_.GetLength();
-
-    break;
-
-  case LogRecordType::UPDATE:
-
-    // new rid, old tuple, new tuple 
-    memcpy(log_buffer_ + log_buffer_size_, &log_record.update_rid, sizeof(RID));
-    log_buffer_size_ += sizeof(RID);
-    
-    log_record.old_tuple.SerializeTo(log_buffer_ + log_buffer_size_);
-    log_buffer_size_ += log_record.old_tuple.GetLength();
-    
-    log_record.new_tuple.SerializeTo(log_buffer_ + log_buffer_size_);
-    log_buffer_size_ += log_record.new_tuple.GetLength();
-    
-    break;
-  
-  
-  case LogRecordType::NEWPAGE:
-    
-    // previous page id
-    memcpy(log_buffer_ + log_buffer_size_, &log_record.prev_page_id, sizeof(page_id_t));
-    log_buffer_size_ += sizeof(page_id_t);
-    
-    
-    break;
-
-  default:
-    break;
+  // 2. serialize into the slot, in parallel w other appends
+  int buffer = ReservedBuffer(reserved);
+  log_record.lsn_ = ReservedLSN(reserved);
+  log_record.size_ = size;
+  log_record.SerializeTo(log_buffers_[buffer] + ReservedOffset(reserved),
+                         log_record.lsn_);
+  if (offset != nullptr) {
+    // buffer can't be flushed n reused before our slot is filled
+    *offset = buffer_offsets_[buffer] + ReservedOffset(reserved);
   }
 
+  // 3. slot filled, a swap waiting on this buffer may go on
+  filled_[buffer].fetch_add(size, std::memory_order_release);
+  log_appends->Add();
+  return log_record.lsn_;
+}
 
-  // 4. u() WAL
-  log_record.lsn_ += next_lsn_;
-  new_log_entries_ = true;
 
-  return log_record.lsn_;
+
+/*
+ * leader only (flushing_ set by the caller). appenders fill the next buffers
+ * while the write n fsync run w lock_WAL_ released
+ *
+ * target fixed at the call == appends arriving meanwhile don't keep the
+ * leader writing forever, they make the next group
+ */
+void LogManager::Flush(std::unique_lock<std::mutex> &lock) {
+  lsn_t target = GetNextLSN() - 1;
+  while (persistent_lsn_ < target) {
+    if (sealed_.empty() && !SealBuffer()) {
+      break;
+    }
+    // by pointer, no copy. front stays in sealed_ while in flight == not
+    // reused by appenders
+    SealedBuffer sealed = sealed_.front();
+    lock.unlock();
+    while (filled_[sealed.buffer_].load(std::memory_order_acquire) !=
+           sealed.size_) {
+      std::this_thread::yield();
+    }
+    filled_[sealed.buffer_].store(0, std::memory_order_relaxed);
+    {
+      MetricTimer timer(flush_latency);
+      disk_manager_->WriteLog(log_buffers_[sealed.buffer_], sealed.size_);
+    }
+    log_flushes->Add();
+    lock.lock();
+    sealed_.pop_front();
+    persistent_lsn_ = sealed.lsn_;
+    cv_flushed_.notify_all();
+  }
+  flushing_ = false;
+  cv_flushed_.notify_all();
 }
 
 
 /**
- * @brief 
- * why swap instead of append ??
+ * @brief
+ * why a ring instead of copying into a flush buffer ?? no copy, appends go
+ * on in the next buffer while this 1 is written. consecutive writes are
+ * different buffers, the disk manager checks they take turns
+ *
+ * the next buffer is free iff it isn't the oldest sealed 1: sealed_ holds
+ * the buffers right before the current 1, in ring order
  */
-void log_buffer_to_flush_buffer(){
-  
-  // 1. apeend at end, no flush 
-  memcpy(flush_buffer_ + flush_buffer_size_, log_buffer_, log_buffer_size_);
-
-  // 2. u() log manager struct
-  flush_buffer_size_ += log_buffer_size_;
-  log_buffer_size_ = 0;
-  new_log_entries_ = false;
-  persistent_lsn_ = next_lsn_ - 1;
+bool LogManager::SealBuffer() {
+  if (sealed_.size() + 1 >= log_buffer_count_) {
+    return false;
+  }
+  uint64_t reserved = reserved_.load(std::memory_order_acquire);
+  uint64_t next;
+  do {
+    if (ReservedOffset(reserved) == 0) {
+      return false;
+    }
+    // same lsn, next buffer, offset 0. next buffer's file offset published
+    // by the CAS, appends into it read it after theirs
+    int next_buffer = (ReservedBuffer(reserved) + 1) % log_buffer_count_;
+    buffer_offsets_[next_buffer] =
+        buffer_offsets_[ReservedBuffer(reserved)] + ReservedOffset(reserved);
+    next = (reserved >> 32 << 32) | static_cast<uint64_t>(next_buffer) << 24;
+  } while (!reserved_.compare_exchange_weak(reserved, next,
+                                            std::memory_order_acq_rel));
+
+  sealed_.push_back({ReservedBuffer(reserved), ReservedOffset(reserved),
+                     ReservedLSN(reserved) - 1});
+  return true;
 }
 
 } // namespace cmudb
@@ -0,0 +1,363 @@
+/**
+ * log_record.cpp
+ * - log record <-> bytes in the log, layout at the top of log_record.h
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "logging/log_record.h"
+
+namespace cmudb {
+
+// unchanged bytes between 2 diff ranges cheaper to repeat than to start a
+// new range (gap + length varints)
+static const int32_t DIFF_MERGE_GAP = 2;
+
+static int VarintSize(uint32_t value) {
+  int n = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++n;
+  }
+  return n;
+}
+
+static char *PutVarint(char *pos, uint32_t value) {
+  while (value >= 0x80) {
+    *pos++ = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  *pos++ = static_cast<char>(value);
+  return pos;
+}
+
+// nullptr in == nullptr out, so reads chain. nullptr == runs past end /
+// over 5 bytes
+static const char *GetVarint(const char *pos, const char *end,
+                             uint32_t &value) {
+  value = 0;
+  if (pos == nullptr) {
+    return nullptr;
+  }
+  for (int shift = 0; shift < 35 && pos < end; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*pos++);
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return pos;
+    }
+  }
+  return nullptr;
+}
+
+// INVALID_* (-1) == 0 == 1 byte
+static uint32_t Biased(int32_t value) {
+  return static_cast<uint32_t>(value) + 1;
+}
+
+static int RidSize(const RID &rid) {
+  return VarintSize(Biased(rid.GetPageId())) +
+         VarintSize(Biased(rid.GetSlotNum()));
+}
+
+static char *PutRid(char *pos, const RID &rid) {
+  pos = PutVarint(pos, Biased(rid.GetPageId()));
+  return PutVarint(pos, Biased(rid.GetSlotNum()));
+}
+
+static const char *GetRid(const char *pos, const char *end, RID &rid) {
+  uint32_t page_id, slot_num;
+  pos = GetVarint(pos, end, page_id);
+  pos = GetVarint(pos, end, slot_num);
+  rid.Set(page_id - 1, slot_num - 1);
+  return pos;
+}
+
+static int TupleSize(const Tuple &tuple) {
+  return VarintSize(tuple.GetLength()) + tuple.GetLength();
+}
+
+static char *PutTuple(char *pos, const Tuple &tuple) {
+  pos = PutVarint(pos, tuple.GetLength());
+  memcpy(pos, tuple.GetData(), tuple.GetLength());
+  return pos + tuple.GetLength();
+}
+
+// <id, lsn> pairs, both biased
+template <typename T>
+static int PairsSize(const std::vector<std::pair<T, lsn_t>> &pairs) {
+  int n = VarintSize(pairs.size());
+  for (auto &pair : pairs) {
+    n += VarintSize(Biased(pair.first)) + VarintSize(Biased(pair.second));
+  }
+  return n;
+}
+
+template <typename T>
+static char *PutPairs(char *pos, const std::vector<std::pair<T, lsn_t>> &pairs) {
+  pos = PutVarint(pos, pairs.size());
+  for (auto &pair : pairs) {
+    pos = PutVarint(pos, Biased(pair.first));
+    pos = PutVarint(pos, Biased(pair.second));
+  }
+  return pos;
+}
+
+template <typename T>
+static const char *GetPairs(const char *pos, const char *end,
+                            std::vector<std::pair<T, lsn_t>> &pairs) {
+  uint32_t num_pairs;
+  pos = GetVarint(pos, end, num_pairs);
+  pairs.clear();
+  // 2 bytes a pair at least, a bogus count can't allocate much
+  if (pos == nullptr || num_pairs > static_cast<uint32_t>(end - pos) / 2) {
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < num_pairs && pos != nullptr; ++i) {
+    uint32_t id, lsn;
+    pos = GetVarint(pos, end, id);
+    pos = GetVarint(pos, end, lsn);
+    pairs.emplace_back(id - 1, lsn - 1);
+  }
+  return pos;
+}
+
+static const char *GetTuple(const char *pos, const char *end, Tuple &tuple) {
+  uint32_t size;
+  pos = GetVarint(pos, end, size);
+  if (pos == nullptr || size > static_cast<uint32_t>(end - pos)) {
+    return nullptr;
+  }
+  tuple.DeserializeFrom(pos, size);
+  return pos + size;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * once per record, at construction. size in the log still depends on the
+ * lsn (GetSerializedSize)
+ */
+void LogRecord::ComputeBodySize() {
+  body_size_ = 1 + VarintSize(Biased(txn_id_));
+  switch (log_record_type_) {
+  case LogRecordType::INSERT:
+    body_size_ += RidSize(insert_rid_) + TupleSize(insert_tuple_);
+    break;
+
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    body_size_ += RidSize(delete_rid_) + TupleSize(delete_tuple_);
+    break;
+
+  case LogRecordType::UPDATE: {
+    // ranges where new bytes differ from old (or old is shorter), gaps of
+    // <= DIFF_MERGE_GAP equal bytes folded into the range
+    const char *old_data = old_tuple_.GetData();
+    const char *new_data = new_tuple_.GetData();
+    int32_t old_size = old_tuple_.GetLength();
+    int32_t new_size = new_tuple_.GetLength();
+    auto same = [&](int32_t i) {
+      return i < old_size && old_data[i] == new_data[i];
+    };
+    update_diff_.clear();
+    int32_t i = 0;
+    while (i < new_size) {
+      if (same(i)) {
+        ++i;
+        continue;
+      }
+      int32_t end = i + 1;
+      for (int32_t j = end, run = 0; j < new_size && run <= DIFF_MERGE_GAP;
+           ++j) {
+        if (same(j)) {
+          ++run;
+        } else {
+          run = 0;
+          end = j + 1;
+        }
+      }
+      update_diff_.emplace_back(i, end - i);
+      i = end;
+    }
+
+    body_size_ += RidSize(update_rid_) + TupleSize(old_tuple_) +
+                  VarintSize(new_size) + VarintSize(update_diff_.size());
+    int32_t prev_end = 0;
+    for (auto &range : update_diff_) {
+      body_size_ += VarintSize(range.first - prev_end) +
+                    VarintSize(range.second) + range.second;
+      prev_end = range.first + range.second;
+    }
+    break;
+  }
+
+  case LogRecordType::NEWPAGE:
+    body_size_ +=
+        VarintSize(Biased(page_id_)) + VarintSize(Biased(prev_page_id_));
+    break;
+
+  case LogRecordType::END_CHECKPOINT:
+    body_size_ += PairsSize(active_txns_) + PairsSize(dirty_pages_);
+    break;
+
+  default: // BEGIN / COMMIT / ABORT / BEGIN_CHECKPOINT, header only
+    break;
+  }
+}
+
+int32_t LogRecord::GetSerializedSize(lsn_t lsn) const {
+  uint32_t delta = prev_lsn_ == INVALID_LSN ? 0 : lsn - prev_lsn_;
+  int32_t body = body_size_ + VarintSize(delta);
+  return VarintSize(body) + body;
+}
+
+void LogRecord::SerializeTo(char *storage, lsn_t lsn) const {
+  uint32_t delta = prev_lsn_ == INVALID_LSN ? 0 : lsn - prev_lsn_;
+  char *pos = PutVarint(storage, body_size_ + VarintSize(delta));
+  *pos++ = static_cast<char>(log_record_type_);
+  pos = PutVarint(pos, Biased(txn_id_));
+  pos = PutVarint(pos, delta);
+
+  switch (log_record_type_) {
+  case LogRecordType::INSERT:
+    pos = PutTuple(PutRid(pos, insert_rid_), insert_tuple_);
+    break;
+
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    pos = PutTuple(PutRid(pos, delete_rid_), delete_tuple_);
+    break;
+
+  case LogRecordType::UPDATE: {
+    pos = PutTuple(PutRid(pos, update_rid_), old_tuple_);
+    pos = PutVarint(pos, new_tuple_.GetLength());
+    pos = PutVarint(pos, update_diff_.size());
+    int32_t prev_end = 0;
+    for (auto &range : update_diff_) {
+      pos = PutVarint(pos, range.first - prev_end);
+      pos = PutVarint(pos, range.second);
+      memcpy(pos, new_tuple_.GetData() + range.first, range.second);
+      pos += range.second;
+      prev_end = range.first + range.second;
+    }
+    break;
+  }
+
+  case LogRecordType::NEWPAGE:
+    pos = PutVarint(PutVarint(pos, Biased(page_id_)), Biased(prev_page_id_));
+    break;
+
+  case LogRecordType::END_CHECKPOINT:
+    pos = PutPairs(PutPairs(pos, active_txns_), dirty_pages_);
+    break;
+
+  default:
+    break;
+  }
+  assert(pos - storage == GetSerializedSize(lsn));
+}
+
+/*
+ * a record is complete iff size says so n its fields parse to exactly that
+ * many bytes. zeros (preallocated, never written log) == size 0 == no record
+ */
+bool LogRecord::DeserializeFrom(const char *data, int32_t size, lsn_t lsn) {
+  const char *end = data + size;
+  uint32_t body, txn_id, delta;
+  const char *pos = GetVarint(data, end, body);
+  if (pos == nullptr || body == 0 || body > static_cast<uint32_t>(end - pos)) {
+    return false;
+  }
+  end = pos + body;
+  log_record_type_ = static_cast<LogRecordType>(static_cast<uint8_t>(*pos++));
+  pos = GetVarint(pos, end, txn_id);
+  pos = GetVarint(pos, end, delta);
+
+  switch (log_record_type_) {
+  case LogRecordType::INSERT:
+    pos = GetTuple(GetRid(pos, end, insert_rid_), end, insert_tuple_);
+    break;
+
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    pos = GetTuple(GetRid(pos, end, delete_rid_), end, delete_tuple_);
+    break;
+
+  case LogRecordType::UPDATE: {
+    // new image == old bytes up to its size, ranges applied on top
+    uint32_t new_size, num_ranges;
+    pos = GetTuple(GetRid(pos, end, update_rid_), end, old_tuple_);
+    pos = GetVarint(pos, end, new_size);
+    pos = GetVarint(pos, end, num_ranges);
+    if (pos == nullptr || new_size > MAX_PAGE_SIZE) {
+      return false;
+    }
+    std::vector<char> new_data(new_size, 0);
+    memcpy(new_data.data(), old_tuple_.GetData(),
+           std::min<uint32_t>(new_size, old_tuple_.GetLength()));
+    update_diff_.clear();
+    uint32_t prev_end = 0;
+    for (uint32_t i = 0; i < num_ranges && pos != nullptr; ++i) {
+      uint32_t gap, length;
+      pos = GetVarint(pos, end, gap);
+      pos = GetVarint(pos, end, length);
+      if (pos == nullptr || length > static_cast<uint32_t>(end - pos) ||
+          prev_end + gap + length > new_size) {
+        return false;
+      }
+      memcpy(new_data.data() + prev_end + gap, pos, length);
+      update_diff_.emplace_back(prev_end + gap, length);
+      pos += length;
+      prev_end += gap + length;
+    }
+    new_tuple_.DeserializeFrom(new_data.data(), new_size);
+    break;
+  }
+
+  case LogRecordType::NEWPAGE: {
+    uint32_t page_id, prev_page_id;
+    pos = GetVarint(GetVarint(pos, end, page_id), end, prev_page_id);
+    page_id_ = page_id - 1;
+    prev_page_id_ = prev_page_id - 1;
+    break;
+  }
+
+  case LogRecordType::END_CHECKPOINT:
+    pos = GetPairs(GetPairs(pos, end, active_txns_), end, dirty_pages_);
+    break;
+
+  case LogRecordType::BEGIN:
+  case LogRecordType::COMMIT:
+  case LogRecordType::ABORT:
+  case LogRecordType::BEGIN_CHECKPOINT:
+    break;
+
+  default:
+    return false;
+  }
+  if (pos != end) {
+    return false;
+  }
+
+  lsn_ = lsn;
+  txn_id_ = txn_id - 1;
+  prev_lsn_ = delta == 0 ? INVALID_LSN : lsn - delta;
+  size_ = end - data;
+  body_size_ = body - VarintSize(delta);
+  return true;
+}
+
+} // namespace cmudb
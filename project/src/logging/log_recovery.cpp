@@ -2,7 +2,13 @@
  * log_recovey.cpp
  */
 
+#include <cassert>
+#include <queue>
+#include <unordered_set>
+
+#include "common/logger.h"
 #include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "page/table_page.h"
 
 namespace cmudb {
@@ -33,68 +39,137 @@ namespace cmudb {
  * 
  * 
  */
-bool LogRecovery::DeserializeLogRecord(const char *data,
+bool LogRecovery::DeserializeLogRecord(const char *data, int size, lsn_t lsn,
                                       LogRecord &log_record) {
   
   // 1. raw bytes (data) -> struct (log record)
-  
-  // 1.1 header, 5 fields, 4 bytes each 
-  // | size | LSN | transID | prevLSN | LogType |
-  int32_t bytes_of_field = 4;
-  log_record.size_ = *reinterpret_cast<const int *>(data);
-  log_record.lsn_ = *reinterpret_cast<const lsn_t *>(data + bytes_of_field);
-  log_record.txn_id_ = *reinterpret_cast<const txn_id_t *>(data + bytes_of_field*2);
-  log_record.prev_lsn_ = *reinterpret_cast<const lsn_t *>(data + bytes_of_field*3);
-  log_record.log_record_type_ = *reinterpret_cast<const LogRecordType*>(data + bytes_of_field*4);
-
-  // 1.2
-  switch (log_record.log_record_type_){
-  
-  // | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
-  // log record does not follow graph bytes
-  // use log_record.h private var instead of bytes layout graph
-  case LogRecordType::INSERT:
-    log_record.insert_rid_ = *reinterpret_cast<const RID *>(data + LogRecord::HEADER_SIZE);
-    // NOTE: tuple == class, 4 types of constructor
-    log_record.insert_tuple_.DeserializeFrom(data + LogRecord::HEADER_SIZE + sizeof(RID));
-    break;
-  
-  case LogRecordType::MARKDELETE:
-  case LogRecordType::APPLYDELETE:
-  case LogRecordType::ROLLBACKDELETE:
-    log_record.delete_rid_ = *reinterpret_cast<const RID *>(data + LogRecord::HEADER_SIZE);    
-    log_record.delete_tuple_.DeserializeFrom(data + LogRecord::HEADER_SIZE + sizeof(RID));
-    break;
+  // varint header, prevLSN as a delta, update == old tuple + diff. layout n
+  // parsing in log_record.h / .cpp, lsn counted by the caller (not stored)
+  if (!log_record.DeserializeFrom(data, size, lsn)) {
+    return false;
+  }
 
-  case LogRecordType::UPDATE:
-    log_record.update_rid_ = *reinterpret_cast<const RID *>(data + LogRecord::HEADER_SIZE);
-    log_record.old_tuple_.DeserializeFrom(data + LogRecord::HEADER_SIZE + sizeof(RID));
-    log_record.new_tuple_.DeserializeFrom(data + LogRecord::HEADER_SIZE + sizeof(RID) + log_record.old_tuple_.GetLength());
-    break;
 
-  case LogRecordType::NEWPAGE: 
-    log_record.prev_page_id_ = *reinterpret_cast<const page_id_t *>(data + LogRecord::HEADER_SIZE);
+  // 2. reconstruct ATT, DPT, minDirtyPageLSN ?? 
+  // loop from top to bottom 
+
 
 
-  // skip ?? 
-  case LogRecordType::BEGIN:
-  case LogRecordType::COMMIT:
-  case LogRecordType::ABORT:    
-  case LogRecordType::CLR: // ??
 
-  default:
-    break;
+  
+  return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * ARIES analysis, from the last checkpoint's BEGIN_CHECKPOINT to the end
+ * 
+ * ATT == txns not committed / aborted by the end, w their last lsn
+ * DPT == pages possibly not on disk, w the 1st lsn that may be missing
+ * 
+ * END_CHECKPOINT's tables are merged in: a snapshot taken after BEGIN, so
+ * records scanned before it may be in it or not. ATT keeps the later lsn,
+ * DPT the earlier recLSN, txns ended before the snapshot was logged stay out
+ * 
+ * no checkpoint (master record all 0) == log start
+ */
+void LogRecovery::Analysis() {
+  // 1. master record
+  lsn_t checkpoint_lsn = 0;
+  int64_t checkpoint_offset = 0, redo_offset = 0;
+  redo_lsn_ = 0;
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page != nullptr) {
+    header_page->GetMasterRecord(checkpoint_lsn, checkpoint_offset, redo_lsn_,
+                                 redo_offset);
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
   }
+  redo_offset_ = redo_offset;
+  active_txn_.clear();
+  dirty_page_table_.clear();
+
+  // 2. scan from the checkpoint on
+  std::unordered_set<txn_id_t> ended_txns;
+  int64_t offset = checkpoint_offset;
+  lsn_t lsn = checkpoint_lsn;
+  while (disk_manager_->ReadLog(log_buffer_, log_buffer_capacity_, offset)) {
+    LogRecord log_entry;
+    int log_file_offset = 0;
+    while (DeserializeLogRecord(log_buffer_ + log_file_offset,
+                                log_buffer_capacity_ - log_file_offset, lsn,
+                                log_entry)) {
+      log_file_offset += log_entry.GetSize();
+      lsn++;
 
+      switch (log_entry.GetLogRecordType()) {
+      case LogRecordType::BEGIN_CHECKPOINT:
+        break;
 
-  // 2. reconstruct ATT, DPT, minDirtyPageLSN ?? 
-  // loop from top to bottom 
+      case LogRecordType::END_CHECKPOINT:
+        for (auto &entry : log_entry.GetActiveTxns()) {
+          if (ended_txns.count(entry.first) == 0) {
+            lsn_t &last_lsn =
+                active_txn_.emplace(entry.first, entry.second).first->second;
+            last_lsn = std::max(last_lsn, entry.second);
+          }
+        }
+        for (auto &entry : log_entry.GetDirtyPages()) {
+          lsn_t &rec_lsn =
+              dirty_page_table_.emplace(entry.first, entry.second)
+                  .first->second;
+          rec_lsn = std::min(rec_lsn, entry.second);
+        }
+        break;
 
+      case LogRecordType::COMMIT:
+      case LogRecordType::ABORT:
+        active_txn_.erase(log_entry.GetTxnId());
+        ended_txns.insert(log_entry.GetTxnId());
+        break;
 
+      // BEGIN n changes: txn's last lsn, 1st change of a page == its recLSN
+      default:
+        active_txn_[log_entry.GetTxnId()] = log_entry.GetLSN();
+        if (GetPageId(log_entry) != INVALID_PAGE_ID) {
+          dirty_page_table_.emplace(GetPageId(log_entry), log_entry.GetLSN());
+        }
+        break;
+      }
+    }
 
+    // a record cut at the end of the read == next read starts at it
+    if (log_file_offset == 0) {
+      break;
+    }
+    offset += log_file_offset;
+  }
+}
 
-  
-  return true;
+// NEWPAGE touches 2 pages (new n prev), their page lsns decide, no DPT
+page_id_t LogRecovery::GetPageId(LogRecord &log_record) {
+  switch (log_record.GetLogRecordType()) {
+  case LogRecordType::INSERT:
+    return log_record.GetInsertRID().GetPageId();
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    return log_record.GetDeleteRID().GetPageId();
+  case LogRecordType::UPDATE:
+    return log_record.GetUpdateRID().GetPageId();
+  default:
+    return INVALID_PAGE_ID;
+  }
 }
 
 
@@ -109,7 +184,7 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
 
 
 /*
- * disk page LSN < commit LSN == redo 
+ * disk page LSN < record's LSN == redo 
  * 
  * redo == analysis + redo 
  * since in test == redo(), then undo()
@@ -117,18 +192,12 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
  * 
  * redo phase on TABLE PAGE level(table/table_page.h)
  * 
- * read log file from the beginning to end 
- * (you must prefetch log records into log buffer to reduce unnecessary I/O operations)
- * 
- *
- * remember to compare page's LSN with log_record's sequence number, 
- * and also build active_txn_ table & lsn_mapping_ table
- * 
+ * read log file from the redo point to end, whole log buffers at a time
+ * (prefetch log records into log buffer to reduce unnecessary I/O operations)
  * 
- * 
- * Q&A 
- * virtual table vs table heap vs table page ?? 
- * read abort() + 3 table classes to help understand
+ * repeat history: losers' changes redone too, undo() takes them back. also
+ * builds lsn_offset_map_ (redo point <= every loser's BEGIN == all of their
+ * records in it)
  * 
  * 
  * 
@@ -139,113 +208,138 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
  * 
  */
 void LogRecovery::Redo() {
+  assert(!ENABLE_LOGGING);
+
+  // 0. ATT, DPT n the redo point from the last checkpoint on
+  Analysis();
+  lsn_offset_map_.clear();
 
   
-  // 1. while loop read WAL from disk from top to bottom == all txns' logs
+  // 1. while loop read WAL from disk from the redo point to bottom
   // each time read 11 * 512 bytes == (BUFFER_POOL_SIZE + 1) * PAGE_SIZE
-  int offset = 0;
-  while(disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset)){
-    offset += LOG_BUFFER_SIZE;
+  int64_t offset = redo_offset_;
+  lsn_t lsn = redo_lsn_; // not in the log: each record's == previous + 1
+  while(disk_manager_->ReadLog(log_buffer_, log_buffer_capacity_, offset)){
     
     // 2. raw bytes -> struct 
     // each time parse log_entry size bytes from 11 * 512 bytes
     LogRecord log_entry;
     int log_file_offset = 0;
-    while(DeserializeLogRecord(log_buffer_, log_entry)){
+    while(DeserializeLogRecord(log_buffer_ + log_file_offset,
+                               log_buffer_capacity_ - log_file_offset, lsn,
+                               log_entry)){
       
       // for later undo 
-      lsn_offset_map_[log_entry.GetLSN()] = offset_ + log_file_offset;
+      lsn_offset_map_[log_entry.GetLSN()] = offset + log_file_offset;
       log_file_offset += log_entry.GetSize();
+      lsn++;
+
+      // page not in DPT / change before its recLSN == on disk already
+      page_id_t page_id = GetPageId(log_entry);
+      if (page_id != INVALID_PAGE_ID &&
+          (dirty_page_table_.count(page_id) == 0 ||
+           log_entry.GetLSN() < dirty_page_table_[page_id])) {
+        continue;
+      }
     
-      
-      
-      // 3. re-execute WAL row 
-      // make sure disk page's LSN to up to disk WAL's LSN
-      switch (log_entry.GetLogRecordType()){
-            
-      // init ATT
-      // ATT == find txns that need to undo 
-      case LogRecordType::BEGIN: 
-        active_txn_[log_entry.GetTxnID()] = log_entry.GetLSN();
-        break;
-            
-      
-      // remove txn from ATT       
-      case LogRecordType::COMMIT:
-        active_txn_.erase(record.GetTxnId());
-        break;
-
-      
-      // remove txn from ATT 
-      case LogRecordType::ABORT:
-        active_txn_.erase(record.GetTxnId());
-        break;
-      
-
-
-      // for all following == u() ATT to latest LSN ?? 
-
-      case LogRecordType::NEWPAGE: 
-        
-        // 0. 
-        auto new_page = buffer_pool_manager_->NewPage();
-        TablePage* table_page = reinterpret_cast<TablePage*>(new_page);
-        table_page->Init(new_page->GetPageId(), PAGE_SIZE, log_entry->GetPrevPageId(), log_manager, nullptr);
-
-        break;
-      
-      
-      case LogRecordType::INSERT:
-        
-        // 1. fetch page
-        // record id == page id + slot no.
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == redo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-
-          // 3. insert tuple into table again 
-          TablePage *table_page = reinterpret_cast<TablePage *>(page);
-          table_page->InsertTuple(log_entry.insert_tuple_, 
-              log_entry.GetInsertRID(), nullptr, lock_manager_, log_manager_);
-        }
-        
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-
-        break;
-      
-      case LogRecordType::MARKDELETE:
-
-
-        break;
-
-      case LogRecordType::APPLYDELETE:
-
-
-        break;
-
-      case LogRecordType::ROLLBACKDELETE:
-
-        break;
-
-      case LogRecordType::UPDATE:
-
-        break;
+      // 3. re-execute WAL row, page lsn decides
+      RedoLogRecord(log_entry);
+    }
 
-      
-        
+    // a record cut at the end of the read == next read starts at it
+    if (log_file_offset == 0) {
+      break;
+    }
+    offset += log_file_offset;
+  }
 
-      // ??
-      case LogRecordType::CLR: 
+}
 
-      default:
-        break;
+/*
+ * page LSN < record's LSN == change not on the page, done again n page LSN
+ * moved up to the record's
+ *
+ * BEGIN / COMMIT / ABORT / checkpoints change no page. NEWPAGE == new page
+ * inited n linked after prev page, each w its own page LSN check
+ */
+void LogRecovery::RedoLogRecord(LogRecord &log_record) {
+  lsn_t lsn = log_record.GetLSN();
+
+  if (log_record.GetLogRecordType() == LogRecordType::NEWPAGE) {
+    page_id_t page_id = log_record.GetNewPageId();
+    TablePage *new_page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (new_page != nullptr) {
+      bool is_dirty = new_page->GetLSN() < lsn;
+      if (is_dirty) {
+        new_page->Init(page_id, buffer_pool_manager_->GetPageSize(),
+                       log_record.GetPrevPageId(), nullptr, nullptr);
+        new_page->SetLSN(lsn);
       }
+      buffer_pool_manager_->UnpinPage(page_id, is_dirty);
     }
 
+    page_id_t prev_page_id = log_record.GetPrevPageId();
+    if (prev_page_id == INVALID_PAGE_ID) {
+      return;
+    }
+    TablePage *prev_page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(prev_page_id));
+    if (prev_page != nullptr) {
+      bool is_dirty = prev_page->GetLSN() < lsn;
+      if (is_dirty) {
+        prev_page->SetNextPageId(page_id);
+        prev_page->SetLSN(lsn);
+      }
+      buffer_pool_manager_->UnpinPage(prev_page_id, is_dirty);
+    }
+    return;
+  }
 
+  page_id_t page_id = GetPageId(log_record);
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  TablePage *page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    return;
   }
+  page->WLatch();
+  bool is_dirty = page->GetLSN() < lsn;
+  if (is_dirty) {
+    ApplyChange(page, log_record);
+    page->SetLSN(lsn);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, is_dirty);
+}
 
+// ENABLE_LOGGING off == TablePage takes no txn, lock manager or log manager
+void LogRecovery::ApplyChange(TablePage *page, LogRecord &log_record) {
+  switch (log_record.GetLogRecordType()) {
+  case LogRecordType::INSERT:
+    page->InsertTupleAt(log_record.GetInserteTuple(),
+                        log_record.GetInsertRID());
+    break;
+  case LogRecordType::MARKDELETE:
+    page->MarkDelete(log_record.GetDeleteRID(), nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->ApplyDelete(log_record.GetDeleteRID(), nullptr, nullptr);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->RollbackDelete(log_record.GetDeleteRID(), nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE: {
+    Tuple old_tuple;
+    page->UpdateTuple(log_record.GetNewTuple(), old_tuple,
+                      log_record.GetUpdateRID(), nullptr, nullptr, nullptr);
+    break;
+  }
+  default:
+    break;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -258,216 +352,125 @@ void LogRecovery::Redo() {
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /*
- * disk page LSN > commit LSN == undo 
- * undo == undo all changes if its not "committed"
+ * undo == take back all changes of txns not committed / aborted (ATT)
  * 
  * undo phase on TABLE PAGE level(table/table_page.h)
- * iterate through active txn map and undo each operation
- * 
- * 
  * 
  * redo() then undo() 
  * - redo() == bring page up to date of what log says it shd be like
- * - undo() == then undo all uncommitted changes to previous commit
- * 
- * 
- * redo() + undo() 
- * - undo what's been redone, wasted repeated steps
- * - since no analysis phase, redo once to learn whether committed at the end
- * 
- * 
- * 
- * ATT 
- * - who are the uncommitted txns 
- * - latestLSN == LSN to start undo changes by uncommitted txns
- * 
+ * - undo() == then undo all uncommitted changes
  * 
+ * losers' records latest 1st across all of them (prevLSN chains merged
+ * in a heap), each read back via lsn_offset_map_. every change undone is
+ * logged as its inverse (INSERT <-> APPLYDELETE, MARKDELETE <->
+ * ROLLBACKDELETE, UPDATE w old n new swapped), like Abort() would. its
+ * BEGIN reached == ABORT logged == loser ended, not undone again by a
+ * later recovery
  * 
+ * NEWPAGE not undone: an empty page linked in the table is harmless
  * 
+ * the end: log n pages flushed, redone pages carry no recLSN the next
+ * checkpoint's DPT would know
  */
 void LogRecovery::Undo() {
+  assert(!ENABLE_LOGGING);
+
+  // 1. <next lsn to undo, txn> max heap, loser's last record == its ATT lsn
+  std::priority_queue<std::pair<lsn_t, txn_id_t>> undo_heap;
+  // last record logged for the txn == prevLSN of its next compensation
+  std::unordered_map<txn_id_t, lsn_t> undo_prev_lsn;
+  for (auto &entry : active_txn_) {
+    undo_heap.emplace(entry.second, entry.first);
+    undo_prev_lsn[entry.first] = entry.second;
+  }
 
-  // 1. read log entries into heap == loop WAL from bottom to top   
-  for (auto ATT_entry = active_txn_.begin(); ATT_entry < active_txn_.end(); ++ATT_entry){
-    
-    // alternative heap: 
-    // txn's latest_lsn + lsn_offset_map + row's prevLSN
-    lsn_t txn_latest_lsn = ATT_entry->second();
-    int txn_latest_lsn_offset = lsn_offset_map_[txn_latest_lsn];
-    
-    
-    // 2. raw bytes -> struct        
-    bool curr_txn_finished_undo = false;
-    while(true){
-
-      if(curr_txn_finished_undo){
-        break;
-      }
-
-      // read log belonging to T1/T2/T3 etc. from its last entry
-      // only need 1 row's size so LOG_BUFFER_SIZE is overkill
-      disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, txn_latest_lsn_offset);                
-      LogRecord log_entry;    
-      DeserializeLogRecord(log_buffer_, log_entry)
-                            
-      
-      // 3. undo all uncommitted == until "BEGIN"
-      // undo == do the opposite 
-      switch (log_entry.GetLogRecordType()){
-          
-      
-      case LogRecordType::BEGIN:         
-        curr_txn_finished_undo = true; // next txn 
-        break;
-      
-      
-      case LogRecordType::COMMIT:
-        // uncommitted txn not suppose to have this
-        assert(false);
-        break;
-            
-      case LogRecordType::ABORT:
-        // uncommitted txn not suppose to have this
-        assert(false);
-        break;
-      
-            
-      
-      // undo INSERT == APPLYDELETE 
-      case LogRecordType::INSERT:
-        
-        // 1. fetch page        
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == nothing to undo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-          break;
-        }       
-
-        // 3. ApplyDelete
-        TablePage *table_page = reinterpret_cast<TablePage *>(page);
-        table_page->ApplyDelete(log_entry->rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-        
-        break;
-      
-      
-      //undo MARKDELETE == ROLLBACKDELETE
-      case LogRecordType::MARKDELETE:
-        
-        // 1. fetch page        
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == nothing to undo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-          break;
-        }       
-
-        // 3. ApplyDelete
-        TablePage *table_page = reinterpret_cast<TablePage *>(page);
-        table_page->RollbackDelete(log_entry->rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-                
-        break;
-
-      
-
-
-      case LogRecordType::APPLYDELETE:
-
-        
-        
-
-        // 1. fetch page        
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == nothing to undo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-          break;
-        }       
-
-        // 3. ApplyDelete
-        TablePage *table_page = reinterpret_cast<TablePage *>(page);
-        // log contains delete_tuple -> put tuple back to original slot 
-        // tuple == delete_tuple
-        table_page->InsertTuple(log_entry->delete_tuple_, log_entry->delete_rid_, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-                
-        
-        break;
-
-      case LogRecordType::ROLLBACKDELETE:
-
-        // 1. fetch page        
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == nothing to undo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-          break;
-        }       
-
-        // 3. MarkDelete
-        TablePage *table_page = reinterpret_cast<TablePage *>(page);
-        table_page->MarkDelete(log_entry->rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-        
-        break;
-
-      case LogRecordType::UPDATE:
-
-
-        // 1. fetch page        
-        auto page = buffer_pool_manager_->FetchPage(log_entry->GetInsertRID()->GetPageID());
-        
-        // 2. disk page LSN < commit LSN == nothing to undo 
-        if(page->GetLSN() < log_entry->GetLSN()){
-          break;
-        }       
-
-        // 3. MarkDelete
-        TablePage *table_page = reinterpret_cast<TablePage *>(page);
-        table_page->UpdateTuple(log_entry->old_tuple, log_entry->new_tuple, log_entry->rid, nullptr, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-        
-        break;
-
-
-
-      // fetch the new page n zero out ??
-      case LogRecordType::NEWPAGE: 
-        
-        auto new_page = buffer_pool_manager_->NewPage();
-        TablePage* table_page = reinterpret_cast<TablePage*>(new_page);
-        table_page->Init(new_page->GetPageId(), PAGE_SIZE, log_entry->GetPrevPageId(), log_manager, nullptr);
-
-        break;
-      
-
-      default:
-        break;
-                  
-      }
+  while (!undo_heap.empty()) {
+    lsn_t lsn = undo_heap.top().first;
+    txn_id_t txn_id = undo_heap.top().second;
+    undo_heap.pop();
 
-    
-      txn_latest_lsn = log_entry->GetPrevLSN();
-      txn_latest_lsn_offset = lsn_offset_map_[txn_latest_lsn];
+    // 2. raw bytes -> struct, only 1 record needed from the read
+    LogRecord log_entry;
+    auto offset = lsn_offset_map_.find(lsn);
+    if (offset == lsn_offset_map_.end() ||
+        !disk_manager_->ReadLog(log_buffer_, log_buffer_capacity_,
+                                offset->second) ||
+        !DeserializeLogRecord(log_buffer_, log_buffer_capacity_, lsn,
+                              log_entry)) {
+      LOG_DEBUG("undo: lsn %d of txn %d not in the log", lsn, txn_id);
+      continue;
+    }
+    assert(log_entry.GetTxnId() == txn_id);
 
+    // 3. change logged as its inverse n applied
+    if (GetPageId(log_entry) != INVALID_PAGE_ID) {
+      undo_prev_lsn[txn_id] = UndoLogRecord(log_entry, undo_prev_lsn[txn_id]);
     }
 
+    // 4. next record of the txn, or its BEGIN reached
+    if (log_entry.GetLogRecordType() != LogRecordType::BEGIN &&
+        log_entry.GetPrevLSN() != INVALID_LSN) {
+      undo_heap.emplace(log_entry.GetPrevLSN(), txn_id);
+    } else {
+      LogRecord abort_entry(txn_id, undo_prev_lsn[txn_id],
+                            LogRecordType::ABORT);
+      log_manager_->AppendLogRecord(abort_entry);
+    }
   }
-  
-
-
-  
-
-
-  // 3. 
-
-
-
+  active_txn_.clear();
 
+  // 5. WAL before the pages it covers
+  log_manager_->ForceFlushWAL();
+  buffer_pool_manager_->FlushAllPages();
 }
 
-
+// page holds log_record's change (redo done) == inverse always applies
+lsn_t LogRecovery::UndoLogRecord(LogRecord &log_record, lsn_t prev_lsn) {
+  txn_id_t txn_id = log_record.GetTxnId();
+  LogRecord compensation;
+  switch (log_record.GetLogRecordType()) {
+  case LogRecordType::INSERT:
+    compensation = LogRecord(txn_id, prev_lsn, LogRecordType::APPLYDELETE,
+                             log_record.GetInsertRID(),
+                             log_record.GetInserteTuple());
+    break;
+  case LogRecordType::APPLYDELETE:
+    compensation = LogRecord(txn_id, prev_lsn, LogRecordType::INSERT,
+                             log_record.GetDeleteRID(),
+                             log_record.GetDeleteTuple());
+    break;
+  case LogRecordType::MARKDELETE:
+    compensation = LogRecord(txn_id, prev_lsn, LogRecordType::ROLLBACKDELETE,
+                             log_record.GetDeleteRID(),
+                             log_record.GetDeleteTuple());
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    compensation = LogRecord(txn_id, prev_lsn, LogRecordType::MARKDELETE,
+                             log_record.GetDeleteRID(),
+                             log_record.GetDeleteTuple());
+    break;
+  case LogRecordType::UPDATE:
+    compensation = LogRecord(txn_id, prev_lsn, LogRecordType::UPDATE,
+                             log_record.GetUpdateRID(),
+                             log_record.GetNewTuple(),
+                             log_record.GetOldTuple());
+    break;
+  default:
+    return prev_lsn;
+  }
+  lsn_t lsn = log_manager_->AppendLogRecord(compensation);
+
+  page_id_t page_id = GetPageId(compensation);
+  TablePage *page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page != nullptr) {
+    page->WLatch();
+    ApplyChange(page, compensation);
+    page->SetLSN(lsn);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  return lsn;
+}
 
 } // namespace cmudb
@@ -33,15 +33,23 @@ namespace cmudb {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id) {
+                                          page_id_t parent_id,
+                                          size_t page_size) {
 
 
   // 1. parent class page
+  SetPageType(IndexPageType::INTERNAL_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
 
 
   // 2. child class internal page
-
-
+  // slots between header n checksum trailer, -1 == room for 1 extra kv
+  // before split
+  SetMaxSize((page_size - PAGE_CHECKSUM_SIZE -
+              sizeof(B_PLUS_TREE_INTERNAL_PAGE_TYPE)) /
+                 sizeof(MappingType) - 1);
 }
 
 /*****************************************************************************
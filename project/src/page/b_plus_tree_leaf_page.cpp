@@ -36,9 +36,18 @@ namespace cmudb {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id) {
-
-  
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      size_t page_size) {
+  SetPageType(IndexPageType::LEAF_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  // slots between header n checksum trailer, -1 == room for 1 extra kv
+  // before split
+  SetMaxSize((page_size - PAGE_CHECKSUM_SIZE -
+              sizeof(B_PLUS_TREE_LEAF_PAGE_TYPE)) /
+                 sizeof(MappingType) - 1);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
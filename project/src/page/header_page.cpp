@@ -8,6 +8,10 @@
 
 namespace cmudb {
 
+// RecordCount + PageSize + PoolSize + MasterRecord + Format
+static constexpr int RECORDS_OFFSET = HEADER_FORMAT_OFFSET + 8;
+static constexpr int RECORD_SIZE = 36;
+
 /**
  * Record related
  */
@@ -17,7 +21,10 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RECORDS_OFFSET + record_num * RECORD_SIZE;
+  // header page full, up to the tablespaces
+  if (offset + RECORD_SIZE > TablespaceOffset(GetTablespaceCount() - 1))
+    return false;
   // check for duplicate name
   if (FindRecord(name) != -1)
     return false;
@@ -37,9 +44,9 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
-  memmove(GetData() + offset, GetData() + offset + 36,
-          (record_num - index - 1) * 36);
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET;
+  memmove(GetData() + offset, GetData() + offset + RECORD_SIZE,
+          (record_num - index - 1) * RECORD_SIZE);
 
   SetRecordCount(record_num - 1);
   return true;
@@ -53,7 +60,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,15 +74,76 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
 }
 
+/**
+ * Tablespace related
+ */
+bool HeaderPage::InsertTablespace(int tablespace_id, const std::string &path) {
+  assert(path.length() < TABLESPACE_RECORD_SIZE - 4);
+
+  int count = GetTablespaceCount();
+  int offset = TablespaceOffset(count);
+  // header page full, down to the records
+  if (offset < RECORDS_OFFSET + GetRecordCount() * RECORD_SIZE)
+    return false;
+  int existing_id;
+  if (GetTablespaceId(path, existing_id))
+    return false;
+  for (int i = 0; i < count; i++) {
+    std::string existing_path;
+    GetTablespace(i, existing_id, existing_path);
+    if (existing_id == tablespace_id)
+      return false;
+  }
+  memset(GetData() + offset, 0, TABLESPACE_RECORD_SIZE);
+  memcpy(GetData() + offset, &tablespace_id, 4);
+  memcpy(GetData() + offset + 4, path.c_str(), path.length() + 1);
+
+  SetTablespaceCount(count + 1);
+  return true;
+}
+
+bool HeaderPage::GetTablespaceId(const std::string &path, int &tablespace_id) {
+  int count = GetTablespaceCount();
+  for (int i = 0; i < count; i++) {
+    std::string existing_path;
+    GetTablespace(i, tablespace_id, existing_path);
+    if (existing_path == path)
+      return true;
+  }
+  return false;
+}
+
+void HeaderPage::GetTablespace(int index, int &tablespace_id,
+                               std::string &path) {
+  assert(index >= 0 && index < GetTablespaceCount());
+  int offset = TablespaceOffset(index);
+  memcpy(&tablespace_id, GetData() + offset, 4);
+  path = std::string(GetData() + offset + 4);
+}
+
+// 0 on a page from before tablespaces: never written that far down
+int HeaderPage::GetTablespaceCount() {
+  return *reinterpret_cast<int *>(GetData() + TablespaceOffset(-1));
+}
+
 /**
  * helper functions
  */
+int HeaderPage::TablespaceOffset(int index) {
+  return static_cast<int>(Page::GetPageSize()) - PAGE_CHECKSUM_SIZE - 4 -
+         (index + 1) * TABLESPACE_RECORD_SIZE;
+}
+
+void HeaderPage::SetTablespaceCount(int tablespace_count) {
+  memcpy(GetData() + TablespaceOffset(-1), &tablespace_count, 4);
+}
+
 // record count
 int HeaderPage::GetRecordCount() { return *reinterpret_cast<int *>(GetData()); }
 
@@ -83,11 +151,65 @@ void HeaderPage::SetRecordCount(int record_count) {
   memcpy(GetData(), &record_count, 4);
 }
 
+// database parameters
+size_t HeaderPage::GetPageSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + HEADER_PAGE_SIZE_OFFSET);
+}
+
+void HeaderPage::SetPageSize(size_t page_size) {
+  int32_t value = page_size;
+  memcpy(GetData() + HEADER_PAGE_SIZE_OFFSET, &value, 4);
+}
+
+size_t HeaderPage::GetPoolSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + HEADER_POOL_SIZE_OFFSET);
+}
+
+void HeaderPage::SetPoolSize(size_t pool_size) {
+  int32_t value = pool_size;
+  memcpy(GetData() + HEADER_POOL_SIZE_OFFSET, &value, 4);
+}
+
+// file format
+bool HeaderPage::IsSupportedFormat() {
+  int32_t magic, version;
+  memcpy(&magic, GetData() + HEADER_FORMAT_OFFSET, 4);
+  memcpy(&version, GetData() + HEADER_FORMAT_OFFSET + 4, 4);
+  return magic == HEADER_MAGIC && version == HEADER_FORMAT_VERSION;
+}
+
+void HeaderPage::SetFormat() {
+  int32_t magic = HEADER_MAGIC, version = HEADER_FORMAT_VERSION;
+  memcpy(GetData() + HEADER_FORMAT_OFFSET, &magic, 4);
+  memcpy(GetData() + HEADER_FORMAT_OFFSET + 4, &version, 4);
+}
+
+// master record
+void HeaderPage::GetMasterRecord(lsn_t &checkpoint_lsn,
+                                 int64_t &checkpoint_offset, lsn_t &redo_lsn,
+                                 int64_t &redo_offset) {
+  const char *data = GetData() + HEADER_MASTER_RECORD_OFFSET;
+  memcpy(&checkpoint_lsn, data, 4);
+  memcpy(&checkpoint_offset, data + 4, 8);
+  memcpy(&redo_lsn, data + 12, 4);
+  memcpy(&redo_offset, data + 16, 8);
+}
+
+void HeaderPage::SetMasterRecord(lsn_t checkpoint_lsn,
+                                 int64_t checkpoint_offset, lsn_t redo_lsn,
+                                 int64_t redo_offset) {
+  char *data = GetData() + HEADER_MASTER_RECORD_OFFSET;
+  memcpy(data, &checkpoint_lsn, 4);
+  memcpy(data + 4, &checkpoint_offset, 8);
+  memcpy(data + 12, &redo_lsn, 4);
+  memcpy(data + 16, &redo_offset, 8);
+}
+
 int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name = reinterpret_cast<char *>(GetData() + (RECORDS_OFFSET + i * RECORD_SIZE));
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
@@ -60,6 +60,7 @@
  * 
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include "page/table_page.h"
@@ -114,11 +115,9 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
   memcpy(GetData(), &page_id, 4); // set PageId
   
   if (ENABLE_LOGGING) {
-    // TODO: add your logging logic here
-
-    // 1. u() WAL 
-    LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT,
-          page_id_t prev_page_id)    
+    // 1. u() WAL, page n its link from prev page (caller sets it)
+    LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(),
+                        LogRecordType::NEWPAGE, page_id, prev_page_id);
     auto lsn = log_manager->AppendLogRecord(log_entry);
 
     // 2. u() TT lastest LSN
@@ -131,7 +130,8 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
 
   SetPrevPageId(prev_page_id);
   SetNextPageId(INVALID_PAGE_ID);
-  SetFreeSpacePointer(page_size);
+  // last bytes == checksum trailer, the disk manager's
+  SetFreeSpacePointer(page_size - PAGE_CHECKSUM_SIZE);
   SetTupleCount(0);
 }
 
@@ -200,11 +200,10 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
   
   // 3. u() 4 tables w updated rid 
   if (ENABLE_LOGGING) {
-    // TODO: add your logging logic here
-
-    // acquire the exclusive lock
-    // ?? 
-    assert(lock_manager->LockExclusive(txn, rid.Get()));
+    // acquire the exclusive lock, outside the assert == NDEBUG still locks
+    bool locked = lock_manager->LockExclusive(txn, rid);
+    assert(locked);
+    (void)locked;
     
     // u() WAL 
     LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(), 
@@ -280,8 +279,6 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
                !lock_manager->LockExclusive(txn, rid)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
-
     // u() WAL 
     Tuple tuple;
     GetTuple(rid, tuple, txn, lock_manager);
@@ -368,12 +365,10 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
       return false;
     }
 
-    // TODO: add your logging logic here
-
     // u() 4 tables 
     // rid doesnt change, still same slot
-    LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE,
-              rid, old_tuple, new_tuple);
+    LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(),
+                        LogRecordType::UPDATE, rid, old_tuple, new_tuple);
     auto lsn = log_manager->AppendLogRecord(log_entry);    
     txn->SetPrevLSN(lsn); // u() TT    
     SetLSN(lsn); // u() buffer pool PageLSN
@@ -453,11 +448,9 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // must already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
-    // TODO: add your logging logic here
-
     // u() 4 tables 
-    LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE,
-              rid, delete_tuple)
+    LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(),
+                        LogRecordType::APPLYDELETE, rid, delete_tuple);
     auto lsn = log_manager->AppendLogRecord(log_entry);    
     txn->SetPrevLSN(lsn); // u() TT    
     SetLSN(lsn); // u() buffer pool PageLSN
@@ -501,14 +494,22 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
                                LogManager *log_manager) {
   
-  // 1. log
+  // 1. r() bitmap (tuple's size)
+  int slot_num = rid.GetSlotNum();
+  assert(slot_num < GetTupleCount());
+  int32_t tuple_size = GetTupleSize(slot_num);
+
+  // 2. log
   if (ENABLE_LOGGING) {
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
 
-    // TODO: add your logging logic here
-
+    // tuple logged like MarkDelete's, recovery undoes it w a MarkDelete
+    Tuple tuple;
+    tuple.DeserializeFrom(GetData() + GetTupleOffset(slot_num),
+                          tuple_size < 0 ? -tuple_size : tuple_size);
+    tuple.rid_ = rid;
     LogRecord log_entry(txn->GetTransactionId(), txn->GetPrevLSN(), 
               LogRecordType::ROLLBACKDELETE, rid, tuple);    
     auto lsn = log_manager->AppendLogRecord(log_entry);    
@@ -517,11 +518,6 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
 
   }
 
-  // 2. r() bitmap (tuple's size)
-  int slot_num = rid.GetSlotNum();
-  assert(slot_num < GetTupleCount());
-  int32_t tuple_size = GetTupleSize(slot_num);
-
   // 3. u() bitmap only (no memcopy) 
   if (tuple_size < 0)
     SetTupleSize(slot_num, -tuple_size); // tuple size to +ve
@@ -576,6 +572,39 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
 }
 
 
+/*
+ * recovery only (redo INSERT, undo APPLYDELETE): tuple back into rid's
+ * slot, an empty 1 or a new 1 at the end (slots in between empty). no
+ * lock, no log
+ *
+ * InsertTuple picks the slot itself, redo has to land in the logged 1
+ */
+bool TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) {
+  int slot_num = rid.GetSlotNum();
+  int32_t tuple_count = GetTupleCount();
+  if (slot_num < tuple_count && GetTupleSize(slot_num) != 0) {
+    return false; // taken
+  }
+  int32_t new_slots = std::max(slot_num + 1 - tuple_count, 0);
+  if (GetFreeSpaceSize() < tuple.size_ + new_slots * 8) {
+    return false; // not enough space
+  }
+
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  for (int i = tuple_count; i < slot_num; ++i) {
+    SetTupleOffset(i, 0);
+    SetTupleSize(i, 0);
+  }
+  SetTupleOffset(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (new_slots > 0) {
+    SetTupleCount(slot_num + 1);
+  }
+  return true;
+}
+
+
 /**
  * Tuple iterator
  */
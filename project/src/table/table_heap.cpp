@@ -18,21 +18,24 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
                      page_id_t first_page_id)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager), first_page_id_(first_page_id) {}
+      log_manager_(log_manager), first_page_id_(first_page_id),
+      extent_(OBJECT_EXTENT_PAGES, DiskManager::GetTablespaceId(first_page_id)) {}
 
 // create table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, int tablespace_id)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager), extent_(OBJECT_EXTENT_PAGES, tablespace_id) {
   auto first_page =
-      static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
+      static_cast<TablePage *>(buffer_pool_manager_->NewPage(
+          first_page_id_, INVALID_PAGE_ID, &extent_));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  first_page->Init(first_page_id_, buffer_pool_manager_->GetPageSize(),
+                   INVALID_LSN, log_manager_, txn);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
@@ -51,7 +54,9 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
   
   
   // 0. must be within tuple size 
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  // larger than one page size
+  if (static_cast<size_t>(tuple.size_) + 32 + PAGE_CHECKSUM_SIZE >
+      buffer_pool_manager_->GetPageSize()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
@@ -92,8 +97,10 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
     
     // 2nd page doesnt exist yet, create new page as next page 
     } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
+      // from the heap's own extent == chain stays sequential on disk, even
+      // w other tables / indexes growing at the same time
+      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(
+          next_page_id, cur_page->GetPageId(), &extent_));
       if (new_page == nullptr) {
         cur_page->WUnlatch();
         buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
@@ -107,8 +114,12 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
 
       // new page == next page 
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
+      new_page->Init(next_page_id, buffer_pool_manager_->GetPageSize(),
+                     cur_page->GetPageId(), log_manager_, txn);
+      if (ENABLE_LOGGING) {
+        // link is redone w the NEWPAGE record == not on disk before it
+        cur_page->SetLSN(new_page->GetLSN());
+      }
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
       cur_page = new_page;
@@ -221,9 +232,10 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 
 
 // called by tuple iterator
-bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                         BufferAccessStrategy *strategy) {
   auto page = static_cast<TablePage *>(
-      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+      buffer_pool_manager_->FetchPage(rid.GetPageId(), strategy));
   if (page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
@@ -231,14 +243,33 @@ bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
   page->RLatch();
   bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
   page->RUnlatch();
-  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false, strategy);
   return res;
 }
 
 
 
+/**
+ * every page of the chain back to the disk manager, reused after the next
+ * full flush. false == a page is pinned / can't be fetched, pages before it
+ * are gone already
+ */
 bool TableHeap::DeleteTableHeap() {
-  // todo: real delete
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return false;
+    page->RLatch();
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    // resident n unpinned right after the fetch
+    if (!buffer_pool_manager_->DeletePage(page_id))
+      return false;
+    first_page_id_ = page_id = next_page_id;
+  }
   return true;
 }
 
@@ -254,17 +285,18 @@ bool TableHeap::DeleteTableHeap() {
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
-TableIterator TableHeap::begin(Transaction *txn) {
-  auto page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+TableIterator TableHeap::begin(Transaction *txn,
+                               BufferAccessStrategy *strategy) {
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(first_page_id_, strategy));
   page->RLatch();
   RID rid;
   // if failed (no tuple), rid will be the result of default
   // constructor, which means eof
   page->GetFirstTupleRid(rid);
   page->RUnlatch();
-  buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  buffer_pool_manager_->UnpinPage(first_page_id_, false, strategy);
+  return TableIterator(this, rid, txn, strategy);
 }
 
 TableIterator TableHeap::end() {
@@ -1,17 +1,38 @@
 /**
  * table_iterator.cpp
+ * 
+ * read-ahead: the iterator keeps the next readahead_window_ pages of the
+ * chain in flight (BufferPoolManager::PrefetchPage). A page's next id is only
+ * known once it is read, so the chain is extended through pages already read,
+ * never waiting for one still in flight.
+ * 
+ * window adapts to how fast the scan consumes pages:
+ * - next page still being read when the scan gets there == x2
+ * - next page read but gone again (evicted / dropped) == /2
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include "table/table_heap.h"
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             BufferAccessStrategy *strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      strategy_(strategy) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
+
+    // start read-ahead from the 1st page
+    BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+    auto page = static_cast<TablePage *>(
+        buffer_pool_manager->FetchPage(rid.GetPageId(), strategy_));
+    if (page != nullptr) {
+      ReadAhead(page);
+      buffer_pool_manager->UnpinPage(rid.GetPageId(), false, strategy_);
+    }
   }
 };
 
@@ -41,7 +62,7 @@ TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   
   auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId(), strategy_));
   
   cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
@@ -50,10 +71,9 @@ TableIterator &TableIterator::operator++() {
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+      auto next_page = FetchNextPage(cur_page->GetNextPageId());
       cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false, strategy_);
       cur_page = next_page;
       cur_page->RLatch();
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
@@ -63,11 +83,11 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, strategy_);
   }
   // release until copy the tuple
   cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+  buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false, strategy_);
   return *this;
 }
 
@@ -79,4 +99,87 @@ TableIterator TableIterator::operator++(int) {
   return clone;
 }
 
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+// next page of the chain, from read-ahead if it made it in time
+TablePage *TableIterator::FetchNextPage(page_id_t page_id) {
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+
+  Page *page = nullptr;
+  if (!readahead_.empty() && readahead_.front() == page_id) {
+    readahead_.pop_front();
+    bool in_flight = false;
+    page = buffer_pool_manager->FetchPageIfLoaded(page_id, strategy_,
+                                                  &in_flight);
+    if (page == nullptr && in_flight) {
+      readahead_window_ =
+          std::min(readahead_window_ * 2, MaxReadAheadWindow());
+    } else if (page == nullptr) {
+      readahead_window_ = std::max<size_t>(readahead_window_ / 2, 1);
+    }
+  } else {
+    readahead_.clear(); // chain changed under us, start over from here
+  }
+
+  if (page == nullptr) {
+    page = buffer_pool_manager->FetchPage(page_id, strategy_);
+  }
+  if (page != nullptr) {
+    ReadAhead(static_cast<TablePage *>(page));
+  }
+  return static_cast<TablePage *>(page);
+}
+
+
+// page == pinned current page, issue prefetches up to window pages past it
+void TableIterator::ReadAhead(TablePage *page) {
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  size_t window = std::min(readahead_window_, MaxReadAheadWindow());
+
+  while (readahead_.size() < window) {
+    TablePage *tail = page;
+    if (!readahead_.empty()) {
+      tail = static_cast<TablePage *>(buffer_pool_manager->FetchPageIfLoaded(
+          readahead_.back(), strategy_));
+      if (tail == nullptr) {
+        break; // still in flight, extend on a later page
+      }
+    }
+    tail->RLatch();
+    page_id_t next_page_id = tail->GetNextPageId();
+    tail->RUnlatch();
+    if (tail != page) {
+      buffer_pool_manager->UnpinPage(tail->GetPageId(), false, strategy_);
+    }
+    if (next_page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    buffer_pool_manager->PrefetchPage(next_page_id, strategy_);
+    readahead_.push_back(next_page_id);
+  }
+}
+
+
+// ring: current page + page being fetched need a slot besides the window
+// shared pool: at most a quarter of it
+size_t TableIterator::MaxReadAheadWindow() {
+  if (strategy_ != nullptr) {
+    size_t ring_size = strategy_->GetRingSize();
+    return ring_size > 2 ? std::min<size_t>(READAHEAD_MAX_WINDOW, ring_size - 2)
+                         : 0;
+  }
+  return std::min<size_t>(READAHEAD_MAX_WINDOW,
+                          table_heap_->buffer_pool_manager_->GetPoolSize() / 4);
+}
+
 } // namespace cmudb
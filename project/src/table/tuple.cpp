@@ -81,6 +81,15 @@ void Tuple::DeserializeFrom(const char *storage) {
   this->allocated_ = true;
 }
 
+void Tuple::DeserializeFrom(const char *data, int32_t size) {
+  if (allocated_)
+    delete[] data_;
+  size_ = size;
+  data_ = new char[size_];
+  memcpy(data_, data, size_);
+  allocated_ = true;
+}
+
 
 
 // Copy constructor
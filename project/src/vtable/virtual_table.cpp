@@ -2,6 +2,7 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sys/stat.h>
@@ -9,6 +10,7 @@
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "common/string_utility.h"
 #include "page/header_page.h"
 #include "vtable/virtual_table.h"
@@ -28,9 +30,185 @@ SQLITE_EXTENSION_INIT1
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
+/* storage engine setup */
+
+// storage engine on db_file_name, header page created if the file is new.
+// read_only == only if the file exists already
+static void OpenStorageEngine(const std::string &db_file_name,
+                              size_t page_size = PAGE_SIZE,
+                              size_t pool_size = 0, bool read_only = false,
+                              const std::string &log_file_name = "",
+                              bool compress = false) {
+  struct stat buffer;
+  bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
+
+  // init storage engine
+  storage_engine_ = new StorageEngine(db_file_name, page_size, pool_size,
+                                      read_only && is_file_exist,
+                                      log_file_name, compress);
+  // start the logging, existing log recovered by now. read-only == no log
+  if (storage_engine_->log_manager_ != nullptr)
+    storage_engine_->log_manager_->RunFlushThread();
+  // create header page from BufferPoolManager if necessary
+  if (!is_file_exist) {
+    page_id_t header_page_id;
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
+
+    assert(header_page_id == HEADER_PAGE_ID);
+    // page size n pool size persisted for next open
+    header_page->Init(storage_engine_->pool_size_);
+    storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  }
+  // header page there now, master record goes in it
+  if (storage_engine_->checkpoint_manager_ != nullptr) {
+    storage_engine_->checkpoint_manager_->RunCheckpointThread();
+  }
+}
+
+// module args after the schema: 'page_size=N', 'pool_size=N',
+// 'tablespace=path', 'index_tablespace=path' and at most 1 index definition,
+// in any order. 0 / "" == not given
+static int ParseModuleArgs(int argc, const char *const *argv,
+                           std::string &index_string, size_t &page_size,
+                           size_t &pool_size, std::string &tablespace,
+                           std::string &index_tablespace, char **pzErr) {
+  for (int i = 4; i < argc; i++) {
+    std::string arg(argv[i]);
+    // remove the very first and last character if quoted
+    if (arg.size() >= 2 && (arg[0] == '\'' || arg[0] == '"'))
+      arg = arg.substr(1, (arg.size() - 2));
+
+    std::string::size_type n = arg.find('=');
+    std::string key = arg.substr(0, n);
+    StringUtility::Trim(key);
+    if (n == std::string::npos ||
+        (key != "page_size" && key != "pool_size" && key != "tablespace" &&
+         key != "index_tablespace")) {
+      index_string = arg;
+      continue;
+    }
+    std::string value = arg.substr(n + 1);
+    StringUtility::Trim(value);
+    if (key == "tablespace" || key == "index_tablespace") {
+      if (value.empty() || value.size() >= TABLESPACE_RECORD_SIZE - 4) {
+        *pzErr = sqlite3_mprintf("invalid %s '%s'", key.c_str(),
+                                 value.c_str());
+        return SQLITE_ERROR;
+      }
+      (key == "tablespace" ? tablespace : index_tablespace) = value;
+      continue;
+    }
+    char *end = nullptr;
+    unsigned long number = strtoul(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || number == 0) {
+      *pzErr = sqlite3_mprintf("invalid %s '%s'", key.c_str(), value.c_str());
+      return SQLITE_ERROR;
+    }
+    if (key == "page_size") {
+      if (number < MIN_PAGE_SIZE || number > MAX_PAGE_SIZE ||
+          (number & (number - 1)) != 0) {
+        *pzErr = sqlite3_mprintf("page_size must be a power of 2 in [%d, %d]",
+                                 MIN_PAGE_SIZE, MAX_PAGE_SIZE);
+        return SQLITE_ERROR;
+      }
+      page_size = number;
+    } else {
+      pool_size = number;
+    }
+  }
+  return SQLITE_OK;
+}
+
+// page size can only change while there is nothing stored in the database,
+// pool size any time, on a database w tables it applies from the next open
+static int ConfigureStorageEngine(size_t page_size, size_t pool_size,
+                                  char **pzErr) {
+  if (page_size == 0)
+    page_size = storage_engine_->page_size_;
+  if (pool_size == 0)
+    pool_size = storage_engine_->pool_size_;
+  if (page_size == storage_engine_->page_size_ &&
+      pool_size == storage_engine_->pool_size_)
+    return SQLITE_OK;
+
+  BufferPoolManager *buffer_pool_manager =
+      storage_engine_->buffer_pool_manager_;
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  if (header_page->GetRecordCount() > 0) {
+    if (page_size != storage_engine_->page_size_) {
+      buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+      *pzErr = sqlite3_mprintf("page_size is fixed at %d once tables exist",
+                               static_cast<int>(storage_engine_->page_size_));
+      return SQLITE_ERROR;
+    }
+    header_page->SetPoolSize(pool_size);
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, true);
+    return SQLITE_OK;
+  }
+  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+
+  // empty database == start the files over w the new sizes. log, free
+  // space map n slot map go too, they describe the old file
+  std::string db_file_name = storage_engine_->db_file_name_;
+  std::string log_file_name = storage_engine_->log_file_name_;
+  bool compress = storage_engine_->compress_;
+  delete storage_engine_;
+  DiskManager::RemoveFiles(db_file_name, log_file_name);
+  OpenStorageEngine(db_file_name, page_size, pool_size, false, log_file_name,
+                    compress);
+  return SQLITE_OK;
+}
+
+// id of the tablespace at path, "" == the db file. create == opened n
+// recorded in the header page if new. -1 == can't
+static int GetTablespace(HeaderPage *header_page, const std::string &path,
+                         bool create) {
+  int tablespace_id = 0;
+  if (path.empty() || header_page->GetTablespaceId(path, tablespace_id))
+    return tablespace_id;
+  if (!create)
+    return -1;
+  tablespace_id = storage_engine_->disk_manager_->CreateTablespace(path);
+  if (tablespace_id < 0 ||
+      !header_page->InsertTablespace(tablespace_id, path))
+    return -1;
+  return tablespace_id;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
 /* API implementation */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                sqlite3_vtab **ppVtab, char **pzErr) {
+  // the first three parameter:(1) module name (2) database name (3)table name
+  assert(argc >= 4);
+  if (storage_engine_->read_only_) {
+    *pzErr = sqlite3_mprintf("vtable.db is open read-only");
+    return SQLITE_READONLY;
+  }
+  // parse arg[4..](index definition, storage options)
+  std::string index_string;
+  size_t page_size = 0;
+  size_t pool_size = 0;
+  std::string tablespace, index_tablespace;
+  int rc = ParseModuleArgs(argc, argv, index_string, page_size, pool_size,
+                           tablespace, index_tablespace, pzErr);
+  if (rc == SQLITE_OK)
+    rc = ConfigureStorageEngine(page_size, pool_size, pzErr);
+  if (rc != SQLITE_OK)
+    return rc;
+
   BufferPoolManager *buffer_pool_manager =
       storage_engine_->buffer_pool_manager_;
   LockManager *lock_manager = storage_engine_->lock_manager_;
@@ -40,26 +218,35 @@ int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   HeaderPage *header_page =
       static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
 
-  // the first three parameter:(1) module name (2) database name (3)table name
-  assert(argc >= 4);
+  // placement, recorded in the header page w the roots
+  int tablespace_id = GetTablespace(header_page, tablespace, true);
+  int index_tablespace_id = GetTablespace(header_page, index_tablespace, true);
+  if (tablespace_id < 0 || index_tablespace_id < 0) {
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, true);
+    *pzErr = sqlite3_mprintf("can't open tablespace '%s'",
+                             tablespace_id < 0 ? tablespace.c_str()
+                                               : index_tablespace.c_str());
+    return SQLITE_CANTOPEN;
+  }
+
   // parse arg[3](string that defines table schema)
   std::string schema_string(argv[3]);
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
   Schema *schema = ParseCreateStatement(schema_string);
 
-  // parse arg[4](string that defines table index)
+  // index definition, if any
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  if (!index_string.empty()) {
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    index = ConstructIndex(index_metadata, buffer_pool_manager);
+    index = ConstructIndex(index_metadata, buffer_pool_manager,
+                           INVALID_PAGE_ID, index_tablespace_id);
   }
   // create table object, allocate memory space
-  VirtualTable *table = new VirtualTable(schema, buffer_pool_manager,
-                                         lock_manager, log_manager, index);
+  VirtualTable *table =
+      new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
+                       index, INVALID_PAGE_ID, tablespace_id);
 
   // insert table root page info into header page
   header_page->InsertRecord(std::string(argv[2]), table->GetFirstPageId());
@@ -98,23 +285,42 @@ int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   LockManager *lock_manager = storage_engine_->lock_manager_;
   LogManager *log_manager = storage_engine_->log_manager_;
 
+  // parse arg[4..], storage options were applied by VtabCreate already
+  std::string index_string;
+  size_t page_size = 0;
+  size_t pool_size = 0;
+  std::string tablespace, index_tablespace;
+  if (ParseModuleArgs(argc, argv, index_string, page_size, pool_size,
+                      tablespace, index_tablespace, pzErr) != SQLITE_OK) {
+    delete schema;
+    return SQLITE_ERROR;
+  }
+
   // Retrieve table root page info from header page
   HeaderPage *header_page =
       static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
   page_id_t table_root_id;
   header_page->GetRootId(std::string(argv[2]), table_root_id);
-  // parse arg[4](string that defines table index)
+  // an index w/o a root yet still needs its tablespace, opened on startup
+  int index_tablespace_id = GetTablespace(header_page, index_tablespace, false);
+  if (index_tablespace_id < 0) {
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+    delete schema;
+    *pzErr = sqlite3_mprintf("unknown tablespace '%s'",
+                             index_tablespace.c_str());
+    return SQLITE_CANTOPEN;
+  }
+  // index definition, if any
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  if (!index_string.empty()) {
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
     // Retrieve index root page info from header page
     page_id_t index_root_id;
     header_page->GetRootId(index_metadata->GetName(), index_root_id);
-    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id);
+    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id,
+                           index_tablespace_id);
   }
   VirtualTable *table =
       new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
@@ -191,6 +397,8 @@ int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
 int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
                sqlite_int64 *pRowid) {
   // LOG_DEBUG("VtabUpdate");
+  if (storage_engine_->read_only_)
+    return SQLITE_READONLY;
   VirtualTable *table = reinterpret_cast<VirtualTable *>(pVTab);
   // The single row with rowid equal to argv[0] is deleted
   if (argc == 1) {
@@ -323,6 +531,9 @@ int VtabFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum, const char *idxStr,
     key_schema = cursor->GetKeySchema();
     Tuple scan_tuple = ConstructTuple(key_schema, argv);
     cursor->ScanKey(scan_tuple);
+  } else {
+    cursor->SetScanFlag(false);
+    cursor->BeginScan();
   }
   return SQLITE_OK;
 }
@@ -416,30 +627,208 @@ sqlite3_module VtableModule = {
     0,              /* xRollbackTo */
 };
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * metrics tables, read only, over MetricsRegistry (common/metrics.h)
+ *
+ * eponymous only (no xCreate) == exist as soon as the extension is loaded:
+ *   SELECT * FROM metrics_counters;
+ *   SELECT name, p99_us FROM metrics_histograms WHERE count > 0;
+ * values are read when a scan starts (xFilter), each scan sees them live
+ */
+
+struct MetricsTableInfo {
+  const char *schema_;
+  bool histograms_;
+};
+
+static MetricsTableInfo metrics_counters_table = {
+    "CREATE TABLE x(name TEXT, value INTEGER)", false};
+static MetricsTableInfo metrics_histograms_table = {
+    "CREATE TABLE x(name TEXT, count INTEGER, sum_us INTEGER, avg_us INTEGER, "
+    "p50_us INTEGER, p90_us INTEGER, p99_us INTEGER)",
+    true};
+
+struct MetricsTable {
+  sqlite3_vtab base_; /* Base class - must be first */
+  bool histograms_;
+};
+
+struct MetricsCursor {
+  sqlite3_vtab_cursor base_; /* Base class - must be first */
+  // snapshot, 1 row == name + integer columns
+  std::vector<std::pair<std::string, std::vector<sqlite3_int64>>> rows_;
+  size_t row_;
+};
+
+static int MetricsConnect(sqlite3 *db, void *pAux,
+                          __attribute__((unused)) int argc,
+                          __attribute__((unused)) const char *const *argv,
+                          sqlite3_vtab **ppVtab,
+                          __attribute__((unused)) char **pzErr) {
+  MetricsTableInfo *info = reinterpret_cast<MetricsTableInfo *>(pAux);
+  int rc = sqlite3_declare_vtab(db, info->schema_);
+  if (rc != SQLITE_OK) {
+    return rc;
+  }
+  MetricsTable *table = new MetricsTable();
+  table->histograms_ = info->histograms_;
+  *ppVtab = &table->base_;
+  return SQLITE_OK;
+}
+
+static int MetricsDisconnect(sqlite3_vtab *pVtab) {
+  delete reinterpret_cast<MetricsTable *>(pVtab);
+  return SQLITE_OK;
+}
+
+// no index, full scan of a few dozen rows
+static int MetricsBestIndex(__attribute__((unused)) sqlite3_vtab *tab,
+                            sqlite3_index_info *pIdxInfo) {
+  pIdxInfo->estimatedCost = 100;
+  return SQLITE_OK;
+}
+
+static int MetricsOpen(__attribute__((unused)) sqlite3_vtab *pVtab,
+                       sqlite3_vtab_cursor **ppCursor) {
+  MetricsCursor *cursor = new MetricsCursor();
+  cursor->row_ = 0;
+  *ppCursor = &cursor->base_;
+  return SQLITE_OK;
+}
+
+static int MetricsClose(sqlite3_vtab_cursor *cur) {
+  delete reinterpret_cast<MetricsCursor *>(cur);
+  return SQLITE_OK;
+}
+
+static int MetricsFilter(sqlite3_vtab_cursor *pVtabCursor,
+                         __attribute__((unused)) int idxNum,
+                         __attribute__((unused)) const char *idxStr,
+                         __attribute__((unused)) int argc,
+                         __attribute__((unused)) sqlite3_value **argv) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(pVtabCursor);
+  MetricsTable *table = reinterpret_cast<MetricsTable *>(pVtabCursor->pVtab);
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  cursor->rows_.clear();
+  cursor->row_ = 0;
+
+  if (!table->histograms_) {
+    for (auto &counter : registry.SnapshotCounters()) {
+      cursor->rows_.emplace_back(
+          counter.first,
+          std::vector<sqlite3_int64>{
+              static_cast<sqlite3_int64>(counter.second)});
+    }
+    return SQLITE_OK;
+  }
+  for (auto &histogram : registry.GetHistograms()) {
+    const MetricHistogram *h = histogram.second;
+    sqlite3_int64 count = h->GetCount();
+    sqlite3_int64 sum = h->GetSum();
+    cursor->rows_.emplace_back(
+        histogram.first,
+        std::vector<sqlite3_int64>{
+            count, sum, count == 0 ? 0 : sum / count,
+            static_cast<sqlite3_int64>(h->GetPercentile(0.5)),
+            static_cast<sqlite3_int64>(h->GetPercentile(0.9)),
+            static_cast<sqlite3_int64>(h->GetPercentile(0.99))});
+  }
+  return SQLITE_OK;
+}
+
+static int MetricsNext(sqlite3_vtab_cursor *cur) {
+  reinterpret_cast<MetricsCursor *>(cur)->row_++;
+  return SQLITE_OK;
+}
+
+static int MetricsEof(sqlite3_vtab_cursor *cur) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(cur);
+  return cursor->row_ >= cursor->rows_.size();
+}
+
+static int MetricsColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx,
+                         int i) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(cur);
+  auto &row = cursor->rows_[cursor->row_];
+  if (i == 0) {
+    sqlite3_result_text(ctx, row.first.c_str(), -1, SQLITE_TRANSIENT);
+  } else {
+    sqlite3_result_int64(ctx, row.second[i - 1]);
+  }
+  return SQLITE_OK;
+}
+
+static int MetricsRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
+  *pRowid = reinterpret_cast<MetricsCursor *>(cur)->row_;
+  return SQLITE_OK;
+}
+
+sqlite3_module MetricsModule = {
+    0,                 /* iVersion */
+    0,                 /* xCreate - eponymous only */
+    MetricsConnect,    /* xConnect */
+    MetricsBestIndex,  /* xBestIndex */
+    MetricsDisconnect, /* xDisconnect */
+    MetricsDisconnect, /* xDestroy */
+    MetricsOpen,       /* xOpen - open a cursor */
+    MetricsClose,      /* xClose - close a cursor */
+    MetricsFilter,     /* xFilter - snapshot the registry */
+    MetricsNext,       /* xNext - advance a cursor */
+    MetricsEof,        /* xEof - check for end of scan */
+    MetricsColumn,     /* xColumn - read data */
+    MetricsRowid,      /* xRowid - read data */
+    0,                 /* xUpdate - read only */
+    0,                 /* xBegin */
+    0,                 /* xSync */
+    0,                 /* xCommit */
+    0,                 /* xRollback */
+    0,                 /* xFindMethod */
+    0,                 /* xRename */
+    0,                 /* xSavepoint */
+    0,                 /* xRelease */
+    0,                 /* xRollbackTo */
+};
+
 #ifdef _WIN32
 __declspec(dllexport)
 #endif
     extern "C" int sqlite3_vtable_init(sqlite3 *db, char **pzErrMsg,
                                        const sqlite3_api_routines *pApi) {
   SQLITE_EXTENSION_INIT2(pApi);
-  std::string db_file_name = "vtable.db";
-  struct stat buffer;
-  bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
-
-  // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
-  // start the logging
-  storage_engine_->log_manager_->RunFlushThread();
-  // create header page from BufferPoolManager if necessary
-  if (!is_file_exist) {
-    page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
-
-    assert(header_page_id == HEADER_PAGE_ID);
-    storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  // sizes of an existing vtable.db come from its header page.
+  // VTABLE_READ_ONLY set == replica, served from a read-only mapping.
+  // VTABLE_LOG_FILE == log somewhere else, e.g. a volume of its own.
+  // VTABLE_COMPRESS set == a new vtable.db stores its pages compressed
+  // vtable.db of another format == refused, nothing registered
+  const char *log_file_name = getenv("VTABLE_LOG_FILE");
+  try {
+    OpenStorageEngine("vtable.db", PAGE_SIZE, 0,
+                      getenv("VTABLE_READ_ONLY") != nullptr,
+                      log_file_name != nullptr ? log_file_name : "",
+                      getenv("VTABLE_COMPRESS") != nullptr);
+  } catch (Exception &e) {
+    *pzErrMsg = sqlite3_mprintf("%s", e.what());
+    return SQLITE_ERROR;
   }
 
   int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_create_module(db, "metrics_counters", &MetricsModule,
+                               &metrics_counters_table);
+  }
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_create_module(db, "metrics_histograms", &MetricsModule,
+                               &metrics_histograms_table);
+  }
   return rc;
 }
 
@@ -575,7 +964,7 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
 // serve the functionality of index factory
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id) {
+                      page_id_t root_id, int tablespace_id) {
   // The size of the key in bytes
   Schema *key_schema = metadata->GetKeySchema();
   int key_size = key_schema->GetLength();
@@ -584,19 +973,19 @@ Index *ConstructIndex(IndexMetadata *metadata,
 
   if (key_size <= 4) {
     return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, tablespace_id);
   } else if (key_size <= 8) {
     return new BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, tablespace_id);
   } else if (key_size <= 16) {
     return new BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, tablespace_id);
   } else if (key_size <= 32) {
     return new BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, tablespace_id);
   } else {
     return new BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>(
-        metadata, buffer_pool_manager, root_id);
+        metadata, buffer_pool_manager, root_id, tablespace_id);
   }
 }
 
@@ -0,0 +1,114 @@
+/**
+ * buffer_access_strategy_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// 30 cold pages on disk, then 6 hot pages resident in a 10 frame pool
+static void SetupPool(BufferPoolManager &bpm, std::vector<page_id_t> &scan,
+                      std::vector<page_id_t> &hot) {
+  page_id_t page_id;
+  for (int i = 0; i < 30; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "scan %d", i);
+    bpm.UnpinPage(page_id, true);
+    scan.push_back(page_id);
+  }
+  for (int i = 0; i < 6; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "hot %d", i);
+    bpm.UnpinPage(page_id, true);
+    hot.push_back(page_id);
+  }
+}
+
+TEST(BufferAccessStrategyTest, SampleTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  std::vector<page_id_t> scan, hot;
+  SetupPool(bpm, scan, hot);
+
+  {
+    BufferAccessStrategy strategy(4);
+    for (size_t i = 0; i < scan.size(); ++i) {
+      Page *page = bpm.FetchPage(scan[i], &strategy);
+      ASSERT_NE(nullptr, page);
+      char expected[32];
+      snprintf(expected, sizeof(expected), "scan %zu", i);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      EXPECT_EQ(true, bpm.UnpinPage(scan[i], false, &strategy));
+    }
+    // ring frames are private: 6 pinned hot + 4 ring == no frame to evict
+    page_id_t page_id;
+    for (page_id_t hot_id : hot) {
+      EXPECT_NE(nullptr, bpm.FetchPage(hot_id));
+    }
+    EXPECT_EQ(nullptr, bpm.NewPage(page_id));
+    for (page_id_t hot_id : hot) {
+      EXPECT_EQ(true, bpm.UnpinPage(hot_id, false));
+    }
+  }
+
+  // scan never touched the hot pages == still resident (delete needs RAM)
+  for (page_id_t page_id : hot) {
+    EXPECT_EQ(true, bpm.DeletePage(page_id));
+  }
+  // ring handed back to the free list, scanned pages gone
+  EXPECT_EQ(false, bpm.FlushPage(scan.back()));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferAccessStrategyTest, WithoutStrategyTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  std::vector<page_id_t> scan, hot;
+  SetupPool(bpm, scan, hot);
+
+  // plain fetch == one scan wipes the pool
+  for (page_id_t page_id : scan) {
+    ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+    bpm.UnpinPage(page_id, false);
+  }
+  for (page_id_t page_id : hot) {
+    EXPECT_EQ(false, bpm.DeletePage(page_id));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferAccessStrategyTest, PromoteTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  std::vector<page_id_t> scan, hot;
+  SetupPool(bpm, scan, hot);
+
+  BufferAccessStrategy strategy(2);
+  ASSERT_NE(nullptr, bpm.FetchPage(scan[0], &strategy));
+  // someone else uses the scanned page too, last unpin promotes it
+  ASSERT_NE(nullptr, bpm.FetchPage(scan[0]));
+  EXPECT_EQ(true, bpm.UnpinPage(scan[0], false, &strategy));
+  EXPECT_EQ(true, bpm.UnpinPage(scan[0], false));
+
+  // ring slot 0 is not ours anymore, recycling must not steal it
+  for (size_t i = 1; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm.FetchPage(scan[i], &strategy));
+    EXPECT_EQ(true, bpm.UnpinPage(scan[i], false, &strategy));
+  }
+  EXPECT_EQ(true, bpm.DeletePage(scan[0]));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
@@ -2,9 +2,20 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/metrics.h"
+#include "page/header_page.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
@@ -48,4 +59,408 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+// deleted page ids come back after a full flush, near the hint
+TEST(BufferPoolManagerTest, DeletePageReuseTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  EXPECT_EQ(true, bpm->DeletePage(1));
+  EXPECT_EQ(true, bpm->DeletePage(4));
+  ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(6, page_id); // not durably unlinked yet
+  bpm->UnpinPage(page_id, true);
+
+  bpm->FlushAllPages();
+  ASSERT_NE(nullptr, bpm->NewPage(page_id, 3));
+  EXPECT_EQ(4, page_id);
+  ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(1, page_id);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+TEST(BufferPoolManagerTest, PageSizeTest) {
+  page_id_t temp_page_id;
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db", 4096);
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(4096, bpm->GetPageSize());
+
+  // header page records the page size for the next open
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(temp_page_id));
+  ASSERT_NE(nullptr, header_page);
+  header_page->Init(4);
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+
+  // whole 4096 bytes up to the checksum trailer survive eviction
+  for (int i = 1; i < 9; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(4096, page->GetPageSize());
+    memset(page->GetData() + 8, 'a' + i, 4096 - 8 - PAGE_CHECKSUM_SIZE);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  for (int i = 1; i < 9; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ('a' + i, page->GetData()[8]);
+    EXPECT_EQ('a' + i, page->GetData()[4095 - PAGE_CHECKSUM_SIZE]);
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  // header page was evicted, i.e. written back, long ago
+  delete bpm;
+  delete disk_manager;
+
+  // reopen w the default: page size comes from the file
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(4096, disk_manager->GetPageSize());
+  bpm = new BufferPoolManager(4, disk_manager);
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  ASSERT_NE(nullptr, header_page);
+  EXPECT_EQ(4096, header_page->GetPageSize());
+  EXPECT_EQ(4, header_page->GetPoolSize());
+  auto page = bpm->FetchPage(8);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ('a' + 8, page->GetData()[4095 - PAGE_CHECKSUM_SIZE]);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// num_threads fetch / unpin num_pages hot pages fetches times each, all
+// hits. @return seconds taken
+static double FetchHotPages(BufferPoolManager *bpm, int num_pages,
+                            int num_threads, int fetches) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([bpm, tid, num_pages, fetches]() {
+      for (int i = 0; i < fetches; ++i) {
+        page_id_t page_id = (i + tid) % num_pages;
+        Page *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        ASSERT_EQ(page_id, page->GetPageId());
+        bpm->UnpinPage(page_id, false);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// hits on pinned pages never touch the latch: many threads fetch / unpin the
+// same hot pages, pin counts must come back exactly
+TEST(BufferPoolManagerTest, ConcurrentFetchHitTest) {
+  const int num_pages = 8;
+  page_id_t temp_page_id;
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+  // stay pinned, every fetch below is a hit on an already pinned page
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  }
+
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    FetchHotPages(bpm, num_pages, num_threads, 100000);
+  }
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(1, bpm->FetchPage(i)->GetPinCount() - 1);
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// same workload, prints hits/sec at 1 - 8 threads. benchmark == not in the
+// default run, no timing asserted: --gtest_also_run_disabled_tests
+TEST(BufferPoolManagerTest, DISABLED_ConcurrentFetchHitBenchmark) {
+  const int num_pages = 8;
+  const int fetches_per_thread = 1000000;
+  page_id_t temp_page_id;
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  }
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    double seconds =
+        FetchHotPages(bpm, num_pages, num_threads, fetches_per_thread);
+    printf("%d threads: %.1f Mhits/s\n", num_threads,
+           num_threads * fetches_per_thread / seconds / 1e6);
+  }
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// pool much smaller than the pages in use: frames are evicted n reused
+// while other threads still hold stale page table lookups of them. a fetch
+// must never return a frame holding another page, or 1 still being read
+TEST(BufferPoolManagerTest, FrameReuseStressTest) {
+  const int num_pages = 16;
+  const int num_threads = 8;
+  const int fetches_per_thread = 20000;
+  page_id_t temp_page_id;
+  remove("test.db");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  std::atomic<int> fetched{0}, wrong_pages{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&, tid]() {
+      std::mt19937 rng(tid);
+      char expected[32];
+      for (int i = 0; i < fetches_per_thread; ++i) {
+        // few hot pages == hits on pinned frames (lock free) mixed w misses
+        page_id_t page_id = rng() % 4 == 0 ? rng() % num_pages : rng() % 3;
+        Page *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue; // every frame pinned right now
+        }
+        snprintf(expected, sizeof(expected), "page %d", page_id);
+        if (page->GetPageId() != page_id ||
+            strcmp(expected, page->GetData()) != 0) {
+          ++wrong_pages;
+        }
+        ++fetched;
+        bpm->UnpinPage(page_id, false);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, wrong_pages);
+  EXPECT_LT(0, fetched);
+  // every pin given back == every frame evictable
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(1, bpm->FetchPage(i)->GetPinCount() - 1);
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// recLSN == next lsn when the pin that dirtied it began, kept till written.
+// pinned pages listed too, they may be changed right now
+TEST(BufferPoolManagerTest, DirtyPageTableTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  auto append = [log_manager](int n) {
+    for (int i = 0; i < n; ++i) {
+      LogRecord log_record(0, INVALID_LSN, LogRecordType::COMMIT);
+      log_manager->AppendLogRecord(log_record);
+    }
+  };
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table;
+  auto get_dirty_page_table = [&]() {
+    dirty_page_table.clear();
+    bpm->GetDirtyPageTable(dirty_page_table);
+    return dirty_page_table;
+  };
+
+  // pinned at 5, dirty at 8 == recLSN 5
+  append(5);
+  page_id_t page_id_0, page_id_1;
+  ASSERT_NE(nullptr, bpm->NewPage(page_id_0));
+  EXPECT_EQ((std::unordered_map<page_id_t, lsn_t>{{page_id_0, 5}}),
+            get_dirty_page_table());
+  append(3);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_0, true));
+  ASSERT_NE(nullptr, bpm->NewPage(page_id_1));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_1, false));
+  EXPECT_EQ((std::unordered_map<page_id_t, lsn_t>{{page_id_0, 5}}),
+            get_dirty_page_table());
+
+  // dirty again before written == keeps the older recLSN
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id_0));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_0, true));
+  EXPECT_EQ(5, get_dirty_page_table()[page_id_0]);
+  EXPECT_EQ(true, bpm->FlushPage(page_id_0));
+  EXPECT_EQ(true, get_dirty_page_table().empty());
+
+  // written by a batched flush, pinned 1 stays
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id_1));
+  append(2);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_1, true));
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id_0));
+  EXPECT_EQ((std::unordered_map<page_id_t, lsn_t>{{page_id_0, 10},
+                                                  {page_id_1, 8}}),
+            get_dirty_page_table());
+  EXPECT_EQ(1, bpm->FlushAllPages());
+  EXPECT_EQ((std::unordered_map<page_id_t, lsn_t>{{page_id_0, 10}}),
+            get_dirty_page_table());
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_0, false));
+  EXPECT_EQ(true, get_dirty_page_table().empty());
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// page failing its checksum == nullptr for a miss n a prefetch alike, never
+// cached, its frame back on the free list
+TEST(BufferPoolManagerTest, CorruptPageTest) {
+  remove("test.db");
+  remove("test.fsm");
+  MetricCounter *failed_reads =
+      MetricsRegistry::Instance().GetCounter("buffer_pool.failed_reads");
+  uint64_t failed_before = failed_reads->Get();
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  std::vector<page_id_t> ids;
+  page_id_t page_id;
+  for (int i = 0; i < 20; ++i) {
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm->UnpinPage(page_id, true);
+    ids.push_back(page_id);
+  }
+  bpm->FlushAllPages();
+
+  // 1 byte flipped in 2 evicted pages behind the disk manager's back
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  char corrupt = 'x';
+  for (int i : {0, 1}) {
+    EXPECT_EQ(1, pwrite(fd, &corrupt, 1,
+                        static_cast<off_t>(ids[i]) * PAGE_SIZE + 100));
+  }
+  close(fd);
+
+  EXPECT_EQ(nullptr, bpm->FetchPage(ids[0]));
+  EXPECT_EQ(nullptr, bpm->FetchPage(ids[0])); // read again, not cached
+  bool in_flight = true;
+  EXPECT_EQ(true, bpm->PrefetchPage(ids[1]));
+  while (bpm->FetchPageIfLoaded(ids[1], nullptr, &in_flight) == nullptr &&
+         in_flight) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(false, in_flight);
+  EXPECT_EQ(nullptr, bpm->FetchPageIfLoaded(ids[1]));
+  EXPECT_EQ(nullptr, bpm->FetchPage(ids[1]));
+  EXPECT_EQ(failed_before + 4, failed_reads->Get());
+
+  // no frame lost: all 10 pinned at once
+  for (int i = 2; i < 12; ++i) {
+    Page *page = bpm->FetchPage(ids[i]);
+    ASSERT_NE(nullptr, page);
+    char expected[32];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+  }
+  for (int i = 2; i < 12; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(ids[i], false));
+  }
+
+  // checks off == read as is
+  disk_manager->SetVerifyChecksums(false);
+  Page *page = bpm->FetchPage(ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ('x', page->GetData()[100]);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0"));
+  bpm->UnpinPage(ids[0], false);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+}
+
+// batched flush: log forced up to the lsn each written copy carries, pinned
+// pages changed right before the write included. durable already == no force
+// (no flush thread, the log only goes out when forced)
+TEST(BufferPoolManagerTest, FlushWALTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  ENABLE_LOGGING = true;
+  auto append = [log_manager](int n) {
+    lsn_t lsn = INVALID_LSN;
+    for (int i = 0; i < n; ++i) {
+      LogRecord log_record(0, INVALID_LSN, LogRecordType::COMMIT);
+      lsn = log_manager->AppendLogRecord(log_record);
+    }
+    return lsn;
+  };
+
+  page_id_t page_id_0, page_id_1;
+  Page *page_0 = bpm->NewPage(page_id_0);
+  ASSERT_NE(nullptr, page_0);
+  Page *page_1 = bpm->NewPage(page_id_1);
+  ASSERT_NE(nullptr, page_1);
+  page_0->SetLSN(append(3));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_0, true));
+  EXPECT_EQ(1, bpm->FlushAllPages());
+  EXPECT_EQ(2, log_manager->GetPersistentLSN());
+
+  // still pinned, changed after the last force
+  page_1->SetLSN(append(2));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_1, true));
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id_1));
+  EXPECT_EQ(1, bpm->FlushAllPages());
+  EXPECT_EQ(4, log_manager->GetPersistentLSN());
+
+  // newer records, none on the page == left to the flush thread
+  append(2);
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id_0));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_0, true));
+  EXPECT_EQ(1, bpm->FlushAllPages());
+  EXPECT_EQ(4, log_manager->GetPersistentLSN());
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_1, false));
+
+  ENABLE_LOGGING = false;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
@@ -0,0 +1,135 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2);
+
+  // 1 reference each, 2 and 3 referenced twice
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  // < K references == infinite distance, LRU among them
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  // then oldest 2nd most recent reference
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(1, lru_k_replacer.Size());
+
+  // pinned == not evictable, but history survives
+  EXPECT_EQ(true, lru_k_replacer.Erase(3));
+  EXPECT_EQ(false, lru_k_replacer.Erase(3));
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+  lru_k_replacer.Insert(5);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 2);
+
+  // 1 touched 3 times in a row == 1 correlated burst, still < K references
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(1);
+  // 2 touched twice far apart == 2 references
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(5);
+  lru_k_replacer.Insert(6);
+  lru_k_replacer.Insert(7);
+
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  // 5, 6, 7 are inside their correlated period, 2 goes first
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+}
+
+// replay a page id trace through a pool of pool_size frames
+// hit == pin + unpin, miss == victim + unpin
+static double ReplayTrace(Replacer<int> &replacer, size_t pool_size,
+                          const std::vector<int> &trace) {
+  std::unordered_set<int> in_pool;
+  size_t hits = 0;
+  for (int page_id : trace) {
+    if (in_pool.count(page_id) != 0) {
+      ++hits;
+      replacer.Erase(page_id);
+    } else if (in_pool.size() == pool_size) {
+      int victim;
+      EXPECT_EQ(true, replacer.Victim(victim));
+      in_pool.erase(victim);
+    }
+    in_pool.insert(page_id);
+    replacer.Insert(page_id);
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+/*
+ * reporting scan + OLTP point lookups over the same pool
+ * - scan: 2000 table pages, each fetched 3x in a row (1 per tuple)
+ * - lookup after every scan page: root, 1 of 4 internals, 1 of 40 leaves
+ * hot set == 45 pages < 64 frames, plain LRU still loses it to the scan
+ * leaves come back every 240 ticks == need the retained history
+ * 
+ * trace is fixed == ratios are exact: both hit the scan's 2nd n 3rd fetch
+ * of a page (2/3 of scan accesses), only LRU-2 keeps the lookups' pages
+ */
+TEST(LRUKReplacerTest, ScanHitRatioTest) {
+  const size_t pool_size = 64;
+  std::vector<int> trace;
+  int lookup = 0;
+  for (int round = 0; round < 3; ++round) {
+    for (int scan_page = 1000; scan_page < 3000; ++scan_page) {
+      for (int tuple = 0; tuple < 3; ++tuple) {
+        trace.push_back(scan_page);
+      }
+      trace.push_back(0);
+      trace.push_back(1 + lookup % 4);
+      trace.push_back(10 + (lookup * 7) % 40);
+      ++lookup;
+    }
+  }
+
+  LRUReplacer<int> lru_replacer;
+  LRUKReplacer<int> lru_k_replacer(2, 3, 1000);
+  double lru_hit_ratio = ReplayTrace(lru_replacer, pool_size, trace);
+  double lru_k_hit_ratio = ReplayTrace(lru_k_replacer, pool_size, trace);
+
+  EXPECT_GT(0.67, lru_hit_ratio);
+  EXPECT_LT(lru_hit_ratio + 0.15, lru_k_hit_ratio);
+}
+
+} // namespace cmudb
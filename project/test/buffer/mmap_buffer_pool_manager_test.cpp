@@ -0,0 +1,127 @@
+/**
+ * mmap_buffer_pool_manager_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "buffer/mmap_buffer_pool_manager.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// num_pages through a regular pool, page i starts w "page i"
+static void WriteDatabase(int num_pages) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+}
+
+TEST(MmapBufferPoolManagerTest, SampleTest) {
+  WriteDatabase(20);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  MmapBufferPoolManager *bpm = new MmapBufferPoolManager(disk_manager);
+  EXPECT_EQ(20, bpm->GetNumPages());
+
+  // any num of pages at once, no pool size to run out of
+  char expected[32];
+  for (int i = 0; i < 20; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, page->GetPageId());
+    snprintf(expected, sizeof(expected), "page %d", i);
+    EXPECT_EQ(0, strcmp(expected, page->GetData()));
+  }
+  // same page == same frame, straight into the mapping
+  EXPECT_EQ(bpm->FetchPage(3)->GetData() + PAGE_SIZE,
+            bpm->FetchPage(4)->GetData());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  EXPECT_EQ(nullptr, bpm->FetchPage(20));
+  EXPECT_EQ(nullptr, bpm->FetchPage(INVALID_PAGE_ID));
+  EXPECT_EQ(false, bpm->UnpinPage(5, true));
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(false, bpm->DeletePage(5));
+  EXPECT_EQ(0, bpm->FlushAllPages());
+
+  // read-ahead hint only, page is there either way
+  EXPECT_EQ(false, bpm->PrefetchPage(7));
+  bool in_flight = true;
+  EXPECT_NE(nullptr, bpm->FetchPageIfLoaded(7, nullptr, &in_flight));
+  EXPECT_EQ(false, in_flight);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// open + full scans: mmap vs a pool 1/8 the size of the file (every page
+// copied in on each scan), file in the OS page cache for both. prints both,
+// not in the default run, no timing asserted:
+// --gtest_also_run_disabled_tests
+TEST(MmapBufferPoolManagerTest, DISABLED_OpenScanBenchmark) {
+  const int num_pages = 8192;
+  const int num_scans = 10;
+  WriteDatabase(num_pages);
+
+  auto scan = [&](BufferPoolManager *bpm) {
+    uint64_t sum = 0;
+    for (int round = 0; round < num_scans; ++round) {
+      for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+        Page *page = bpm->FetchPage(page_id);
+        page->RLatch();
+        for (size_t i = 0; i < PAGE_SIZE; i += 64) {
+          sum += page->GetData()[i];
+        }
+        page->RUnlatch();
+        bpm->UnpinPage(page_id, false);
+      }
+    }
+    return sum;
+  };
+  auto run = [&](bool mapped, uint64_t &sum) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    auto start = std::chrono::steady_clock::now();
+    BufferPoolManager *bpm =
+        mapped ? static_cast<BufferPoolManager *>(
+                     new MmapBufferPoolManager(disk_manager))
+               : new ParallelBufferPoolManager(BUFFER_POOL_INSTANCES,
+                                               num_pages / 8, disk_manager);
+    std::chrono::duration<double, std::micro> open_us =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    sum = scan(bpm);
+    std::chrono::duration<double> scan_s =
+        std::chrono::steady_clock::now() - start;
+    printf("%s: open %.0f us, scan %.0f Kpages/s\n",
+           mapped ? "mmap" : "buffer pool", open_us.count(),
+           num_scans * num_pages / scan_s.count() / 1e3);
+    delete bpm;
+    delete disk_manager;
+  };
+
+  uint64_t pool_sum, mapped_sum;
+  run(false, pool_sum);
+  run(true, mapped_sum);
+  EXPECT_EQ(pool_sum, mapped_sum);
+
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
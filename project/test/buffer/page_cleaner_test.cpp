@@ -0,0 +1,124 @@
+/**
+ * page_cleaner_test.cpp
+ */
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(PageCleanerTest, PeekVictimsTest) {
+  std::vector<int> values;
+
+  LRUReplacer<int> lru_replacer;
+  for (int i = 1; i <= 5; ++i) {
+    lru_replacer.Insert(i);
+  }
+  lru_replacer.Insert(1);
+  lru_replacer.PeekVictims(values, 3);
+  EXPECT_EQ(std::vector<int>({2, 3, 4}), values);
+  EXPECT_EQ(5, lru_replacer.Size()); // peek never evicts
+
+  ClockReplacer<int> clock_replacer(
+      6, [](const int &value) { return static_cast<size_t>(value); });
+  for (int i = 1; i <= 5; ++i) {
+    clock_replacer.Insert(i);
+  }
+  int value;
+  EXPECT_EQ(true, clock_replacer.Victim(value)); // clears every ref bit
+  EXPECT_EQ(1, value);
+  clock_replacer.Insert(3);
+  clock_replacer.PeekVictims(values, 10);
+  EXPECT_EQ(std::vector<int>({2, 4, 5, 3}), values);
+
+  LRUKReplacer<int> lru_k_replacer(2);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.PeekVictims(values, 10);
+  EXPECT_EQ(std::vector<int>({2, 3, 1}), values);
+  EXPECT_EQ(true, lru_k_replacer.Victim(value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(PageCleanerTest, CleanPagesTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+
+  page_id_t page_id;
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 10; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm.UnpinPage(page_id, true);
+    page_ids.push_back(page_id);
+  }
+
+  // half the evictable frames at most == coldest 5
+  EXPECT_EQ(5, bpm.CleanPages(8));
+  EXPECT_EQ(0, bpm.CleanPages(8)); // cold half is clean already
+  EXPECT_EQ(5, bpm.GetCleanerWrites());
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_id));
+    bpm.UnpinPage(page_id, false);
+  }
+  EXPECT_EQ(5, bpm.GetCleanEvictions());
+  EXPECT_EQ(0, bpm.GetDirtyEvictions());
+
+  // cleaned pages made it to disk
+  Page *page = bpm.FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 0"));
+  bpm.UnpinPage(page_ids[0], false);
+  EXPECT_EQ(1, bpm.GetDirtyEvictions()); // page 5 never cleaned
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(PageCleanerTest, BackgroundTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(2, 20, disk_manager);
+  bpm.SetPageCleanerRate(std::chrono::milliseconds(1), 4);
+  bpm.RunPageCleaner();
+
+  page_id_t page_id;
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 200; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm.UnpinPage(page_id, true);
+    page_ids.push_back(page_id);
+    if (i % 10 == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+  bpm.StopPageCleaner();
+
+  EXPECT_LT(0, bpm.GetCleanerWrites());
+  EXPECT_LT(0, bpm.GetCleanEvictions());
+
+  // nothing lost, whoever wrote it
+  for (int i = 0; i < 200; ++i) {
+    Page *page = bpm.FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    char expected[32];
+    snprintf(expected, sizeof(expected), "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    bpm.UnpinPage(page_ids[i], false);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
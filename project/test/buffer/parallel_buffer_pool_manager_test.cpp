@@ -0,0 +1,186 @@
+/**
+ * parallel_buffer_pool_manager_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ParallelBufferPoolManagerTest, SampleTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(5, 10, disk_manager);
+  EXPECT_EQ(5, bpm.GetNumInstances());
+  EXPECT_EQ(10, bpm.GetPoolSize());
+
+  auto page_zero = bpm.NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page_zero);
+  EXPECT_EQ(0, temp_page_id);
+  strcpy(page_zero->GetData(), "Hello");
+
+  // sequential page ids == round robin over shards, fills every frame
+  for (int i = 1; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  }
+  // all the pages are pinned, every shard is full
+  for (int i = 10; i < 15; ++i) {
+    EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(INVALID_PAGE_ID, temp_page_id);
+  }
+
+  // same page id always lands on the same shard
+  EXPECT_EQ(bpm.GetBufferPoolManager(0), bpm.GetBufferPoolManager(0));
+  EXPECT_NE(bpm.GetBufferPoolManager(0), bpm.GetBufferPoolManager(1));
+
+  // unpin everything, evict page zero out of its shard
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+
+  // fetch page zero again, read back from disk
+  page_zero = bpm.FetchPage(0);
+  ASSERT_NE(nullptr, page_zero);
+  EXPECT_EQ(0, strcmp(page_zero->GetData(), "Hello"));
+  EXPECT_EQ(true, bpm.UnpinPage(0, false));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// owning shard all pinned, another 1 has room: new page lands there
+TEST(ParallelBufferPoolManagerTest, FullShardTest) {
+  remove("test.db");
+  remove("test.fsm");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(2, 4, disk_manager);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_id));
+    EXPECT_EQ(i, page_id);
+  }
+  // shard 1's frames free, shard 0's pinned
+  EXPECT_TRUE(bpm.UnpinPage(1, false));
+  EXPECT_TRUE(bpm.DeletePage(1));
+  EXPECT_TRUE(bpm.UnpinPage(3, false));
+  EXPECT_TRUE(bpm.DeletePage(3));
+
+  // 4 == shard 0, skipped n given back
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(5, page_id);
+  EXPECT_EQ(bpm.GetBufferPoolManager(1), bpm.GetBufferPoolManager(page_id));
+  EXPECT_EQ(nullptr, bpm.PeekPage(4));
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(1, page_id % 2);
+
+  // whole pool pinned
+  EXPECT_EQ(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(INVALID_PAGE_ID, page_id);
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+TEST(ParallelBufferPoolManagerTest, ConcurrentTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 50;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(num_threads, 64, disk_manager);
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&bpm, tid]() {
+      page_id_t page_id;
+      std::vector<page_id_t> page_ids;
+      for (int i = 0; i < pages_per_thread; ++i) {
+        Page *page = bpm.NewPage(page_id);
+        if (page == nullptr) {
+          continue; // owning shard happened to be all pinned
+        }
+        sprintf(page->GetData(), "%d-%d", tid, page_id);
+        page_ids.push_back(page_id);
+        bpm.UnpinPage(page_id, true);
+      }
+      for (auto id : page_ids) {
+        Page *page = bpm.FetchPage(id);
+        ASSERT_NE(nullptr, page);
+        char expected[32];
+        sprintf(expected, "%d-%d", tid, id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        bpm.UnpinPage(id, false);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// dirty pages of all shards, pinned ones too, end up on disk
+TEST(ParallelBufferPoolManagerTest, FlushAllPagesTest) {
+  const int num_pages = 40;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(4, num_pages, disk_manager);
+
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, page_id);
+    sprintf(page->GetData(), "page %d", page_id);
+    bpm.UnpinPage(page_id, true);
+  }
+  // pinned while flushed
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm.FetchPage(i));
+  }
+
+  EXPECT_EQ(num_pages, bpm.FlushAllPages());
+  EXPECT_EQ(0, bpm.FlushAllPages()); // all clean now
+
+  char data[PAGE_SIZE];
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->ReadPage(i, data);
+    char expected[32];
+    sprintf(expected, "page %d", i);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  // range only
+  for (int i = 0; i < 10; ++i) {
+    sprintf(bpm.FetchPage(i)->GetData(), "again %d", i);
+    bpm.UnpinPage(i, true);
+    bpm.UnpinPage(i, true);
+  }
+  EXPECT_EQ(5, bpm.FlushRange(5, 20));
+  disk_manager->ReadPage(7, data);
+  EXPECT_EQ(0, strcmp(data, "again 7"));
+  disk_manager->ReadPage(2, data);
+  EXPECT_EQ(0, strcmp(data, "page 2"));
+  EXPECT_EQ(5, bpm.FlushAllPages());
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,109 @@
+/**
+ * read_ahead_test.cpp
+ */
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// 30 pages on disk, none resident afterwards except the last few
+static void WritePages(BufferPoolManager &bpm, std::vector<page_id_t> &ids) {
+  page_id_t page_id;
+  for (int i = 0; i < 30; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    bpm.UnpinPage(page_id, true);
+    ids.push_back(page_id);
+  }
+}
+
+static void ExpectPage(Page *page, int i) {
+  ASSERT_NE(nullptr, page);
+  char expected[32];
+  snprintf(expected, sizeof(expected), "page %d", i);
+  EXPECT_EQ(0, strcmp(page->GetData(), expected));
+}
+
+TEST(ReadAheadTest, PrefetchPageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  std::vector<page_id_t> ids;
+  WritePages(bpm, ids);
+
+  EXPECT_EQ(false, bpm.PrefetchPage(ids[29])); // resident
+  EXPECT_EQ(true, bpm.PrefetchPage(ids[0]));
+  EXPECT_EQ(false, bpm.PrefetchPage(ids[0])); // queued / reading
+  EXPECT_EQ(true, bpm.PrefetchPage(ids[1]));
+
+  // FetchPage on a page in flight waits for its read
+  Page *page = bpm.FetchPage(ids[0]);
+  ExpectPage(page, 0);
+  bpm.UnpinPage(ids[0], false);
+
+  // poll w/o blocking until the worker is done
+  bool in_flight = true;
+  while ((page = bpm.FetchPageIfLoaded(ids[1], nullptr, &in_flight)) ==
+         nullptr) {
+    ASSERT_EQ(true, in_flight);
+    std::this_thread::yield();
+  }
+  ExpectPage(page, 1);
+  bpm.UnpinPage(ids[1], false);
+  EXPECT_LE(1, bpm.GetPrefetchReads());
+
+  // never requested == neither loaded nor in flight
+  EXPECT_EQ(nullptr, bpm.FetchPageIfLoaded(ids[5], nullptr, &in_flight));
+  EXPECT_EQ(false, in_flight);
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(ReadAheadTest, StrategyTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  ParallelBufferPoolManager bpm(2, 10, disk_manager);
+  std::vector<page_id_t> ids;
+  WritePages(bpm, ids);
+
+  // scan-like: fetch page i, keep 2 pages past it in flight in the ring
+  {
+    BufferAccessStrategy strategy(4);
+    for (int i = 0; i < 20; ++i) {
+      bpm.PrefetchPage(ids[i + 1], &strategy);
+      bpm.PrefetchPage(ids[i + 2], &strategy);
+      Page *page = bpm.FetchPage(ids[i], &strategy);
+      ExpectPage(page, i);
+      bpm.UnpinPage(ids[i], false, &strategy);
+    }
+    // requests still queued are dropped w the strategy
+    for (int i = 20; i < 26; ++i) {
+      bpm.PrefetchPage(ids[i], &strategy);
+    }
+  }
+
+  // ring frames are back, every frame can be pinned
+  page_id_t page_id;
+  std::vector<page_id_t> pinned;
+  for (int i = 0; i < 10; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    if (page != nullptr) {
+      pinned.push_back(page_id);
+    }
+  }
+  EXPECT_EQ(10, pinned.size());
+  for (page_id_t id : pinned) {
+    bpm.UnpinPage(id, false);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
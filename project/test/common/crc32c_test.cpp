@@ -0,0 +1,69 @@
+/**
+ * crc32c_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "common/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(Crc32cTest, SampleTest) {
+  // check value of the standard
+  const char check[] = "123456789";
+  EXPECT_EQ(0xe3069283u, Crc32c::Compute(check, 9));
+  EXPECT_EQ(0xe3069283u, Crc32c::ComputeSoftware(check, 9));
+  EXPECT_EQ(0u, Crc32c::Compute(check, 0));
+
+  // both agree on any length / alignment, n chained == in 1 go
+  std::vector<char> data(1000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i * 131 + 7);
+  }
+  for (size_t offset = 0; offset < 9; offset++) {
+    for (size_t size = 0; size + offset <= 100; size++) {
+      EXPECT_EQ(Crc32c::ComputeSoftware(&data[offset], size),
+                Crc32c::Compute(&data[offset], size));
+    }
+  }
+  uint32_t crc = Crc32c::Compute(data.data(), 333);
+  EXPECT_EQ(Crc32c::Compute(data.data(), data.size()),
+            Crc32c::Compute(&data[333], data.size() - 333, crc));
+
+  // 1 bit flipped == different
+  uint32_t before = Crc32c::Compute(data.data(), data.size());
+  data[500] ^= 0x10;
+  EXPECT_NE(before, Crc32c::Compute(data.data(), data.size()));
+}
+
+// GB/s n ns per page, hardware vs software. not in the default run, no
+// timing asserted: --gtest_also_run_disabled_tests
+TEST(Crc32cTest, DISABLED_PageBenchmark) {
+  printf("crc32c hardware accelerated: %d\n", Crc32c::IsHardwareAccelerated());
+  std::vector<char> page(4096, 'x');
+  const int rounds = 100000;
+  auto bench = [&](uint32_t (*crc)(const char *, size_t, uint32_t)) {
+    uint32_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      page[0] = static_cast<char>(i);
+      sum += crc(page.data(), page.size(), 0);
+    }
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    printf("%.2f GB/s, %.0f ns per 4K page\n",
+           rounds * page.size() / seconds.count() / 1e9,
+           seconds.count() * 1e9 / rounds);
+    return sum;
+  };
+  printf("hardware: ");
+  uint32_t hardware = bench(Crc32c::Compute);
+  printf("software: ");
+  uint32_t software = bench(Crc32c::ComputeSoftware);
+  EXPECT_EQ(hardware, software);
+}
+
+} // namespace cmudb
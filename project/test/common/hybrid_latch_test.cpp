@@ -0,0 +1,103 @@
+/**
+ * hybrid_latch_test.cpp
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common/hybrid_latch.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// 2 halves always written together, a validated optimistic read never sees
+// them differ
+class Pair {
+public:
+  void Add(int num) {
+    latch_.WLock();
+    first_.store(first_.load(std::memory_order_relaxed) + num,
+                 std::memory_order_relaxed);
+    second_.store(second_.load(std::memory_order_relaxed) + num,
+                  std::memory_order_relaxed);
+    latch_.WUnlock();
+  }
+  int Read() {
+    latch_.RLock();
+    int res = first_.load(std::memory_order_relaxed);
+    EXPECT_EQ(res, second_.load(std::memory_order_relaxed));
+    latch_.RUnlock();
+    return res;
+  }
+  // @return false == validation failed, retry
+  bool ReadOptimistic(int &first, int &second) {
+    uint64_t version = latch_.OptimisticLock();
+    first = first_.load(std::memory_order_relaxed);
+    second = second_.load(std::memory_order_relaxed);
+    return latch_.Validate(version);
+  }
+  HybridLatch latch_;
+
+private:
+  std::atomic<int> first_{0};
+  std::atomic<int> second_{0};
+};
+
+TEST(HybridLatchTest, SizeTest) { EXPECT_EQ(8, sizeof(HybridLatch)); }
+
+TEST(HybridLatchTest, BasicTest) {
+  int num_threads = 100;
+  Pair pair;
+  pair.Add(5);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    if (tid % 2 == 0) {
+      threads.push_back(std::thread([&pair]() { pair.Read(); }));
+    } else {
+      threads.push_back(std::thread([&pair]() { pair.Add(1); }));
+    }
+  }
+  for (int i = 0; i < num_threads; i++) {
+    threads[i].join();
+  }
+  EXPECT_EQ(55, pair.Read());
+}
+
+TEST(HybridLatchTest, OptimisticTest) {
+  Pair pair;
+
+  // nothing written == valid, shared readers don't invalidate
+  uint64_t version = pair.latch_.OptimisticLock();
+  pair.latch_.RLock();
+  EXPECT_TRUE(pair.latch_.Validate(version));
+  pair.latch_.RUnlock();
+  EXPECT_TRUE(pair.latch_.Validate(version));
+
+  // writer in / done == invalid
+  pair.latch_.WLock();
+  EXPECT_FALSE(pair.latch_.Validate(version));
+  pair.latch_.WUnlock();
+  EXPECT_FALSE(pair.latch_.Validate(version));
+
+  // concurrent writers: every validated read is consistent
+  std::atomic<bool> stop{false};
+  std::thread writer([&pair, &stop]() {
+    while (!stop) {
+      pair.Add(1);
+    }
+  });
+  int validated = 0;
+  for (int i = 0; i < 10000; i++) {
+    int first, second;
+    if (pair.ReadOptimistic(first, second)) {
+      EXPECT_EQ(first, second);
+      validated++;
+    }
+  }
+  stop = true;
+  writer.join();
+  EXPECT_GT(validated, 0);
+}
+
+} // namespace cmudb
@@ -0,0 +1,130 @@
+/**
+ * lz4_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/lz4.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// compressed n back, @return compressed size
+static size_t RoundTrip(const std::string &data) {
+  std::vector<char> compressed(Lz4::MaxCompressedSize(data.size()));
+  size_t size =
+      Lz4::Compress(data.data(), data.size(), compressed.data(),
+                    compressed.size());
+  EXPECT_LT(0u, size);
+  std::vector<char> out(data.size() + 1);
+  EXPECT_EQ(static_cast<int64_t>(data.size()),
+            Lz4::Decompress(compressed.data(), size, out.data(), out.size()));
+  EXPECT_EQ(data, std::string(out.data(), data.size()));
+  return size;
+}
+
+TEST(Lz4Test, SampleTest) {
+  // short / empty == literals only
+  EXPECT_EQ(1u, RoundTrip(""));
+  EXPECT_EQ(6u, RoundTrip("hello"));
+
+  // runs n repeats shrink, long lengths take extra bytes
+  EXPECT_GT(32u, RoundTrip(std::string(4096, 'a')));
+  std::string text;
+  for (int i = 0; i < 100; i++) {
+    text += "name=row" + std::to_string(i) + ", city=Pittsburgh, state=PA; ";
+  }
+  EXPECT_GT(text.size() / 4, RoundTrip(text));
+
+  // incompressible stays within the bound
+  std::string noise(65536, 0);
+  uint32_t seed = 1;
+  for (auto &c : noise) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+  EXPECT_GE(Lz4::MaxCompressedSize(noise.size()), RoundTrip(noise));
+  // every length around the end limits
+  for (size_t size = 0; size < 40; size++) {
+    RoundTrip(std::string(size, 'x'));
+    RoundTrip(noise.substr(0, size));
+  }
+
+  // too small an output == 0, not a partial block
+  char small[8];
+  EXPECT_EQ(0u, Lz4::Compress(noise.data(), 100, small, sizeof(small)));
+}
+
+TEST(Lz4Test, MalformedTest) {
+  std::string text(1000, 'a');
+  text += "tail of literals";
+  char compressed[64], out[2048];
+  size_t size = Lz4::Compress(text.data(), text.size(), compressed,
+                              sizeof(compressed));
+  ASSERT_LT(0u, size);
+  // output too small
+  EXPECT_EQ(-1, Lz4::Decompress(compressed, size, out, 100));
+  // cut short anywhere
+  for (size_t cut = 1; cut < size; cut++) {
+    int64_t n = Lz4::Decompress(compressed, cut, out, sizeof(out));
+    EXPECT_TRUE(n < static_cast<int64_t>(text.size())) << cut;
+  }
+  // offset before the start of the output
+  const char bad_offset[] = {0x10, 'a', 0x10, 0x00, 0x00};
+  EXPECT_EQ(-1, Lz4::Decompress(bad_offset, sizeof(bad_offset), out,
+                                sizeof(out)));
+  // every single byte garbled: any result, never out of bounds (asan)
+  for (size_t i = 0; i < size; i++) {
+    char garbled[64];
+    memcpy(garbled, compressed, size);
+    garbled[i] ^= 0x5a;
+    EXPECT_GE(static_cast<int64_t>(sizeof(out)),
+              Lz4::Decompress(garbled, size, out, sizeof(out)));
+  }
+}
+
+// text like table pages: ratio, compress n decompress speed. not in the
+// default run, no timing asserted: --gtest_also_run_disabled_tests
+TEST(Lz4Test, DISABLED_PageBenchmark) {
+  const size_t page_size = 512;
+  const int num_pages = 20000;
+  std::string pages;
+  for (int i = 0; pages.size() < page_size * num_pages; i++) {
+    pages += "id=" + std::to_string(i) + " name=customer" +
+             std::to_string(i % 97) + " address=" + std::to_string(i % 13) +
+             " Forbes Avenue, Pittsburgh;";
+  }
+  std::vector<char> compressed(num_pages *
+                               Lz4::MaxCompressedSize(page_size));
+  std::vector<size_t> sizes(num_pages);
+  auto start = std::chrono::steady_clock::now();
+  size_t total = 0;
+  for (int i = 0; i < num_pages; i++) {
+    sizes[i] = Lz4::Compress(&pages[i * page_size], page_size,
+                             &compressed[i * Lz4::MaxCompressedSize(page_size)],
+                             Lz4::MaxCompressedSize(page_size));
+    total += sizes[i];
+  }
+  std::chrono::duration<double> compress_s =
+      std::chrono::steady_clock::now() - start;
+  std::vector<char> out(page_size);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(static_cast<int64_t>(page_size),
+              Lz4::Decompress(&compressed[i * Lz4::MaxCompressedSize(page_size)],
+                              sizes[i], out.data(), out.size()));
+  }
+  std::chrono::duration<double> decompress_s =
+      std::chrono::steady_clock::now() - start;
+  double mb = page_size * num_pages / 1e6;
+  printf("%zu byte pages: ratio %.2f, compress %.0f MB/s, decompress %.0f "
+         "MB/s\n",
+         page_size, static_cast<double>(page_size) * num_pages / total,
+         mb / compress_s.count(), mb / decompress_s.count());
+}
+
+} // namespace cmudb
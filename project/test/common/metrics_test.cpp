@@ -0,0 +1,82 @@
+/**
+ * metrics_test.cpp
+ */
+
+#include <thread>
+#include <vector>
+
+#include "common/metrics.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(MetricsTest, CounterTest) {
+  MetricsRegistry &registry = MetricsRegistry::Instance();
+  MetricCounter *counter = registry.GetCounter("test.counter");
+  // same name == same metric
+  EXPECT_EQ(counter, registry.GetCounter("test.counter"));
+
+  // threads land on different shards, sum is exact
+  int num_threads = 8;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([counter]() {
+      for (int i = 0; i < 10000; i++) {
+        counter->Add();
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  counter->Add(5);
+  EXPECT_EQ(80005, counter->Get());
+
+  bool found = false;
+  for (auto &snapshot : registry.SnapshotCounters()) {
+    if (snapshot.first == "test.counter") {
+      EXPECT_EQ(80005, snapshot.second);
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST(MetricsTest, HistogramTest) {
+  MetricHistogram *histogram =
+      MetricsRegistry::Instance().GetHistogram("test.histogram");
+  EXPECT_EQ(0, histogram->GetCount());
+  EXPECT_EQ(0, histogram->GetPercentile(0.5));
+
+  // 90 fast (3us == bucket [2, 4)), 10 slow (1000us == bucket [512, 1024))
+  for (int i = 0; i < 90; i++) {
+    histogram->Record(3);
+  }
+  for (int i = 0; i < 10; i++) {
+    histogram->Record(1000);
+  }
+  EXPECT_EQ(100, histogram->GetCount());
+  EXPECT_EQ(90 * 3 + 10 * 1000, histogram->GetSum());
+  EXPECT_EQ(4, histogram->GetPercentile(0.5));
+  EXPECT_EQ(4, histogram->GetPercentile(0.9));
+  EXPECT_EQ(1024, histogram->GetPercentile(0.99));
+
+  uint64_t buckets[MetricHistogram::num_buckets_];
+  histogram->GetBuckets(buckets);
+  EXPECT_EQ(90, buckets[2]);
+  EXPECT_EQ(10, buckets[10]);
+
+  // 0us and huge values stay in range
+  histogram->Record(0);
+  histogram->Record(1ULL << 40);
+  histogram->GetBuckets(buckets);
+  EXPECT_EQ(1, buckets[0]);
+  EXPECT_EQ(1, buckets[MetricHistogram::num_buckets_ - 1]);
+
+  {
+    MetricTimer timer(histogram);
+  }
+  EXPECT_EQ(103, histogram->GetCount());
+}
+
+} // namespace cmudb
@@ -0,0 +1,109 @@
+/**
+ * async_io_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#include "common/exception.h"
+#include "disk/async_io.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// both backends, io_uring only where the kernel allows it
+static std::vector<std::unique_ptr<AsyncIO>> Backends() {
+  std::vector<std::unique_ptr<AsyncIO>> backends;
+  backends.emplace_back(new ThreadPoolIO(2));
+  try {
+    backends.emplace_back(new IoUringIO(8)); // small ring == submitters wait
+  } catch (Exception &e) {
+    printf("io_uring not available: %s\n", e.what());
+  }
+  return backends;
+}
+
+TEST(AsyncIOTest, ReadWriteTest) {
+  const int num_pages = 64;
+  for (auto &backend : Backends()) {
+    int fd = open("test.db", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_LE(0, fd);
+    std::vector<char> data(num_pages * PAGE_SIZE);
+    for (int i = 0; i < num_pages; i++) {
+      memset(&data[i * PAGE_SIZE], 'a' + i % 26, PAGE_SIZE);
+    }
+
+    // more requests than ring entries, 1 batch
+    std::atomic<int> callbacks{0};
+    std::vector<IORequest> requests;
+    for (int i = 0; i < num_pages; i++) {
+      requests.push_back({IOType::WRITE, fd, &data[i * PAGE_SIZE], PAGE_SIZE,
+                          i * PAGE_SIZE,
+                          [&callbacks](int64_t) { callbacks++; }, nullptr});
+    }
+    auto handles = backend->SubmitBatch(requests);
+    EXPECT_TRUE(IOHandle::WaitAll(handles));
+    EXPECT_EQ(num_pages, callbacks);
+    for (auto &handle : handles) {
+      EXPECT_TRUE(handle->IsDone());
+      EXPECT_EQ(PAGE_SIZE, handle->Wait());
+    }
+
+    std::vector<char> buffer(num_pages * PAGE_SIZE);
+    handles.clear();
+    for (int i = num_pages - 1; i >= 0; i--) {
+      handles.push_back(backend->Submit(IOType::READ, fd,
+                                        &buffer[i * PAGE_SIZE], PAGE_SIZE,
+                                        i * PAGE_SIZE));
+    }
+    EXPECT_TRUE(IOHandle::WaitAll(handles));
+    EXPECT_EQ(0, memcmp(data.data(), buffer.data(), data.size()))
+        << backend->GetName();
+
+    // past eof == short, not an error
+    EXPECT_EQ(0, backend->Submit(IOType::READ, fd, buffer.data(), PAGE_SIZE,
+                                 num_pages * PAGE_SIZE)
+                     ->Wait());
+    // bad fd == -errno
+    EXPECT_GT(0, backend->Submit(IOType::READ, -1, buffer.data(), PAGE_SIZE, 0)
+                     ->Wait());
+    close(fd);
+  }
+  remove("test.db");
+}
+
+TEST(AsyncIOTest, DiskManagerTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  printf("async I/O backend: %s\n", disk_manager->GetAsyncIOBackend());
+
+  char data[2][PAGE_SIZE];
+  memset(data[0], 'x', PAGE_SIZE);
+  memset(data[1], 'y', PAGE_SIZE);
+  std::atomic<bool> written{false};
+  auto handle = disk_manager->WritePagesAsync(
+      2, data[0], 2, [&written](int64_t) { written = true; });
+  EXPECT_EQ(2 * PAGE_SIZE, handle->Wait());
+  EXPECT_TRUE(written);
+
+  char buffer[PAGE_SIZE];
+  EXPECT_EQ(PAGE_SIZE, disk_manager->ReadPageAsync(3, buffer)->Wait());
+  EXPECT_EQ(0, memcmp(data[1], buffer, PAGE_SIZE));
+  // never written == zeros
+  memset(buffer, 'z', PAGE_SIZE);
+  disk_manager->ReadPageAsync(10, buffer)->Wait();
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    EXPECT_EQ(0, buffer[i]);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,687 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "common/metrics.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, SampleTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+
+  // never written == zeros
+  memset(buffer, 'x', PAGE_SIZE);
+  disk_manager->ReadPage(5, buffer);
+  for (int i = 0; i < PAGE_SIZE; i++) {
+    EXPECT_EQ(0, buffer[i]);
+  }
+
+  for (int page_id = 0; page_id < 4; page_id++) {
+    memset(data, 'a' + page_id, PAGE_SIZE);
+    disk_manager->WritePage(page_id, data);
+  }
+  disk_manager->SyncPages();
+  for (int page_id = 3; page_id >= 0; page_id--) {
+    disk_manager->ReadPage(page_id, buffer);
+    memset(data, 'a' + page_id, PAGE_SIZE);
+    EXPECT_EQ(0, memcmp(data, buffer, PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+  }
+
+  // runs land at their page ids
+  char run[3 * PAGE_SIZE];
+  memset(run, 'r', sizeof(run));
+  disk_manager->WritePages(1, run, 3);
+  disk_manager->ReadPage(3, buffer);
+  EXPECT_EQ(0, memcmp(run, buffer, PAGE_SIZE));
+  disk_manager->ReadPage(0, buffer);
+  EXPECT_EQ('a', buffer[0]);
+
+  // log: appended, read back by offset
+  char log[] = "log record";
+  disk_manager->WriteLog(log, sizeof(log));
+  char log_buffer[sizeof(log) + 4];
+  EXPECT_TRUE(disk_manager->ReadLog(log_buffer, sizeof(log_buffer), 0));
+  EXPECT_EQ(0, strcmp(log, log_buffer));
+  EXPECT_FALSE(disk_manager->ReadLog(log_buffer, sizeof(log_buffer), 100));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// every thread owns some pages, writes n reads them back at the same time
+TEST(DiskManagerTest, ConcurrentTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 64;
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([disk_manager, tid]() {
+      char data[PAGE_SIZE], buffer[PAGE_SIZE];
+      for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = i * num_threads + tid;
+          snprintf(data, PAGE_SIZE, "%d-%d", page_id, round);
+          disk_manager->WritePage(page_id, data);
+        }
+        for (int i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = i * num_threads + tid;
+          snprintf(data, PAGE_SIZE, "%d-%d", page_id, round);
+          disk_manager->ReadPage(page_id, buffer);
+          EXPECT_EQ(0, strcmp(data, buffer));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, FreeSpaceMapTest) {
+  remove("test.db");
+  remove("test.fsm");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  for (page_id_t i = 0; i < 10; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+
+  // freed only once a full flush made the unlinks durable
+  disk_manager->DeallocatePage(3);
+  disk_manager->DeallocatePage(5);
+  uint64_t mark = disk_manager->GetFreeMark();
+  disk_manager->DeallocatePage(8); // after the mark
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+  disk_manager->ReleaseFreedPages(mark);
+  EXPECT_FALSE(disk_manager->IsAllocated(5));
+  EXPECT_TRUE(disk_manager->IsAllocated(8));
+
+  // nearest after the hint, else lowest, else past the end
+  EXPECT_EQ(5, disk_manager->AllocatePage(4));
+  EXPECT_EQ(3, disk_manager->AllocatePage(6));
+  EXPECT_EQ(11, disk_manager->AllocatePage());
+
+  // any page write persists the map 1st. 8 still pending == leaked, not
+  // handed out twice
+  char data[PAGE_SIZE] = {};
+  disk_manager->WritePage(0, data);
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  for (page_id_t i = 0; i < 12; i++) {
+    EXPECT_TRUE(disk_manager->IsAllocated(i));
+  }
+  EXPECT_EQ(12, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  // db w/o a map: every page in the file allocated
+  remove("test.fsm");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsAllocated(0));
+  EXPECT_EQ(1, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  // db n everything next to it
+  DiskManager::RemoveFiles("test.db");
+  struct stat file_stat;
+  EXPECT_NE(0, stat("test.db", &file_stat));
+  EXPECT_NE(0, stat("test.log", &file_stat));
+  EXPECT_NE(0, stat("test.fsm", &file_stat));
+}
+
+// O_DIRECT: aligned n unaligned buffers, log in pieces not a block long
+TEST(DiskManagerTest, ExtentTest) {
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+
+  // 2 objects growing interleaved, each in its own run
+  PageExtent *heap = new PageExtent(4);
+  PageExtent *index = new PageExtent(4);
+  for (page_id_t i = 0; i < 4; i++) {
+    EXPECT_EQ(1 + i, disk_manager->AllocatePage(INVALID_PAGE_ID, heap));
+    EXPECT_EQ(5 + i, disk_manager->AllocatePage(INVALID_PAGE_ID, index));
+  }
+  EXPECT_EQ(9, disk_manager->AllocatePage(INVALID_PAGE_ID, heap));
+  // reserved n not handed out yet == nobody else's
+  EXPECT_EQ(13, disk_manager->AllocatePage());
+
+  // only handed out pages on disk, a crash frees the rest
+  char data[PAGE_SIZE] = {};
+  disk_manager->WritePage(0, data);
+  uint64_t bits = 0;
+  std::ifstream fsm("test.fsm", std::ios::binary);
+  fsm.read(reinterpret_cast<char *>(&bits), sizeof(bits));
+  ASSERT_TRUE(fsm.good());
+  EXPECT_EQ((1ULL << 10) - 1 + (1ULL << 13), bits);
+
+  // unused rest free at once
+  delete heap;
+  EXPECT_TRUE(disk_manager->IsAllocated(9));
+  EXPECT_FALSE(disk_manager->IsAllocated(10));
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+
+  // next runs: 1st free run after the hint (else after the last run), then
+  // the lowest, the end if none is long enough
+  for (page_id_t page_id : {2, 3, 4, 5, 6, 7}) {
+    disk_manager->DeallocatePage(page_id);
+  }
+  disk_manager->ReleaseFreedPages(disk_manager->GetFreeMark());
+  EXPECT_EQ(2, disk_manager->AllocatePage(8, index));
+  PageExtent *small = new PageExtent(2);
+  EXPECT_EQ(11, disk_manager->AllocatePage(9, small));
+  EXPECT_EQ(12, disk_manager->AllocatePage(INVALID_PAGE_ID, small));
+  EXPECT_EQ(6, disk_manager->AllocatePage(INVALID_PAGE_ID, small));
+  PageExtent *large = new PageExtent(4);
+  EXPECT_EQ(14, disk_manager->AllocatePage(3, large));
+  delete small;
+  delete large;
+
+  // blocks allocated ahead, size == what was written
+  disk_manager->WriteLog(data, 100);
+  struct stat db_stat, log_stat;
+  ASSERT_EQ(0, stat("test.db", &db_stat));
+  ASSERT_EQ(0, stat("test.log", &log_stat));
+  EXPECT_EQ(PAGE_SIZE, db_stat.st_size);
+  EXPECT_EQ(100, log_stat.st_size);
+  EXPECT_LE(DB_EXTENT_PAGES * PAGE_SIZE, db_stat.st_blocks * 512);
+  EXPECT_LE(LOG_EXTENT_SIZE, log_stat.st_blocks * 512);
+  delete index;
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+TEST(DiskManagerTest, TablespaceTest) {
+  remove("test.db");
+  remove("test.fsm");
+  mkdir("test_ts", 0755);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+  int tablespace_id = disk_manager->CreateTablespace("test_ts/index.db");
+  EXPECT_EQ(1, tablespace_id);
+  EXPECT_FALSE(disk_manager->OpenTablespace(1, "test_ts/other.db"));
+
+  // ids in the tablespace's own range, numbered from 0 within its file
+  page_id_t first = DiskManager::MakePageId(tablespace_id, 0);
+  PageExtent *index = new PageExtent(4, tablespace_id);
+  EXPECT_EQ(first, disk_manager->AllocatePage(INVALID_PAGE_ID, index));
+  // hint's tablespace, past the extent
+  EXPECT_EQ(first + 4, disk_manager->AllocatePage(first));
+  EXPECT_EQ(1, disk_manager->AllocatePage());
+  // not open
+  EXPECT_EQ(INVALID_PAGE_ID,
+            disk_manager->AllocatePage(DiskManager::MakePageId(5, 0)));
+
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  memset(data, 'i', PAGE_SIZE);
+  disk_manager->WritePage(first + 1, data);
+  delete index;
+  memset(data, 'd', PAGE_SIZE);
+  disk_manager->WritePage(1, data);
+  struct stat file_stat;
+  ASSERT_EQ(0, stat("test_ts/index.db", &file_stat));
+  EXPECT_EQ(2 * PAGE_SIZE, file_stat.st_size);
+  ASSERT_EQ(0, stat("test.db", &file_stat));
+  EXPECT_EQ(2 * PAGE_SIZE, file_stat.st_size);
+  disk_manager->ReadPage(first + 1, buffer);
+  EXPECT_EQ('i', buffer[0]);
+  EXPECT_EQ('i', buffer[PAGE_SIZE - PAGE_CHECKSUM_SIZE - 1]);
+  disk_manager->ReadPageAsync(1, buffer)->Wait();
+  EXPECT_EQ('d', buffer[0]);
+  delete disk_manager;
+
+  // reopened from its path (the header page's job), map n pages kept,
+  // the extent's unused rest free
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->HasTablespace(1));
+  EXPECT_TRUE(disk_manager->OpenTablespace(1, "test_ts/index.db"));
+  for (page_id_t page_id = first; page_id <= first + 4; page_id++) {
+    EXPECT_EQ(page_id == first || page_id == first + 4,
+              disk_manager->IsAllocated(page_id));
+  }
+  EXPECT_EQ(first + 1, disk_manager->AllocatePage(first));
+  disk_manager->ReadPage(first + 1, buffer);
+  EXPECT_EQ('i', buffer[0]);
+  delete disk_manager;
+
+  remove("test_ts/index.db");
+  remove("test_ts/index.fsm");
+  rmdir("test_ts");
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+// existing files only, nothing created or written
+TEST(DiskManagerTest, ReadOnlyTest) {
+  remove("test.db");
+  remove("test.fsm");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  for (int page_id = 0; page_id < 2; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    memset(data, 'a' + page_id, PAGE_SIZE);
+    disk_manager->WritePage(page_id, data);
+  }
+  delete disk_manager;
+  remove("test.log");
+  remove("test.fsm");
+
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, false, "", false, true);
+  EXPECT_TRUE(disk_manager->ReadPage(1, buffer));
+  EXPECT_EQ('b', buffer[0]);
+  // no map == every page in the file allocated
+  EXPECT_TRUE(disk_manager->IsAllocated(1));
+  memset(data, 'x', PAGE_SIZE);
+  disk_manager->WritePage(0, data);
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ('a', buffer[0]);
+  delete disk_manager;
+  struct stat file_stat;
+  EXPECT_NE(0, stat("test.log", &file_stat));
+  EXPECT_NE(0, stat("test.fsm", &file_stat));
+  ASSERT_EQ(0, stat("test.db", &file_stat));
+  EXPECT_EQ(2 * PAGE_SIZE, file_stat.st_size);
+
+  // no file == nothing opened
+  remove("test.db");
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, false, "", false, true);
+  EXPECT_FALSE(disk_manager->HasTablespace(0));
+  delete disk_manager;
+  EXPECT_NE(0, stat("test.db", &file_stat));
+  EXPECT_NE(0, stat("test.log", &file_stat));
+}
+
+TEST(DiskManagerTest, DirectIOTest) {
+  DiskManager *disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  if (!disk_manager->IsDirectIO()) {
+    printf("O_DIRECT not supported here, buffered I/O\n");
+  }
+
+  char *aligned = DiskManager::AllocateAligned(2 * PAGE_SIZE);
+  memset(aligned, 'a', 2 * PAGE_SIZE);
+  disk_manager->WritePages(0, aligned, 2);
+  char unaligned[PAGE_SIZE + 1];
+  memset(unaligned + 1, 'u', PAGE_SIZE);
+  disk_manager->WritePage(2, unaligned + 1);
+  disk_manager->WritePagesAsync(3, unaligned + 1, 1)->Wait();
+
+  disk_manager->ReadPage(1, unaligned + 1);
+  EXPECT_EQ(0, memcmp(aligned, unaligned + 1, PAGE_SIZE));
+  disk_manager->ReadPageAsync(2, aligned)->Wait();
+  EXPECT_EQ('u', aligned[0]);
+  EXPECT_EQ('u', aligned[PAGE_SIZE - PAGE_CHECKSUM_SIZE - 1]);
+  disk_manager->ReadPageAsync(3, unaligned + 1)->Wait();
+  EXPECT_EQ('u', unaligned[PAGE_SIZE - PAGE_CHECKSUM_SIZE]);
+  DiskManager::FreeAligned(aligned);
+
+  // 2 writers' worth of log buffers, as the log manager swaps them
+  char log[2][100];
+  std::string expected;
+  for (int i = 0; i < 12; i++) {
+    memset(log[i % 2], 'a' + i, sizeof(log[0]));
+    disk_manager->WriteLog(log[i % 2], sizeof(log[0]));
+    expected.append(log[i % 2], sizeof(log[0]));
+  }
+  delete disk_manager;
+
+  // no padding left behind, appends go on after reopening
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  std::ifstream file("test.log", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(expected.size(), static_cast<size_t>(file.tellg()));
+  char more[] = "more";
+  disk_manager->WriteLog(more, 4);
+  expected.append(more, 4);
+
+  std::vector<char> buffer(expected.size());
+  EXPECT_TRUE(disk_manager->ReadLog(buffer.data(), buffer.size(), 0));
+  EXPECT_EQ(expected, std::string(buffer.data(), buffer.size()));
+  // unaligned offset n size
+  EXPECT_TRUE(disk_manager->ReadLog(buffer.data(), 150, 1050));
+  EXPECT_EQ(expected.substr(1050, 150), std::string(buffer.data(), 150));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ChecksumTest) {
+  remove("test.db");
+  remove("test.fsm");
+  MetricCounter *failures =
+      MetricsRegistry::Instance().GetCounter("disk.checksum_failures");
+  uint64_t failures_before = failures->Get();
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  for (int page_id = 0; page_id < 4; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    memset(data, 'a' + page_id, PAGE_SIZE);
+    disk_manager->WritePage(page_id, data);
+  }
+  // stamped in place, verified on the way back
+  EXPECT_NE('d', data[PAGE_SIZE - 1]);
+  EXPECT_TRUE(disk_manager->ReadPage(3, buffer));
+  EXPECT_EQ(0, memcmp(data, buffer, PAGE_SIZE));
+
+  // 1 byte flipped behind the disk manager's back
+  int fd = open("test.db", O_RDWR);
+  ASSERT_LE(0, fd);
+  char corrupt = 'x';
+  EXPECT_EQ(1, pwrite(fd, &corrupt, 1, 2 * PAGE_SIZE + 100));
+  // stored 0 == never stamped (zeros, older files), passes
+  memset(data, 'o', PAGE_SIZE);
+  memset(data + PAGE_SIZE - PAGE_CHECKSUM_SIZE, 0, PAGE_CHECKSUM_SIZE);
+  EXPECT_EQ(PAGE_SIZE, pwrite(fd, data, PAGE_SIZE, PAGE_SIZE));
+  close(fd);
+
+  EXPECT_FALSE(disk_manager->ReadPage(2, buffer));
+  EXPECT_EQ('x', buffer[100]);
+  int64_t async_result = 0;
+  disk_manager
+      ->ReadPageAsync(2, buffer,
+                      [&async_result](int64_t result) {
+                        async_result = result;
+                      })
+      ->Wait();
+  EXPECT_EQ(-EIO, async_result);
+  EXPECT_TRUE(disk_manager->ReadPage(1, buffer));
+  EXPECT_EQ('o', buffer[0]);
+  EXPECT_TRUE(disk_manager->ReadPage(10, buffer));
+  EXPECT_EQ(failures_before + 2, failures->Get());
+  EXPECT_EQ(std::vector<page_id_t>{2}, disk_manager->GetCorruptPages());
+
+  // off == served as is
+  disk_manager->SetVerifyChecksums(false);
+  EXPECT_TRUE(disk_manager->ReadPage(2, buffer));
+  delete disk_manager;
+
+  // scrubber finds it w/o anyone reading it, skipped pages are not read
+  disk_manager = new DiskManager("test.db");
+  disk_manager->StartScrubber(
+      1000, [](page_id_t page_id) { return page_id == 3; });
+  while (disk_manager->GetCorruptPages().empty()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  disk_manager->StopScrubber();
+  EXPECT_EQ(std::vector<page_id_t>{2}, disk_manager->GetCorruptPages());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.log");
+}
+
+// rows of text, like a wide table's pages
+static void FillTextPage(char *data, size_t page_size, int page_id) {
+  std::string rows;
+  for (int row = 0; rows.size() < page_size; row++) {
+    rows += "id=" + std::to_string(page_id * 16 + row) + " name=customer" +
+            std::to_string((page_id + row) % 97) +
+            " address=Forbes Avenue, Pittsburgh PA;";
+  }
+  memcpy(data, rows.data(), page_size);
+}
+
+// where page_id's slot starts, in units (see CompressedPageFile)
+static uint32_t SlotOffset(page_id_t page_id) {
+  uint32_t entry[2] = {};
+  std::ifstream map("test.map", std::ios::binary);
+  map.seekg(page_id * sizeof(entry));
+  map.read(reinterpret_cast<char *>(entry), sizeof(entry));
+  return entry[0];
+}
+
+TEST(DiskManagerTest, CompressionTest) {
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.map");
+  DiskManager *disk_manager =
+      new DiskManager("test.db", PAGE_SIZE, false, "", true);
+  EXPECT_TRUE(disk_manager->IsCompressed());
+  char data[8][PAGE_SIZE], buffer[PAGE_SIZE];
+  for (int page_id = 0; page_id < 8; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    FillTextPage(data[page_id], PAGE_SIZE, page_id);
+    disk_manager->WritePage(page_id, data[page_id]);
+  }
+  for (int page_id = 7; page_id >= 0; page_id--) {
+    EXPECT_TRUE(disk_manager->ReadPage(page_id, buffer));
+    EXPECT_EQ(0, memcmp(data[page_id], buffer, PAGE_SIZE));
+  }
+  struct stat file_stat;
+  ASSERT_EQ(0, stat("test.db", &file_stat));
+  EXPECT_GT(4 * PAGE_SIZE, file_stat.st_size);
+  // rewritten == a new slot even if it fits the old one, which is not
+  // reused before the next sync
+  uint32_t old_offset = SlotOffset(1);
+  disk_manager->WritePage(1, data[1]);
+  EXPECT_NE(old_offset, SlotOffset(1));
+  disk_manager->WritePage(3, data[3]);
+  EXPECT_NE(old_offset, SlotOffset(3));
+  EXPECT_TRUE(disk_manager->ReadPage(1, buffer));
+  EXPECT_EQ(0, memcmp(data[1], buffer, PAGE_SIZE));
+  // never written == zeros, can't be mapped
+  EXPECT_TRUE(disk_manager->ReadPage(20, buffer));
+  EXPECT_EQ(0, buffer[0]);
+  size_t num_pages;
+  EXPECT_EQ(nullptr, disk_manager->MapPages(num_pages));
+
+  // incompressible grows out of its slot, stored raw
+  uint32_t seed = 1;
+  for (auto &c : data[0]) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+  disk_manager->WritePage(0, data[0]);
+  // run, 1 async
+  memset(data[2], 'r', 3 * PAGE_SIZE);
+  disk_manager->WritePages(2, data[2], 3);
+  EXPECT_EQ(PAGE_SIZE, disk_manager->WritePagesAsync(6, data[0], 1)->Wait());
+  EXPECT_EQ(PAGE_SIZE, disk_manager->ReadPageAsync(6, buffer)->Wait());
+  EXPECT_EQ(0, memcmp(data[0], buffer, PAGE_SIZE));
+  disk_manager->DeallocatePage(7);
+  disk_manager->ReleaseFreedPages(disk_manager->GetFreeMark());
+  delete disk_manager;
+
+  // map found next to the file, no flag needed
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsCompressed());
+  for (int page_id = 0; page_id < 7; page_id++) {
+    EXPECT_TRUE(disk_manager->ReadPage(page_id, buffer));
+    EXPECT_EQ(0, memcmp(page_id == 6 ? data[0] : data[page_id], buffer,
+                        PAGE_SIZE))
+        << page_id;
+  }
+  // freed == reads as never written
+  EXPECT_TRUE(disk_manager->ReadPage(7, buffer));
+  EXPECT_EQ(0, buffer[0]);
+  delete disk_manager;
+  remove("test.db");
+
+  // page size of a compressed file from its header page
+  disk_manager = new DiskManager("test.db", 1024, false, "", true);
+  std::vector<char> header(1024, 0);
+  int32_t page_size = 1024;
+  memcpy(&header[HEADER_PAGE_SIZE_OFFSET], &page_size, 4);
+  disk_manager->WritePage(disk_manager->AllocatePage(), header.data());
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(1024, disk_manager->GetPageSize());
+  delete disk_manager;
+
+  // empty file == plain, the stale map goes
+  remove("test.db");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->IsCompressed());
+  EXPECT_NE(0, stat("test.map", &file_stat));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.log");
+}
+
+// text pages written in flush sized runs, then scanned: plain vs
+// compressed. file in the OS page cache for both == the cpu cost of
+// compression against 1/ratio the bytes through the page cache / disk.
+// not in the default run, no timing asserted:
+// --gtest_also_run_disabled_tests
+TEST(DiskManagerTest, DISABLED_CompressionBenchmark) {
+  const int num_pages = 8192;
+  const int run_pages = 32;
+  const int num_scans = 4;
+  std::vector<char> pages(num_pages * PAGE_SIZE);
+  for (int page_id = 0; page_id < num_pages; page_id++) {
+    FillTextPage(&pages[page_id * PAGE_SIZE], PAGE_SIZE, page_id);
+  }
+
+  for (bool compress : {false, true}) {
+    remove("test.db");
+    remove("test.fsm");
+    remove("test.map");
+    DiskManager *disk_manager =
+        new DiskManager("test.db", PAGE_SIZE, false, "", compress);
+    for (int page_id = 0; page_id < num_pages; page_id++) {
+      disk_manager->AllocatePage();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int page_id = 0; page_id < num_pages; page_id += run_pages) {
+      disk_manager->WritePages(page_id, &pages[page_id * PAGE_SIZE],
+                               run_pages);
+    }
+    disk_manager->SyncPages();
+    std::chrono::duration<double> write_s =
+        std::chrono::steady_clock::now() - start;
+
+    char buffer[PAGE_SIZE];
+    start = std::chrono::steady_clock::now();
+    for (int scan = 0; scan < num_scans; scan++) {
+      for (int page_id = 0; page_id < num_pages; page_id++) {
+        disk_manager->ReadPage(page_id, buffer);
+      }
+    }
+    std::chrono::duration<double> scan_s =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(0, memcmp(&pages[(num_pages - 1) * PAGE_SIZE], buffer,
+                        PAGE_SIZE));
+
+    struct stat file_stat;
+    ASSERT_EQ(0, stat("test.db", &file_stat));
+    double mb = static_cast<double>(num_pages) * PAGE_SIZE / 1e6;
+    printf("%s: file %.2f MB (ratio %.2f), write %.0f MB/s, scan %.0f "
+           "MB/s\n",
+           compress ? "compressed" : "plain", file_stat.st_size / 1e6,
+           mb * 1e6 / file_stat.st_size, mb / write_s.count(),
+           num_scans * mb / scan_s.count());
+    delete disk_manager;
+  }
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.map");
+  remove("test.log");
+}
+
+// what DiskManager used to do: 1 fstream, 1 latch around seek + read/write
+class StreamPageFile {
+public:
+  explicit StreamPageFile(const std::string &file_name) {
+    io_.open(file_name, std::ios::binary | std::ios::trunc | std::ios::out);
+    io_.close();
+    io_.open(file_name, std::ios::binary | std::ios::in | std::ios::out);
+  }
+  void WritePage(page_id_t page_id, const char *page_data) {
+    std::lock_guard<std::mutex> guard(latch_);
+    io_.seekp(static_cast<int64_t>(page_id) * PAGE_SIZE);
+    io_.write(page_data, PAGE_SIZE);
+    io_.flush();
+  }
+  void ReadPage(page_id_t page_id, char *page_data) {
+    std::lock_guard<std::mutex> guard(latch_);
+    io_.seekp(static_cast<int64_t>(page_id) * PAGE_SIZE);
+    io_.read(page_data, PAGE_SIZE);
+    io_.clear();
+  }
+
+private:
+  std::fstream io_;
+  std::mutex latch_;
+};
+
+// microbenchmark: random page reads + writes (1 in 4), pread/pwrite
+// DiskManager vs the old shared stream, file in the OS page cache. not in
+// the default run, no timing asserted: --gtest_also_run_disabled_tests
+TEST(DiskManagerTest, DISABLED_PositionalIOBenchmark) {
+  const int num_pages = 1024;
+  const int ops_per_thread = 20000;
+
+  auto run = [&](int num_threads, auto &file) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.push_back(std::thread([&, tid]() {
+        char data[PAGE_SIZE] = {};
+        uint32_t seed = tid + 1;
+        for (int i = 0; i < ops_per_thread; i++) {
+          seed = seed * 1103515245 + 12345;
+          page_id_t page_id = (seed >> 8) % num_pages;
+          if (i % 4 == 0) {
+            file.WritePage(page_id, data);
+          } else {
+            file.ReadPage(page_id, data);
+          }
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return num_threads * ops_per_thread / elapsed.count() / 1e3;
+  };
+
+  char data[PAGE_SIZE] = {};
+  DiskManager *disk_manager = new DiskManager("test.db");
+  StreamPageFile stream("test_stream.db");
+  for (int page_id = 0; page_id < num_pages; page_id++) {
+    disk_manager->WritePage(page_id, data);
+    stream.WritePage(page_id, data);
+  }
+
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    double positional_kops = run(num_threads, *disk_manager);
+    double stream_kops = run(num_threads, stream);
+    printf("%d threads: pread/pwrite %.0f Kops/s, fstream %.0f Kops/s\n",
+           num_threads, positional_kops, stream_kops);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test_stream.db");
+}
+
+} // namespace cmudb
@@ -0,0 +1,169 @@
+/**
+ * lock_free_hash_table_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "common/exception.h"
+#include "hash/lock_free_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LockFreeHashTableTest, SampleTest) {
+  LockFreeHashTable<int, int> test(8);
+  EXPECT_EQ(16, test.GetNumSlots());
+
+  for (int i = 0; i < 8; i++) {
+    test.Insert(i, i * 10);
+  }
+  EXPECT_EQ(8, test.Size());
+  // full
+  EXPECT_THROW(test.Insert(100, 100), Exception);
+  // overwrite is not a new key
+  test.Insert(3, 33);
+  EXPECT_EQ(8, test.Size());
+
+  // find test
+  int result;
+  EXPECT_TRUE(test.Find(3, result));
+  EXPECT_EQ(33, result);
+  EXPECT_TRUE(test.Find(7, result));
+  EXPECT_EQ(70, result);
+  EXPECT_FALSE(test.Find(8, result));
+
+  // delete test
+  EXPECT_TRUE(test.Remove(3));
+  EXPECT_FALSE(test.Remove(3));
+  EXPECT_FALSE(test.Remove(20));
+  EXPECT_FALSE(test.Find(3, result));
+  EXPECT_EQ(7, test.Size());
+  test.Insert(100, 100);
+  EXPECT_TRUE(test.Find(100, result));
+  EXPECT_EQ(100, result);
+}
+
+// removes shift colliding keys back, none of them may get lost
+TEST(LockFreeHashTableTest, RemoveShiftTest) {
+  const int num_keys = 500;
+  LockFreeHashTable<int, int> test(num_keys);
+  for (int run = 0; run < 3; run++) {
+    for (int i = 0; i < num_keys; i++) {
+      test.Insert(i, i + run);
+    }
+    // remove every other key, in an order unrelated to slots
+    for (int i = num_keys - 1; i >= 0; i -= 2) {
+      EXPECT_TRUE(test.Remove(i));
+    }
+    int result;
+    for (int i = 0; i < num_keys; i++) {
+      EXPECT_EQ(i % 2 == 0, test.Find(i, result));
+      if (i % 2 == 0) {
+        EXPECT_EQ(i + run, result);
+      }
+    }
+    for (int i = 0; i < num_keys; i += 2) {
+      EXPECT_TRUE(test.Remove(i));
+    }
+    EXPECT_EQ(0, test.Size());
+  }
+}
+
+// readers never miss a key that stays in the table, while a writer keeps
+// inserting / removing (shifting) keys around it
+TEST(LockFreeHashTableTest, ConcurrentFindTest) {
+  const int num_readers = 4;
+  const int stable_keys = 64;
+  const int churn_keys = 128;
+  LockFreeHashTable<int, int> test(stable_keys + churn_keys);
+  for (int i = 0; i < stable_keys; i++) {
+    test.Insert(i, i);
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_readers; tid++) {
+    threads.push_back(std::thread([&test, &stop, &misses]() {
+      int result;
+      while (!stop) {
+        for (int i = 0; i < stable_keys; i++) {
+          if (!test.Find(i, result) || result != i) {
+            misses++;
+          }
+        }
+      }
+    }));
+  }
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < churn_keys; i++) {
+      test.Insert(stable_keys + i, i);
+    }
+    for (int i = 0; i < churn_keys; i++) {
+      test.Remove(stable_keys + i);
+    }
+  }
+  stop = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, misses);
+  EXPECT_EQ(stable_keys, test.Size());
+}
+
+// microbenchmark: lookups/sec vs a mutex guarded std::unordered_map, the
+// way the old page table was used (every lookup under 1 latch). not in the
+// default run, no timing asserted: --gtest_also_run_disabled_tests
+TEST(LockFreeHashTableTest, DISABLED_LookupBenchmark) {
+  const int num_keys = 1024;
+  const int lookups_per_thread = 200000;
+  LockFreeHashTable<int, int> lock_free(num_keys);
+  std::unordered_map<int, int> locked;
+  std::mutex latch;
+  for (int i = 0; i < num_keys; i++) {
+    lock_free.Insert(i, i);
+    locked[i] = i;
+  }
+
+  auto run = [&](int num_threads, bool use_lock_free) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.push_back(std::thread([&, tid]() {
+        int result = 0;
+        for (int i = 0; i < lookups_per_thread; i++) {
+          int key = (i * 7 + tid) % num_keys;
+          if (use_lock_free) {
+            lock_free.Find(key, result);
+          } else {
+            std::lock_guard<std::mutex> guard(latch);
+            result = locked.find(key)->second;
+          }
+        }
+        EXPECT_GE(result, 0);
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return num_threads * lookups_per_thread / elapsed.count() / 1e6;
+  };
+
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    double lock_free_mops = run(num_threads, true);
+    double locked_mops = run(num_threads, false);
+    printf("%d threads: lock free %.1f Mlookups/s, mutex + unordered_map "
+           "%.1f Mlookups/s\n",
+           num_threads, lock_free_mops, locked_mops);
+  }
+}
+
+} // namespace cmudb
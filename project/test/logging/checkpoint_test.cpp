@@ -0,0 +1,351 @@
+/**
+ * checkpoint_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "logging/checkpoint_manager.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the log from offset on, record at offset == lsn
+static std::vector<LogRecord> ReadLogRecords(DiskManager *disk_manager,
+                                             int64_t offset, lsn_t lsn) {
+  std::vector<char> log(1 << 20);
+  disk_manager->ReadLog(log.data(), log.size(), offset);
+  std::vector<LogRecord> log_records;
+  size_t pos = 0;
+  LogRecord log_record;
+  while (log_record.DeserializeFrom(log.data() + pos, log.size() - pos,
+                                    lsn + log_records.size())) {
+    pos += log_record.GetSize();
+    log_records.push_back(log_record);
+  }
+  return log_records;
+}
+
+struct MasterRecord {
+  lsn_t checkpoint_lsn_;
+  int64_t checkpoint_offset_;
+  lsn_t redo_lsn_;
+  int64_t redo_offset_;
+};
+
+// as recovery reads it, off disk
+static MasterRecord ReadMasterRecord(DiskManager *disk_manager) {
+  std::vector<char> data(disk_manager->GetPageSize());
+  disk_manager->ReadPage(HEADER_PAGE_ID, data.data());
+  MasterRecord master;
+  memcpy(&master.checkpoint_lsn_, data.data() + HEADER_MASTER_RECORD_OFFSET, 4);
+  memcpy(&master.checkpoint_offset_,
+         data.data() + HEADER_MASTER_RECORD_OFFSET + 4, 8);
+  memcpy(&master.redo_lsn_, data.data() + HEADER_MASTER_RECORD_OFFSET + 12, 4);
+  memcpy(&master.redo_offset_, data.data() + HEADER_MASTER_RECORD_OFFSET + 16,
+         8);
+  return master;
+}
+
+// records of txn, prev lsn chained like table page changes do
+static lsn_t AppendNewPage(LogManager *log_manager, Transaction *txn,
+                           page_id_t page_id) {
+  LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                       LogRecordType::NEWPAGE, page_id, INVALID_PAGE_ID);
+  lsn_t lsn = log_manager->AppendLogRecord(log_record);
+  txn->SetPrevLSN(lsn);
+  return lsn;
+}
+
+TEST(CheckpointTest, SampleTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  TransactionManager *txn_manager = new TransactionManager(nullptr, log_manager);
+  page_id_t header_page_id;
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushAllPages();
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  // t1 active w a change, its page dirty since lsn 3. t2 done
+  Transaction *t1 = txn_manager->Begin();
+  Transaction *t2 = txn_manager->Begin();
+  txn_manager->Commit(t2);
+  delete t2;
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(3, AppendNewPage(log_manager, t1, page_id));
+  bpm->UnpinPage(page_id, true);
+
+  // redo from t1's BEGIN == log start
+  EXPECT_EQ(4, checkpoint_manager->Checkpoint());
+  MasterRecord master = ReadMasterRecord(disk_manager);
+  EXPECT_EQ(4, master.checkpoint_lsn_);
+  EXPECT_EQ(0, master.redo_lsn_);
+  EXPECT_EQ(0, master.redo_offset_);
+  EXPECT_EQ(0, checkpoint_manager->GetRedoLSN());
+  std::vector<LogRecord> log_records =
+      ReadLogRecords(disk_manager, master.checkpoint_offset_, 4);
+  ASSERT_EQ(2, log_records.size());
+  EXPECT_EQ(LogRecordType::BEGIN_CHECKPOINT,
+            log_records[0].GetLogRecordType());
+  EXPECT_EQ(LogRecordType::END_CHECKPOINT, log_records[1].GetLogRecordType());
+  EXPECT_EQ((std::vector<std::pair<txn_id_t, lsn_t>>{
+                {t1->GetTransactionId(), 3}}),
+            log_records[1].GetActiveTxns());
+  EXPECT_EQ((std::vector<std::pair<page_id_t, lsn_t>>{{page_id, 3}}),
+            log_records[1].GetDirtyPages());
+  // whole log from the start agrees on lsns
+  EXPECT_EQ(6, ReadLogRecords(disk_manager, 0, 0).size());
+
+  // nothing active, nothing dirty == redo from the checkpoint itself
+  txn_manager->Commit(t1);
+  delete t1;
+  bpm->FlushAllPages();
+  lsn_t checkpoint_lsn = checkpoint_manager->Checkpoint();
+  master = ReadMasterRecord(disk_manager);
+  EXPECT_EQ(checkpoint_lsn, master.checkpoint_lsn_);
+  EXPECT_EQ(checkpoint_lsn, master.redo_lsn_);
+  EXPECT_EQ(master.checkpoint_offset_, master.redo_offset_);
+  log_records = ReadLogRecords(disk_manager, master.redo_offset_,
+                               master.redo_lsn_);
+  ASSERT_EQ(2, log_records.size());
+  EXPECT_EQ(LogRecordType::BEGIN_CHECKPOINT,
+            log_records[0].GetLogRecordType());
+  EXPECT_TRUE(log_records[1].GetActiveTxns().empty());
+  EXPECT_TRUE(log_records[1].GetDirtyPages().empty());
+
+  // page changed after it holds redo there, till the next checkpoint writes
+  // it as an old page
+  Transaction *t3 = txn_manager->Begin();
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+  AppendNewPage(log_manager, t3, page_id);
+  bpm->UnpinPage(page_id, true);
+  txn_manager->Commit(t3);
+  delete t3;
+  EXPECT_NE(INVALID_LSN, checkpoint_manager->Checkpoint());
+  EXPECT_EQ(checkpoint_lsn, checkpoint_manager->GetRedoLSN());
+  lsn_t last_lsn = checkpoint_manager->Checkpoint();
+  EXPECT_EQ(last_lsn, checkpoint_manager->GetRedoLSN());
+  EXPECT_EQ(last_lsn, ReadMasterRecord(disk_manager).redo_lsn_);
+
+  delete checkpoint_manager;
+  log_manager->StopFlushThread();
+  delete txn_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// reopened log goes on w the next lsn, at the end of its last whole record
+TEST(CheckpointTest, ResumeTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  TransactionManager *txn_manager = new TransactionManager(nullptr, log_manager);
+  page_id_t page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  bpm->FlushAllPages();
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  // records before n after the checkpoint
+  for (int i = 0; i < 6; ++i) {
+    Transaction *txn = txn_manager->Begin();
+    txn_manager->Commit(txn);
+    delete txn;
+    if (i == 2) {
+      EXPECT_EQ(6, checkpoint_manager->Checkpoint());
+    }
+  }
+  log_manager->StopFlushThread();
+  lsn_t next_lsn = log_manager->GetNextLSN();
+  int64_t next_offset = log_manager->GetNextOffset();
+  EXPECT_EQ(14, next_lsn);
+  delete checkpoint_manager;
+  delete txn_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+
+  // crash in the middle of writing a record
+  FILE *log_file = fopen("test.log", "ab");
+  ASSERT_NE(nullptr, log_file);
+  const char torn[] = {0x40, 0x01, 0x02};
+  fwrite(torn, 1, sizeof(torn), log_file);
+  fclose(log_file);
+
+  disk_manager = new DiskManager("test.db");
+  log_manager = new LogManager(disk_manager);
+  EXPECT_EQ(next_lsn, log_manager->GetNextLSN());
+  EXPECT_EQ(next_offset, log_manager->GetNextOffset());
+  EXPECT_EQ(next_offset, disk_manager->GetLogSize());
+  EXPECT_EQ(next_lsn - 1, log_manager->GetPersistentLSN());
+
+  txn_manager = new TransactionManager(nullptr, log_manager);
+  log_manager->RunFlushThread();
+  Transaction *txn = txn_manager->Begin();
+  txn_manager->Commit(txn);
+  delete txn;
+  log_manager->StopFlushThread();
+  // torn bytes gone, lsns agree from the start of the log
+  std::vector<LogRecord> log_records = ReadLogRecords(disk_manager, 0, 0);
+  ASSERT_EQ(next_lsn + 2, static_cast<lsn_t>(log_records.size()));
+  EXPECT_EQ(LogRecordType::BEGIN, log_records[next_lsn].GetLogRecordType());
+  EXPECT_EQ(next_lsn, log_records[next_lsn].GetLSN());
+
+  delete txn_manager;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// DPT bigger than a log buffer == several END_CHECKPOINT records
+TEST(CheckpointTest, SplitTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager, 256);
+  BufferPoolManager *bpm = new BufferPoolManager(64, disk_manager, log_manager);
+  TransactionManager *txn_manager = new TransactionManager(nullptr, log_manager);
+  page_id_t page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  const int num_pages = 50;
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  lsn_t checkpoint_lsn = checkpoint_manager->Checkpoint();
+  MasterRecord master = ReadMasterRecord(disk_manager);
+  std::vector<LogRecord> log_records = ReadLogRecords(
+      disk_manager, master.checkpoint_offset_, checkpoint_lsn);
+  ASSERT_LT(2, log_records.size());
+  std::unordered_map<page_id_t, lsn_t> dirty_pages;
+  for (size_t i = 1; i < log_records.size(); ++i) {
+    EXPECT_EQ(LogRecordType::END_CHECKPOINT,
+              log_records[i].GetLogRecordType());
+    EXPECT_GE(256, log_records[i].GetSize());
+    for (auto &entry : log_records[i].GetDirtyPages()) {
+      EXPECT_TRUE(dirty_pages.insert(entry).second);
+    }
+  }
+  // header page n the new ones, nothing logged before them
+  EXPECT_EQ(num_pages + 1, dirty_pages.size());
+  EXPECT_EQ(0, master.redo_lsn_);
+
+  delete checkpoint_manager;
+  log_manager->StopFlushThread();
+  delete txn_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// checkpoint thread keeps the master record moving
+TEST(CheckpointTest, ThreadTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  TransactionManager *txn_manager = new TransactionManager(nullptr, log_manager);
+  page_id_t page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  checkpoint_manager->RunCheckpointThread(std::chrono::milliseconds(5));
+  for (int i = 0; i < 20; ++i) {
+    Transaction *txn = txn_manager->Begin();
+    txn_manager->Commit(txn);
+    delete txn;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  checkpoint_manager->StopCheckpointThread();
+  MasterRecord master = ReadMasterRecord(disk_manager);
+  EXPECT_LT(0, master.checkpoint_lsn_);
+  EXPECT_LT(0, master.redo_lsn_);
+  std::vector<LogRecord> log_records = ReadLogRecords(
+      disk_manager, master.checkpoint_offset_, master.checkpoint_lsn_);
+  ASSERT_LE(2, log_records.size());
+  EXPECT_EQ(LogRecordType::BEGIN_CHECKPOINT,
+            log_records[0].GetLogRecordType());
+  EXPECT_EQ(log_manager->GetNextLSN(),
+            master.checkpoint_lsn_ + static_cast<lsn_t>(log_records.size()));
+
+  delete checkpoint_manager;
+  log_manager->StopFlushThread();
+  delete txn_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// deleted pages reusable after the next checkpoint but one: by then every
+// page dirty before the delete was written
+TEST(CheckpointTest, FreePagesTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  TransactionManager *txn_manager = new TransactionManager(nullptr, log_manager);
+  page_id_t page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  page_id_t page_ids[2];
+  for (auto &id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(id));
+    bpm->UnpinPage(id, true);
+  }
+  EXPECT_TRUE(bpm->DeletePage(page_ids[0]));
+  ASSERT_NE(INVALID_LSN, checkpoint_manager->Checkpoint());
+  EXPECT_TRUE(bpm->DeletePage(page_ids[1]));
+  EXPECT_TRUE(disk_manager->IsAllocated(page_ids[0]));
+  ASSERT_NE(INVALID_LSN, checkpoint_manager->Checkpoint());
+  EXPECT_FALSE(disk_manager->IsAllocated(page_ids[0]));
+  EXPECT_TRUE(disk_manager->IsAllocated(page_ids[1]));
+  ASSERT_NE(INVALID_LSN, checkpoint_manager->Checkpoint());
+  EXPECT_FALSE(disk_manager->IsAllocated(page_ids[1]));
+
+  delete checkpoint_manager;
+  log_manager->StopFlushThread();
+  delete txn_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+} // namespace cmudb
@@ -0,0 +1,246 @@
+/**
+ * group_commit_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "logging/log_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the log from the start, deserialized in lsn order
+static std::vector<LogRecord> ReadLogRecords(DiskManager *disk_manager) {
+  std::vector<char> log(1 << 20);
+  disk_manager->ReadLog(log.data(), log.size(), 0);
+  std::vector<LogRecord> log_records;
+  size_t offset = 0;
+  LogRecord log_record;
+  while (log_record.DeserializeFrom(log.data() + offset, log.size() - offset,
+                                    log_records.size())) {
+    offset += log_record.GetSize();
+    log_records.push_back(log_record);
+  }
+  return log_records;
+}
+
+// each thread appends n waits on num_commits COMMIT records
+static void Commit(LogManager *log_manager, int num_threads, int num_commits) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([=]() {
+      for (int i = 0; i < num_commits; ++i) {
+        LogRecord log_record(t, INVALID_LSN, LogRecordType::COMMIT);
+        lsn_t lsn = log_manager->AppendLogRecord(log_record);
+        log_manager->WaitForFlush(lsn);
+        EXPECT_LE(lsn, log_manager->GetPersistentLSN());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(GroupCommitTest, SampleTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  // 1 committer == 1 flush per commit, already durable == no flush
+  LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+  EXPECT_EQ(0, log_manager->AppendLogRecord(begin));
+  LogRecord commit(0, 0, LogRecordType::COMMIT);
+  EXPECT_EQ(1, log_manager->AppendLogRecord(commit));
+  EXPECT_EQ(INVALID_LSN, log_manager->GetPersistentLSN());
+  log_manager->WaitForFlush(0);
+  EXPECT_EQ(1, log_manager->GetPersistentLSN());
+  EXPECT_EQ(1, disk_manager->GetNumFlushes());
+  log_manager->WaitForFlush(1);
+  log_manager->ForceFlushWAL();
+  EXPECT_EQ(1, disk_manager->GetNumFlushes());
+
+  // leader waits for the batch == far fewer flushes than commits
+  const int num_threads = 8, num_commits = 50;
+  log_manager->SetGroupCommit(std::chrono::milliseconds(10), num_threads);
+  Commit(log_manager, num_threads, num_commits);
+  int num_records = 2 + num_threads * num_commits;
+  EXPECT_EQ(num_records - 1, log_manager->GetPersistentLSN());
+  EXPECT_GT(num_threads * num_commits / 2, disk_manager->GetNumFlushes());
+
+  // log holds every record once, in lsn order
+  std::vector<LogRecord> log_records = ReadLogRecords(disk_manager);
+  ASSERT_EQ(num_records, log_records.size());
+  EXPECT_EQ(LogRecordType::BEGIN, log_records[0].GetLogRecordType());
+  EXPECT_EQ(0, log_records[1].GetPrevLSN());
+  for (int i = 2; i < num_records; ++i) {
+    EXPECT_EQ(LogRecordType::COMMIT, log_records[i].GetLogRecordType());
+    EXPECT_EQ(INVALID_LSN, log_records[i].GetPrevLSN());
+  }
+
+  // flush thread: whatever nobody waited on goes out by StopFlushThread
+  log_manager->RunFlushThread();
+  EXPECT_TRUE(ENABLE_LOGGING);
+  LogRecord abort(1, INVALID_LSN, LogRecordType::ABORT);
+  lsn_t lsn = log_manager->AppendLogRecord(abort);
+  log_manager->StopFlushThread();
+  EXPECT_FALSE(ENABLE_LOGGING);
+  EXPECT_EQ(lsn, log_manager->GetPersistentLSN());
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// appends from many threads into a small buffer: slots reserved w/o
+// lock_WAL_, buffers swapped over n over while others are still copying
+TEST(GroupCommitTest, ReservationTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager, 256, 3);
+
+  // NEWPAGE record i of thread t points at page t * num_appends + i
+  const int num_threads = 8, num_appends = 500;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([=]() {
+      for (int i = 0; i < num_appends; ++i) {
+        if (i % 2 == 0) {
+          LogRecord log_record(t, INVALID_LSN, LogRecordType::NEWPAGE,
+                               t * num_appends + i, INVALID_PAGE_ID);
+          log_manager->AppendLogRecord(log_record);
+        } else {
+          LogRecord log_record(t, INVALID_LSN, LogRecordType::COMMIT);
+          log_manager->AppendLogRecord(log_record);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager->ForceFlushWAL();
+  int num_records = num_threads * num_appends;
+  EXPECT_EQ(num_records, log_manager->GetNextLSN());
+  EXPECT_EQ(num_records - 1, log_manager->GetPersistentLSN());
+  EXPECT_LT(num_records * 4 / 256, disk_manager->GetNumFlushes());
+
+  // every record once, lsn order, no torn / interleaved slots
+  std::vector<LogRecord> log_records = ReadLogRecords(disk_manager);
+  ASSERT_EQ(num_records, log_records.size());
+  std::vector<bool> seen(num_records);
+  for (auto &log_record : log_records) {
+    if (log_record.GetLogRecordType() == LogRecordType::NEWPAGE) {
+      page_id_t page_id = log_record.GetNewPageId();
+      EXPECT_EQ(log_record.GetTxnId(), page_id / num_appends);
+      EXPECT_FALSE(seen[page_id]);
+      seen[page_id] = true;
+    } else {
+      EXPECT_EQ(LogRecordType::COMMIT, log_record.GetLogRecordType());
+    }
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// full buffers are sealed n queued, IO only once the ring is full
+TEST(GroupCommitTest, RingTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // 5 COMMIT records (4 bytes) per buffer
+  LogManager *log_manager = new LogManager(disk_manager, 20, 4);
+  for (int i = 0; i < 20; ++i) {
+    LogRecord log_record(0, INVALID_LSN, LogRecordType::COMMIT);
+    EXPECT_EQ(i, log_manager->AppendLogRecord(log_record));
+  }
+  EXPECT_EQ(0, disk_manager->GetNumFlushes());
+  EXPECT_EQ(INVALID_LSN, log_manager->GetPersistentLSN());
+
+  // ring full: 3 sealed + the current 1 written, 1 write each
+  LogRecord log_record(0, INVALID_LSN, LogRecordType::COMMIT);
+  EXPECT_EQ(20, log_manager->AppendLogRecord(log_record));
+  EXPECT_EQ(4, disk_manager->GetNumFlushes());
+  EXPECT_EQ(19, log_manager->GetPersistentLSN());
+
+  log_manager->ForceFlushWAL();
+  EXPECT_EQ(5, disk_manager->GetNumFlushes());
+  EXPECT_EQ(21, ReadLogRecords(disk_manager).size());
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// appends/s across thread counts n ring sizes, nobody waiting on a flush,
+// the flush thread writing sealed buffers. 2 buffers == appenders stall
+// while 1 is in flight n the other fills up. not in the default run, no
+// timing asserted: --gtest_also_run_disabled_tests
+TEST(GroupCommitTest, DISABLED_AppendBenchmark) {
+  const int total_appends = 1 << 20;
+  for (size_t num_buffers : {2, 8}) {
+    for (int num_threads : {1, 2, 4, 8}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      LogManager *log_manager =
+          new LogManager(disk_manager, 1 << 16, num_buffers);
+      log_manager->RunFlushThread();
+      std::vector<std::thread> threads;
+      auto start = std::chrono::steady_clock::now();
+      for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([=]() {
+          for (int i = 0; i < total_appends / num_threads; ++i) {
+            LogRecord log_record(t, INVALID_LSN, LogRecordType::NEWPAGE, i,
+                                 INVALID_PAGE_ID);
+            log_manager->AppendLogRecord(log_record);
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      log_manager->StopFlushThread();
+      printf("%zu buffers, %d threads: %6.2f M appends/s\n", num_buffers,
+             num_threads, total_appends / elapsed.count() / 1e6);
+      delete log_manager;
+      delete disk_manager;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
+// commits/s across thread counts: no delay (leader flushes at once, commits
+// arriving meanwhile make the next group) vs a commit delay. not in the
+// default run, no timing asserted: --gtest_also_run_disabled_tests
+TEST(GroupCommitTest, DISABLED_CommitBenchmark) {
+  const int total_commits = 2000;
+  for (int delay_us : {0, 200}) {
+    for (int num_threads : {1, 2, 4, 8, 16}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      LogManager *log_manager = new LogManager(disk_manager);
+      log_manager->SetGroupCommit(std::chrono::microseconds(delay_us),
+                                  num_threads);
+      auto start = std::chrono::steady_clock::now();
+      Commit(log_manager, num_threads, total_commits / num_threads);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      int flushes = disk_manager->GetNumFlushes();
+      printf("delay %3d us, %2d threads: %8.0f commits/s, %5.1f commits/fsync\n",
+             delay_us, num_threads, total_commits / elapsed.count(),
+             static_cast<double>(total_commits) / flushes);
+      delete log_manager;
+      delete disk_manager;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
+} // namespace cmudb
@@ -49,12 +49,14 @@ TEST(LogManagerTest, BasicLogging) {
   // some basic manually checking here
   char buffer[PAGE_SIZE];
   storage_engine->disk_manager_->ReadLog(buffer, PAGE_SIZE, 0);
-  int32_t size = *reinterpret_cast<int32_t *>(buffer);
-  LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 20);
-  LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 44);
-  LOG_DEBUG("size  = %d", size);
+  LogRecord log_record;
+  int offset = 0;
+  for (lsn_t lsn = 0; log_record.DeserializeFrom(buffer + offset,
+                                                 PAGE_SIZE - offset, lsn);
+       ++lsn) {
+    LOG_DEBUG("%s", log_record.ToString().c_str());
+    offset += log_record.GetSize();
+  }
 
   delete txn;
   delete storage_engine;
@@ -76,8 +78,17 @@ TEST(LogManagerTest, BasicLogging) {
 TEST(LogManagerTest, RedoTestWithOneTxn) {
 
 
-  // 1. init managers 
+  // 1. init managers, header page 1st like OpenStorageEngine: reopening
+  // checks its format
+  remove("test.db");
+  remove("test.log");
   StorageEngine *storage_engine = new StorageEngine("test.db");
+  page_id_t header_page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      storage_engine->buffer_pool_manager_->NewPage(header_page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  header_page->Init();
+  storage_engine->buffer_pool_manager_->UnpinPage(header_page_id, true);
   Transaction *txn = storage_engine->transaction_manager_->Begin();
 
   EXPECT_FALSE(ENABLE_LOGGING);
@@ -129,16 +140,9 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   delete storage_engine;
 
   // restart system
+  // 6. log recovered by the constructor, before any thread runs
   storage_engine = new StorageEngine("test.db");
-
-
-
-  // 6. init log_recovery struct 
-  LogRecovery *log_recovery = new LogRecovery(
-      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_);
-
-  log_recovery->Redo();
-  log_recovery->Undo();
+  EXPECT_FALSE(ENABLE_LOGGING);
 
   
   
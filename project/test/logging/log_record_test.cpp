@@ -0,0 +1,200 @@
+/**
+ * log_record_test.cpp
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "disk/disk_manager.h"
+#include "logging/log_record.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+static Tuple MakeTuple(const std::vector<char> &data) {
+  Tuple tuple;
+  tuple.DeserializeFrom(data.data(), data.size());
+  return tuple;
+}
+
+static bool SameData(const Tuple &a, const Tuple &b) {
+  return a.GetLength() == b.GetLength() &&
+         memcmp(a.GetData(), b.GetData(), a.GetLength()) == 0;
+}
+
+// serialize as if appended at lsn, deserialize back
+static bool RoundTrip(LogRecord &log_record, lsn_t lsn, LogRecord &out,
+                      std::vector<char> &bytes) {
+  int32_t size = log_record.GetSerializedSize(lsn);
+  bytes.assign(size + 8, 0);
+  log_record.SerializeTo(bytes.data(), lsn);
+  bytes.resize(size);
+  return out.DeserializeFrom(bytes.data(), bytes.size(), lsn) &&
+         out.GetSize() == size;
+}
+
+TEST(LogRecordTest, SampleTest) {
+  std::vector<char> bytes;
+  LogRecord out;
+
+  // txn record: size, type, txn id, lsn delta == 4 bytes
+  LogRecord commit(7, 100, LogRecordType::COMMIT);
+  ASSERT_TRUE(RoundTrip(commit, 103, out, bytes));
+  EXPECT_EQ(4, out.GetSize());
+  EXPECT_EQ(LogRecordType::COMMIT, out.GetLogRecordType());
+  EXPECT_EQ(103, out.GetLSN());
+  EXPECT_EQ(100, out.GetPrevLSN());
+  EXPECT_EQ(7, out.GetTxnId());
+  LogRecord begin(8, INVALID_LSN, LogRecordType::BEGIN);
+  ASSERT_TRUE(RoundTrip(begin, 1 << 30, out, bytes));
+  EXPECT_EQ(INVALID_LSN, out.GetPrevLSN());
+  EXPECT_EQ(4, out.GetSize());
+  // far prev lsn == longer varint
+  LogRecord abort(8, 0, LogRecordType::ABORT);
+  ASSERT_TRUE(RoundTrip(abort, 1 << 20, out, bytes));
+  EXPECT_EQ(0, out.GetPrevLSN());
+  EXPECT_EQ(6, out.GetSize());
+
+  std::vector<char> data(100);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i;
+  }
+  Tuple tuple = MakeTuple(data);
+  RID rid(DiskManager::MakePageId(3, 1000), 17);
+  LogRecord insert(1, 0, LogRecordType::INSERT, rid, tuple);
+  ASSERT_TRUE(RoundTrip(insert, 1, out, bytes));
+  EXPECT_EQ(rid, out.GetInsertRID());
+  EXPECT_TRUE(SameData(tuple, out.GetInserteTuple()));
+  LogRecord mark_delete(1, 1, LogRecordType::MARKDELETE, rid, tuple);
+  ASSERT_TRUE(RoundTrip(mark_delete, 2, out, bytes));
+  EXPECT_EQ(LogRecordType::MARKDELETE, out.GetLogRecordType());
+  EXPECT_EQ(rid, out.GetDeleteRID());
+
+  LogRecord new_page(1, 2, LogRecordType::NEWPAGE, 5, INVALID_PAGE_ID);
+  ASSERT_TRUE(RoundTrip(new_page, 3, out, bytes));
+  EXPECT_EQ(5, out.GetNewPageId());
+  EXPECT_EQ(INVALID_PAGE_ID, out.GetPrevPageId());
+  EXPECT_EQ(6, out.GetSize());
+
+  // update: 2 bytes changed in 1 place == old tuple + 1 short range
+  std::vector<char> new_data = data;
+  new_data[40] = 'x';
+  new_data[41] = 'y';
+  LogRecord update(1, 3, LogRecordType::UPDATE, rid, tuple,
+                   MakeTuple(new_data));
+  ASSERT_TRUE(RoundTrip(update, 4, out, bytes));
+  EXPECT_EQ(rid, out.GetUpdateRID());
+  EXPECT_TRUE(SameData(tuple, out.GetOldTuple()));
+  EXPECT_TRUE(SameData(MakeTuple(new_data), out.GetNewTuple()));
+  EXPECT_GE(tuple.GetLength() + 16, out.GetSize());
+
+  // every cut short == incomplete, never a record
+  for (int32_t size = 0; size < static_cast<int32_t>(bytes.size()); ++size) {
+    EXPECT_FALSE(out.DeserializeFrom(bytes.data(), size, 4));
+  }
+  // zeros == unwritten log
+  std::vector<char> zeros(64, 0);
+  EXPECT_FALSE(out.DeserializeFrom(zeros.data(), zeros.size(), 0));
+}
+
+// BEGIN_CHECKPOINT == header only, END carries the ATT n DPT
+TEST(LogRecordTest, CheckpointTest) {
+  std::vector<char> bytes;
+  LogRecord out;
+
+  LogRecord begin(INVALID_TXN_ID, INVALID_LSN,
+                  LogRecordType::BEGIN_CHECKPOINT);
+  ASSERT_TRUE(RoundTrip(begin, 1000, out, bytes));
+  EXPECT_EQ(LogRecordType::BEGIN_CHECKPOINT, out.GetLogRecordType());
+  EXPECT_EQ(INVALID_TXN_ID, out.GetTxnId());
+  EXPECT_EQ(4, out.GetSize());
+
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns = {
+      {0, 0}, {7, 999}, {1 << 20, 1 << 30}};
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages = {
+      {HEADER_PAGE_ID, 5}, {DiskManager::MakePageId(3, 1000), 0}};
+  LogRecord end(LogRecordType::END_CHECKPOINT, active_txns, dirty_pages);
+  ASSERT_TRUE(RoundTrip(end, 1001, out, bytes));
+  EXPECT_EQ(LogRecordType::END_CHECKPOINT, out.GetLogRecordType());
+  EXPECT_EQ(active_txns, out.GetActiveTxns());
+  EXPECT_EQ(dirty_pages, out.GetDirtyPages());
+  EXPECT_GE(6 + static_cast<int>(active_txns.size() + dirty_pages.size()) *
+                    LogRecord::MAX_CHECKPOINT_ENTRY_SIZE,
+            out.GetSize());
+
+  // empty tables
+  LogRecord empty(LogRecordType::END_CHECKPOINT, {}, {});
+  ASSERT_TRUE(RoundTrip(empty, 1002, out, bytes));
+  EXPECT_TRUE(out.GetActiveTxns().empty());
+  EXPECT_TRUE(out.GetDirtyPages().empty());
+  EXPECT_EQ(6, out.GetSize());
+
+  // every cut short == incomplete
+  ASSERT_TRUE(RoundTrip(end, 1001, out, bytes));
+  for (int32_t size = 0; size < static_cast<int32_t>(bytes.size()); ++size) {
+    EXPECT_FALSE(out.DeserializeFrom(bytes.data(), size, 1001));
+  }
+}
+
+// random edits of random tuples, new image rebuilt from old + diff
+TEST(LogRecordTest, UpdateDiffTest) {
+  std::mt19937 rng(7);
+  std::vector<char> bytes;
+  LogRecord out;
+  for (int round = 0; round < 1000; ++round) {
+    std::vector<char> old_data(rng() % 300);
+    for (auto &c : old_data) {
+      c = rng() % 4; // repeats == equal bytes inside changed ranges
+    }
+    std::vector<char> new_data = old_data;
+    new_data.resize(rng() % 2 ? old_data.size() : rng() % 300);
+    for (int edits = rng() % 8; edits > 0 && !new_data.empty(); --edits) {
+      new_data[rng() % new_data.size()] = rng();
+    }
+    LogRecord update(round, round - 1, LogRecordType::UPDATE,
+                     RID(round, round), MakeTuple(old_data),
+                     MakeTuple(new_data));
+    ASSERT_TRUE(RoundTrip(update, round, out, bytes));
+    ASSERT_TRUE(SameData(MakeTuple(old_data), out.GetOldTuple()));
+    ASSERT_TRUE(SameData(MakeTuple(new_data), out.GetNewTuple()));
+  }
+}
+
+// update heavy log volume, compact vs the old fixed format (20 bytes header,
+// 8 bytes rid, 4 bytes size + data per tuple image). seeded == sizes exact:
+// 1 full image + the diff + < 32 bytes of header, rid n sizes per update,
+// under 0.6 of the fixed format's 2 images
+TEST(LogRecordTest, UpdateSizeTest) {
+  std::mt19937 rng(11);
+  for (int tuple_size : {64, 256, 1024}) {
+    for (int changed : {4, 16}) {
+      const int num_updates = 10000;
+      int64_t fixed_bytes = 0, compact_bytes = 0;
+      std::vector<char> data(tuple_size);
+      for (auto &c : data) {
+        c = rng();
+      }
+      for (int i = 0; i < num_updates; ++i) {
+        // 1 column (changed bytes) rewritten
+        std::vector<char> new_data = data;
+        int offset = rng() % (tuple_size - changed);
+        for (int j = 0; j < changed; ++j) {
+          new_data[offset + j] = rng();
+        }
+        LogRecord update(i % 16, i >= 16 ? i - 16 : INVALID_LSN,
+                         LogRecordType::UPDATE,
+                         RID(i % 1000, i % 32), MakeTuple(data),
+                         MakeTuple(new_data));
+        fixed_bytes += 20 + sizeof(RID) + 2 * sizeof(int32_t) + 2 * tuple_size;
+        compact_bytes += update.GetSerializedSize(i);
+        data = new_data;
+      }
+      EXPECT_GT(static_cast<int64_t>(tuple_size + changed + 32) * num_updates,
+                compact_bytes);
+      EXPECT_GT(0.6 * fixed_bytes, compact_bytes);
+    }
+  }
+}
+
+} // namespace cmudb
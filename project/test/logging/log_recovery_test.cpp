@@ -0,0 +1,218 @@
+/**
+ * log_recovery_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "logging/checkpoint_manager.h"
+#include "logging/log_recovery.h"
+#include "page/header_page.h"
+#include "table/table_heap.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// len bytes of c
+static Tuple MakeTuple(char c, size_t len = 60) {
+  std::vector<char> data(len, c);
+  Tuple tuple;
+  tuple.DeserializeFrom(data.data(), data.size());
+  return tuple;
+}
+
+// as a scan after recovery sees it: false == deleted / no such slot
+static bool ReadTuple(BufferPoolManager *bpm, const RID &rid, Tuple &tuple) {
+  TablePage *page =
+      static_cast<TablePage *>(bpm->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    return false;
+  }
+  bool found = page->GetTuple(rid, tuple, nullptr, nullptr);
+  bpm->UnpinPage(rid.GetPageId(), false);
+  return found;
+}
+
+static bool SameData(const Tuple &a, const Tuple &b) {
+  return a.GetLength() == b.GetLength() &&
+         memcmp(a.GetData(), b.GetData(), a.GetLength()) == 0;
+}
+
+// the log from offset on, record at offset == lsn
+static std::vector<LogRecord> ReadLogRecords(DiskManager *disk_manager,
+                                             int64_t offset, lsn_t lsn) {
+  std::vector<char> log(1 << 20);
+  disk_manager->ReadLog(log.data(), log.size(), offset);
+  std::vector<LogRecord> log_records;
+  size_t pos = 0;
+  LogRecord log_record;
+  while (log_record.DeserializeFrom(log.data() + pos, log.size() - pos,
+                                    lsn + log_records.size())) {
+    pos += log_record.GetSize();
+    log_records.push_back(log_record);
+  }
+  return log_records;
+}
+
+/*
+ * t1 committed n flushed before checkpoint 1, t2 committed after it (2
+ * pages, 2nd one linked by t2), t3 active through checkpoint 2 n the crash
+ *
+ * redo starts at checkpoint 1 (t2's pages dirty since), t3 rolled back
+ */
+TEST(LogRecoveryTest, CrashAfterCheckpointTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(true);
+  TransactionManager *txn_manager =
+      new TransactionManager(lock_manager, log_manager);
+  page_id_t header_page_id;
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushAllPages();
+  log_manager->RunFlushThread();
+  CheckpointManager *checkpoint_manager =
+      new CheckpointManager(txn_manager, log_manager, bpm);
+
+  // t1: a, b
+  Transaction *t1 = txn_manager->Begin();
+  TableHeap *table =
+      new TableHeap(bpm, lock_manager, log_manager, t1);
+  page_id_t first_page_id = table->GetFirstPageId();
+  RID rid_a, rid_b;
+  ASSERT_TRUE(table->InsertTuple(MakeTuple('a'), rid_a, t1));
+  ASSERT_TRUE(table->InsertTuple(MakeTuple('b'), rid_b, t1));
+  txn_manager->Commit(t1);
+  delete t1;
+  bpm->FlushAllPages();
+  lsn_t checkpoint_1 = checkpoint_manager->Checkpoint();
+  ASSERT_NE(INVALID_LSN, checkpoint_1);
+
+  // t2: fillers till a 2nd page, c on it, a -> a2, b deleted
+  Transaction *t2 = txn_manager->Begin();
+  std::vector<RID> filler_rids;
+  RID rid_c;
+  while (true) {
+    ASSERT_TRUE(table->InsertTuple(MakeTuple('f'), rid_c, t2));
+    if (rid_c.GetPageId() != first_page_id) {
+      break;
+    }
+    filler_rids.push_back(rid_c);
+  }
+  ASSERT_TRUE(table->UpdateTuple(MakeTuple('A'), rid_a, t2));
+  ASSERT_TRUE(table->MarkDelete(rid_b, t2));
+  txn_manager->Commit(t2);
+  delete t2;
+
+  // t3: d, c -> c3, a2 deleted, checkpoint, e
+  Transaction *t3 = txn_manager->Begin();
+  txn_id_t loser = t3->GetTransactionId();
+  RID rid_d, rid_e;
+  ASSERT_TRUE(table->InsertTuple(MakeTuple('d'), rid_d, t3));
+  ASSERT_TRUE(table->UpdateTuple(MakeTuple('C'), rid_c, t3));
+  ASSERT_TRUE(table->MarkDelete(rid_a, t3));
+  ASSERT_NE(INVALID_LSN, checkpoint_manager->Checkpoint());
+  ASSERT_TRUE(table->InsertTuple(MakeTuple('e'), rid_e, t3));
+
+  // crash: log out, pages dirty since checkpoint 1 not
+  delete checkpoint_manager;
+  log_manager->StopFlushThread();
+  delete table;
+  delete t3;
+  delete txn_manager;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+
+  // reopen n recover
+  disk_manager = new DiskManager("test.db");
+  log_manager = new LogManager(disk_manager);
+  bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  std::vector<LogRecord> checkpoint_records =
+      ReadLogRecords(disk_manager, 0, 0);
+  ASSERT_LT(checkpoint_1, static_cast<lsn_t>(checkpoint_records.size()));
+  EXPECT_EQ(LogRecordType::BEGIN_CHECKPOINT,
+            checkpoint_records[checkpoint_1].GetLogRecordType());
+  lsn_t end_lsn = log_manager->GetNextLSN();
+
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm, log_manager);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  // redo from checkpoint 1, not the log start / the last checkpoint
+  EXPECT_EQ(checkpoint_1, log_recovery->GetRedoLSN());
+  int64_t redo_offset = 0;
+  for (lsn_t lsn = 0; lsn < checkpoint_1; lsn++) {
+    redo_offset += checkpoint_records[lsn].GetSize();
+  }
+  EXPECT_LT(0, redo_offset);
+  EXPECT_EQ(redo_offset, log_recovery->GetRedoOffset());
+  delete log_recovery;
+
+  // t1 n t2 in, t3 out
+  Tuple tuple;
+  ASSERT_TRUE(ReadTuple(bpm, rid_a, tuple));
+  EXPECT_TRUE(SameData(MakeTuple('A'), tuple));
+  EXPECT_FALSE(ReadTuple(bpm, rid_b, tuple));
+  for (auto &rid : filler_rids) {
+    ASSERT_TRUE(ReadTuple(bpm, rid, tuple));
+    EXPECT_TRUE(SameData(MakeTuple('f'), tuple));
+  }
+  ASSERT_TRUE(ReadTuple(bpm, rid_c, tuple));
+  EXPECT_TRUE(SameData(MakeTuple('f'), tuple));
+  EXPECT_FALSE(ReadTuple(bpm, rid_d, tuple));
+  EXPECT_FALSE(ReadTuple(bpm, rid_e, tuple));
+  TablePage *first_page =
+      static_cast<TablePage *>(bpm->FetchPage(first_page_id));
+  ASSERT_NE(nullptr, first_page);
+  EXPECT_EQ(rid_c.GetPageId(), first_page->GetNextPageId());
+  bpm->UnpinPage(first_page_id, false);
+
+  // t3's changes undone in the log too, then ended
+  std::vector<LogRecord> undo_records =
+      ReadLogRecords(disk_manager, 0, 0);
+  ASSERT_EQ(end_lsn + 5, static_cast<lsn_t>(undo_records.size()));
+  std::vector<LogRecordType> undo_types;
+  for (size_t i = end_lsn; i < undo_records.size(); i++) {
+    EXPECT_EQ(loser, undo_records[i].GetTxnId());
+    undo_types.push_back(undo_records[i].GetLogRecordType());
+  }
+  EXPECT_EQ((std::vector<LogRecordType>{
+                LogRecordType::APPLYDELETE, LogRecordType::ROLLBACKDELETE,
+                LogRecordType::UPDATE, LogRecordType::APPLYDELETE,
+                LogRecordType::ABORT}),
+            undo_types);
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+
+  // recovering again: nothing left to undo
+  disk_manager = new DiskManager("test.db");
+  log_manager = new LogManager(disk_manager);
+  bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  end_lsn = log_manager->GetNextLSN();
+  log_recovery = new LogRecovery(disk_manager, bpm, log_manager);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  EXPECT_EQ(end_lsn, log_manager->GetNextLSN());
+  ASSERT_TRUE(ReadTuple(bpm, rid_a, tuple));
+  EXPECT_TRUE(SameData(MakeTuple('A'), tuple));
+  EXPECT_FALSE(ReadTuple(bpm, rid_e, tuple));
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -5,19 +5,22 @@
 #include "page/header_page.h"
 #include "gtest/gtest.h"
 
-// NOTE: when you running this test, make sure page size(config.h) is at least
-// 4096
 namespace cmudb {
 
 TEST(HeaderPageTest, UnitTest) {
-  DiskManager *disk_manager = new DiskManager("test.db");
+  // 27 records need a bigger header page than the default
+  DiskManager *disk_manager = new DiskManager("test.db", 4096);
   BufferPoolManager *buffer_pool_manager =
       new BufferPoolManager(20, disk_manager);
   page_id_t header_page_id;
   HeaderPage *page =
       static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
   ASSERT_NE(nullptr, page);
-  page->Init();
+  EXPECT_FALSE(page->IsSupportedFormat());
+  page->Init(20);
+  EXPECT_EQ(4096, page->GetPageSize());
+  EXPECT_EQ(20, page->GetPoolSize());
+  EXPECT_TRUE(page->IsSupportedFormat());
 
   for (int i = 1; i < 28; i++) {
     std::string name = std::to_string(i);
@@ -55,4 +58,95 @@ TEST(HeaderPageTest, UnitTest) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(HeaderPageTest, TablespaceTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  page_id_t header_page_id;
+  HeaderPage *page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_NE(nullptr, page);
+  page->Init(20);
+  EXPECT_EQ(0, page->GetTablespaceCount());
+
+  EXPECT_EQ(true, page->InsertTablespace(1, "/data/hot/index.db"));
+  EXPECT_EQ(true, page->InsertTablespace(2, "cold.db"));
+  EXPECT_EQ(false, page->InsertTablespace(2, "other.db"));
+  EXPECT_EQ(false, page->InsertTablespace(3, "cold.db"));
+  EXPECT_EQ(2, page->GetTablespaceCount());
+  int tablespace_id;
+  std::string path;
+  EXPECT_EQ(true, page->GetTablespaceId("cold.db", tablespace_id));
+  EXPECT_EQ(2, tablespace_id);
+  EXPECT_EQ(false, page->GetTablespaceId("none.db", tablespace_id));
+  page->GetTablespace(0, tablespace_id, path);
+  EXPECT_EQ(1, tablespace_id);
+  EXPECT_EQ("/data/hot/index.db", path);
+
+  // records n tablespaces share the page, from both ends
+  int num_records = 0;
+  while (page->InsertRecord(std::to_string(num_records), num_records + 1)) {
+    num_records++;
+  }
+  EXPECT_EQ((PAGE_SIZE - 36 - 4 - PAGE_CHECKSUM_SIZE -
+             2 * TABLESPACE_RECORD_SIZE) / 36,
+            num_records);
+  EXPECT_EQ(false, page->InsertTablespace(3, "full.db"));
+  page_id_t root_id;
+  EXPECT_EQ(true, page->GetRootId(std::to_string(num_records - 1), root_id));
+  EXPECT_EQ(num_records, root_id);
+  EXPECT_EQ(true, page->GetTablespaceId("/data/hot/index.db", tablespace_id));
+  EXPECT_EQ(1, tablespace_id);
+
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+  delete buffer_pool_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
+
+TEST(HeaderPageTest, MasterRecordTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  page_id_t header_page_id;
+  HeaderPage *page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_NE(nullptr, page);
+  page->Init(20);
+  EXPECT_EQ(true, page->InsertRecord("table", 7));
+
+  // no checkpoint == log start
+  lsn_t checkpoint_lsn, redo_lsn;
+  int64_t checkpoint_offset, redo_offset;
+  page->GetMasterRecord(checkpoint_lsn, checkpoint_offset, redo_lsn,
+                        redo_offset);
+  EXPECT_EQ(0, checkpoint_lsn);
+  EXPECT_EQ(0, checkpoint_offset);
+  EXPECT_EQ(0, redo_lsn);
+  EXPECT_EQ(0, redo_offset);
+
+  // offsets past 4GB, records n parameters untouched
+  page->SetMasterRecord(1000, 5LL << 32, 900, 123456);
+  page->GetMasterRecord(checkpoint_lsn, checkpoint_offset, redo_lsn,
+                        redo_offset);
+  EXPECT_EQ(1000, checkpoint_lsn);
+  EXPECT_EQ(5LL << 32, checkpoint_offset);
+  EXPECT_EQ(900, redo_lsn);
+  EXPECT_EQ(123456, redo_offset);
+  page_id_t root_id;
+  EXPECT_EQ(true, page->GetRootId("table", root_id));
+  EXPECT_EQ(7, root_id);
+  EXPECT_EQ(20, page->GetPoolSize());
+  EXPECT_EQ(PAGE_SIZE, page->GetPageSize());
+
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+  delete buffer_pool_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+}
 } // namespace cmudb